@@ -13,6 +13,62 @@
 #include <assert.h>
 
 
+/*
+ *
+ * Helpers.
+ *
+ */
+
+/*!
+ * Binary search over the timestamps of a fifo, which are newest first when
+ * walked from @p latest. Returns the index of the first sample, counting from
+ * the newest, that is older than @p ts_ns, or as old if @p or_equal is set.
+ * Returns @p num if there is no such sample.
+ */
+static size_t
+find_first_older(const uint64_t *timestamps_ns, size_t num, size_t latest, uint64_t ts_ns, bool or_equal)
+{
+	size_t lo = 0;
+	size_t hi = num;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		uint64_t mid_ns = timestamps_ns[(latest + mid) % num];
+
+		if (mid_ns < ts_ns || (or_equal && mid_ns == ts_ns)) {
+			hi = mid;
+		} else {
+			lo = mid + 1;
+		}
+	}
+
+	return lo;
+}
+
+/*!
+ * The samples between @p start_ns and @p stop_ns, inclusive, are those at
+ * index @p out_first up to but not including @p out_end.
+ */
+static void
+find_window(const uint64_t *timestamps_ns,
+            size_t num,
+            size_t latest,
+            uint64_t start_ns,
+            uint64_t stop_ns,
+            size_t *out_first,
+            size_t *out_end)
+{
+	// Error, skip averaging.
+	if (start_ns > stop_ns) {
+		*out_first = *out_end = 0;
+		return;
+	}
+
+	*out_first = find_first_older(timestamps_ns, num, latest, stop_ns, true);
+	*out_end = find_first_older(timestamps_ns, num, latest, start_ns, false);
+}
+
+
 /*
  *
  * Filter fifo vec3_f32.
@@ -25,6 +81,18 @@ struct m_ff_vec3_f32
 	size_t latest;
 	struct xrt_vec3 *samples;
 	uint64_t *timestamps_ns;
+
+	/*!
+	 * Running sum of all samples pushed up to and including the one in the
+	 * same slot, the sum of any run of samples is then one subtraction.
+	 */
+	struct xrt_vec3_f64 *sums;
+
+	//! Running sum before the oldest sample still in the fifo.
+	struct xrt_vec3_f64 base;
+
+	//! Pushes since @ref base was last subtracted from all sums.
+	size_t pushes_since_rebase;
 };
 
 
@@ -39,10 +107,28 @@ vec3_f32_init(struct m_ff_vec3_f32 *ff, size_t num)
 {
 	ff->samples = U_TYPED_ARRAY_CALLOC(struct xrt_vec3, num);
 	ff->timestamps_ns = U_TYPED_ARRAY_CALLOC(uint64_t, num);
+	ff->sums = U_TYPED_ARRAY_CALLOC(struct xrt_vec3_f64, num);
 	ff->num = num;
 	ff->latest = 0;
 }
 
+/*!
+ * Keeps the running sums from growing without end, which would lose
+ * precision, costs one pass over the fifo every @ref num pushes.
+ */
+static void
+vec3_f32_rebase(struct m_ff_vec3_f32 *ff)
+{
+	for (size_t i = 0; i < ff->num; i++) {
+		ff->sums[i].x -= ff->base.x;
+		ff->sums[i].y -= ff->base.y;
+		ff->sums[i].z -= ff->base.z;
+	}
+
+	ff->base = (struct xrt_vec3_f64){0, 0, 0};
+	ff->pushes_since_rebase = 0;
+}
+
 static void
 vec3_f32_destroy(struct m_ff_vec3_f32 *ff)
 {
@@ -56,6 +142,11 @@ vec3_f32_destroy(struct m_ff_vec3_f32 *ff)
 		ff->timestamps_ns = NULL;
 	}
 
+	if (ff->sums != NULL) {
+		free(ff->sums);
+		ff->sums = NULL;
+	}
+
 	ff->num = 0;
 	ff->latest = 0;
 }
@@ -99,12 +190,24 @@ m_ff_vec3_f32_push(struct m_ff_vec3_f32 *ff, const struct xrt_vec3 *sample, uint
 {
 	assert(ff->timestamps_ns[ff->latest] <= timestamp_ns);
 
+	struct xrt_vec3_f64 prev = ff->sums[ff->latest];
+
 	// We write samples backwards in the queue.
 	size_t i = ff->latest == 0 ? ff->num - 1 : --ff->latest;
 	ff->latest = i;
 
+	// The slot held the oldest sample, it's now before the start of the fifo.
+	ff->base = ff->sums[i];
+
 	ff->samples[i] = *sample;
 	ff->timestamps_ns[i] = timestamp_ns;
+	ff->sums[i].x = prev.x + sample->x;
+	ff->sums[i].y = prev.y + sample->y;
+	ff->sums[i].z = prev.z + sample->z;
+
+	if (++ff->pushes_since_rebase >= ff->num) {
+		vec3_f32_rebase(ff);
+	}
 }
 
 bool
@@ -122,52 +225,63 @@ m_ff_vec3_f32_get(struct m_ff_vec3_f32 *ff, size_t num, struct xrt_vec3 *out_sam
 }
 
 size_t
-m_ff_vec3_f32_filter(struct m_ff_vec3_f32 *ff, uint64_t start_ns, uint64_t stop_ns, struct xrt_vec3 *out_average)
+m_ff_vec3_f32_get_batch(struct m_ff_vec3_f32 *ff,
+                        size_t first,
+                        size_t count,
+                        float *out_x,
+                        float *out_y,
+                        float *out_z,
+                        uint64_t *out_timestamps_ns)
 {
-	size_t num_sampled = 0;
-	size_t count = 0;
-	// Use double precision internally.
-	double x = 0;
-	double y = 0;
-	double z = 0;
-
-	// Error, skip averaging.
-	if (start_ns > stop_ns) {
-		count = ff->num;
+	if (first >= ff->num) {
+		return 0;
+	}
+	if (count > ff->num - first) {
+		count = ff->num - first;
 	}
 
-	while (count < ff->num) {
-		size_t pos = (ff->latest + count) % ff->num;
+	size_t pos = (ff->latest + first) % ff->num;
+	for (size_t i = 0; i < count; i++) {
+		out_x[i] = ff->samples[pos].x;
+		out_y[i] = ff->samples[pos].y;
+		out_z[i] = ff->samples[pos].z;
+		out_timestamps_ns[i] = ff->timestamps_ns[pos];
 
-		// We have not yet reached where to start.
-		if (ff->timestamps_ns[pos] > stop_ns) {
-			count++;
-			continue;
+		if (++pos == ff->num) {
+			pos = 0;
 		}
+	}
 
-		// If the sample is before the start we have reach the end.
-		if (ff->timestamps_ns[pos] < start_ns) {
-			count++;
-			break;
-		}
+	return count;
+}
 
-		x += ff->samples[pos].x;
-		y += ff->samples[pos].y;
-		z += ff->samples[pos].z;
-		num_sampled++;
-		count++;
-	}
+size_t
+m_ff_vec3_f32_count_since(struct m_ff_vec3_f32 *ff, uint64_t start_ns)
+{
+	return find_first_older(ff->timestamps_ns, ff->num, ff->latest, start_ns, false);
+}
+
+size_t
+m_ff_vec3_f32_filter(struct m_ff_vec3_f32 *ff, uint64_t start_ns, uint64_t stop_ns, struct xrt_vec3 *out_average)
+{
+	size_t first = 0;
+	size_t end = 0;
+	find_window(ff->timestamps_ns, ff->num, ff->latest, start_ns, stop_ns, &first, &end);
 
 	// Avoid division by zero.
-	if (num_sampled > 0) {
-		x /= num_sampled;
-		y /= num_sampled;
-		z /= num_sampled;
+	if (first >= end) {
+		*out_average = (struct xrt_vec3){0, 0, 0};
+		return 0;
 	}
 
-	out_average->x = (float)x;
-	out_average->y = (float)y;
-	out_average->z = (float)z;
+	// Sum of the samples from first to end, the newest to the oldest.
+	struct xrt_vec3_f64 newest = ff->sums[(ff->latest + first) % ff->num];
+	struct xrt_vec3_f64 before = end < ff->num ? ff->sums[(ff->latest + end) % ff->num] : ff->base;
+	size_t num_sampled = end - first;
+
+	out_average->x = (float)((newest.x - before.x) / num_sampled);
+	out_average->y = (float)((newest.y - before.y) / num_sampled);
+	out_average->z = (float)((newest.z - before.z) / num_sampled);
 
 	return num_sampled;
 }
@@ -185,6 +299,11 @@ struct m_ff_f64
 	size_t latest;
 	double *samples;
 	uint64_t *timestamps_ns;
+
+	//! Same as @ref m_ff_vec3_f32::sums.
+	double *sums;
+	double base;
+	size_t pushes_since_rebase;
 };
 
 
@@ -199,10 +318,22 @@ ff_f64_init(struct m_ff_f64 *ff, size_t num)
 {
 	ff->samples = U_TYPED_ARRAY_CALLOC(double, num);
 	ff->timestamps_ns = U_TYPED_ARRAY_CALLOC(uint64_t, num);
+	ff->sums = U_TYPED_ARRAY_CALLOC(double, num);
 	ff->num = num;
 	ff->latest = 0;
 }
 
+static void
+ff_f64_rebase(struct m_ff_f64 *ff)
+{
+	for (size_t i = 0; i < ff->num; i++) {
+		ff->sums[i] -= ff->base;
+	}
+
+	ff->base = 0;
+	ff->pushes_since_rebase = 0;
+}
+
 static void
 ff_f64_destroy(struct m_ff_f64 *ff)
 {
@@ -216,6 +347,11 @@ ff_f64_destroy(struct m_ff_f64 *ff)
 		ff->timestamps_ns = NULL;
 	}
 
+	if (ff->sums != NULL) {
+		free(ff->sums);
+		ff->sums = NULL;
+	}
+
 	ff->num = 0;
 	ff->latest = 0;
 }
@@ -259,12 +395,22 @@ m_ff_f64_push(struct m_ff_f64 *ff, const double *sample, uint64_t timestamp_ns)
 {
 	assert(ff->timestamps_ns[ff->latest] <= timestamp_ns);
 
+	double prev = ff->sums[ff->latest];
+
 	// We write samples backwards in the queue.
 	size_t i = ff->latest == 0 ? ff->num - 1 : --ff->latest;
 	ff->latest = i;
 
+	// The slot held the oldest sample, it's now before the start of the fifo.
+	ff->base = ff->sums[i];
+
 	ff->samples[i] = *sample;
 	ff->timestamps_ns[i] = timestamp_ns;
+	ff->sums[i] = prev + *sample;
+
+	if (++ff->pushes_since_rebase >= ff->num) {
+		ff_f64_rebase(ff);
+	}
 }
 
 bool
@@ -284,41 +430,21 @@ m_ff_f64_get(struct m_ff_f64 *ff, size_t num, double *out_sample, uint64_t *out_
 size_t
 m_ff_f64_filter(struct m_ff_f64 *ff, uint64_t start_ns, uint64_t stop_ns, double *out_average)
 {
-	size_t num_sampled = 0;
-	size_t count = 0;
-	double val = 0;
-
-	// Error, skip averaging.
-	if (start_ns > stop_ns) {
-		count = ff->num;
-	}
-
-	while (count < ff->num) {
-		size_t pos = (ff->latest + count) % ff->num;
-
-		// We have not yet reached where to start.
-		if (ff->timestamps_ns[pos] > stop_ns) {
-			count++;
-			continue;
-		}
-
-		// If the sample is before the start we have reach the end.
-		if (ff->timestamps_ns[pos] < start_ns) {
-			count++;
-			break;
-		}
-
-		val += ff->samples[pos];
-		num_sampled++;
-		count++;
-	}
+	size_t first = 0;
+	size_t end = 0;
+	find_window(ff->timestamps_ns, ff->num, ff->latest, start_ns, stop_ns, &first, &end);
 
 	// Avoid division by zero.
-	if (num_sampled > 0) {
-		val /= num_sampled;
+	if (first >= end) {
+		*out_average = 0;
+		return 0;
 	}
 
-	*out_average = val;
+	double newest = ff->sums[(ff->latest + first) % ff->num];
+	double before = end < ff->num ? ff->sums[(ff->latest + end) % ff->num] : ff->base;
+	size_t num_sampled = end - first;
+
+	*out_average = (newest - before) / num_sampled;
 
 	return num_sampled;
 }
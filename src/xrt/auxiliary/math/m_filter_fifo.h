@@ -52,11 +52,37 @@ m_ff_vec3_f32_push(struct m_ff_vec3_f32 *ff, const struct xrt_vec3 *sample, uint
 bool
 m_ff_vec3_f32_get(struct m_ff_vec3_f32 *ff, size_t num, struct xrt_vec3 *out_sample, uint64_t *out_timestamp_ns);
 
+/*!
+ * Copies up to @p count samples, starting at index @p first, into separate
+ * arrays for each component, indexed like @ref m_ff_vec3_f32_get. Cheaper
+ * than calling that function for each sample when walking many of them.
+ *
+ * @return The number of samples copied, less than @p count if the fifo ran out.
+ */
+size_t
+m_ff_vec3_f32_get_batch(struct m_ff_vec3_f32 *ff,
+                        size_t first,
+                        size_t count,
+                        float *out_x,
+                        float *out_y,
+                        float *out_z,
+                        uint64_t *out_timestamps_ns);
+
+/*!
+ * Returns the number of samples at or after @p start_ns, these are the
+ * indices from zero up to the returned value. Uses a binary search.
+ */
+size_t
+m_ff_vec3_f32_count_since(struct m_ff_vec3_f32 *ff, uint64_t start_ns);
+
 /*!
  * Averages all samples in the fifo between the two timepoints, returns number
  * of samples sampled, if no samples was found between the timpoints returns 0
  * and sets @p out_average to all zeros.
  *
+ * Running sums are kept as samples are pushed, so this is a binary search for
+ * each end of the window and does not depend on the number of samples in it.
+ *
  * @param ff          Filter fifo to search in.
  * @param start_ns    Timepoint furthest in the past, to start searching for
  *                    samples.
@@ -104,6 +130,9 @@ m_ff_f64_get(struct m_ff_f64 *ff, size_t num, double *out_sample, uint64_t *out_
  * of samples sampled, if no samples was found between the timpoints returns 0
  * and sets @p out_average to all zeros.
  *
+ * Running sums are kept as samples are pushed, so this is a binary search for
+ * each end of the window and does not depend on the number of samples in it.
+ *
  * @param ff          Filter fifo to search in.
  * @param start_ns    Timepoint furthest in the past, to start searching for
  *                    samples.
@@ -171,6 +200,17 @@ public:
 		return m_ff_vec3_f32_get(mFifoPtr, num, out_sample, out_timestamp_ns);
 	}
 
+	/*!
+	 * @copydoc m_ff_vec3_f32_count_since
+	 *
+	 * Wrapper for @ref m_ff_vec3_f32_count_since.
+	 */
+	inline size_t
+	countSince(uint64_t start_ns)
+	{
+		return m_ff_vec3_f32_count_since(mFifoPtr, start_ns);
+	}
+
 	/*!
 	 * @copydoc m_ff_vec3_f32_filter
 	 *
@@ -0,0 +1,125 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Incremental IMU preintegration on top of a base pose.
+ * @ingroup aux_math
+ */
+
+#include "m_api.h"
+#include "m_vec3.h"
+#include "m_imu_preintegration.h"
+
+#include "util/u_time.h"
+
+
+void
+m_imu_preintegration_reset(struct m_imu_preintegration *pi, int64_t base_ts)
+{
+	*pi = (struct m_imu_preintegration){
+	    .base_ts = base_ts,
+	    .last_ts = base_ts,
+	    .sample_count = 0,
+	    .delta_orientation = XRT_QUAT_IDENTITY,
+	};
+}
+
+void
+m_imu_preintegration_integrate(struct m_imu_preintegration *pi,
+                               int64_t ts,
+                               const struct xrt_vec3 *accel,
+                               const struct xrt_vec3 *gyro)
+{
+	if (ts < pi->last_ts) {
+		return;
+	}
+
+	float dt = (float)time_ns_to_s(ts - pi->last_ts);
+	pi->last_ts = ts;
+
+	// Integrate gyroscope
+	struct xrt_quat angvel_delta;
+	struct xrt_vec3 scaled_half_g = m_vec3_mul_scalar(*gyro, dt * 0.5f);
+	math_quat_exp(&scaled_half_g, &angvel_delta);
+	math_quat_rotate(&pi->delta_orientation, &angvel_delta, &pi->delta_orientation);
+
+	// Integrate accelerometer, in the base body frame.
+	struct xrt_vec3 body_accel;
+	math_quat_rotate_vec3(&pi->delta_orientation, accel, &body_accel);
+	pi->delta_velocity = m_vec3_add(pi->delta_velocity, m_vec3_mul_scalar(body_accel, dt));
+	pi->delta_position = m_vec3_add(pi->delta_position, m_vec3_mul_scalar(pi->delta_velocity, dt));
+	pi->delta_position = m_vec3_add(pi->delta_position, m_vec3_mul_scalar(body_accel, dt * dt * 0.5f));
+
+	/*
+	 * The gravity correction is constant in world space, its velocity is
+	 * correction * total_s, so each step adds correction times the sum below
+	 * to the position, same as the accelerometer part above.
+	 */
+	pi->total_s += dt;
+	pi->gravity_position_s2 += pi->total_s * dt + dt * dt * 0.5;
+
+	pi->last_gyro = *gyro;
+	pi->last_accel = *accel;
+	pi->sample_count++;
+}
+
+void
+m_imu_preintegration_integrate_interpolated(struct m_imu_preintegration *pi,
+                                            int64_t ts,
+                                            int64_t next_ts,
+                                            const struct xrt_vec3 *next_accel,
+                                            const struct xrt_vec3 *next_gyro)
+{
+	if (ts >= next_ts || pi->sample_count == 0) {
+		// Nothing to interpolate from (or to), hold the next sample.
+		m_imu_preintegration_integrate(pi, ts, next_accel, next_gyro);
+		return;
+	}
+
+	float amount = (float)(ts - pi->last_ts) / (float)(next_ts - pi->last_ts);
+
+	struct xrt_vec3 accel = m_vec3_lerp(pi->last_accel, *next_accel, amount);
+	struct xrt_vec3 gyro = m_vec3_lerp(pi->last_gyro, *next_gyro, amount);
+
+	m_imu_preintegration_integrate(pi, ts, &accel, &gyro);
+}
+
+void
+m_imu_preintegration_apply(const struct m_imu_preintegration *pi,
+                           const struct xrt_space_relation *base_rel,
+                           const struct xrt_vec3 *gravity_correction,
+                           struct xrt_space_relation *out_rel)
+{
+	*out_rel = *base_rel;
+
+	if (pi->sample_count == 0) {
+		return;
+	}
+
+	const struct xrt_quat base_o = base_rel->pose.orientation;
+	const struct xrt_vec3 base_v = base_rel->linear_velocity;
+	const float total_s = (float)pi->total_s;
+	const float gravity_s2 = (float)pi->gravity_position_s2;
+
+	// Orientation and angular velocity
+	struct xrt_quat *o = &out_rel->pose.orientation;
+	math_quat_rotate(&base_o, &pi->delta_orientation, o);
+	math_quat_rotate_derivative(o, &pi->last_gyro, &out_rel->angular_velocity);
+
+	// Linear velocity
+	struct xrt_vec3 dv;
+	math_quat_rotate_vec3(&base_o, &pi->delta_velocity, &dv);
+	struct xrt_vec3 v = base_v;
+	v = m_vec3_add(v, dv);
+	v = m_vec3_add(v, m_vec3_mul_scalar(*gravity_correction, total_s));
+	out_rel->linear_velocity = v;
+
+	// Position
+	struct xrt_vec3 dp;
+	math_quat_rotate_vec3(&base_o, &pi->delta_position, &dp);
+	struct xrt_vec3 p = base_rel->pose.position;
+	p = m_vec3_add(p, m_vec3_mul_scalar(base_v, total_s));
+	p = m_vec3_add(p, dp);
+	p = m_vec3_add(p, m_vec3_mul_scalar(*gravity_correction, gravity_s2));
+	out_rel->pose.position = p;
+}
@@ -0,0 +1,117 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Incremental IMU preintegration on top of a base pose.
+ * @ingroup aux_math
+ */
+
+#pragma once
+
+#include "xrt/xrt_defines.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*!
+ * Accumulates IMU samples relative to a base pose at @ref base_ts, without
+ * having to know the base pose itself. Samples are folded in as they arrive,
+ * so getting the integrated pose is a constant amount of work no matter how
+ * many samples there are since the base pose.
+ *
+ * The integration is the same as naively stepping a world space relation one
+ * sample at a time: rotate by the gyro, then add the rotated accelerometer
+ * and gravity correction to the velocity and position. Everything that does
+ * not depend on the base pose is kept in the base body frame, gravity and the
+ * base velocity are folded in by @ref m_imu_preintegration_apply.
+ *
+ * @ingroup aux_math
+ */
+struct m_imu_preintegration
+{
+	//! Timestamp of the pose the samples are integrated on top of.
+	int64_t base_ts;
+
+	//! Timestamp of the last integrated sample, @ref base_ts if none.
+	int64_t last_ts;
+
+	//! Number of samples integrated since the last reset.
+	uint32_t sample_count;
+
+	//! Rotation from the base orientation to the current one.
+	struct xrt_quat delta_orientation;
+
+	//! Velocity change from the accelerometer only, base body frame.
+	struct xrt_vec3 delta_velocity;
+
+	//! Position change from the accelerometer only, base body frame.
+	struct xrt_vec3 delta_position;
+
+	//! Seconds since @ref base_ts of the last sample.
+	double total_s;
+
+	//! Factor for the gravity correction's effect on the position, in s^2.
+	double gravity_position_s2;
+
+	//! Last integrated gyro sample, for the angular velocity.
+	struct xrt_vec3 last_gyro;
+
+	//! Last integrated accelerometer sample.
+	struct xrt_vec3 last_accel;
+};
+
+/*!
+ * Starts over on top of a new base pose at @p base_ts.
+ *
+ * @ingroup aux_math
+ */
+void
+m_imu_preintegration_reset(struct m_imu_preintegration *pi, int64_t base_ts);
+
+/*!
+ * Integrates a sample at @p ts, the samples before @p ts are assumed to hold
+ * from the previous sample (or @ref m_imu_preintegration::base_ts) up to it.
+ * Samples older than the last integrated one are ignored.
+ *
+ * @ingroup aux_math
+ */
+void
+m_imu_preintegration_integrate(struct m_imu_preintegration *pi,
+                               int64_t ts,
+                               const struct xrt_vec3 *accel,
+                               const struct xrt_vec3 *gyro);
+
+/*!
+ * Integrates a sample at @p ts that lies between the last integrated sample
+ * and the next one at @p next_ts, linearly interpolating the values of the
+ * two samples. Used to stop integrating in between two samples.
+ *
+ * @ingroup aux_math
+ */
+void
+m_imu_preintegration_integrate_interpolated(struct m_imu_preintegration *pi,
+                                            int64_t ts,
+                                            int64_t next_ts,
+                                            const struct xrt_vec3 *next_accel,
+                                            const struct xrt_vec3 *next_gyro);
+
+/*!
+ * Applies the integrated samples on top of @p base_rel, which is the pose at
+ * @ref m_imu_preintegration::base_ts, giving the relation at
+ * @ref m_imu_preintegration::last_ts.
+ *
+ * @ingroup aux_math
+ */
+void
+m_imu_preintegration_apply(const struct m_imu_preintegration *pi,
+                           const struct xrt_space_relation *base_rel,
+                           const struct xrt_vec3 *gravity_correction,
+                           struct xrt_space_relation *out_rel);
+
+
+#ifdef __cplusplus
+}
+#endif
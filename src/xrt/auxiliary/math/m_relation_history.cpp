@@ -20,10 +20,10 @@
 #include "util/u_trace_marker.h"
 #include "xrt/xrt_defines.h"
 #include "os/os_threading.h"
-#include "util/u_template_historybuf.hpp"
 
+#include <array>
+#include <atomic>
 #include <memory>
-#include <algorithm>
 #include <cstring>
 #include <stdio.h>
 #include <stdlib.h>
@@ -31,7 +31,6 @@
 #include <assert.h>
 #include <mutex>
 
-using namespace xrt::auxiliary::util;
 namespace os = xrt::auxiliary::os;
 
 struct relation_history_entry
@@ -42,13 +41,109 @@ struct relation_history_entry
 
 static constexpr size_t BufLen = 4096;
 
+/*!
+ * The history is a fixed ring of entries addressed by an ever increasing
+ * absolute index, protected by a sequence counter (seqlock).
+ *
+ * There is only ever one writer at a time, writers are serialised by
+ * @ref write_mutex, and the writer makes the sequence odd while it touches
+ * the ring. Readers never take any lock: they read the sequence, copy out
+ * what they need and then check that the sequence did not change, retrying
+ * if it did. Because indices are absolute and reduced modulo @ref BufLen,
+ * a reader that races with the writer can only ever see stale or torn
+ * values inside the ring, never go out of bounds, and such a read is always
+ * thrown away by the sequence check.
+ */
 struct m_relation_history
 {
-	HistoryBuffer<struct relation_history_entry, BufLen> impl;
-	mutable os::Mutex mutex;
+	std::array<struct relation_history_entry, BufLen> entries{};
+
+	//! Odd while the writer is modifying the ring.
+	std::atomic<uint64_t> sequence{0};
+
+	//! Absolute index of the oldest valid entry.
+	std::atomic<uint64_t> tail{0};
+
+	//! Absolute index one past the newest valid entry.
+	std::atomic<uint64_t> head{0};
+
+	//! Serialises writers (push and clear), readers never touch it.
+	os::Mutex write_mutex;
 };
 
 
+/*
+ *
+ * Seqlock helpers.
+ *
+ */
+
+static inline void
+write_begin(struct m_relation_history *rh)
+{
+	uint64_t seq = rh->sequence.load(std::memory_order_relaxed);
+	rh->sequence.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+static inline void
+write_end(struct m_relation_history *rh)
+{
+	uint64_t seq = rh->sequence.load(std::memory_order_relaxed);
+	rh->sequence.store(seq + 1, std::memory_order_release);
+}
+
+/*!
+ * Calls @p func until it has run without the writer touching the ring at
+ * the same time, @p func must only copy data out and have no side effects
+ * that can't be repeated.
+ */
+template <typename Func>
+static inline void
+read_consistent(const struct m_relation_history *rh, Func &&func)
+{
+	while (true) {
+		uint64_t seq = rh->sequence.load(std::memory_order_acquire);
+		if ((seq & 1) != 0) {
+			// Writer in progress, it only holds it for one entry copy.
+			continue;
+		}
+
+		func();
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (rh->sequence.load(std::memory_order_relaxed) == seq) {
+			return;
+		}
+	}
+}
+
+static inline const struct relation_history_entry &
+entry_at(const struct m_relation_history *rh, uint64_t index)
+{
+	return rh->entries[index % BufLen];
+}
+
+/*!
+ * Read the valid range, only to be called inside of @ref read_consistent,
+ * returns false if the range is empty or torn (will be retried).
+ */
+static inline bool
+read_range(const struct m_relation_history *rh, uint64_t &out_tail, uint64_t &out_head)
+{
+	out_tail = rh->tail.load(std::memory_order_relaxed);
+	out_head = rh->head.load(std::memory_order_relaxed);
+
+	return out_head > out_tail && out_head - out_tail <= BufLen;
+}
+
+
+/*
+ *
+ * 'Exported' functions.
+ *
+ */
+
 void
 m_relation_history_create(struct m_relation_history **rh_ptr)
 {
@@ -63,21 +158,34 @@ m_relation_history_push(struct m_relation_history *rh, struct xrt_space_relation
 	struct relation_history_entry rhe;
 	rhe.relation = *in_relation;
 	rhe.timestamp = timestamp;
-	bool ret = false;
-	std::unique_lock<os::Mutex> lock(rh->mutex);
-	try {
-		// if we aren't empty, we can compare against the latest timestamp.
-		if (rh->impl.empty() || rhe.timestamp > rh->impl.back().timestamp) {
-			// Everything explodes if the timestamps in relation_history aren't monotonically increasing. If
-			// we get a timestamp that's before the most recent timestamp in the buffer, don't put it
-			// in the history.
-			rh->impl.push_back(rhe);
-			ret = true;
-		}
-	} catch (std::exception const &e) {
-		U_LOG_E("Caught exception: %s", e.what());
+
+	std::unique_lock<os::Mutex> lock(rh->write_mutex);
+
+	// Only we write these and we hold the write lock, no need to seqlock.
+	uint64_t tail = rh->tail.load(std::memory_order_relaxed);
+	uint64_t head = rh->head.load(std::memory_order_relaxed);
+
+	// Everything explodes if the timestamps in relation_history aren't monotonically increasing. If
+	// we get a timestamp that's before the most recent timestamp in the buffer, don't put it
+	// in the history.
+	if (head != tail && rhe.timestamp <= entry_at(rh, head - 1).timestamp) {
+		return false;
 	}
-	return ret;
+
+	write_begin(rh);
+
+	rh->entries[head % BufLen] = rhe;
+	head++;
+	if (head - tail > BufLen) {
+		tail = head - BufLen;
+	}
+
+	rh->tail.store(tail, std::memory_order_relaxed);
+	rh->head.store(head, std::memory_order_relaxed);
+
+	write_end(rh);
+
+	return true;
 }
 
 enum m_relation_history_result
@@ -86,98 +194,129 @@ m_relation_history_get(const struct m_relation_history *rh,
                        struct xrt_space_relation *out_relation)
 {
 	XRT_TRACE_MARKER();
-	std::unique_lock<os::Mutex> lock(rh->mutex);
-	try {
-		if (rh->impl.empty() || at_timestamp_ns == 0) {
-			// Do nothing. You push nothing to the buffer you get nothing from the buffer.
-			*out_relation = {};
-			return M_RELATION_HISTORY_RESULT_INVALID;
-		}
-		const auto b = rh->impl.begin();
-		const auto e = rh->impl.end();
-
-		// Find the first element *not less than* our value. the lambda we pass is the comparison
-		// function, to compare against timestamps.
-		const auto it =
-		    std::lower_bound(b, e, at_timestamp_ns, [](const relation_history_entry &rhe, uint64_t timestamp) {
-			    return rhe.timestamp < timestamp;
-		    });
 
-		if (it == e) {
-			// lower bound is at the end:
-			// The desired timestamp is after what our buffer contains.
-			// (pose-prediction)
-			// Output flags match the most recent buffer entry.
-			int64_t diff_prediction_ns = static_cast<int64_t>(at_timestamp_ns) - rh->impl.back().timestamp;
-			double delta_s = time_ns_to_s(diff_prediction_ns);
+	if (at_timestamp_ns == 0) {
+		// Do nothing. You push nothing to the buffer you get nothing from the buffer.
+		*out_relation = {};
+		return M_RELATION_HISTORY_RESULT_INVALID;
+	}
 
-			U_LOG_T("Extrapolating %f s past the back of the buffer!", delta_s);
+	enum m_relation_history_result result;
+	struct relation_history_entry predecessor;
+	struct relation_history_entry successor;
 
-			m_predict_relation(&rh->impl.back().relation, delta_s, out_relation);
-			return M_RELATION_HISTORY_RESULT_PREDICTED;
+	read_consistent(rh, [&] {
+		uint64_t tail;
+		uint64_t head;
+		if (!read_range(rh, tail, head)) {
+			result = M_RELATION_HISTORY_RESULT_INVALID;
+			return;
 		}
-		if (at_timestamp_ns == it->timestamp) {
-			// exact match:
-			// Flags copied directly along with everything else.
-			U_LOG_T("Exact match in the buffer!");
-			*out_relation = it->relation;
-			return M_RELATION_HISTORY_RESULT_EXACT;
+
+		// Find the first element *not less than* our value.
+		uint64_t lo = tail;
+		uint64_t hi = head;
+		while (lo < hi) {
+			uint64_t mid = lo + (hi - lo) / 2;
+			if (entry_at(rh, mid).timestamp < at_timestamp_ns) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
 		}
-		if (it == b) {
+
+		if (lo == head) {
+			// lower bound is at the end:
+			// The desired timestamp is after what our buffer contains.
+			predecessor = entry_at(rh, head - 1);
+			result = M_RELATION_HISTORY_RESULT_PREDICTED;
+		} else if (at_timestamp_ns == entry_at(rh, lo).timestamp) {
+			// exact match.
+			successor = entry_at(rh, lo);
+			result = M_RELATION_HISTORY_RESULT_EXACT;
+		} else if (lo == tail) {
 			// lower bound is at the beginning (and it's not an exact match):
 			// The desired timestamp is before what our buffer contains.
-			// (an edge case where somebody asks for a really old pose and we do our best)
-			// Output flags are the same as the input flags for the history entry we use
-			int64_t diff_prediction_ns = static_cast<int64_t>(at_timestamp_ns) - rh->impl.front().timestamp;
-			double delta_s = time_ns_to_s(diff_prediction_ns);
-			U_LOG_T("Extrapolating %f s before the front of the buffer!", delta_s);
-			m_predict_relation(&rh->impl.front().relation, delta_s, out_relation);
-			return M_RELATION_HISTORY_RESULT_REVERSE_PREDICTED;
+			successor = entry_at(rh, tail);
+			result = M_RELATION_HISTORY_RESULT_REVERSE_PREDICTED;
+		} else {
+			// We precede lo and follow lo - 1 (which we know exists because we already handled
+			// the lo == tail case)
+			predecessor = entry_at(rh, lo - 1);
+			successor = entry_at(rh, lo);
+			result = M_RELATION_HISTORY_RESULT_INTERPOLATED;
 		}
-		U_LOG_T("Interpolating within buffer!");
-
-		// We precede *it and follow *(it - 1) (which we know exists because we already handled
-		// the it = begin() case)
-		const auto &predecessor = *(it - 1);
-		const auto &successor = *it;
-
-		// Do the thing.
-		int64_t diff_before = static_cast<int64_t>(at_timestamp_ns) - predecessor.timestamp;
-		int64_t diff_after = static_cast<int64_t>(successor.timestamp) - at_timestamp_ns;
-
-		float amount_to_lerp = (float)diff_before / (float)(diff_before + diff_after);
-
-		// Copy intersection of relation flags
-		xrt_space_relation result{};
-		result.relation_flags = (enum xrt_space_relation_flags)(predecessor.relation.relation_flags &
-		                                                        successor.relation.relation_flags);
-		// First-order implementation - lerp between the before and after
-		if (0 != (result.relation_flags & XRT_SPACE_RELATION_POSITION_VALID_BIT)) {
-			result.pose.position = m_vec3_lerp(predecessor.relation.pose.position,
-			                                   successor.relation.pose.position, amount_to_lerp);
-		}
-		if (0 != (result.relation_flags & XRT_SPACE_RELATION_ORIENTATION_VALID_BIT)) {
+	});
 
-			math_quat_slerp(&predecessor.relation.pose.orientation, &successor.relation.pose.orientation,
-			                amount_to_lerp, &result.pose.orientation);
-		}
+	// Everything below works on our own copies, no need to hold anything.
+	switch (result) {
+	case M_RELATION_HISTORY_RESULT_INVALID: {
+		*out_relation = {};
+		return result;
+	}
+	case M_RELATION_HISTORY_RESULT_PREDICTED: {
+		// (pose-prediction)
+		// Output flags match the most recent buffer entry.
+		int64_t diff_prediction_ns = static_cast<int64_t>(at_timestamp_ns) - predecessor.timestamp;
+		double delta_s = time_ns_to_s(diff_prediction_ns);
 
-		//! @todo Does interpolating the velocities make any sense?
-		if (0 != (result.relation_flags & XRT_SPACE_RELATION_ANGULAR_VELOCITY_VALID_BIT)) {
-			result.angular_velocity = m_vec3_lerp(predecessor.relation.angular_velocity,
-			                                      successor.relation.angular_velocity, amount_to_lerp);
-		}
-		if (0 != (result.relation_flags & XRT_SPACE_RELATION_LINEAR_VELOCITY_VALID_BIT)) {
-			result.linear_velocity = m_vec3_lerp(predecessor.relation.linear_velocity,
-			                                     successor.relation.linear_velocity, amount_to_lerp);
-		}
-		*out_relation = result;
-		return M_RELATION_HISTORY_RESULT_INTERPOLATED;
+		U_LOG_T("Extrapolating %f s past the back of the buffer!", delta_s);
 
-	} catch (std::exception const &e) {
-		U_LOG_E("Caught exception: %s", e.what());
-		return M_RELATION_HISTORY_RESULT_INVALID;
+		m_predict_relation(&predecessor.relation, delta_s, out_relation);
+		return result;
+	}
+	case M_RELATION_HISTORY_RESULT_EXACT: {
+		// Flags copied directly along with everything else.
+		U_LOG_T("Exact match in the buffer!");
+		*out_relation = successor.relation;
+		return result;
+	}
+	case M_RELATION_HISTORY_RESULT_REVERSE_PREDICTED: {
+		// (an edge case where somebody asks for a really old pose and we do our best)
+		// Output flags are the same as the input flags for the history entry we use
+		int64_t diff_prediction_ns = static_cast<int64_t>(at_timestamp_ns) - successor.timestamp;
+		double delta_s = time_ns_to_s(diff_prediction_ns);
+		U_LOG_T("Extrapolating %f s before the front of the buffer!", delta_s);
+		m_predict_relation(&successor.relation, delta_s, out_relation);
+		return result;
+	}
+	case M_RELATION_HISTORY_RESULT_INTERPOLATED: break;
+	}
+
+	U_LOG_T("Interpolating within buffer!");
+
+	// Do the thing.
+	int64_t diff_before = static_cast<int64_t>(at_timestamp_ns) - predecessor.timestamp;
+	int64_t diff_after = static_cast<int64_t>(successor.timestamp) - at_timestamp_ns;
+
+	float amount_to_lerp = (float)diff_before / (float)(diff_before + diff_after);
+
+	// Copy intersection of relation flags
+	xrt_space_relation relation{};
+	relation.relation_flags = (enum xrt_space_relation_flags)(predecessor.relation.relation_flags &
+	                                                          successor.relation.relation_flags);
+	// First-order implementation - lerp between the before and after
+	if (0 != (relation.relation_flags & XRT_SPACE_RELATION_POSITION_VALID_BIT)) {
+		relation.pose.position =
+		    m_vec3_lerp(predecessor.relation.pose.position, successor.relation.pose.position, amount_to_lerp);
 	}
+	if (0 != (relation.relation_flags & XRT_SPACE_RELATION_ORIENTATION_VALID_BIT)) {
+
+		math_quat_slerp(&predecessor.relation.pose.orientation, &successor.relation.pose.orientation,
+		                amount_to_lerp, &relation.pose.orientation);
+	}
+
+	//! @todo Does interpolating the velocities make any sense?
+	if (0 != (relation.relation_flags & XRT_SPACE_RELATION_ANGULAR_VELOCITY_VALID_BIT)) {
+		relation.angular_velocity = m_vec3_lerp(predecessor.relation.angular_velocity,
+		                                        successor.relation.angular_velocity, amount_to_lerp);
+	}
+	if (0 != (relation.relation_flags & XRT_SPACE_RELATION_LINEAR_VELOCITY_VALID_BIT)) {
+		relation.linear_velocity = m_vec3_lerp(predecessor.relation.linear_velocity,
+		                                       successor.relation.linear_velocity, amount_to_lerp);
+	}
+	*out_relation = relation;
+	return M_RELATION_HISTORY_RESULT_INTERPOLATED;
 }
 
 bool
@@ -232,27 +371,49 @@ m_relation_history_get_latest(const struct m_relation_history *rh,
                               uint64_t *out_time_ns,
                               struct xrt_space_relation *out_relation)
 {
-	std::unique_lock<os::Mutex> lock(rh->mutex);
-	if (rh->impl.empty()) {
+	bool ret;
+	struct relation_history_entry latest;
+
+	read_consistent(rh, [&] {
+		uint64_t tail;
+		uint64_t head;
+		ret = read_range(rh, tail, head);
+		if (ret) {
+			latest = entry_at(rh, head - 1);
+		}
+	});
+
+	if (!ret) {
 		return false;
 	}
-	*out_relation = rh->impl.back().relation;
-	*out_time_ns = rh->impl.back().timestamp;
+
+	*out_relation = latest.relation;
+	*out_time_ns = latest.timestamp;
 	return true;
 }
 
 uint32_t
 m_relation_history_get_size(const struct m_relation_history *rh)
 {
-	std::unique_lock<os::Mutex> lock(rh->mutex);
-	return (uint32_t)rh->impl.size();
+	uint64_t size;
+
+	read_consistent(rh, [&] {
+		uint64_t tail;
+		uint64_t head;
+		size = read_range(rh, tail, head) ? head - tail : 0;
+	});
+
+	return (uint32_t)size;
 }
 
 void
 m_relation_history_clear(struct m_relation_history *rh)
 {
-	std::unique_lock<os::Mutex> lock(rh->mutex);
-	rh->impl.clear();
+	std::unique_lock<os::Mutex> lock(rh->write_mutex);
+
+	write_begin(rh);
+	rh->tail.store(rh->head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	write_end(rh);
 }
 
 void
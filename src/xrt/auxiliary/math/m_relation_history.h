@@ -20,9 +20,10 @@ extern "C" {
 /**
  * @brief Opaque type for storing the history of a space relation in a ring buffer
  *
- * @note Unlike the bare C++ data structure @ref HistoryBuffer this wraps, **this is a thread safe interface**,
- * and is safe for concurrent access from multiple threads.
- * (It is using a simple mutex, not a reader/writer lock, but that is fine until proven to be a bottleneck.)
+ * @note **This is a thread safe interface**, and is safe for concurrent access from multiple threads.
+ * Writers (push and clear) are serialised with a mutex, readers never take a lock and never block on a writer;
+ * they use a sequence counter and retry in the rare case a push happened while they were reading. This
+ * makes it suitable for the common case of one high rate driver thread pushing and many threads querying.
  *
  * @ingroup aux_util
  */
@@ -14,6 +14,7 @@
 #include "math/m_vec3.h"
 #include "math/m_space.h"
 
+#include <math.h>
 #include <stdio.h>
 #include <assert.h>
 
@@ -345,3 +346,214 @@ m_space_relation_interpolate(struct xrt_space_relation *a,
 		out_relation->angular_velocity = m_vec3_lerp(a->angular_velocity, b->angular_velocity, t);
 	}
 }
+
+extern "C" void
+m_relation_set_store(struct m_relation_set *set, uint32_t index, const struct xrt_space_relation *relation)
+{
+	assert(index < M_RELATION_SET_MAX_COUNT);
+
+	// Stored like apply_relation sees the poses.
+	struct xrt_pose pose = XRT_POSE_IDENTITY;
+	make_valid_pose(get_flags(relation), &relation->pose, &pose);
+
+	set->px[index] = pose.position.x;
+	set->py[index] = pose.position.y;
+	set->pz[index] = pose.position.z;
+	set->ox[index] = pose.orientation.x;
+	set->oy[index] = pose.orientation.y;
+	set->oz[index] = pose.orientation.z;
+	set->ow[index] = pose.orientation.w;
+	set->lx[index] = relation->linear_velocity.x;
+	set->ly[index] = relation->linear_velocity.y;
+	set->lz[index] = relation->linear_velocity.z;
+	set->ax[index] = relation->angular_velocity.x;
+	set->ay[index] = relation->angular_velocity.y;
+	set->az[index] = relation->angular_velocity.z;
+	set->flags[index] = relation->relation_flags;
+
+	if (set->count <= index) {
+		set->count = index + 1;
+	}
+}
+
+extern "C" void
+m_relation_set_load(const struct m_relation_set *set, uint32_t index, struct xrt_space_relation *out_relation)
+{
+	assert(index < set->count);
+
+	out_relation->relation_flags = set->flags[index];
+	out_relation->pose.position = {set->px[index], set->py[index], set->pz[index]};
+	out_relation->pose.orientation = {set->ox[index], set->oy[index], set->oz[index], set->ow[index]};
+	out_relation->linear_velocity = {set->lx[index], set->ly[index], set->lz[index]};
+	out_relation->angular_velocity = {set->ax[index], set->ay[index], set->az[index]};
+}
+
+extern "C" void
+m_relation_set_apply(const struct m_relation_set *set,
+                     const struct xrt_space_relation *base,
+                     struct m_relation_set *out_set)
+{
+	const enum xrt_space_relation_flags pose_flags = (enum xrt_space_relation_flags)(
+	    XRT_SPACE_RELATION_POSITION_VALID_BIT | XRT_SPACE_RELATION_ORIENTATION_VALID_BIT);
+
+	const uint32_t count = set->count;
+	out_set->count = count;
+
+	// A base without a pose makes every relation zero, like in a chain.
+	if ((base->relation_flags & pose_flags) == 0) {
+		for (uint32_t i = 0; i < count; i++) {
+			struct xrt_space_relation zero = XRT_SPACE_RELATION_ZERO;
+			m_relation_set_store(out_set, i, &zero);
+		}
+		return;
+	}
+
+	flags bf = get_flags(base);
+	struct xrt_pose base_pose = XRT_POSE_IDENTITY;
+	make_valid_pose(bf, &base->pose, &base_pose);
+
+	// Same upgrade as in apply_relation.
+	if (bf.has_orientation && !bf.has_position) {
+		bf.has_position = true;
+	}
+
+
+	/*
+	 * Flags, per relation, turned into masks for the loop below.
+	 */
+
+	float ori_mask[M_RELATION_SET_MAX_COUNT];
+	float pos_mask[M_RELATION_SET_MAX_COUNT];
+	float lin_mask[M_RELATION_SET_MAX_COUNT];
+	float ang_mask[M_RELATION_SET_MAX_COUNT];
+	enum xrt_space_relation_flags out_flags[M_RELATION_SET_MAX_COUNT];
+
+	for (uint32_t i = 0; i < count; i++) {
+		struct xrt_space_relation a = {};
+		a.relation_flags = set->flags[i];
+		flags af = get_flags(&a);
+
+		// For making the pose valid, before the upgrade just like apply_relation.
+		ori_mask[i] = af.has_orientation ? 1.0f : 0.0f;
+		pos_mask[i] = af.has_position ? 1.0f : 0.0f;
+
+		if (af.has_orientation && !af.has_position) {
+			af.has_position = true;
+		}
+
+		int new_flags = 0;
+		if (af.has_orientation && bf.has_orientation) {
+			new_flags |= XRT_SPACE_RELATION_ORIENTATION_VALID_BIT;
+		}
+		if (af.has_position && bf.has_position) {
+			new_flags |= XRT_SPACE_RELATION_POSITION_VALID_BIT;
+		}
+		if (af.has_tracked_position && bf.has_tracked_position) {
+			new_flags |= XRT_SPACE_RELATION_POSITION_TRACKED_BIT;
+		}
+		if (af.has_tracked_orientation && bf.has_tracked_orientation) {
+			new_flags |= XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT;
+		}
+		if (af.has_linear_velocity && bf.has_linear_velocity) {
+			new_flags |= XRT_SPACE_RELATION_LINEAR_VELOCITY_VALID_BIT;
+		}
+		if (af.has_angular_velocity && bf.has_angular_velocity) {
+			new_flags |= XRT_SPACE_RELATION_ANGULAR_VELOCITY_VALID_BIT;
+		}
+
+		lin_mask[i] = (new_flags & XRT_SPACE_RELATION_LINEAR_VELOCITY_VALID_BIT) != 0 ? 1.0f : 0.0f;
+		ang_mask[i] = (new_flags & XRT_SPACE_RELATION_ANGULAR_VELOCITY_VALID_BIT) != 0 ? 1.0f : 0.0f;
+		out_flags[i] = (enum xrt_space_relation_flags)new_flags;
+	}
+
+
+	/*
+	 * The transform, straight line code so it gets vectorised.
+	 */
+
+	const float qx = base_pose.orientation.x;
+	const float qy = base_pose.orientation.y;
+	const float qz = base_pose.orientation.z;
+	const float qw = base_pose.orientation.w;
+
+	// Rotation matrix of the base, rotates vectors and derivatives alike.
+	const float m00 = 1.0f - 2.0f * (qy * qy + qz * qz);
+	const float m01 = 2.0f * (qx * qy - qz * qw);
+	const float m02 = 2.0f * (qx * qz + qy * qw);
+	const float m10 = 2.0f * (qx * qy + qz * qw);
+	const float m11 = 1.0f - 2.0f * (qx * qx + qz * qz);
+	const float m12 = 2.0f * (qy * qz - qx * qw);
+	const float m20 = 2.0f * (qx * qz - qy * qw);
+	const float m21 = 2.0f * (qy * qz + qx * qw);
+	const float m22 = 1.0f - 2.0f * (qx * qx + qy * qy);
+
+	const struct xrt_vec3 bp = base_pose.position;
+	const struct xrt_vec3 bl = base->linear_velocity;
+	const struct xrt_vec3 ba = base->angular_velocity;
+
+	for (uint32_t i = 0; i < count; i++) {
+		// Invalid parts of the pose are identity, results of earlier applies can have those.
+		float px = set->px[i] * pos_mask[i];
+		float py = set->py[i] * pos_mask[i];
+		float pz = set->pz[i] * pos_mask[i];
+		float ax = set->ox[i] * ori_mask[i];
+		float ay = set->oy[i] * ori_mask[i];
+		float az = set->oz[i] * ori_mask[i];
+		float aw = set->ow[i] * ori_mask[i] + (1.0f - ori_mask[i]);
+
+		// Position rotated into the base space.
+		float rx = m00 * px + m01 * py + m02 * pz;
+		float ry = m10 * px + m11 * py + m12 * pz;
+		float rz = m20 * px + m21 * py + m22 * pz;
+
+		// Orientation, base * relation.
+		float ox = qw * ax + qx * aw + qy * az - qz * ay;
+		float oy = qw * ay - qx * az + qy * aw + qz * ax;
+		float oz = qw * az + qx * ay - qy * ax + qz * aw;
+		float ow = qw * aw - qx * ax - qy * ay - qz * az;
+
+		// Ensure no errors have crept in, like the chain does.
+		float inv_len = 1.0f / sqrtf(ox * ox + oy * oy + oz * oz + ow * ow);
+
+		// Rotated velocities, plus the base's.
+		float lx = m00 * set->lx[i] + m01 * set->ly[i] + m02 * set->lz[i] + bl.x;
+		float ly = m10 * set->lx[i] + m11 * set->ly[i] + m12 * set->lz[i] + bl.y;
+		float lz = m20 * set->lx[i] + m21 * set->ly[i] + m22 * set->lz[i] + bl.z;
+		float wx = m00 * set->ax[i] + m01 * set->ay[i] + m02 * set->az[i] + ba.x;
+		float wy = m10 * set->ax[i] + m11 * set->ay[i] + m12 * set->az[i] + ba.y;
+		float wz = m20 * set->ax[i] + m21 * set->ay[i] + m22 * set->az[i] + ba.z;
+
+		// The base's angular velocity moves the relation's position, the "lever arm".
+		float tx = ba.y * rz - ba.z * ry;
+		float ty = ba.z * rx - ba.x * rz;
+		float tz = ba.x * ry - ba.y * rx;
+
+		out_set->px[i] = rx + bp.x;
+		out_set->py[i] = ry + bp.y;
+		out_set->pz[i] = rz + bp.z;
+		out_set->ox[i] = ox * inv_len;
+		out_set->oy[i] = oy * inv_len;
+		out_set->oz[i] = oz * inv_len;
+		out_set->ow[i] = ow * inv_len;
+		out_set->lx[i] = lx * lin_mask[i] + tx * ang_mask[i];
+		out_set->ly[i] = ly * lin_mask[i] + ty * ang_mask[i];
+		out_set->lz[i] = lz * lin_mask[i] + tz * ang_mask[i];
+		out_set->ax[i] = wx * ang_mask[i];
+		out_set->ay[i] = wy * ang_mask[i];
+		out_set->az[i] = wz * ang_mask[i];
+	}
+
+
+	/*
+	 * Flags, and relations without a pose become zero like in a chain.
+	 */
+
+	for (uint32_t i = 0; i < count; i++) {
+		if ((set->flags[i] & pose_flags) == 0) {
+			struct xrt_space_relation zero = XRT_SPACE_RELATION_ZERO;
+			m_relation_set_store(out_set, i, &zero);
+		} else {
+			out_set->flags[i] = out_flags[i];
+		}
+	}
+}
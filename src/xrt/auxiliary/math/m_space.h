@@ -220,6 +220,67 @@ m_relation_chain_push_inverted_pose_if_not_identity(struct xrt_relation_chain *x
 void
 m_relation_chain_resolve(const struct xrt_relation_chain *xrc, struct xrt_space_relation *out_relation);
 
+
+/*
+ *
+ * Relation set functions.
+ *
+ */
+
+/*!
+ * Max number of relations in a @ref m_relation_set, fits all joints of a hand.
+ */
+#define M_RELATION_SET_MAX_COUNT (32)
+
+/*!
+ * Many relations stored as a structure of arrays, so the same relation can be
+ * applied to all of them at once with @ref m_relation_set_apply. Use
+ * @ref m_relation_set_store and @ref m_relation_set_load to fill and read it.
+ */
+struct m_relation_set
+{
+	uint32_t count;
+
+	float px[M_RELATION_SET_MAX_COUNT], py[M_RELATION_SET_MAX_COUNT], pz[M_RELATION_SET_MAX_COUNT];
+
+	float ox[M_RELATION_SET_MAX_COUNT], oy[M_RELATION_SET_MAX_COUNT], oz[M_RELATION_SET_MAX_COUNT],
+	    ow[M_RELATION_SET_MAX_COUNT];
+
+	float lx[M_RELATION_SET_MAX_COUNT], ly[M_RELATION_SET_MAX_COUNT], lz[M_RELATION_SET_MAX_COUNT];
+
+	float ax[M_RELATION_SET_MAX_COUNT], ay[M_RELATION_SET_MAX_COUNT], az[M_RELATION_SET_MAX_COUNT];
+
+	enum xrt_space_relation_flags flags[M_RELATION_SET_MAX_COUNT];
+};
+
+/*!
+ * Store @p relation at @p index, grows the set's count to include it.
+ *
+ * @public @memberof m_relation_set
+ */
+void
+m_relation_set_store(struct m_relation_set *set, uint32_t index, const struct xrt_space_relation *relation);
+
+/*!
+ * Read the relation at @p index.
+ *
+ * @public @memberof m_relation_set
+ */
+void
+m_relation_set_load(const struct m_relation_set *set, uint32_t index, struct xrt_space_relation *out_relation);
+
+/*!
+ * For every relation in @p set, does the same as resolving a chain with that
+ * relation followed by @p base, but the work on @p base is only done once.
+ * The @p set and @p out_set arguments can be the same.
+ *
+ * @public @memberof m_relation_set
+ */
+void
+m_relation_set_apply(const struct m_relation_set *set,
+                     const struct xrt_space_relation *base,
+                     struct m_relation_set *out_set);
+
 /*!
  * @}
  */
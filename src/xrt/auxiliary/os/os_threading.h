@@ -176,6 +176,39 @@ os_mutex_recursive_destroy(struct os_mutex *om)
 }
 
 
+/*
+ *
+ * Once.
+ *
+ */
+
+/*!
+ * A wrapper around a native once guard, for setting up globals lazily.
+ * Statically initialise it with @ref OS_ONCE_INIT.
+ */
+struct os_once
+{
+	pthread_once_t once;
+};
+
+/*!
+ * Static initialiser for @ref os_once.
+ */
+#define OS_ONCE_INIT {PTHREAD_ONCE_INIT}
+
+/*!
+ * Call @p func unless it has been called already, all other callers wait
+ * until it has returned.
+ *
+ * @public @memberof os_once
+ */
+static inline void
+os_once_call(struct os_once *oo, void (*func)(void))
+{
+	pthread_once(&oo->once, func);
+}
+
+
 /*
  *
  * Conditional variable.
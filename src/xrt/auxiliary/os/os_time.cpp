@@ -15,6 +15,13 @@
 
 #include "xrt/xrt_config_os.h"
 
+#include "os/os_time.h"
+
+#ifdef XRT_OS_LINUX
+#include <errno.h>
+#include <sys/prctl.h>
+#endif
+
 #ifdef XRT_OS_WINDOWS
 
 #include <inttypes.h>
@@ -29,3 +36,75 @@ os_realtime_get_ns(void)
 	return ret;
 }
 #endif
+
+#ifdef XRT_OS_LINUX
+
+//! Timer slack for threads using the precise sleeper, the default is 50us.
+#define TIMER_SLACK_NS (1)
+
+//! Bounds of the learned spin time, the upper one limits CPU burned per wait.
+#define MIN_SPIN_NS (int64_t)(10 * 1000)
+#define MAX_SPIN_NS (int64_t)(500 * 1000)
+
+//! Shorter sleeps than this are just spun.
+#define MIN_SLEEP_NS (int64_t)(20 * 1000)
+
+/*!
+ * Grows quickly when sleeps wake up later than expected, and shrinks slowly
+ * when they don't, so it settles on a high percentile of the wake up latency.
+ */
+static void
+update_spin(struct os_precise_sleeper *ops, int64_t overshoot_ns)
+{
+	if (overshoot_ns > MAX_SPIN_NS) {
+		overshoot_ns = MAX_SPIN_NS;
+	}
+
+	int64_t spin_ns = ops->spin_ns;
+	if (overshoot_ns > spin_ns) {
+		spin_ns += (overshoot_ns - spin_ns) / 4;
+	} else {
+		spin_ns -= (spin_ns - overshoot_ns) / 256;
+	}
+
+	if (spin_ns < MIN_SPIN_NS) {
+		spin_ns = MIN_SPIN_NS;
+	} else if (spin_ns > MAX_SPIN_NS) {
+		spin_ns = MAX_SPIN_NS;
+	}
+
+	ops->spin_ns = spin_ns;
+}
+
+extern "C" void
+os_precise_sleeper_wait_until(struct os_precise_sleeper *ops, uint64_t until_ns)
+{
+	if (!ops->timer_slack_set) {
+		prctl(PR_SET_TIMERSLACK, TIMER_SLACK_NS, 0, 0, 0);
+		ops->timer_slack_set = true;
+	}
+
+	uint64_t now_ns = os_monotonic_get_ns();
+	uint64_t sleep_until_ns = until_ns - (uint64_t)ops->spin_ns;
+
+	if (until_ns > now_ns && (int64_t)(sleep_until_ns - now_ns) > MIN_SLEEP_NS) {
+		struct timespec spec;
+		os_ns_to_timespec(sleep_until_ns, &spec);
+
+		// Absolute, so being interrupted doesn't move the deadline.
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &spec, NULL) == EINTR) {
+		}
+
+		now_ns = os_monotonic_get_ns();
+		update_spin(ops, (int64_t)(now_ns - sleep_until_ns));
+	}
+
+	while (now_ns < until_ns) {
+		now_ns = os_monotonic_get_ns();
+	}
+
+	ops->last_error_ns = (int64_t)(now_ns - until_ns);
+	ops->wait_count++;
+}
+
+#endif // XRT_OS_LINUX
@@ -125,6 +125,33 @@ os_precise_sleeper_deinit(struct os_precise_sleeper *ops);
 static inline void
 os_precise_sleeper_nanosleep(struct os_precise_sleeper *ops, int32_t nsec);
 
+#if defined(XRT_OS_LINUX) || defined(XRT_DOXYGEN)
+/*!
+ * How far ahead of the deadline a new @ref os_precise_sleeper stops sleeping
+ * and starts spinning, it then learns the actual wake up latency.
+ *
+ * @ingroup aux_os_time
+ */
+#define OS_PRECISE_SLEEPER_INITIAL_SPIN_NS (50 * 1000)
+
+/*!
+ * Wait until the given monotonic time (Linux-only).
+ *
+ * Sleeps on an absolute deadline with the thread's timer slack lowered, and
+ * spins the last part of the wait. How long to spin is learned from how late
+ * the previous sleeps woke up, the error of this wait is then stored in
+ * os_precise_sleeper::last_error_ns and os_precise_sleeper::wait_count is
+ * incremented.
+ *
+ * The timer slack is per thread, it is lowered on the first thread that waits
+ * on @p ops, so only use a sleeper from one thread.
+ *
+ * @public @memberof os_precise_sleeper
+ */
+void
+os_precise_sleeper_wait_until(struct os_precise_sleeper *ops, uint64_t until_ns);
+#endif
+
 #if defined(XRT_HAVE_TIMESPEC) || defined(XRT_DOXYGEN)
 /*!
  * Convert a timespec struct to nanoseconds.
@@ -208,6 +235,18 @@ struct os_precise_sleeper
 {
 #if defined(XRT_OS_WINDOWS)
 	HANDLE timer;
+#elif defined(XRT_OS_LINUX)
+	//! How long before the deadline to wake up and start spinning.
+	int64_t spin_ns;
+
+	//! How late the last wait returned, negative if early.
+	int64_t last_error_ns;
+
+	//! Number of waits done, goes up each time @ref last_error_ns is set.
+	uint64_t wait_count;
+
+	//! Has the timer slack of the waiting thread been lowered.
+	bool timer_slack_set;
 #else
 	int unused_;
 #endif
@@ -218,6 +257,11 @@ os_precise_sleeper_init(struct os_precise_sleeper *ops)
 {
 #if defined(XRT_OS_WINDOWS)
 	ops->timer = CreateWaitableTimer(NULL, TRUE, NULL);
+#elif defined(XRT_OS_LINUX)
+	ops->spin_ns = OS_PRECISE_SLEEPER_INITIAL_SPIN_NS;
+	ops->last_error_ns = 0;
+	ops->wait_count = 0;
+	ops->timer_slack_set = false;
 #endif
 }
 
@@ -0,0 +1,603 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Single file, memory-mappable container for EuRoC recordings.
+ * @ingroup aux_tracking
+ */
+
+#include "t_euroc_container.h"
+
+#include "util/u_format.h"
+#include "util/u_logging.h"
+#include "util/u_misc.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//! Frames waiting to be written before new ones are dropped, a few seconds of stereo at 30 Hz
+#define T_EUROC_CONTAINER_MAX_QUEUED 128
+
+using std::deque;
+using std::mutex;
+using std::pair;
+using std::unique_lock;
+using std::vector;
+
+static_assert(sizeof(t_euroc_container_file_header) == T_EUROC_CONTAINER_ALIGNMENT, "Header size");
+static_assert(sizeof(t_euroc_container_frame_header) == T_EUROC_CONTAINER_ALIGNMENT, "Payload alignment");
+static_assert(sizeof(t_euroc_container_imu) == 56, "On disk size");
+static_assert(sizeof(t_euroc_container_gt) == 40, "On disk size");
+static_assert(sizeof(t_euroc_container_index_entry) == 24, "On disk size");
+static_assert(sizeof(t_euroc_container_footer) == 64, "On disk size");
+
+static uint64_t
+align_up(uint64_t v)
+{
+	return (v + T_EUROC_CONTAINER_ALIGNMENT - 1) & ~(uint64_t)(T_EUROC_CONTAINER_ALIGNMENT - 1);
+}
+
+
+/*
+ *
+ * Writer.
+ *
+ */
+
+struct t_euroc_container_writer
+{
+	FILE *file = nullptr;
+	uint64_t offset = 0; //!< Where the next write lands, tracked to avoid ftell
+	uint32_t cam_count = 0;
+	bool failed = false;          //!< A write failed, the file is not usable
+	bool block_when_full = false; //!< Pushes wait for room instead of dropping frames
+	uint32_t dropped = 0;
+
+	std::thread thread;
+	mutex lock;
+	std::condition_variable cond;
+	std::condition_variable space_cond; //!< Signalled when a queued frame is taken
+	bool stopping = false;
+	deque<pair<uint32_t, xrt_frame *>> queue; //!< Protected by lock
+
+	vector<t_euroc_container_imu> imus; //!< Protected by lock
+	vector<t_euroc_container_gt> gts;   //!< Protected by lock
+
+	vector<t_euroc_container_index_entry> index; //!< Only touched by the writer thread
+};
+
+static void
+writer_write(struct t_euroc_container_writer *w, const void *data, size_t size)
+{
+	if (w->failed || size == 0) {
+		return;
+	}
+
+	if (fwrite(data, 1, size, w->file) != size) {
+		U_LOG_E("Failed to write EuRoC container, stopping writes");
+		w->failed = true;
+		return;
+	}
+	w->offset += size;
+}
+
+static void
+writer_pad(struct t_euroc_container_writer *w)
+{
+	static const uint8_t zeros[T_EUROC_CONTAINER_ALIGNMENT] = {0};
+	writer_write(w, zeros, align_up(w->offset) - w->offset);
+}
+
+static void
+writer_write_frame(struct t_euroc_container_writer *w, uint32_t cam_index, struct xrt_frame *xf)
+{
+	t_euroc_container_frame_header header = {};
+	header.magic = T_EUROC_CONTAINER_FRAME_MAGIC;
+	header.cam_index = cam_index;
+	header.timestamp_ns = (int64_t)xf->timestamp;
+	header.width = xf->width;
+	header.height = xf->height;
+	header.stride = (uint32_t)xf->stride;
+	header.format = xf->format == XRT_FORMAT_L8 ? T_EUROC_CONTAINER_FORMAT_L8 : T_EUROC_CONTAINER_FORMAT_R8G8B8;
+	header.payload_size = (uint64_t)xf->stride * xf->height;
+	header.record_size = align_up(sizeof(header) + header.payload_size);
+
+	t_euroc_container_index_entry entry = {};
+	entry.timestamp_ns = header.timestamp_ns;
+	entry.offset = w->offset;
+	entry.cam_index = cam_index;
+
+	writer_write(w, &header, sizeof(header));
+	writer_write(w, xf->data, header.payload_size);
+	writer_pad(w);
+
+	if (!w->failed) {
+		w->index.push_back(entry);
+	}
+}
+
+static void
+writer_run(struct t_euroc_container_writer *w)
+{
+	unique_lock lock{w->lock};
+
+	while (true) {
+		w->cond.wait(lock, [w] { return w->stopping || !w->queue.empty(); });
+		if (w->queue.empty()) {
+			break; // Stopping and everything is written.
+		}
+
+		pair<uint32_t, xrt_frame *> item = w->queue.front();
+		w->queue.pop_front();
+		w->space_cond.notify_one();
+
+		// Don't block pushes on the disk.
+		lock.unlock();
+		writer_write_frame(w, item.first, item.second);
+		xrt_frame_reference(&item.second, NULL);
+		lock.lock();
+	}
+}
+
+static void
+writer_finish(struct t_euroc_container_writer *w)
+{
+	t_euroc_container_footer footer = {};
+	memcpy(footer.magic, T_EUROC_CONTAINER_FOOTER_MAGIC, sizeof(footer.magic));
+
+	footer.imu_offset = w->offset;
+	footer.imu_count = w->imus.size();
+	writer_write(w, w->imus.data(), w->imus.size() * sizeof(t_euroc_container_imu));
+	writer_pad(w);
+
+	footer.gt_offset = w->offset;
+	footer.gt_count = w->gts.size();
+	writer_write(w, w->gts.data(), w->gts.size() * sizeof(t_euroc_container_gt));
+	writer_pad(w);
+
+	footer.index_offset = w->offset;
+	footer.frame_count = w->index.size();
+	writer_write(w, w->index.data(), w->index.size() * sizeof(t_euroc_container_index_entry));
+	writer_pad(w);
+
+	writer_write(w, &footer, sizeof(footer));
+}
+
+extern "C" bool
+t_euroc_container_writer_create(const char *path,
+                                uint32_t cam_count,
+                                bool block_when_full,
+                                struct t_euroc_container_writer **out_writer)
+{
+	FILE *file = fopen(path, "wb");
+	if (file == nullptr) {
+		U_LOG_E("Could not create EuRoC container '%s'", path);
+		return false;
+	}
+
+	struct t_euroc_container_writer *w = new t_euroc_container_writer{};
+	w->file = file;
+	w->cam_count = cam_count;
+	w->block_when_full = block_when_full;
+
+	t_euroc_container_file_header header = {};
+	memcpy(header.magic, T_EUROC_CONTAINER_MAGIC, sizeof(header.magic));
+	header.version = T_EUROC_CONTAINER_VERSION;
+	header.cam_count = cam_count;
+	writer_write(w, &header, sizeof(header));
+
+	w->thread = std::thread(writer_run, w);
+
+	*out_writer = w;
+	return true;
+}
+
+extern "C" void
+t_euroc_container_writer_push_frame(struct t_euroc_container_writer *w, uint32_t cam_index, struct xrt_frame *xf)
+{
+	if (xf->format != XRT_FORMAT_L8 && xf->format != XRT_FORMAT_R8G8B8) {
+		U_LOG_W("EuRoC container only supports L8 and R8G8B8 frames, got %s", u_format_str(xf->format));
+		return;
+	}
+
+	if (cam_index >= w->cam_count) {
+		U_LOG_W("Frame for camera %u in a container of %u cameras", cam_index, w->cam_count);
+		return;
+	}
+
+	unique_lock lock{w->lock};
+	if (w->block_when_full) {
+		w->space_cond.wait(lock, [w] { return w->queue.size() < T_EUROC_CONTAINER_MAX_QUEUED; });
+	}
+	if (w->queue.size() >= T_EUROC_CONTAINER_MAX_QUEUED) {
+		w->dropped++;
+		return;
+	}
+
+	struct xrt_frame *ref = nullptr;
+	xrt_frame_reference(&ref, xf);
+	w->queue.emplace_back(cam_index, ref);
+	w->cond.notify_one();
+}
+
+extern "C" void
+t_euroc_container_writer_push_imu(struct t_euroc_container_writer *w, const struct xrt_imu_sample *sample)
+{
+	t_euroc_container_imu imu = {};
+	imu.timestamp_ns = sample->timestamp_ns;
+	imu.accel_m_s2[0] = sample->accel_m_s2.x;
+	imu.accel_m_s2[1] = sample->accel_m_s2.y;
+	imu.accel_m_s2[2] = sample->accel_m_s2.z;
+	imu.gyro_rad_secs[0] = sample->gyro_rad_secs.x;
+	imu.gyro_rad_secs[1] = sample->gyro_rad_secs.y;
+	imu.gyro_rad_secs[2] = sample->gyro_rad_secs.z;
+
+	unique_lock lock{w->lock};
+	w->imus.push_back(imu);
+}
+
+extern "C" void
+t_euroc_container_writer_push_gt(struct t_euroc_container_writer *w, const struct xrt_pose_sample *sample)
+{
+	const xrt_pose &p = sample->pose;
+
+	t_euroc_container_gt gt = {};
+	gt.timestamp_ns = sample->timestamp_ns;
+	gt.position[0] = p.position.x;
+	gt.position[1] = p.position.y;
+	gt.position[2] = p.position.z;
+	gt.orientation[0] = p.orientation.x;
+	gt.orientation[1] = p.orientation.y;
+	gt.orientation[2] = p.orientation.z;
+	gt.orientation[3] = p.orientation.w;
+
+	unique_lock lock{w->lock};
+	w->gts.push_back(gt);
+}
+
+extern "C" bool
+t_euroc_container_writer_destroy(struct t_euroc_container_writer **w_ptr)
+{
+	struct t_euroc_container_writer *w = *w_ptr;
+	if (w == nullptr) {
+		return true;
+	}
+
+	{
+		unique_lock lock{w->lock};
+		w->stopping = true;
+		w->cond.notify_one();
+	}
+	w->thread.join();
+
+	writer_finish(w);
+
+	bool ok = !w->failed;
+	if (fclose(w->file) != 0) {
+		ok = false;
+	}
+
+	if (w->dropped > 0) {
+		U_LOG_W("EuRoC container writer dropped %u frames, disk too slow", w->dropped);
+	}
+	if (!ok) {
+		U_LOG_E("EuRoC container is incomplete");
+	}
+
+	delete w;
+	*w_ptr = nullptr;
+	return ok;
+}
+
+
+/*
+ *
+ * Reader.
+ *
+ */
+
+struct euroc_container
+{
+	struct t_euroc_container base;
+
+	const uint8_t *map = nullptr;
+	size_t map_size = 0;
+
+	//! Only used when the index had to be rebuilt.
+	vector<t_euroc_container_index_entry> recovered_index;
+
+	//! Per camera (timestamp, index into base.frames) sorted by timestamp.
+	vector<vector<pair<int64_t, uint32_t>>> cams;
+};
+
+struct euroc_container_frame
+{
+	struct xrt_frame base;
+	struct t_euroc_container *c;
+};
+
+static struct euroc_container *
+euroc_container_from(struct t_euroc_container *c)
+{
+	return (struct euroc_container *)c;
+}
+
+//! Checks that @p count elements of @p elem_size at @p offset lie inside the file
+static bool
+in_bounds(const euroc_container *ec, uint64_t offset, uint64_t count, uint64_t elem_size)
+{
+	if (offset > ec->map_size || count > (ec->map_size - offset) / elem_size) {
+		return false;
+	}
+	return true;
+}
+
+static bool
+is_aligned(uint64_t v)
+{
+	return (v & (T_EUROC_CONTAINER_ALIGNMENT - 1)) == 0;
+}
+
+//! Bytes per pixel of @p format, zero if it is not a known format
+static uint32_t
+format_bytes_per_pixel(uint32_t format)
+{
+	switch (format) {
+	case T_EUROC_CONTAINER_FORMAT_L8: return 1;
+	case T_EUROC_CONTAINER_FORMAT_R8G8B8: return 3;
+	default: return 0;
+	}
+}
+
+static bool
+frame_header_is_valid(const euroc_container *ec, uint64_t offset)
+{
+	// Records start aligned so the payloads are, see writer_pad.
+	if (!is_aligned(offset) || !in_bounds(ec, offset, 1, sizeof(t_euroc_container_frame_header))) {
+		return false;
+	}
+
+	t_euroc_container_frame_header h;
+	memcpy(&h, ec->map + offset, sizeof(h));
+
+	uint32_t bpp = format_bytes_per_pixel(h.format);
+
+	bool valid = h.magic == T_EUROC_CONTAINER_FRAME_MAGIC &&                     //
+	             h.cam_index < ec->base.cam_count &&                              //
+	             bpp != 0 &&                                                      //
+	             (uint64_t)h.width * bpp <= h.stride &&                           //
+	             h.payload_size == (uint64_t)h.stride * h.height &&               //
+	             h.record_size >= sizeof(h) + h.payload_size &&                   //
+	             is_aligned(h.record_size) &&                                     //
+	             in_bounds(ec, offset, 1, h.record_size);
+	return valid;
+}
+
+static bool
+read_footer(euroc_container *ec)
+{
+	if (ec->map_size < sizeof(t_euroc_container_file_header) + sizeof(t_euroc_container_footer)) {
+		return false;
+	}
+
+	t_euroc_container_footer f;
+	memcpy(&f, ec->map + ec->map_size - sizeof(f), sizeof(f));
+	if (memcmp(f.magic, T_EUROC_CONTAINER_FOOTER_MAGIC, sizeof(f.magic)) != 0) {
+		return false;
+	}
+
+	// The tables are used in place, so they must be aligned as written.
+	if (!is_aligned(f.index_offset) || !is_aligned(f.imu_offset) || !is_aligned(f.gt_offset)) {
+		return false;
+	}
+
+	if (!in_bounds(ec, f.index_offset, f.frame_count, sizeof(t_euroc_container_index_entry)) ||
+	    !in_bounds(ec, f.imu_offset, f.imu_count, sizeof(t_euroc_container_imu)) ||
+	    !in_bounds(ec, f.gt_offset, f.gt_count, sizeof(t_euroc_container_gt)) || f.frame_count > UINT32_MAX ||
+	    f.imu_count > UINT32_MAX || f.gt_count > UINT32_MAX) {
+		return false;
+	}
+
+	// The tables are written aligned, so they can be used in place.
+	ec->base.frames = (const t_euroc_container_index_entry *)(ec->map + f.index_offset);
+	ec->base.frame_count = (uint32_t)f.frame_count;
+	ec->base.imus = (const t_euroc_container_imu *)(ec->map + f.imu_offset);
+	ec->base.imu_count = (uint32_t)f.imu_count;
+	ec->base.gts = (const t_euroc_container_gt *)(ec->map + f.gt_offset);
+	ec->base.gt_count = (uint32_t)f.gt_count;
+
+	for (uint32_t i = 0; i < ec->base.frame_count; i++) {
+		if (!frame_header_is_valid(ec, ec->base.frames[i].offset)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//! Walks the frame records to rebuild the index of a container without a footer
+static void
+recover_index(euroc_container *ec)
+{
+	uint64_t offset = sizeof(t_euroc_container_file_header);
+	while (frame_header_is_valid(ec, offset)) {
+		t_euroc_container_frame_header h;
+		memcpy(&h, ec->map + offset, sizeof(h));
+
+		t_euroc_container_index_entry entry = {};
+		entry.timestamp_ns = h.timestamp_ns;
+		entry.offset = offset;
+		entry.cam_index = h.cam_index;
+		ec->recovered_index.push_back(entry);
+
+		offset += h.record_size;
+	}
+
+	ec->base.frames = ec->recovered_index.data();
+	ec->base.frame_count = (uint32_t)ec->recovered_index.size();
+	ec->base.imus = nullptr;
+	ec->base.imu_count = 0;
+	ec->base.gts = nullptr;
+	ec->base.gt_count = 0;
+	ec->base.recovered = true;
+}
+
+extern "C" bool
+t_euroc_container_open(const char *path, struct t_euroc_container **out_container)
+{
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (size_t)st.st_size < sizeof(t_euroc_container_file_header)) {
+		close(fd);
+		return false;
+	}
+
+	size_t size = (size_t)st.st_size;
+	void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // The mapping keeps the file alive.
+	if (map == MAP_FAILED) {
+		U_LOG_E("Could not map EuRoC container '%s'", path);
+		return false;
+	}
+
+	t_euroc_container_file_header header;
+	memcpy(&header, map, sizeof(header));
+	if (memcmp(header.magic, T_EUROC_CONTAINER_MAGIC, sizeof(header.magic)) != 0 ||
+	    header.version != T_EUROC_CONTAINER_VERSION || header.cam_count == 0 ||
+	    header.cam_count > XRT_TRACKING_MAX_SLAM_CAMS) {
+		munmap(map, size);
+		return false;
+	}
+
+	// Playback reads front to back.
+	(void)madvise(map, size, MADV_SEQUENTIAL);
+
+	struct euroc_container *ec = new euroc_container{};
+	ec->base.reference.count = 1;
+	ec->base.cam_count = header.cam_count;
+	ec->map = (const uint8_t *)map;
+	ec->map_size = size;
+
+	if (!read_footer(ec)) {
+		U_LOG_W("EuRoC container '%s' has no valid index, recovering frames only", path);
+		recover_index(ec);
+	}
+
+	ec->cams.resize(ec->base.cam_count);
+	for (uint32_t i = 0; i < ec->base.frame_count; i++) {
+		const t_euroc_container_index_entry &e = ec->base.frames[i];
+		ec->cams[e.cam_index].emplace_back(e.timestamp_ns, i);
+	}
+	for (auto &cam : ec->cams) {
+		std::stable_sort(cam.begin(), cam.end());
+	}
+
+	*out_container = &ec->base;
+	return true;
+}
+
+extern "C" void
+t_euroc_container_destroy(struct t_euroc_container *c)
+{
+	struct euroc_container *ec = euroc_container_from(c);
+	munmap((void *)ec->map, ec->map_size);
+	delete ec;
+}
+
+extern "C" bool
+t_euroc_container_find_frame(struct t_euroc_container *c,
+                             uint32_t cam_index,
+                             int64_t timestamp_ns,
+                             uint32_t *out_index)
+{
+	struct euroc_container *ec = euroc_container_from(c);
+	if (cam_index >= ec->cams.size()) {
+		return false;
+	}
+
+	const auto &cam = ec->cams[cam_index];
+	auto it = std::lower_bound(cam.begin(), cam.end(), std::make_pair(timestamp_ns, (uint32_t)0));
+	if (it == cam.end() || it->first != timestamp_ns) {
+		return false;
+	}
+
+	*out_index = it->second;
+	return true;
+}
+
+static void
+euroc_container_frame_destroy(struct xrt_frame *xf)
+{
+	struct euroc_container_frame *ecf = (struct euroc_container_frame *)xf;
+	t_euroc_container_reference(&ecf->c, NULL);
+	free(ecf);
+}
+
+extern "C" bool
+t_euroc_container_get_frame(struct t_euroc_container *c, uint32_t index, struct xrt_frame **out_xf)
+{
+	struct euroc_container *ec = euroc_container_from(c);
+	if (index >= c->frame_count) {
+		return false;
+	}
+
+	// Validated when the index was read.
+	uint64_t offset = c->frames[index].offset;
+	t_euroc_container_frame_header h;
+	memcpy(&h, ec->map + offset, sizeof(h));
+
+	struct euroc_container_frame *ecf = U_TYPED_CALLOC(struct euroc_container_frame);
+	t_euroc_container_reference(&ecf->c, c);
+
+	struct xrt_frame *xf = &ecf->base;
+	xf->reference.count = 1;
+	xf->destroy = euroc_container_frame_destroy;
+	xf->width = h.width;
+	xf->height = h.height;
+	xf->stride = h.stride;
+	xf->size = h.payload_size;
+	xf->format = h.format == T_EUROC_CONTAINER_FORMAT_L8 ? XRT_FORMAT_L8 : XRT_FORMAT_R8G8B8;
+	xf->stereo_format = XRT_STEREO_FORMAT_NONE;
+	xf->timestamp = h.timestamp_ns;
+	xf->source_timestamp = h.timestamp_ns;
+
+	// Read only mapping, consumers must not write to frames they didn't create.
+	xf->data = (uint8_t *)(ec->map + offset + sizeof(h));
+
+	*out_xf = xf;
+	return true;
+}
+
+extern "C" void
+t_euroc_container_get_imu(struct t_euroc_container *c, uint32_t index, struct xrt_imu_sample *out_sample)
+{
+	const t_euroc_container_imu &imu = c->imus[index];
+	out_sample->timestamp_ns = imu.timestamp_ns;
+	out_sample->accel_m_s2 = {imu.accel_m_s2[0], imu.accel_m_s2[1], imu.accel_m_s2[2]};
+	out_sample->gyro_rad_secs = {imu.gyro_rad_secs[0], imu.gyro_rad_secs[1], imu.gyro_rad_secs[2]};
+}
+
+extern "C" void
+t_euroc_container_get_gt(struct t_euroc_container *c, uint32_t index, struct xrt_pose_sample *out_sample)
+{
+	const t_euroc_container_gt &gt = c->gts[index];
+	out_sample->timestamp_ns = gt.timestamp_ns;
+	out_sample->pose.position = {gt.position[0], gt.position[1], gt.position[2]};
+	out_sample->pose.orientation = {gt.orientation[0], gt.orientation[1], gt.orientation[2], gt.orientation[3]};
+}
@@ -0,0 +1,279 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Single file, memory-mappable container for EuRoC recordings.
+ * @ingroup aux_tracking
+ */
+
+#pragma once
+
+#include "xrt/xrt_defines.h"
+#include "xrt/xrt_frame.h"
+#include "xrt/xrt_tracking.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ *
+ * On disk format.
+ *
+ */
+
+/*!
+ * @defgroup aux_tracking_euroc_container EuRoC capture container
+ * @ingroup aux_tracking
+ *
+ * An append-only alternative to the EuRoC folder layout, made so recording
+ * does no encoding and playback does no decoding. The file is:
+ *
+ * 1. A @ref t_euroc_container_file_header.
+ * 2. One record per camera frame in the order they were written, a
+ *    @ref t_euroc_container_frame_header followed by the raw L8 or R8G8B8
+ *    pixels. Records are padded so every payload is 64 byte aligned.
+ * 3. The IMU and groundtruth side tables, arrays of
+ *    @ref t_euroc_container_imu and @ref t_euroc_container_gt.
+ * 4. The frame index, an array of @ref t_euroc_container_index_entry.
+ * 5. A @ref t_euroc_container_footer as the last bytes of the file.
+ *
+ * Everything is in host byte order. If the recording was interrupted before
+ * the footer was written the frames can still be recovered by walking the
+ * records, only the side tables are lost.
+ *
+ * @{
+ */
+
+#define T_EUROC_CONTAINER_MAGIC "XRTEUCAP"
+#define T_EUROC_CONTAINER_FOOTER_MAGIC "XRTEUIDX"
+#define T_EUROC_CONTAINER_FRAME_MAGIC 0x454d5246 // "FRME"
+#define T_EUROC_CONTAINER_VERSION 1
+#define T_EUROC_CONTAINER_ALIGNMENT 64
+
+//! Default file extension for containers.
+#define T_EUROC_CONTAINER_EXT ".ecap"
+
+enum t_euroc_container_format
+{
+	T_EUROC_CONTAINER_FORMAT_L8 = 1,
+	T_EUROC_CONTAINER_FORMAT_R8G8B8 = 2,
+};
+
+struct t_euroc_container_file_header
+{
+	char magic[8]; //!< @ref T_EUROC_CONTAINER_MAGIC, not null terminated
+	uint32_t version;
+	uint32_t cam_count;
+	uint8_t reserved[48];
+};
+
+struct t_euroc_container_frame_header
+{
+	uint32_t magic; //!< @ref T_EUROC_CONTAINER_FRAME_MAGIC
+	uint32_t cam_index;
+	int64_t timestamp_ns;
+	uint32_t width;
+	uint32_t height;
+	uint32_t stride;
+	uint32_t format;       //!< @ref t_euroc_container_format
+	uint64_t payload_size; //!< stride * height bytes right after this header
+	uint64_t record_size;  //!< This header, the payload and padding, the next record starts after it
+	uint8_t reserved[16];
+};
+
+struct t_euroc_container_imu
+{
+	int64_t timestamp_ns;
+	double accel_m_s2[3];
+	double gyro_rad_secs[3];
+};
+
+struct t_euroc_container_gt
+{
+	int64_t timestamp_ns;
+	float position[3];
+	float orientation[4]; //!< x, y, z, w
+	uint32_t reserved;
+};
+
+struct t_euroc_container_index_entry
+{
+	int64_t timestamp_ns;
+	uint64_t offset; //!< Of the @ref t_euroc_container_frame_header from the start of the file
+	uint32_t cam_index;
+	uint32_t reserved;
+};
+
+struct t_euroc_container_footer
+{
+	char magic[8]; //!< @ref T_EUROC_CONTAINER_FOOTER_MAGIC, not null terminated
+	uint64_t index_offset;
+	uint64_t frame_count;
+	uint64_t imu_offset;
+	uint64_t imu_count;
+	uint64_t gt_offset;
+	uint64_t gt_count;
+	uint8_t reserved[8];
+};
+
+
+/*
+ *
+ * Writer.
+ *
+ */
+
+/*!
+ * Appends frames to a container from its own thread, so pushing a frame only
+ * takes a reference to it. IMU and groundtruth samples are kept in memory
+ * and written as the side tables when the writer is destroyed.
+ */
+struct t_euroc_container_writer;
+
+/*!
+ * Creates the file at @p path, truncating it, and starts the writer thread.
+ * With @p block_when_full pushes wait for the writer instead of dropping
+ * frames, for offline conversion where nothing is lost by waiting.
+ */
+bool
+t_euroc_container_writer_create(const char *path,
+                                uint32_t cam_count,
+                                bool block_when_full,
+                                struct t_euroc_container_writer **out_writer);
+
+/*!
+ * Queues @p xf to be written as a frame of camera @p cam_index, only L8 and
+ * R8G8B8 frames are supported. The frame is referenced until written, frames
+ * are dropped if the disk can't keep up, unless created to block.
+ */
+void
+t_euroc_container_writer_push_frame(struct t_euroc_container_writer *w, uint32_t cam_index, struct xrt_frame *xf);
+
+void
+t_euroc_container_writer_push_imu(struct t_euroc_container_writer *w, const struct xrt_imu_sample *sample);
+
+void
+t_euroc_container_writer_push_gt(struct t_euroc_container_writer *w, const struct xrt_pose_sample *sample);
+
+/*!
+ * Writes all queued frames, the side tables and the index, then closes the
+ * file. Returns false if anything failed to be written.
+ */
+bool
+t_euroc_container_writer_destroy(struct t_euroc_container_writer **w_ptr);
+
+
+/*
+ *
+ * Reader.
+ *
+ */
+
+/*!
+ * A memory-mapped container, frames handed out by it point straight into
+ * the mapping and keep it alive.
+ */
+struct t_euroc_container
+{
+	struct xrt_reference reference;
+
+	uint32_t cam_count;
+
+	uint32_t frame_count;
+	const struct t_euroc_container_index_entry *frames;
+
+	uint32_t imu_count;
+	const struct t_euroc_container_imu *imus;
+
+	uint32_t gt_count;
+	const struct t_euroc_container_gt *gts;
+
+	//! The footer was missing or broken and the frame index was rebuilt.
+	bool recovered;
+};
+
+/*!
+ * Maps the container at @p path, returns false if it is not one (directories
+ * included) or it can't be read.
+ */
+bool
+t_euroc_container_open(const char *path, struct t_euroc_container **out_container);
+
+void
+t_euroc_container_destroy(struct t_euroc_container *c);
+
+static inline void
+t_euroc_container_reference(struct t_euroc_container **dst, struct t_euroc_container *src)
+{
+	struct t_euroc_container *old_dst = *dst;
+
+	if (old_dst == src) {
+		return;
+	}
+
+	if (src) {
+		xrt_reference_inc(&src->reference);
+	}
+
+	*dst = src;
+
+	if (old_dst) {
+		if (xrt_reference_dec_and_is_zero(&old_dst->reference)) {
+			t_euroc_container_destroy(old_dst);
+		}
+	}
+}
+
+/*!
+ * Finds the frame of camera @p cam_index at @p timestamp_ns, @p out_index is
+ * an index into @ref t_euroc_container::frames.
+ */
+bool
+t_euroc_container_find_frame(struct t_euroc_container *c,
+                             uint32_t cam_index,
+                             int64_t timestamp_ns,
+                             uint32_t *out_index);
+
+/*!
+ * Wraps frame @p index without copying, the frame keeps a reference to the
+ * container. Timestamps are the recorded ones.
+ */
+bool
+t_euroc_container_get_frame(struct t_euroc_container *c, uint32_t index, struct xrt_frame **out_xf);
+
+void
+t_euroc_container_get_imu(struct t_euroc_container *c, uint32_t index, struct xrt_imu_sample *out_sample);
+
+void
+t_euroc_container_get_gt(struct t_euroc_container *c, uint32_t index, struct xrt_pose_sample *out_sample);
+
+
+/*
+ *
+ * Conversion, needs OpenCV.
+ *
+ */
+
+/*!
+ * Converts the EuRoC dataset folder at @p dataset_path to a container.
+ */
+bool
+t_euroc_container_from_folder(const char *dataset_path, const char *container_path);
+
+/*!
+ * Writes the container at @p container_path as a EuRoC dataset folder, the
+ * same layout the EuRoC recorder writes, images as PNG.
+ */
+bool
+t_euroc_container_to_folder(const char *container_path, const char *dataset_path);
+
+/*!
+ * @}
+ */
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,282 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Conversion between EuRoC dataset folders and capture containers.
+ * @ingroup aux_tracking
+ */
+
+#include "t_euroc_container.h"
+#include "t_euroc_recorder.h"
+#include "t_frame_cv_mat_wrapper.hpp"
+
+#include "util/u_logging.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+using std::ifstream;
+using std::ofstream;
+using std::string;
+using std::to_string;
+using std::vector;
+using std::filesystem::create_directories;
+using xrt::auxiliary::tracking::FrameMat;
+
+
+/*
+ *
+ * Folder to container.
+ *
+ */
+
+//! Splits a csv line into its columns, dropping the '\r' of CRLF files
+static vector<string>
+split_csv_line(string line)
+{
+	if (!line.empty() && line.back() == '\r') {
+		line.pop_back();
+	}
+
+	vector<string> columns;
+	size_t start = 0;
+	size_t end = 0;
+	while ((end = line.find(',', start)) != string::npos) {
+		columns.push_back(line.substr(start, end - start));
+		start = end + 1;
+	}
+	columns.push_back(line.substr(start));
+	return columns;
+}
+
+//! Reads all lines after the header of a csv, returns false if it can't be opened
+static bool
+read_csv(const string &path, vector<vector<string>> &out_rows)
+{
+	ifstream fin{path};
+	if (!fin.is_open()) {
+		return false;
+	}
+
+	string line;
+	getline(fin, line); // Skip header line
+	while (getline(fin, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+		out_rows.push_back(split_csv_line(line));
+	}
+	return true;
+}
+
+static bool
+push_folder_imus(struct t_euroc_container_writer *w, const string &dataset_path)
+{
+	vector<vector<string>> rows;
+	if (!read_csv(dataset_path + "/mav0/imu0/data.csv", rows)) {
+		U_LOG_E("No imu0 in '%s'", dataset_path.c_str());
+		return false;
+	}
+
+	// EuRoC imu columns: ts wx wy wz ax ay az
+	for (const vector<string> &r : rows) {
+		if (r.size() < 7) {
+			continue;
+		}
+		xrt_imu_sample s{};
+		s.timestamp_ns = stoll(r[0]);
+		s.gyro_rad_secs = {stod(r[1]), stod(r[2]), stod(r[3])};
+		s.accel_m_s2 = {stod(r[4]), stod(r[5]), stod(r[6])};
+		t_euroc_container_writer_push_imu(w, &s);
+	}
+	return true;
+}
+
+//! Same groundtruth sources as the EuRoC player, plus the one the recorder writes
+static void
+push_folder_gt(struct t_euroc_container_writer *w, const string &dataset_path)
+{
+	const char *gt_devices[] = {"gt", "vicon0", "mocap0", "state_groundtruth_estimate0", "leica0"};
+
+	vector<vector<string>> rows;
+	for (const char *device : gt_devices) {
+		if (read_csv(dataset_path + "/mav0/" + device + "/data.csv", rows)) {
+			break;
+		}
+	}
+
+	// EuRoC groundtruth columns: ts px py pz qw qx qy qz
+	for (const vector<string> &r : rows) {
+		float v[7] = {0, 0, 0, 1, 0, 0, 0}; // Identity orientation for leica0
+		for (size_t k = 0; k < 7 && k + 1 < r.size(); k++) {
+			v[k] = stof(r[k + 1]);
+		}
+
+		xrt_pose_sample s{};
+		s.timestamp_ns = stoll(r[0]);
+		s.pose = {{v[4], v[5], v[6], v[3]}, {v[0], v[1], v[2]}};
+		t_euroc_container_writer_push_gt(w, &s);
+	}
+}
+
+static bool
+push_folder_frame(struct t_euroc_container_writer *w, uint32_t cam_index, int64_t ts, const string &img_path)
+{
+	cv::Mat img = cv::imread(img_path, cv::IMREAD_ANYCOLOR); // If colored, reads in BGR order
+	if (img.empty() || img.depth() != CV_8U) {
+		U_LOG_E("Could not read '%s' as an 8 bit image", img_path.c_str());
+		return false;
+	}
+
+	if (img.channels() == 4) {
+		cv::cvtColor(img, img, cv::COLOR_BGRA2BGR);
+	}
+
+	// Stored as is, same as the player hands out images from a folder.
+	xrt_frame *xf = nullptr;
+	FrameMat::Params params{XRT_STEREO_FORMAT_NONE, (uint64_t)ts};
+	if (img.channels() == 3) {
+		FrameMat::wrapR8G8B8(img, &xf, params);
+	} else {
+		FrameMat::wrapL8(img, &xf, params);
+	}
+
+	t_euroc_container_writer_push_frame(w, cam_index, xf);
+	xrt_frame_reference(&xf, NULL);
+	return true;
+}
+
+extern "C" bool
+t_euroc_container_from_folder(const char *dataset_path, const char *container_path)
+{
+	string path = dataset_path;
+
+	// Image names and timestamps of every camera
+	vector<vector<vector<string>>> cams;
+	vector<vector<string>> rows;
+	while (cams.size() < XRT_TRACKING_MAX_SLAM_CAMS &&
+	       read_csv(path + "/mav0/cam" + to_string(cams.size()) + "/data.csv", rows)) {
+		cams.push_back(std::move(rows));
+		rows.clear();
+	}
+
+	if (cams.empty()) {
+		U_LOG_E("No cameras in '%s', is it a EuRoC dataset?", dataset_path);
+		return false;
+	}
+
+	struct t_euroc_container_writer *w = nullptr;
+	if (!t_euroc_container_writer_create(container_path, (uint32_t)cams.size(), true, &w)) {
+		return false;
+	}
+
+	bool ok = push_folder_imus(w, path);
+	push_folder_gt(w, path);
+
+	// Interleave the cameras so each frame sits next to its pair.
+	size_t frame_count = 0;
+	for (const auto &cam : cams) {
+		frame_count = std::max(frame_count, cam.size());
+	}
+
+	for (size_t i = 0; i < frame_count && ok; i++) {
+		for (uint32_t cam_index = 0; cam_index < cams.size() && ok; cam_index++) {
+			if (i >= cams[cam_index].size() || cams[cam_index][i].size() < 2) {
+				continue;
+			}
+			const vector<string> &r = cams[cam_index][i];
+			string img_path = path + "/mav0/cam" + to_string(cam_index) + "/data/" + r[1];
+			ok = push_folder_frame(w, cam_index, stoll(r[0]), img_path);
+		}
+	}
+
+	ok = t_euroc_container_writer_destroy(&w) && ok;
+	return ok;
+}
+
+
+/*
+ *
+ * Container to folder.
+ *
+ */
+
+extern "C" bool
+t_euroc_container_to_folder(const char *container_path, const char *dataset_path)
+{
+	struct t_euroc_container *c = nullptr;
+	if (!t_euroc_container_open(container_path, &c)) {
+		U_LOG_E("'%s' is not a EuRoC container", container_path);
+		return false;
+	}
+
+	string path = string(dataset_path) + "/mav0";
+
+	create_directories(path + "/imu0");
+	ofstream imu_csv{path + "/imu0/data.csv"};
+	imu_csv << std::fixed << std::setprecision(CSV_PRECISION);
+	imu_csv << EUROC_IMU_CSV_HEADER;
+	for (uint32_t i = 0; i < c->imu_count; i++) {
+		xrt_imu_sample s;
+		t_euroc_container_get_imu(c, i, &s);
+		xrt_vec3_f64 a = s.accel_m_s2;
+		xrt_vec3_f64 w = s.gyro_rad_secs;
+		imu_csv << s.timestamp_ns << ",";
+		imu_csv << w.x << "," << w.y << "," << w.z << ",";
+		imu_csv << a.x << "," << a.y << "," << a.z << CSV_EOL;
+	}
+
+	if (c->gt_count > 0) {
+		create_directories(path + "/gt");
+		ofstream gt_csv{path + "/gt/data.csv"};
+		gt_csv << std::fixed << std::setprecision(CSV_PRECISION);
+		gt_csv << EUROC_GT_CSV_HEADER;
+		for (uint32_t i = 0; i < c->gt_count; i++) {
+			xrt_pose_sample s;
+			t_euroc_container_get_gt(c, i, &s);
+			xrt_vec3 p = s.pose.position;
+			xrt_quat o = s.pose.orientation;
+			gt_csv << s.timestamp_ns << ",";
+			gt_csv << p.x << "," << p.y << "," << p.z << ",";
+			gt_csv << o.w << "," << o.x << "," << o.y << "," << o.z << CSV_EOL;
+		}
+	}
+
+	vector<ofstream> cams_csv(c->cam_count);
+	for (uint32_t i = 0; i < c->cam_count; i++) {
+		string data_path = path + "/cam" + to_string(i) + "/data";
+		create_directories(data_path);
+		cams_csv[i] = ofstream{data_path + ".csv"};
+		cams_csv[i] << EUROC_CAM_CSV_HEADER;
+	}
+
+	bool ok = true;
+	for (uint32_t i = 0; i < c->frame_count && ok; i++) {
+		xrt_frame *xf = nullptr;
+		t_euroc_container_get_frame(c, i, &xf);
+
+		uint32_t cam_index = c->frames[i].cam_index;
+		string filename = to_string(xf->timestamp) + ".png";
+		string img_path = path + "/cam" + to_string(cam_index) + "/data/" + filename;
+
+		// Same as the recorder, the bytes are written as they are stored.
+		auto img_type = xf->format == XRT_FORMAT_L8 ? CV_8UC1 : CV_8UC3;
+		cv::Mat img{(int)xf->height, (int)xf->width, img_type, xf->data, xf->stride};
+		ok = cv::imwrite(img_path, img);
+		if (!ok) {
+			U_LOG_E("Could not write '%s'", img_path.c_str());
+		}
+
+		cams_csv[cam_index] << xf->timestamp << "," << filename << CSV_EOL;
+		xrt_frame_reference(&xf, NULL);
+	}
+
+	t_euroc_container_reference(&c, NULL);
+	return ok;
+}
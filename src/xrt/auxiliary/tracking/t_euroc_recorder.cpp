@@ -8,6 +8,7 @@
  */
 
 #include "t_euroc_recorder.h"
+#include "t_euroc_container.h"
 
 #include "os/os_time.h"
 #include "util/u_frame.h"
@@ -29,6 +30,7 @@
 #include <opencv2/imgcodecs.hpp>
 
 DEBUG_GET_ONCE_BOOL_OPTION(euroc_recorder_use_jpg, "EUROC_RECORDER_USE_JPG", false)
+DEBUG_GET_ONCE_BOOL_OPTION(euroc_recorder_use_container, "EUROC_RECORDER_USE_CONTAINER", false)
 
 using std::lock_guard;
 using std::mutex;
@@ -51,6 +53,11 @@ struct euroc_recorder
 
 	bool use_jpg; //! Whether or not we should save images as .jpg files
 
+	//! Record into a single raw container file instead of a dataset folder, see @ref t_euroc_container_writer
+	bool use_container;
+	struct t_euroc_container_writer *container = nullptr; //!< Writer of the current recording, if use_container
+	mutex container_lock{};                               //!< Protects container from stop while pushing
+
 	// Cloner sinks: copy frame to heap for quick release of the original
 	struct xrt_slam_sinks cloner_queues; //!< Queue sinks that write into cloner sinks
 	struct xrt_imu_sink cloner_imu_sink;
@@ -91,20 +98,18 @@ euroc_recorder_mkfiles(struct euroc_recorder *er)
 	create_directories(path + "/mav0/imu0");
 	er->imu_csv = new ofstream{path + "/mav0/imu0/data.csv"};
 	*er->imu_csv << std::fixed << std::setprecision(CSV_PRECISION);
-	*er->imu_csv << "#timestamp [ns],w_RS_S_x [rad s^-1],w_RS_S_y [rad s^-1],w_RS_S_z [rad s^-1],"
-	                "a_RS_S_x [m s^-2],a_RS_S_y [m s^-2],a_RS_S_z [m s^-2]" CSV_EOL;
+	*er->imu_csv << EUROC_IMU_CSV_HEADER;
 
 	create_directories(path + "/mav0/gt");
 	er->gt_csv = new ofstream{path + "/mav0/gt/data.csv"};
 	*er->gt_csv << std::fixed << std::setprecision(CSV_PRECISION);
-	*er->gt_csv << "#timestamp [ns],p_RS_R_x [m],p_RS_R_y [m],p_RS_R_z [m],"
-	               "q_RS_w [],q_RS_x [],q_RS_y [],q_RS_z []" CSV_EOL;
+	*er->gt_csv << EUROC_GT_CSV_HEADER;
 
 	for (int i = 0; i < er->cam_count; i++) {
 		string data_path = path + "/mav0/cam" + to_string(i) + "/data";
 		create_directories(data_path);
 		er->cams_csv[i] = new ofstream{data_path + ".csv"};
-		*er->cams_csv[i] << "#timestamp [ns],filename" CSV_EOL;
+		*er->cams_csv[i] << EUROC_CAM_CSV_HEADER;
 	}
 }
 
@@ -244,6 +249,14 @@ euroc_recorder_receive_imu(xrt_imu_sink *sink, struct xrt_imu_sample *sample)
 		return;
 	}
 
+	if (er->use_container) {
+		lock_guard lock{er->container_lock};
+		if (er->container != nullptr) {
+			t_euroc_container_writer_push_imu(er->container, sample);
+		}
+		return;
+	}
+
 	{
 		lock_guard lock{er->imu_queue_lock};
 		er->imu_queue.push(*sample);
@@ -260,6 +273,14 @@ euroc_recorder_receive_gt(xrt_pose_sink *sink, struct xrt_pose_sample *sample)
 		return;
 	}
 
+	if (er->use_container) {
+		lock_guard lock{er->container_lock};
+		if (er->container != nullptr) {
+			t_euroc_container_writer_push_gt(er->container, sample);
+		}
+		return;
+	}
+
 	{
 		lock_guard lock{er->gt_queue_lock};
 		er->gt_queue.push(*sample);
@@ -278,7 +299,15 @@ euroc_recorder_receive_frame(euroc_recorder *er, struct xrt_frame *src_frame, in
 	xrt_frame *copy = nullptr;
 	u_frame_clone(src_frame, &copy);
 
-	xrt_sink_push_frame(er->writer_queues.cams[cam_index], copy);
+	if (er->use_container) {
+		// The container writer has its own thread, no need for the writer queues.
+		lock_guard lock{er->container_lock};
+		if (er->container != nullptr) {
+			t_euroc_container_writer_push_frame(er->container, cam_index, copy);
+		}
+	} else {
+		xrt_sink_push_frame(er->writer_queues.cams[cam_index], copy);
+	}
 
 	xrt_frame_reference(&copy, NULL);
 }
@@ -322,6 +351,7 @@ extern "C" void
 euroc_recorder_node_destroy(struct xrt_frame_node *node)
 {
 	struct euroc_recorder *er = container_of(node, struct euroc_recorder, node);
+	t_euroc_container_writer_destroy(&er->container);
 	delete er->imu_csv;
 	delete er->gt_csv;
 	for (int i = 0; i < er->cam_count; i++) {
@@ -352,6 +382,7 @@ euroc_recorder_create(struct xrt_frame_context *xfctx, const char *record_path,
 	xrt_frame_context_add(xfctx, xfn);
 
 	er->use_jpg = debug_get_bool_option_euroc_recorder_use_jpg();
+	er->use_container = debug_get_bool_option_euroc_recorder_use_container();
 
 	// Setup sink pipeline
 
@@ -413,7 +444,18 @@ euroc_recorder_start(struct xrt_slam_sinks *er_sinks)
 	string default_path = er->path_prefix + "_" + datetime;
 	er->path = default_path;
 
-	euroc_recorder_mkfiles(er);
+	if (er->use_container) {
+		string container_path = er->path + T_EUROC_CONTAINER_EXT;
+		struct t_euroc_container_writer *container = nullptr;
+		if (!t_euroc_container_writer_create(container_path.c_str(), er->cam_count, false, &container)) {
+			er->path = "";
+			return;
+		}
+		lock_guard lock{er->container_lock};
+		er->container = container;
+	} else {
+		euroc_recorder_mkfiles(er);
+	}
 	er->recording = true;
 }
 
@@ -429,6 +471,19 @@ euroc_recorder_stop(struct xrt_slam_sinks *er_sinks)
 
 	er->path = "";
 	er->recording = false;
+
+	if (er->use_container) {
+		struct t_euroc_container_writer *container = nullptr;
+		{
+			lock_guard lock{er->container_lock};
+			container = er->container;
+			er->container = nullptr;
+		}
+		// Writes out the queued frames, side tables and index.
+		t_euroc_container_writer_destroy(&container);
+		return;
+	}
+
 	euroc_recorder_flush(er);
 }
 
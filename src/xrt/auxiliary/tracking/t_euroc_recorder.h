@@ -15,6 +15,14 @@
 #define CSV_EOL "\r\n"
 #define CSV_PRECISION 10
 
+//! Header lines of the csv files in a EuRoC dataset.
+#define EUROC_IMU_CSV_HEADER                                                                                           \
+	"#timestamp [ns],w_RS_S_x [rad s^-1],w_RS_S_y [rad s^-1],w_RS_S_z [rad s^-1],"                                 \
+	"a_RS_S_x [m s^-2],a_RS_S_y [m s^-2],a_RS_S_z [m s^-2]" CSV_EOL
+#define EUROC_GT_CSV_HEADER                                                                                            \
+	"#timestamp [ns],p_RS_R_x [m],p_RS_R_y [m],p_RS_R_z [m],q_RS_w [],q_RS_x [],q_RS_y [],q_RS_z []" CSV_EOL
+#define EUROC_CAM_CSV_HEADER "#timestamp [ns],filename" CSV_EOL
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -22,6 +30,9 @@ extern "C" {
 /*!
  * Create SLAM sinks to record samples in EuRoC format.
  *
+ * With `EUROC_RECORDER_USE_CONTAINER` set, samples are recorded into a single
+ * @ref aux_tracking_euroc_container file instead of a dataset folder.
+ *
  * @param xfctx Frame context for the sinks.
  * @param record_path Directory name to save the dataset or NULL for a default based on the current datetime.
  * @param cam_count Number of cameras to record
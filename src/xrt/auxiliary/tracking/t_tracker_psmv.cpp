@@ -14,6 +14,7 @@
 #include "tracking/t_tracking.h"
 #include "tracking/t_calibration_opencv.hpp"
 #include "tracking/t_tracker_psmv_fusion.hpp"
+#include "tracking/t_tracker_psmv_blobs.hpp"
 #include "tracking/t_helper_debug_sink.hpp"
 
 #include "util/u_var.h"
@@ -35,44 +36,11 @@
 
 using namespace xrt::auxiliary::tracking;
 
+DEBUG_GET_ONCE_BOOL_OPTION(psmv_sparse_blobs, "PSMV_SPARSE_BLOBS", false)
+
 //! Namespace for PS Move tracking implementation
 namespace xrt::auxiliary::tracking::psmv {
 
-/*!
- * Single camera.
- *
- * @see TrackerPSMV
- */
-struct View
-{
-public:
-	cv::Mat undistort_rectify_map_x;
-	cv::Mat undistort_rectify_map_y;
-
-	cv::Matx33d intrinsics;
-	cv::Mat distortion; // size may vary
-	enum t_camera_distortion_model distortion_model;
-
-	std::vector<cv::KeyPoint> keypoints;
-
-	cv::Mat frame_undist_rectified;
-
-	void
-	populate_from_calib(t_camera_calibration &calib, const RemapPair &rectification)
-	{
-		CameraCalibrationWrapper wrap(calib);
-		intrinsics = wrap.intrinsics_mat;
-		distortion = wrap.distortion_mat.clone();
-		distortion_model = wrap.distortion_model;
-
-		undistort_rectify_map_x = rectification.remap_x;
-		undistort_rectify_map_y = rectification.remap_y;
-	}
-};
-
-// Has to be standard layout because is embedded in TrackerPSMV.
-static_assert(std::is_standard_layout<View>::value);
-
 /*!
  * The core object of the PS Move tracking setup.
  *
@@ -116,6 +84,9 @@ public:
 
 	cv::Ptr<cv::SimpleBlobDetector> sbd;
 
+	//! Find blobs on the raw image and only undistort them, see @ref View.
+	bool sparse_blobs;
+
 	std::shared_ptr<PSMVFusionInterface> filter;
 
 	xrt_vec3 tracked_object_position;
@@ -135,47 +106,15 @@ do_view(TrackerPSMV &t, View &view, cv::Mat &grey, cv::Mat &rgb)
 {
 	XRT_TRACE_MARKER();
 
-	{
-		XRT_TRACE_IDENT(remap);
-
-		// Undistort and rectify the whole image.
-		cv::remap(grey,                         // src
-		          view.frame_undist_rectified,  // dst
-		          view.undistort_rectify_map_x, // map1
-		          view.undistort_rectify_map_y, // map2
-		          cv::INTER_NEAREST,            // interpolation
-		          cv::BORDER_CONSTANT,          // borderMode
-		          cv::Scalar(0, 0, 0));         // borderValue
-	}
-
-	{
-		XRT_TRACE_IDENT(threshold);
-
-		cv::threshold(view.frame_undist_rectified, // src
-		              view.frame_undist_rectified, // dst
-		              32.0,                        // thresh
-		              255.0,                       // maxval
-		              0);                          // type
-	}
-
-	{
-		XRT_TRACE_IDENT(detect);
-
-		// Do blob detection with our masks.
-		//! @todo Re-enable masks.
-		t.sbd->detect(view.frame_undist_rectified, // image
-		              view.keypoints,              // keypoints
-		              cv::noArray());              // mask
+	if (t.sparse_blobs) {
+		view.find_blobs_sparse(grey);
+	} else {
+		view.find_blobs_dense(*t.sbd, grey);
 	}
 
-
 	// Debug is wanted, draw the keypoints.
 	if (rgb.cols > 0) {
-		cv::drawKeypoints(view.frame_undist_rectified,                // image
-		                  view.keypoints,                             // keypoints
-		                  rgb,                                        // outImage
-		                  cv::Scalar(255, 0, 0),                      // color
-		                  cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS); // flags
+		view.draw_debug(rgb, t.sparse_blobs);
 	}
 }
 
@@ -610,37 +549,22 @@ t_psmv_create(struct xrt_frame_context *xfctx,
 	}
 
 	StereoRectificationMaps rectify(data);
-	t.view[0].populate_from_calib(data->view[0], rectify.view[0].rectify);
-	t.view[1].populate_from_calib(data->view[1], rectify.view[1].rectify);
+	t.view[0].populate_from_calib(data->view[0], rectify.view[0]);
+	t.view[1].populate_from_calib(data->view[1], rectify.view[1]);
 	t.disparity_to_depth = rectify.disparity_to_depth_mat;
 	StereoCameraCalibrationWrapper wrapped(data);
 	t.r_cam_rotation = wrapped.camera_rotation_mat;
 	t.r_cam_translation = wrapped.camera_translation_mat;
 	t.calibrated = true;
 
-	// clang-format off
-	cv::SimpleBlobDetector::Params blob_params;
-	blob_params.filterByArea = false;
-	blob_params.filterByConvexity = true;
-	blob_params.minConvexity = 0.8;
-	blob_params.filterByInertia = false;
-	blob_params.filterByColor = true;
-	blob_params.blobColor = 255; // 0 or 255 - color comes from binarized image?
-	blob_params.minArea = 1;
-	blob_params.maxArea = 1000;
-	blob_params.maxThreshold = 51; // using a wide threshold span slows things down bigtime
-	blob_params.minThreshold = 50;
-	blob_params.thresholdStep = 1;
-	blob_params.minDistBetweenBlobs = 5;
-	blob_params.minRepeatability = 1; // need this to avoid error?
-	// clang-format on
-
-	t.sbd = cv::SimpleBlobDetector::create(blob_params);
+	t.sbd = create_blob_detector();
+	t.sparse_blobs = debug_get_bool_option_psmv_sparse_blobs();
 	xrt_frame_context_add(xfctx, &t.node);
 
 	// Everything is safe, now setup the variable tracking.
 	u_var_add_root(&t, "PSMV Tracker", true);
 	u_var_add_vec3_f32(&t, &t.tracked_object_position, "last.ball.pos");
+	u_var_add_bool(&t, &t.sparse_blobs, "Sparse blobs");
 	u_var_add_sink_debug(&t, &t.debug.usd, "Debug");
 
 	*out_sink = &t.sink;
@@ -0,0 +1,229 @@
+// Copyright 2019-2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  PS Move tracker blob finding.
+ * @author Pete Black <pblack@collabora.com>
+ * @author Jakob Bornecrantz <jakob@collabora.com>
+ * @author Rylie Pavlik <rylie.pavlik@collabora.com>
+ * @ingroup aux_tracking
+ */
+
+#include "tracking/t_tracker_psmv_blobs.hpp"
+
+#include "util/u_trace_marker.h"
+
+#include <cmath>
+
+
+namespace xrt::auxiliary::tracking::psmv {
+
+//! Pixels above this are part of the ball.
+static constexpr double kThreshold = 32.0;
+
+//! Blobs less convex than this are not balls, shared by both paths.
+static constexpr float kMinConvexity = 0.8f;
+
+
+/*
+ *
+ * View functions.
+ *
+ */
+
+void
+View::populate_from_calib(t_camera_calibration &calib, const ViewRectification &rectification)
+{
+	CameraCalibrationWrapper wrap(calib);
+	intrinsics = wrap.intrinsics_mat;
+	distortion = wrap.distortion_mat.clone();
+	distortion_model = wrap.distortion_model;
+
+	undistort_rectify_map_x = rectification.rectify.remap_x;
+	undistort_rectify_map_y = rectification.rectify.remap_y;
+	rectify_rotation = rectification.rotation_mat.clone();
+	rectify_projection = rectification.projection_mat.clone();
+}
+
+void
+View::find_blobs_dense(cv::SimpleBlobDetector &sbd, const cv::Mat &grey)
+{
+	{
+		XRT_TRACE_IDENT(remap);
+
+		// Undistort and rectify the whole image.
+		cv::remap(grey,                    // src
+		          frame_undist_rectified,  // dst
+		          undistort_rectify_map_x, // map1
+		          undistort_rectify_map_y, // map2
+		          cv::INTER_NEAREST,       // interpolation
+		          cv::BORDER_CONSTANT,     // borderMode
+		          cv::Scalar(0, 0, 0));    // borderValue
+	}
+
+	{
+		XRT_TRACE_IDENT(threshold);
+
+		cv::threshold(frame_undist_rectified, // src
+		              frame_undist_rectified, // dst
+		              kThreshold,             // thresh
+		              255.0,                  // maxval
+		              0);                     // type
+	}
+
+	{
+		XRT_TRACE_IDENT(detect);
+
+		// Do blob detection with our masks.
+		//! @todo Re-enable masks.
+		sbd.detect(frame_undist_rectified, // image
+		           keypoints,              // keypoints
+		           cv::noArray());         // mask
+	}
+}
+
+void
+View::find_blobs_sparse(const cv::Mat &grey)
+{
+	keypoints.clear();
+	keypoints_raw.clear();
+	points_raw.clear();
+	points_rectified.clear();
+
+	{
+		XRT_TRACE_IDENT(threshold);
+
+		cv::threshold(grey,            // src
+		              frame_threshold, // dst
+		              kThreshold,      // thresh
+		              255.0,           // maxval
+		              0);              // type
+	}
+
+	{
+		XRT_TRACE_IDENT(contours);
+
+		/*
+		 * Same as the blob detector does on its thresholded image, this
+		 * is much cheaper than labelling every pixel with
+		 * cv::connectedComponentsWithStats.
+		 */
+		cv::findContours(frame_threshold,        // image
+		                 contours,               // contours
+		                 cv::RETR_EXTERNAL,      // mode
+		                 cv::CHAIN_APPROX_NONE); // method
+	}
+
+	{
+		XRT_TRACE_IDENT(filter);
+
+		/*
+		 * Every contour is its own blob. The blob detector only merges
+		 * blobs that are close across threshold steps, and it is set
+		 * up with a single step, see @ref create_blob_detector.
+		 */
+		for (const std::vector<cv::Point> &contour : contours) {
+			cv::Moments moms = cv::moments(contour);
+
+			// Single pixels and lines have no area, the blob detector skips them too.
+			if (moms.m00 == 0.0) {
+				continue;
+			}
+
+			// Same convexity filter as the blob detector.
+			cv::convexHull(contour, hull);
+			double hull_area = cv::contourArea(hull);
+			if (hull_area == 0.0 || moms.m00 / hull_area < kMinConvexity) {
+				continue;
+			}
+
+			cv::Point2f pt((float)(moms.m10 / moms.m00), (float)(moms.m01 / moms.m00));
+			float size = 2.0f * std::sqrt((float)moms.m00 / (float)M_PI);
+
+			keypoints_raw.emplace_back(pt, size);
+		}
+	}
+
+	if (keypoints_raw.empty()) {
+		return;
+	}
+
+	{
+		XRT_TRACE_IDENT(undistort);
+
+		for (const cv::KeyPoint &kp : keypoints_raw) {
+			points_raw.push_back(kp.pt);
+		}
+
+		// Same models as calibration_get_undistort_map.
+		if (distortion_model == T_DISTORTION_FISHEYE_KB4) {
+			cv::fisheye::undistortPoints(points_raw,          // distorted
+			                             points_rectified,    // undistorted
+			                             intrinsics,          // K
+			                             distortion,          // D
+			                             rectify_rotation,    // R
+			                             rectify_projection); // P
+		} else {
+			cv::undistortPoints(points_raw,          // src
+			                    points_rectified,    // dst
+			                    intrinsics,          // cameraMatrix
+			                    distortion,          // distCoeffs
+			                    rectify_rotation,    // R
+			                    rectify_projection); // P
+		}
+	}
+
+	// The dense path loses blobs that are rectified out of the image.
+	cv::Rect2f bounds(0, 0, (float)grey.cols, (float)grey.rows);
+	for (size_t i = 0; i < points_rectified.size(); i++) {
+		if (bounds.contains(points_rectified[i])) {
+			keypoints.emplace_back(points_rectified[i], keypoints_raw[i].size);
+		}
+	}
+}
+
+void
+View::draw_debug(cv::Mat &rgb, bool sparse)
+{
+	// The sparse path never makes a rectified image, draw the raw one.
+	const cv::Mat &image = sparse ? frame_threshold : frame_undist_rectified;
+	const std::vector<cv::KeyPoint> &kps = sparse ? keypoints_raw : keypoints;
+
+	cv::drawKeypoints(image,                                      // image
+	                  kps,                                        // keypoints
+	                  rgb,                                        // outImage
+	                  cv::Scalar(255, 0, 0),                      // color
+	                  cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS); // flags
+}
+
+
+/*
+ *
+ * Exported functions.
+ *
+ */
+
+cv::Ptr<cv::SimpleBlobDetector>
+create_blob_detector()
+{
+	// clang-format off
+	cv::SimpleBlobDetector::Params blob_params;
+	blob_params.filterByArea = false;
+	blob_params.filterByConvexity = true;
+	blob_params.minConvexity = kMinConvexity;
+	blob_params.filterByInertia = false;
+	blob_params.filterByColor = true;
+	blob_params.blobColor = 255; // 0 or 255 - color comes from binarized image?
+	blob_params.minArea = 1;
+	blob_params.maxArea = 1000;
+	blob_params.maxThreshold = 51; // using a wide threshold span slows things down bigtime
+	blob_params.minThreshold = 50;
+	blob_params.thresholdStep = 1;
+	blob_params.minDistBetweenBlobs = 5;
+	blob_params.minRepeatability = 1; // need this to avoid error?
+	// clang-format on
+
+	return cv::SimpleBlobDetector::create(blob_params);
+}
+
+} // namespace xrt::auxiliary::tracking::psmv
@@ -0,0 +1,104 @@
+// Copyright 2019-2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  PS Move tracker blob finding.
+ * @author Pete Black <pblack@collabora.com>
+ * @author Jakob Bornecrantz <jakob@collabora.com>
+ * @author Rylie Pavlik <rylie.pavlik@collabora.com>
+ * @ingroup aux_tracking
+ */
+
+#pragma once
+
+#ifndef __cplusplus
+#error "This header is C++-only."
+#endif
+
+#include "tracking/t_tracking.h"
+#include "tracking/t_calibration_opencv.hpp"
+
+#include <vector>
+#include <type_traits>
+
+
+namespace xrt::auxiliary::tracking::psmv {
+
+/*!
+ * Single camera, finds the ball blobs in its half of the frame and hands them
+ * out as keypoints in undistorted and rectified pixel coordinates.
+ *
+ * There are two ways of getting there, they should give the same keypoints
+ * give or take sub-pixel differences:
+ *
+ * - Dense: remap the whole image, threshold it and run a
+ *   cv::SimpleBlobDetector on the result.
+ * - Sparse: threshold the raw image, find the outer contours on it and only
+ *   undistort and rectify their centroids. The ball is a handful of pixels so
+ *   this skips almost all of the work of the dense path.
+ *
+ * @see TrackerPSMV
+ */
+struct View
+{
+public:
+	cv::Mat undistort_rectify_map_x;
+	cv::Mat undistort_rectify_map_y;
+
+	cv::Matx33d intrinsics;
+	cv::Mat distortion; // size may vary
+	enum t_camera_distortion_model distortion_model;
+
+	//! Rectification rotation (R) for this view, used by the sparse path.
+	cv::Mat rectify_rotation;
+	//! Projection (P) into the rectified image, used by the sparse path.
+	cv::Mat rectify_projection;
+
+	std::vector<cv::KeyPoint> keypoints;
+
+	cv::Mat frame_undist_rectified;
+
+	//! Sparse path scratch, the raw thresholded image.
+	cv::Mat frame_threshold;
+	//! Sparse path scratch, outer contours of the thresholded image.
+	std::vector<std::vector<cv::Point>> contours;
+	//! Sparse path scratch, convex hull of the current contour.
+	std::vector<cv::Point> hull;
+	//! Sparse path scratch, the blobs in the raw image for drawing.
+	std::vector<cv::KeyPoint> keypoints_raw;
+	//! Sparse path scratch, centroids before and after undistortion.
+	std::vector<cv::Point2f> points_raw, points_rectified;
+
+	void
+	populate_from_calib(t_camera_calibration &calib, const ViewRectification &rectification);
+
+	/*!
+	 * Remap, threshold and detect on the whole image, fills in @ref keypoints.
+	 */
+	void
+	find_blobs_dense(cv::SimpleBlobDetector &sbd, const cv::Mat &grey);
+
+	/*!
+	 * Threshold and find the blobs on the raw image, then only undistort
+	 * their centroids, fills in @ref keypoints.
+	 */
+	void
+	find_blobs_sparse(const cv::Mat &grey);
+
+	/*!
+	 * Draw the image and keypoints of the last find call into @p rgb.
+	 */
+	void
+	draw_debug(cv::Mat &rgb, bool sparse);
+};
+
+// Has to be standard layout because is embedded in TrackerPSMV.
+static_assert(std::is_standard_layout<View>::value);
+
+/*!
+ * Create the blob detector used by @ref View::find_blobs_dense.
+ */
+cv::Ptr<cv::SimpleBlobDetector>
+create_blob_detector();
+
+} // namespace xrt::auxiliary::tracking::psmv
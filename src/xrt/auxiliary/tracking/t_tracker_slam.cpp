@@ -21,6 +21,7 @@
 #include "math/m_api.h"
 #include "math/m_filter_fifo.h"
 #include "math/m_filter_one_euro.h"
+#include "math/m_imu_preintegration.h"
 #include "math/m_predict.h"
 #include "math/m_relation_history.h"
 #include "math/m_space.h"
@@ -293,6 +294,14 @@ struct TrackerSlam
 	struct os_mutex lock_ff;        //!< Lock for gyro_ff and accel_ff.
 	struct m_ff_vec3_f32 *gyro_ff;  //!< Last gyroscope samples
 	struct m_ff_vec3_f32 *accel_ff; //!< Last accelerometer samples
+	struct m_imu_preintegration imu_preint; //!< IMU integrated since the latest SLAM pose, guarded by @ref lock_ff
+
+	//! Scratch space to read the fifos into in one go, guarded by @ref lock_ff
+	struct
+	{
+		vector<float> gx, gy, gz, ax, ay, az;
+		vector<uint64_t> g_ts, a_ts;
+	} imu_batch;
 	vector<u_sink_debug> ui_sink;   //!< Sink to display frames in UI of each camera
 
 	//! Used to correct accelerometer measurements when integrating into the prediction.
@@ -730,6 +739,66 @@ gt_ui_push(TrackerSlam &t, timepoint_ns ts, xrt_pose tracked_pose)
  *
  */
 
+//! Integrates the buffered IMU samples newer than @p pi's base up to @p until_ns, @ref lock_ff must be held.
+static void
+integrate_imu_samples(TrackerSlam &t, struct m_imu_preintegration &pi, timepoint_ns until_ns)
+{
+	// Count the samples newer than the base, index 0 is the newest one
+	size_t count = m_ff_vec3_f32_count_since(t.gyro_ff, pi.base_ts < 0 ? 0 : (uint64_t)pi.base_ts);
+
+	if (count == 0) {
+		SLAM_WARN("No IMU samples received after latest SLAM pose (and frame)");
+		return;
+	}
+
+	// Only grows, so this stops allocating once it's the size of the fifo
+	auto &b = t.imu_batch;
+	for (auto *v : {&b.gx, &b.gy, &b.gz, &b.ax, &b.ay, &b.az}) {
+		v->resize(count);
+	}
+	b.g_ts.resize(count);
+	b.a_ts.resize(count);
+
+	size_t got_g = m_ff_vec3_f32_get_batch(t.gyro_ff, 0, count, &b.gx[0], &b.gy[0], &b.gz[0], &b.g_ts[0]);
+	size_t got_a = m_ff_vec3_f32_get_batch(t.accel_ff, 0, count, &b.ax[0], &b.ay[0], &b.az[0], &b.a_ts[0]);
+	SLAM_DASSERT(got_g == count && got_a == count, "Failure getting gyro and accel samples");
+
+	for (size_t i = count; i-- > 0;) { // Decreasing i increases timestamp
+		xrt_vec3 g{b.gx[i], b.gy[i], b.gz[i]};
+		xrt_vec3 a{b.ax[i], b.ay[i], b.az[i]};
+		uint64_t g_ts = b.g_ts[i];
+		SLAM_DASSERT(g_ts == b.a_ts[i], "Failure getting synced gyro and accel samples");
+
+		timepoint_ns ts = g_ts;
+		if (ts > until_ns) {
+			// Stop in between this sample and the previous one
+			m_imu_preintegration_integrate_interpolated(&pi, until_ns, ts, &a, &g);
+			break;
+		}
+
+		m_imu_preintegration_integrate(&pi, ts, &a, &g);
+	}
+}
+
+//! Restarts @ref TrackerSlam::imu_preint on top of the latest SLAM pose if it changed.
+static void
+reset_imu_preintegration(TrackerSlam &t)
+{
+	uint64_t rel_ts;
+	xrt_space_relation rel{};
+	if (!t.slam_rels.get_latest(&rel_ts, &rel)) {
+		return;
+	}
+
+	os_mutex_lock(&t.lock_ff);
+	if (t.imu_preint.base_ts != (int64_t)rel_ts) {
+		// Once per pose, catches up on the samples received while the pose was being computed.
+		m_imu_preintegration_reset(&t.imu_preint, (int64_t)rel_ts);
+		integrate_imu_samples(t, t.imu_preint, INT64_MAX);
+	}
+	os_mutex_unlock(&t.lock_ff);
+}
+
 //! Dequeue all tracked poses from the SLAM system and update prediction data with them.
 static bool
 flush_poses(TrackerSlam &t)
@@ -802,6 +871,8 @@ flush_poses(TrackerSlam &t)
 		t.vit.pose_destroy(pose);
 	} while (t.vit.tracker_pop_pose(t.tracker, &pose) == VIT_SUCCESS && pose);
 
+	reset_imu_preintegration(t);
+
 	return true;
 }
 
@@ -813,83 +884,26 @@ predict_pose_from_imu(TrackerSlam &t,
                       timepoint_ns base_rel_ts,
                       struct xrt_space_relation *out_relation)
 {
-	os_mutex_lock(&t.lock_ff);
-
-	// Find oldest imu index i that is newer than latest SLAM pose (or -1)
-	int i = 0;
-	uint64_t imu_ts = UINT64_MAX;
-	xrt_vec3 _;
-	while (m_ff_vec3_f32_get(t.gyro_ff, i, &_, &imu_ts)) {
-		if ((int64_t)imu_ts < base_rel_ts) {
-			i--; // Back to the oldest newer-than-SLAM IMU index (or -1)
-			break;
-		}
-		i++;
-	}
-
-	if (i == -1) {
-		SLAM_WARN("No IMU samples received after latest SLAM pose (and frame)");
-	}
+	struct m_imu_preintegration pi;
 
-	xrt_space_relation integ_rel = base_rel;
-	timepoint_ns integ_rel_ts = base_rel_ts;
-	xrt_quat &o = integ_rel.pose.orientation;
-	xrt_vec3 &p = integ_rel.pose.position;
-	xrt_vec3 &w = integ_rel.angular_velocity;
-	xrt_vec3 &v = integ_rel.linear_velocity;
-	bool clamped = false; // If when_ns is older than the latest IMU ts
-
-	while (i >= 0) { // Decreasing i increases timestamp
-		// Get samples
-		xrt_vec3 g{};
-		xrt_vec3 a{};
-		uint64_t g_ts{};
-		uint64_t a_ts{};
-		bool got = true;
-		got &= m_ff_vec3_f32_get(t.gyro_ff, i, &g, &g_ts);
-		got &= m_ff_vec3_f32_get(t.accel_ff, i, &a, &a_ts);
-		timepoint_ns ts = g_ts;
-
-
-		// Checks
-		if (ts > when_ns) {
-			clamped = true;
-			//! @todo Instead of using same a and g values, do an interpolated sample like this:
-			// a = prev_a + ((when_ns - prev_ts) / (ts - prev_ts)) * (a - prev_a);
-			// g = prev_g + ((when_ns - prev_ts) / (ts - prev_ts)) * (g - prev_g);
-			ts = when_ns; // clamp ts to when_ns
-		}
-		SLAM_DASSERT(got && g_ts == a_ts, "Failure getting synced gyro and accel samples");
-		SLAM_DASSERT(ts >= base_rel_ts, "Accessing imu sample that is older than latest SLAM pose");
-
-		// Update time
-		float dt = (float)time_ns_to_s(ts - integ_rel_ts);
-		integ_rel_ts = ts;
-
-		// Integrate gyroscope
-		xrt_quat angvel_delta{};
-		xrt_vec3 scaled_half_g = g * dt * 0.5f;
-		math_quat_exp(&scaled_half_g, &angvel_delta); // Same as using math_quat_from_angle_vector(g/dt)
-		math_quat_rotate(&o, &angvel_delta, &o);      // Orientation
-		math_quat_rotate_derivative(&o, &g, &w);      // Angular velocity
-
-		// Integrate accelerometer
-		xrt_vec3 world_accel{};
-		math_quat_rotate_vec3(&o, &a, &world_accel);
-		world_accel += t.gravity_correction;
-		v += world_accel * dt;                        // Linear velocity
-		p += v * dt + world_accel * (dt * dt * 0.5f); // Position
+	os_mutex_lock(&t.lock_ff);
 
-		if (clamped) {
-			break;
-		}
-		i--;
+	if (t.imu_preint.base_ts == base_rel_ts && when_ns >= t.imu_preint.last_ts) {
+		// Common case, everything up to the latest IMU sample is already integrated.
+		pi = t.imu_preint;
+	} else {
+		// Base pose not flushed yet or asking for a time before the latest IMU sample.
+		m_imu_preintegration_reset(&pi, base_rel_ts);
+		integrate_imu_samples(t, pi, when_ns);
 	}
 
 	os_mutex_unlock(&t.lock_ff);
 
+	xrt_space_relation integ_rel{};
+	m_imu_preintegration_apply(&pi, &base_rel, &t.gravity_correction, &integ_rel);
+
 	// Do the prediction based on the updated relation
-	double last_imu_to_now_dt = time_ns_to_s(when_ns - integ_rel_ts);
+	double last_imu_to_now_dt = time_ns_to_s(when_ns - pi.last_ts);
 	xrt_space_relation predicted_relation{};
 	m_predict_relation(&integ_rel, last_imu_to_now_dt, &predicted_relation);
 
@@ -1033,6 +1047,7 @@ setup_ui(TrackerSlam &t)
 	os_mutex_init(&t.lock_ff);
 	m_ff_vec3_f32_alloc(&t.gyro_ff, 1000);
 	m_ff_vec3_f32_alloc(&t.accel_ff, 1000);
+	m_imu_preintegration_reset(&t.imu_preint, INT64_MAX); // Nothing to integrate on top of yet
 	m_ff_vec3_f32_alloc(&t.filter.pos_ff, 1000);
 	m_ff_vec3_f32_alloc(&t.filter.rot_ff, 1000);
 
@@ -1322,6 +1337,7 @@ t_slam_receive_imu(struct xrt_imu_sink *sink, struct xrt_imu_sample *s)
 	os_mutex_lock(&t.lock_ff);
 	m_ff_vec3_f32_push(t.gyro_ff, &gyro, ts);
 	m_ff_vec3_f32_push(t.accel_ff, &accel, ts);
+	m_imu_preintegration_integrate(&t.imu_preint, ts, &accel, &gyro);
 	os_mutex_unlock(&t.lock_ff);
 }
 
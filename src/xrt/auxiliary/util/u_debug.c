@@ -14,6 +14,8 @@
 #include "util/u_debug.h"
 #include "util/u_logging.h"
 
+#include "os/os_threading.h"
+
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -24,6 +26,13 @@
 #endif
 
 
+/*!
+ * Lock for the get once helpers, recursive as the getters log which in turn
+ * reads options, one of them being XRT_PRINT_OPTIONS just below.
+ */
+static struct os_mutex g_once_mutex;
+static struct os_once g_once_init = OS_ONCE_INIT;
+
 DEBUG_GET_ONCE_BOOL_OPTION(print, "XRT_PRINT_OPTIONS", false)
 
 
@@ -150,6 +159,33 @@ is_str_in_start_of(const char *str, const char *matches)
 }
 
 
+static void
+once_mutex_init(void)
+{
+	os_mutex_recursive_init(&g_once_mutex);
+}
+
+
+/*
+ *
+ * 'Exported' once functions.
+ *
+ */
+
+void
+debug_once_lock(void)
+{
+	os_once_call(&g_once_init, once_mutex_init);
+	os_mutex_lock(&g_once_mutex);
+}
+
+void
+debug_once_unlock(void)
+{
+	os_mutex_unlock(&g_once_mutex);
+}
+
+
 /*
  *
  * 'Exported' conversion functions.
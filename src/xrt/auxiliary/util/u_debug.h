@@ -92,15 +92,36 @@ debug_get_log_option(const char *name, enum u_logging_level _default);
  *
  */
 
+/*!
+ * Take the lock that the get once helpers below read their options under, it
+ * is recursive so that reading an option can log through a logger that reads
+ * its own options. Such a nested read of an option that is already being read
+ * gets the zero value, like it always has.
+ */
+void
+debug_once_lock(void);
+
+/*!
+ * Release the lock taken with @ref debug_once_lock.
+ */
+void
+debug_once_unlock(void);
+
 #define DEBUG_GET_ONCE_OPTION(suffix, name, _default)                                                                  \
 	static const char *debug_get_option_##suffix(void)                                                             \
 	{                                                                                                              \
 		static char storage[DEBUG_CHAR_STORAGE_SIZE];                                                          \
-		static bool gotten = false;                                                                            \
+		static xrt_atomic_s32_t gotten = 0;                                                                    \
+		static bool started = false;                                                                           \
 		static const char *stored;                                                                             \
-		if (!gotten) {                                                                                         \
-			gotten = true;                                                                                 \
-			stored = debug_get_option(storage, ARRAY_SIZE(storage), name, _default);                       \
+		if (!xrt_atomic_s32_load(&gotten)) {                                                                   \
+			debug_once_lock();                                                                             \
+			if (!started) {                                                                                \
+				started = true;                                                                        \
+				stored = debug_get_option(storage, ARRAY_SIZE(storage), name, _default);               \
+				xrt_atomic_s32_store(&gotten, 1);                                                      \
+			}                                                                                              \
+			debug_once_unlock();                                                                           \
 		}                                                                                                      \
 		return stored;                                                                                         \
 	}
@@ -108,11 +129,17 @@ debug_get_log_option(const char *name, enum u_logging_level _default);
 #define DEBUG_GET_ONCE_TRISTATE_OPTION(suffix, name)                                                                   \
 	static enum debug_tristate_option debug_get_tristate_option_##suffix(void)                                     \
 	{                                                                                                              \
-		static bool gotten = false;                                                                            \
+		static xrt_atomic_s32_t gotten = 0;                                                                    \
+		static bool started = false;                                                                           \
 		static enum debug_tristate_option stored;                                                              \
-		if (!gotten) {                                                                                         \
-			gotten = true;                                                                                 \
-			stored = debug_get_tristate_option(name);                                                      \
+		if (!xrt_atomic_s32_load(&gotten)) {                                                                   \
+			debug_once_lock();                                                                             \
+			if (!started) {                                                                                \
+				started = true;                                                                        \
+				stored = debug_get_tristate_option(name);                                              \
+				xrt_atomic_s32_store(&gotten, 1);                                                      \
+			}                                                                                              \
+			debug_once_unlock();                                                                           \
 		}                                                                                                      \
 		return stored;                                                                                         \
 	}
@@ -120,11 +147,17 @@ debug_get_log_option(const char *name, enum u_logging_level _default);
 #define DEBUG_GET_ONCE_BOOL_OPTION(suffix, name, _default)                                                             \
 	static bool debug_get_bool_option_##suffix(void)                                                               \
 	{                                                                                                              \
-		static bool gotten = false;                                                                            \
+		static xrt_atomic_s32_t gotten = 0;                                                                    \
+		static bool started = false;                                                                           \
 		static bool stored;                                                                                    \
-		if (!gotten) {                                                                                         \
-			gotten = true;                                                                                 \
-			stored = debug_get_bool_option(name, _default);                                                \
+		if (!xrt_atomic_s32_load(&gotten)) {                                                                   \
+			debug_once_lock();                                                                             \
+			if (!started) {                                                                                \
+				started = true;                                                                        \
+				stored = debug_get_bool_option(name, _default);                                        \
+				xrt_atomic_s32_store(&gotten, 1);                                                      \
+			}                                                                                              \
+			debug_once_unlock();                                                                           \
 		}                                                                                                      \
 		return stored;                                                                                         \
 	}
@@ -132,11 +165,17 @@ debug_get_log_option(const char *name, enum u_logging_level _default);
 #define DEBUG_GET_ONCE_NUM_OPTION(suffix, name, _default)                                                              \
 	static long debug_get_num_option_##suffix(void)                                                                \
 	{                                                                                                              \
-		static long gotten = false;                                                                            \
+		static xrt_atomic_s32_t gotten = 0;                                                                    \
+		static bool started = false;                                                                           \
 		static long stored;                                                                                    \
-		if (!gotten) {                                                                                         \
-			gotten = true;                                                                                 \
-			stored = debug_get_num_option(name, _default);                                                 \
+		if (!xrt_atomic_s32_load(&gotten)) {                                                                   \
+			debug_once_lock();                                                                             \
+			if (!started) {                                                                                \
+				started = true;                                                                        \
+				stored = debug_get_num_option(name, _default);                                         \
+				xrt_atomic_s32_store(&gotten, 1);                                                      \
+			}                                                                                              \
+			debug_once_unlock();                                                                           \
 		}                                                                                                      \
 		return stored;                                                                                         \
 	}
@@ -144,11 +183,17 @@ debug_get_log_option(const char *name, enum u_logging_level _default);
 #define DEBUG_GET_ONCE_FLOAT_OPTION(suffix, name, _default)                                                            \
 	static float debug_get_float_option_##suffix(void)                                                             \
 	{                                                                                                              \
-		static long gotten = false;                                                                            \
+		static xrt_atomic_s32_t gotten = 0;                                                                    \
+		static bool started = false;                                                                           \
 		static float stored;                                                                                   \
-		if (!gotten) {                                                                                         \
-			gotten = true;                                                                                 \
-			stored = debug_get_float_option(name, _default);                                               \
+		if (!xrt_atomic_s32_load(&gotten)) {                                                                   \
+			debug_once_lock();                                                                             \
+			if (!started) {                                                                                \
+				started = true;                                                                        \
+				stored = debug_get_float_option(name, _default);                                       \
+				xrt_atomic_s32_store(&gotten, 1);                                                      \
+			}                                                                                              \
+			debug_once_unlock();                                                                           \
 		}                                                                                                      \
 		return stored;                                                                                         \
 	}
@@ -156,15 +201,20 @@ debug_get_log_option(const char *name, enum u_logging_level _default);
 #define DEBUG_GET_ONCE_LOG_OPTION(suffix, name, _default)                                                              \
 	static enum u_logging_level debug_get_log_option_##suffix(void)                                                \
 	{                                                                                                              \
-		static long gotten = false;                                                                            \
+		static xrt_atomic_s32_t gotten = 0;                                                                    \
+		static bool started = false;                                                                           \
 		static enum u_logging_level stored;                                                                    \
-		if (!gotten) {                                                                                         \
-			gotten = true;                                                                                 \
-			stored = debug_get_log_option(name, _default);                                                 \
+		if (!xrt_atomic_s32_load(&gotten)) {                                                                   \
+			debug_once_lock();                                                                             \
+			if (!started) {                                                                                \
+				started = true;                                                                        \
+				stored = debug_get_log_option(name, _default);                                         \
+				xrt_atomic_s32_store(&gotten, 1);                                                      \
+			}                                                                                              \
+			debug_once_unlock();                                                                           \
 		}                                                                                                      \
 		return stored;                                                                                         \
 	}
-
 #ifdef __cplusplus
 }
 #endif
@@ -12,6 +12,7 @@
 #include "util/u_frame.h"
 #include "util/u_debug.h"
 #include "util/u_format.h"
+#include "util/u_worker.h"
 #include "util/u_distortion_mesh.h"
 
 #include "math/m_vec2.h"
@@ -19,25 +20,42 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
 #include <assert.h>
 
 
 DEBUG_GET_ONCE_NUM_OPTION(mesh_size, "XRT_MESH_SIZE", 64)
 
 
+//! Number of threads used to generate meshes when the device has a batch function.
+#define MESH_THREADS 4
+
+//! Samples the batch helpers evaluate at once, sized so the temporaries stay in L1.
+#define BATCH_SIZE 64
+
 typedef bool (*func_calc)(struct xrt_device *xdev, uint32_t view, float u, float v, struct xrt_uv_triplet *result);
 
+typedef bool (*func_calc_batch)(struct xrt_device *xdev,
+                                uint32_t view,
+                                uint32_t count,
+                                const struct xrt_vec2 *uvs,
+                                struct xrt_uv_triplet *results);
+
 static int
 index_for(int row, int col, uint32_t stride, uint32_t offset)
 {
 	return row * stride + col + offset;
 }
 
+/*!
+ * Generates the indices for a mesh of @p num by @p num cells per view, the
+ * vertices of each view following each other in @p verts, and sets it on the
+ * target. Takes ownership of @p verts.
+ */
 static void
-run_func(struct xrt_device *xdev, func_calc calc, struct xrt_hmd_parts *target, uint32_t num)
+set_mesh(struct xrt_hmd_parts *target, float *verts, uint32_t num)
 {
-	assert(calc != NULL);
-
 	uint32_t view_count = target->view_count;
 
 	uint32_t vertex_offsets[XRT_MAX_VIEWS] = {0};
@@ -53,36 +71,9 @@ run_func(struct xrt_device *xdev, func_calc calc, struct xrt_hmd_parts *target,
 
 	uint32_t uv_channels_count = 3;
 	uint32_t stride_in_floats = 2 + uv_channels_count * 2;
-	uint32_t float_count = vertex_count * stride_in_floats;
-
-	float *verts = U_TYPED_ARRAY_CALLOC(float, float_count);
 
-	// Setup the vertices for all views.
-	uint32_t i = 0;
 	for (uint32_t view = 0; view < view_count; view++) {
-		vertex_offsets[view] = i / stride_in_floats;
-
-		for (uint32_t r = 0; r < vert_rows; r++) {
-			// This goes from 0 to 1.0 inclusive.
-			float v = (float)r / (float)cells_rows;
-
-			for (uint32_t c = 0; c < vert_cols; c++) {
-				// This goes from 0 to 1.0 inclusive.
-				float u = (float)c / (float)cells_cols;
-
-				// Make the position in the range of [-1, 1]
-				verts[i + 0] = u * 2.0f - 1.0f;
-				verts[i + 1] = v * 2.0f - 1.0f;
-
-				if (!calc(xdev, view, u, v, (struct xrt_uv_triplet *)&verts[i + 2])) {
-					// bail on error, without updating
-					// distortion.preferred
-					return;
-				}
-
-				i += stride_in_floats;
-			}
-		}
+		vertex_offsets[view] = vertex_count_per_view * view;
 	}
 
 	uint32_t index_count_per_view = cells_rows * (vert_cols * 2 + 2);
@@ -90,7 +81,7 @@ run_func(struct xrt_device *xdev, func_calc calc, struct xrt_hmd_parts *target,
 	int *indices = U_TYPED_ARRAY_CALLOC(int, index_count_total);
 
 	// Set up indices for all views.
-	i = 0;
+	uint32_t i = 0;
 	for (uint32_t view = 0; view < view_count; view++) {
 		index_offsets[view] = i;
 
@@ -124,6 +115,181 @@ run_func(struct xrt_device *xdev, func_calc calc, struct xrt_hmd_parts *target,
 	}
 }
 
+/*!
+ * A run of rows of one view, the unit of work handed to the worker threads.
+ */
+struct mesh_job
+{
+	struct xrt_device *xdev;
+	func_calc calc;
+	func_calc_batch calc_batch;
+
+	uint32_t view;
+	uint32_t num;
+	uint32_t first_row;
+	uint32_t row_count;
+
+	//! Start of this view's vertices.
+	float *verts;
+
+	bool failed;
+};
+
+static void
+mesh_job_run(void *ptr)
+{
+	struct mesh_job *job = (struct mesh_job *)ptr;
+
+	const uint32_t stride_in_floats = U_DISTORTION_MESH_STRIDE_IN_FLOATS;
+	const uint32_t cells = job->num;
+	const uint32_t vert_cols = cells + 1;
+
+	struct xrt_vec2 *uvs = U_TYPED_ARRAY_CALLOC(struct xrt_vec2, vert_cols);
+	struct xrt_uv_triplet *results = U_TYPED_ARRAY_CALLOC(struct xrt_uv_triplet, vert_cols);
+
+	for (uint32_t r = job->first_row; r < job->first_row + job->row_count; r++) {
+		float *row = job->verts + (size_t)r * vert_cols * stride_in_floats;
+
+		// This goes from 0 to 1.0 inclusive.
+		float v = (float)r / (float)cells;
+
+		for (uint32_t c = 0; c < vert_cols; c++) {
+			// This goes from 0 to 1.0 inclusive.
+			uvs[c].x = (float)c / (float)cells;
+			uvs[c].y = v;
+		}
+
+		if (job->calc_batch != NULL) {
+			if (!job->calc_batch(job->xdev, job->view, vert_cols, uvs, results)) {
+				job->failed = true;
+				break;
+			}
+		} else {
+			for (uint32_t c = 0; c < vert_cols; c++) {
+				if (!job->calc(job->xdev, job->view, uvs[c].x, uvs[c].y, &results[c])) {
+					job->failed = true;
+					break;
+				}
+			}
+			if (job->failed) {
+				break;
+			}
+		}
+
+		for (uint32_t c = 0; c < vert_cols; c++) {
+			float *vert = row + c * stride_in_floats;
+
+			// Make the position in the range of [-1, 1]
+			vert[0] = uvs[c].x * 2.0f - 1.0f;
+			vert[1] = uvs[c].y * 2.0f - 1.0f;
+			memcpy(&vert[2], &results[c], sizeof(results[c]));
+		}
+	}
+
+	free(uvs);
+	free(results);
+}
+
+/*!
+ * Fills in the vertices for all views and sets the mesh on the target.
+ *
+ * With a batch function the rows are split over a small thread pool, the
+ * batch function is required to be safe to call concurrently. The per sample
+ * function makes no such promise, some of them talk to other processes or
+ * libraries that are not thread safe, so that path runs the same jobs inline.
+ */
+static void
+run_func(struct xrt_device *xdev,
+         func_calc calc,
+         func_calc_batch calc_batch,
+         struct xrt_hmd_parts *target,
+         uint32_t num)
+{
+	assert(calc != NULL || calc_batch != NULL);
+
+	uint32_t view_count = target->view_count;
+
+	uint32_t cells_cols = num;
+	uint32_t cells_rows = num;
+	uint32_t vert_cols = cells_cols + 1;
+	uint32_t vert_rows = cells_rows + 1;
+
+	uint32_t vertex_count_per_view = vert_rows * vert_cols;
+	uint32_t vertex_count = vertex_count_per_view * view_count;
+
+	uint32_t stride_in_floats = U_DISTORTION_MESH_STRIDE_IN_FLOATS;
+	size_t float_count = (size_t)vertex_count * stride_in_floats;
+
+	float *verts = U_TYPED_ARRAY_CALLOC(float, float_count);
+
+	// A few jobs per thread per view so they even out.
+	struct mesh_job jobs[XRT_MAX_VIEWS][MESH_THREADS * 2];
+	const uint32_t jobs_per_view = ARRAY_SIZE(jobs[0]);
+	const uint32_t rows_per_job = (vert_rows + jobs_per_view - 1) / jobs_per_view;
+	uint32_t job_counts[XRT_MAX_VIEWS] = {0};
+
+	for (uint32_t view = 0; view < view_count; view++) {
+		for (uint32_t j = 0; j < jobs_per_view; j++) {
+			uint32_t first_row = j * rows_per_job;
+			if (first_row >= vert_rows) {
+				break;
+			}
+
+			jobs[view][j] = (struct mesh_job){
+			    .xdev = xdev,
+			    .calc = calc,
+			    .calc_batch = calc_batch,
+			    .view = view,
+			    .num = num,
+			    .first_row = first_row,
+			    .row_count = MIN(rows_per_job, vert_rows - first_row),
+			    .verts = verts + (size_t)vertex_count_per_view * stride_in_floats * view,
+			    .failed = false,
+			};
+			job_counts[view]++;
+		}
+	}
+
+	// Not worth waking up threads for tiny meshes, like the none one.
+	bool threaded = calc_batch != NULL && vert_rows >= MESH_THREADS * 2;
+
+	if (threaded) {
+		struct u_worker_thread_pool *pool =
+		    u_worker_thread_pool_create(MESH_THREADS - 1, MESH_THREADS, "Distortion Mesh");
+		struct u_worker_group *group = u_worker_group_create(pool);
+
+		for (uint32_t view = 0; view < view_count; view++) {
+			for (uint32_t j = 0; j < job_counts[view]; j++) {
+				u_worker_group_push(group, mesh_job_run, &jobs[view][j]);
+			}
+		}
+
+		u_worker_group_wait_all(group);
+
+		u_worker_group_reference(&group, NULL);
+		u_worker_thread_pool_reference(&pool, NULL);
+	} else {
+		for (uint32_t view = 0; view < view_count; view++) {
+			for (uint32_t j = 0; j < job_counts[view] && !jobs[view][j].failed; j++) {
+				mesh_job_run(&jobs[view][j]);
+			}
+		}
+	}
+
+	for (uint32_t view = 0; view < view_count; view++) {
+		for (uint32_t j = 0; j < job_counts[view]; j++) {
+			if (jobs[view][j].failed) {
+				// bail on error, without updating
+				// distortion.preferred
+				free(verts);
+				return;
+			}
+		}
+	}
+
+	set_mesh(target, verts, num);
+}
+
 bool
 u_compute_distortion_vive(struct u_vive_values *values, float u, float v, struct xrt_uv_triplet *result)
 {
@@ -185,6 +351,59 @@ u_compute_distortion_vive(struct u_vive_values *values, float u, float v, struct
 	return true;
 }
 
+bool
+u_compute_distortion_vive_batch(struct u_vive_values *values,
+                                uint32_t count,
+                                const struct xrt_vec2 *uvs,
+                                struct xrt_uv_triplet *results)
+{
+	const struct u_vive_values val = *values;
+
+	// Same as u_compute_distortion_vive, but only worked out once per batch.
+	const float common_factor_value = 0.5f / (1.0f + val.grow_for_undistort);
+	const struct xrt_vec2 factor = {
+	    common_factor_value,
+	    common_factor_value * val.aspect_x_over_y,
+	};
+
+	float x[BATCH_SIZE];
+	float y[BATCH_SIZE];
+
+	for (uint32_t first = 0; first < count; first += BATCH_SIZE) {
+		const uint32_t n = MIN(BATCH_SIZE, count - first);
+
+		for (uint32_t i = 0; i < n; i++) {
+			x[i] = 2.f * uvs[first + i].x - 1.f;
+			y[i] = (2.f * uvs[first + i].y - 1.f) / val.aspect_x_over_y;
+		}
+
+		// Channel at a time over plain arrays, so the loop vectorizes.
+		for (int ch = 0; ch < 3; ch++) {
+			const float cx = val.center[ch].x;
+			const float cy = val.center[ch].y;
+			const float k1 = val.coefficients[ch][0];
+			const float k2 = val.coefficients[ch][1];
+			const float k3 = val.coefficients[ch][2];
+			const float k4 = val.coefficients[ch][3];
+
+			// A triplet is three vec2s, so six floats per sample.
+			float *out = (float *)&results[first] + ch * 2;
+
+			for (uint32_t i = 0; i < n; i++) {
+				const float tx = x[i] - cx;
+				const float ty = y[i] - cy;
+				const float r2 = tx * tx + ty * ty;
+				const float d = (1.f / (1.f + r2 * (k1 + r2 * (k2 + r2 * k3)))) + k4;
+
+				out[i * 6 + 0] = 0.5f + (tx * d + cx) * factor.x;
+				out[i * 6 + 1] = 0.5f + (ty * d + cy) * factor.y;
+			}
+		}
+	}
+
+	return true;
+}
+
 
 #define mul m_vec2_mul
 #define mul_scalar m_vec2_mul_scalar
@@ -233,6 +452,53 @@ u_compute_distortion_panotools(struct u_panotools_values *values, float u, float
 	return true;
 }
 
+bool
+u_compute_distortion_panotools_batch(struct u_panotools_values *values,
+                                     uint32_t count,
+                                     const struct xrt_vec2 *uvs,
+                                     struct xrt_uv_triplet *results)
+{
+	const struct u_panotools_values val = *values;
+
+	float x[BATCH_SIZE];
+	float y[BATCH_SIZE];
+
+	for (uint32_t first = 0; first < count; first += BATCH_SIZE) {
+		const uint32_t n = MIN(BATCH_SIZE, count - first);
+
+		// Distorted position in viewport units, shared by all channels.
+		for (uint32_t i = 0; i < n; i++) {
+			const float rx = (uvs[first + i].x * val.viewport_size.x - val.lens_center.x) / val.scale;
+			const float ry = (uvs[first + i].y * val.viewport_size.y - val.lens_center.y) / val.scale;
+
+			const float r = sqrtf(rx * rx + ry * ry);
+			const float r_mag = val.distortion_k[0] +                // r^1
+			                    val.distortion_k[1] * r +            // r^2
+			                    val.distortion_k[2] * r * r +        // r^3
+			                    val.distortion_k[3] * r * r * r +    // r^4
+			                    val.distortion_k[4] * r * r * r * r; // r^5
+
+			x[i] = rx * r_mag * val.scale;
+			y[i] = ry * r_mag * val.scale;
+		}
+
+		// Only the aberration scale differs per channel.
+		for (int ch = 0; ch < 3; ch++) {
+			const float ab = val.aberration_k[ch];
+
+			// A triplet is three vec2s, so six floats per sample.
+			float *out = (float *)&results[first] + ch * 2;
+
+			for (uint32_t i = 0; i < n; i++) {
+				out[i * 6 + 0] = (x[i] * ab + val.lens_center.x) / val.viewport_size.x;
+				out[i * 6 + 1] = (y[i] * ab + val.lens_center.y) / val.viewport_size.y;
+			}
+		}
+	}
+
+	return true;
+}
+
 bool
 u_compute_distortion_cardboard(struct u_cardboard_distortion_values *values,
                                float u,
@@ -269,6 +535,48 @@ u_compute_distortion_cardboard(struct u_cardboard_distortion_values *values,
 	return true;
 }
 
+bool
+u_compute_distortion_cardboard_batch(struct u_cardboard_distortion_values *values,
+                                     uint32_t count,
+                                     const struct xrt_vec2 *uvs,
+                                     struct xrt_uv_triplet *results)
+{
+	const struct u_cardboard_distortion_values val = *values;
+
+	for (uint32_t i = 0; i < count; i++) {
+		const float x = uvs[i].x * val.screen.size.x - val.screen.offset.x;
+		const float y = uvs[i].y * val.screen.size.y - val.screen.offset.y;
+
+		// Same sum of even powers as u_compute_distortion_cardboard.
+		const float sqrd = x * x + y * y;
+		float r = 1.0f;
+		float fact = 1.0f;
+		r *= sqrd;
+		fact += val.distortion_k[0] * r;
+		r *= sqrd;
+		fact += val.distortion_k[1] * r;
+		r *= sqrd;
+		fact += val.distortion_k[2] * r;
+		r *= sqrd;
+		fact += val.distortion_k[3] * r;
+		r *= sqrd;
+		fact += val.distortion_k[4] * r;
+
+		const float tu = (x * fact + val.texture.offset.x) / val.texture.size.x;
+		const float tv = (y * fact + val.texture.offset.y) / val.texture.size.y;
+
+		// No chromatic aberration, all channels are the same.
+		results[i].r.x = tu;
+		results[i].r.y = tv;
+		results[i].g.x = tu;
+		results[i].g.y = tv;
+		results[i].b.x = tu;
+		results[i].b.y = tv;
+	}
+
+	return true;
+}
+
 /*
  *
  * North Star "2D Polynomial" distortion
@@ -290,8 +598,48 @@ u_ns_polyval2d(float X, float Y, float C[16])
 }
 
 
-bool
-u_compute_distortion_ns_p2d(struct u_ns_p2d_values *values, int view, float u, float v, struct xrt_uv_triplet *result)
+/*!
+ * The ray bounds only depend on the view, so batches work them out once.
+ */
+struct ns_ray_bounds
+{
+	float left, right, up, down;
+};
+
+static inline void
+ns_set_uv_triplet(float u_eye, float v_eye, struct xrt_uv_triplet *result)
+{
+	// boilerplate, put the UV coordinates in all the RGB slots
+	result->r.x = u_eye;
+	result->r.y = v_eye;
+	result->g.x = u_eye;
+	result->g.y = v_eye;
+	result->b.x = u_eye;
+	result->b.y = v_eye;
+}
+
+static inline struct ns_ray_bounds
+ns_p2d_ray_bounds(const struct u_ns_p2d_values *values, int view)
+{
+	struct xrt_fov fov = values->fov[view];
+
+	struct ns_ray_bounds bounds = {
+	    .left = tanf(fov.angle_left),
+	    .right = tanf(fov.angle_right),
+	    .up = tanf(fov.angle_up),
+	    .down = tanf(fov.angle_down),
+	};
+
+	return bounds;
+}
+
+static inline void
+ns_p2d_eval(struct u_ns_p2d_values *values,
+            int view,
+            const struct ns_ray_bounds *bounds,
+            float u,
+            float v,
+            struct xrt_uv_triplet *result)
 {
 	// I think that OpenCV and Monado have different definitions of v coordinates, but not sure. if not,
 	// unexplainable
@@ -300,24 +648,35 @@ u_compute_distortion_ns_p2d(struct u_ns_p2d_values *values, int view, float u, f
 	float x_ray = u_ns_polyval2d(u, v, view ? values->x_coefficients_left : values->x_coefficients_right);
 	float y_ray = u_ns_polyval2d(u, v, view ? values->y_coefficients_left : values->y_coefficients_right);
 
-	struct xrt_fov fov = values->fov[view];
+	float u_eye = (float)math_map_ranges(x_ray, bounds->left, bounds->right, 0, 1);
 
-	float left_ray_bound = tanf(fov.angle_left);
-	float right_ray_bound = tanf(fov.angle_right);
-	float up_ray_bound = tanf(fov.angle_up);
-	float down_ray_bound = tanf(fov.angle_down);
+	float v_eye = (float)math_map_ranges(y_ray, bounds->down, bounds->up, 0, 1);
 
-	float u_eye = (float)math_map_ranges(x_ray, left_ray_bound, right_ray_bound, 0, 1);
+	ns_set_uv_triplet(u_eye, v_eye, result);
+}
 
-	float v_eye = (float)math_map_ranges(y_ray, down_ray_bound, up_ray_bound, 0, 1);
+bool
+u_compute_distortion_ns_p2d(struct u_ns_p2d_values *values, int view, float u, float v, struct xrt_uv_triplet *result)
+{
+	struct ns_ray_bounds bounds = ns_p2d_ray_bounds(values, view);
 
-	// boilerplate, put the UV coordinates in all the RGB slots
-	result->r.x = u_eye;
-	result->r.y = v_eye;
-	result->g.x = u_eye;
-	result->g.y = v_eye;
-	result->b.x = u_eye;
-	result->b.y = v_eye;
+	ns_p2d_eval(values, view, &bounds, u, v, result);
+
+	return true;
+}
+
+bool
+u_compute_distortion_ns_p2d_batch(struct u_ns_p2d_values *values,
+                                  int view,
+                                  uint32_t count,
+                                  const struct xrt_vec2 *uvs,
+                                  struct xrt_uv_triplet *results)
+{
+	struct ns_ray_bounds bounds = ns_p2d_ray_bounds(values, view);
+
+	for (uint32_t i = 0; i < count; i++) {
+		ns_p2d_eval(values, view, &bounds, uvs[i].x, uvs[i].y, &results[i]);
+	}
 
 	return true;
 }
@@ -330,9 +689,28 @@ u_compute_distortion_ns_p2d(struct u_ns_p2d_values *values, int view, float u, f
  *
  */
 
-bool
-u_compute_distortion_ns_meshgrid(
-    struct u_ns_meshgrid_values *values, int view, float u, float v, struct xrt_uv_triplet *result)
+static inline struct ns_ray_bounds
+ns_meshgrid_ray_bounds(const struct u_ns_meshgrid_values *values, int view)
+{
+	struct xrt_fov fov = values->fov[view];
+
+	struct ns_ray_bounds bounds = {
+	    .left = tan(fov.angle_left),
+	    .right = tan(fov.angle_right),
+	    .up = tan(fov.angle_up),
+	    .down = tan(fov.angle_down),
+	};
+
+	return bounds;
+}
+
+static inline void
+ns_meshgrid_eval(struct u_ns_meshgrid_values *values,
+                 int view,
+                 const struct ns_ray_bounds *bounds,
+                 float u,
+                 float v,
+                 struct xrt_uv_triplet *result)
 {
 	int u_edge_num = (values->num_grid_points_u - 1);
 	int v_edge_num = (values->num_grid_points_v - 1);
@@ -384,23 +762,35 @@ u_compute_distortion_ns_meshgrid(
 		bearing = values->grid[view][acc_idx];
 	}
 
-	struct xrt_fov fov = values->fov[view];
+	float u_eye = math_map_ranges(bearing.x, bounds->left, bounds->right, 0, 1);
+	float v_eye = math_map_ranges(bearing.y, bounds->down, bounds->up, 0, 1);
+
+	ns_set_uv_triplet(u_eye, v_eye, result);
+}
+
+bool
+u_compute_distortion_ns_meshgrid(
+    struct u_ns_meshgrid_values *values, int view, float u, float v, struct xrt_uv_triplet *result)
+{
+	struct ns_ray_bounds bounds = ns_meshgrid_ray_bounds(values, view);
 
-	float left_ray_bound = tan(fov.angle_left);
-	float right_ray_bound = tan(fov.angle_right);
-	float up_ray_bound = tan(fov.angle_up);
-	float down_ray_bound = tan(fov.angle_down);
+	ns_meshgrid_eval(values, view, &bounds, u, v, result);
 
-	float u_eye = math_map_ranges(bearing.x, left_ray_bound, right_ray_bound, 0, 1);
-	float v_eye = math_map_ranges(bearing.y, down_ray_bound, up_ray_bound, 0, 1);
+	return true;
+}
 
-	// boilerplate, put the UV coordinates in all the RGB slots
-	result->r.x = u_eye;
-	result->r.y = v_eye;
-	result->g.x = u_eye;
-	result->g.y = v_eye;
-	result->b.x = u_eye;
-	result->b.y = v_eye;
+bool
+u_compute_distortion_ns_meshgrid_batch(struct u_ns_meshgrid_values *values,
+                                       int view,
+                                       uint32_t count,
+                                       const struct xrt_vec2 *uvs,
+                                       struct xrt_uv_triplet *results)
+{
+	struct ns_ray_bounds bounds = ns_meshgrid_ray_bounds(values, view);
+
+	for (uint32_t i = 0; i < count; i++) {
+		ns_meshgrid_eval(values, view, &bounds, uvs[i].x, uvs[i].y, &results[i]);
+	}
 
 	return true;
 }
@@ -438,7 +828,7 @@ u_distortion_mesh_fill_in_none(struct xrt_device *xdev)
 	struct xrt_hmd_parts *target = xdev->hmd;
 
 	// Do the generation.
-	run_func(xdev, u_distortion_mesh_none, target, 1);
+	run_func(xdev, u_distortion_mesh_none, NULL, target, 1);
 
 	// Make the target mostly usable.
 	target->distortion.models |= XRT_DISTORTION_MODEL_NONE;
@@ -470,18 +860,35 @@ u_distortion_mesh_set_none(struct xrt_device *xdev)
  *
  */
 
+uint32_t
+u_distortion_mesh_get_size(void)
+{
+	return (uint32_t)debug_get_num_option_mesh_size();
+}
+
 void
-u_distortion_mesh_fill_in_compute(struct xrt_device *xdev)
+u_distortion_mesh_fill_in_vertices(struct xrt_device *xdev, float *vertices, uint32_t num)
+{
+	set_mesh(xdev->hmd, vertices, num);
+}
+
+void
+u_distortion_mesh_fill_in_compute_with_size(struct xrt_device *xdev, uint32_t num)
 {
 	func_calc calc = xdev->compute_distortion;
-	if (calc == NULL) {
+	func_calc_batch calc_batch = xdev->compute_distortion_batch;
+	if (calc == NULL && calc_batch == NULL) {
 		u_distortion_mesh_fill_in_none(xdev);
 		return;
 	}
 
 	struct xrt_hmd_parts *target = xdev->hmd;
 
-	uint32_t num = (uint32_t)debug_get_num_option_mesh_size();
+	run_func(xdev, calc, calc_batch, target, num);
+}
 
-	run_func(xdev, calc, target, num);
+void
+u_distortion_mesh_fill_in_compute(struct xrt_device *xdev)
+{
+	u_distortion_mesh_fill_in_compute_with_size(xdev, (uint32_t)debug_get_num_option_mesh_size());
 }
@@ -54,6 +54,17 @@ struct u_panotools_values
 bool
 u_compute_distortion_panotools(struct u_panotools_values *values, float u, float v, struct xrt_uv_triplet *result);
 
+/*!
+ * Batch version of @ref u_compute_distortion_panotools.
+ *
+ * @ingroup aux_distortion
+ */
+bool
+u_compute_distortion_panotools_batch(struct u_panotools_values *values,
+                                     uint32_t count,
+                                     const struct xrt_vec2 *uvs,
+                                     struct xrt_uv_triplet *results);
+
 
 /*
  *
@@ -89,6 +100,17 @@ struct u_vive_values
 bool
 u_compute_distortion_vive(struct u_vive_values *values, float u, float v, struct xrt_uv_triplet *result);
 
+/*!
+ * Batch version of @ref u_compute_distortion_vive.
+ *
+ * @ingroup aux_distortion
+ */
+bool
+u_compute_distortion_vive_batch(struct u_vive_values *values,
+                                uint32_t count,
+                                const struct xrt_vec2 *uvs,
+                                struct xrt_uv_triplet *results);
+
 
 /*
  *
@@ -107,6 +129,17 @@ u_compute_distortion_cardboard(struct u_cardboard_distortion_values *values,
                                float v,
                                struct xrt_uv_triplet *result);
 
+/*!
+ * Batch version of @ref u_compute_distortion_cardboard.
+ *
+ * @ingroup aux_distortion
+ */
+bool
+u_compute_distortion_cardboard_batch(struct u_cardboard_distortion_values *values,
+                                     uint32_t count,
+                                     const struct xrt_vec2 *uvs,
+                                     struct xrt_uv_triplet *results);
+
 
 /*
  *
@@ -132,6 +165,19 @@ struct u_ns_p2d_values
 bool
 u_compute_distortion_ns_p2d(struct u_ns_p2d_values *values, int view, float u, float v, struct xrt_uv_triplet *result);
 
+/*!
+ * Batch version of @ref u_compute_distortion_ns_p2d, the ray bounds are only
+ * computed once per call.
+ *
+ * @ingroup aux_distortion
+ */
+bool
+u_compute_distortion_ns_p2d_batch(struct u_ns_p2d_values *values,
+                                  int view,
+                                  uint32_t count,
+                                  const struct xrt_vec2 *uvs,
+                                  struct xrt_uv_triplet *results);
+
 /*
  *
  * Values for Moshi Turner's North Star distortion correction.
@@ -157,6 +203,19 @@ bool
 u_compute_distortion_ns_meshgrid(
     struct u_ns_meshgrid_values *values, int view, float u, float v, struct xrt_uv_triplet *result);
 
+/*!
+ * Batch version of @ref u_compute_distortion_ns_meshgrid, the ray bounds are
+ * only computed once per call.
+ *
+ * @ingroup aux_distortion
+ */
+bool
+u_compute_distortion_ns_meshgrid_batch(struct u_ns_meshgrid_values *values,
+                                       int view,
+                                       uint32_t count,
+                                       const struct xrt_vec2 *uvs,
+                                       struct xrt_uv_triplet *results);
+
 
 /*
  *
@@ -187,10 +246,45 @@ u_distortion_mesh_none(struct xrt_device *xdev, uint32_t view, float u, float v,
  *
  */
 
+/*!
+ * Number of floats per vertex in generated meshes: the position followed by
+ * the r, g and b uv coordinates.
+ *
+ * @ingroup aux_distortion
+ */
+#define U_DISTORTION_MESH_STRIDE_IN_FLOATS (2 + 3 * 2)
+
+/*!
+ * Number of cells along each side of a view in generated meshes, set with the
+ * `XRT_MESH_SIZE` environment variable.
+ *
+ * @ingroup aux_distortion
+ */
+uint32_t
+u_distortion_mesh_get_size(void);
+
+/*!
+ * For drivers that generate the vertices themselves: takes ownership of
+ * @p vertices, generates the indices and populates
+ * `xdev->hmd_parts.distortion.mesh`.
+ *
+ * The vertices are laid out the same as the ones made by
+ * @ref u_distortion_mesh_fill_in_compute, a grid of `(num + 1) * (num + 1)`
+ * vertices per view, row by row from `v = 0`, with
+ * @ref U_DISTORTION_MESH_STRIDE_IN_FLOATS floats each, views following each
+ * other.
+ *
+ * @relatesalso xrt_device
+ * @ingroup aux_distortion
+ */
+void
+u_distortion_mesh_fill_in_vertices(struct xrt_device *xdev, float *vertices, uint32_t num);
+
 /*!
  * Given a @ref xrt_device generates meshes by calling
- * xdev->compute_distortion(), populates `xdev->hmd_parts.distortion.mesh` &
- * `xdev->hmd_parts.distortion.models`.
+ * xdev->compute_distortion_batch() if set, spread over a few threads, or
+ * xdev->compute_distortion() otherwise, populates
+ * `xdev->hmd_parts.distortion.mesh` & `xdev->hmd_parts.distortion.models`.
  *
  * @relatesalso xrt_device
  * @ingroup aux_distortion
@@ -198,6 +292,16 @@ u_distortion_mesh_none(struct xrt_device *xdev, uint32_t view, float u, float v,
 void
 u_distortion_mesh_fill_in_compute(struct xrt_device *xdev);
 
+/*!
+ * Same as @ref u_distortion_mesh_fill_in_compute but with @p num cells along
+ * each side of a view instead of the `XRT_MESH_SIZE` value.
+ *
+ * @relatesalso xrt_device
+ * @ingroup aux_distortion
+ */
+void
+u_distortion_mesh_fill_in_compute_with_size(struct xrt_device *xdev, uint32_t num);
+
 /*!
  * Given a @ref xrt_device generates a no distortion mesh, populates
  * `xdev->hmd_parts.distortion.mesh` & `xdev->hmd_parts.distortion.models`.
@@ -0,0 +1,714 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Scalar, SSE4, AVX2 and NEON row kernels for format conversion.
+ * @ingroup aux_util
+ */
+
+#include "util/u_format_convert.h"
+#include "util/u_debug.h"
+#include "util/u_logging.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define U_FORMAT_CONVERT_HAVE_X86
+#include <immintrin.h>
+
+/*
+ * Per function targets so the rest of the build keeps the baseline ISA,
+ * which kernel runs is picked at runtime.
+ */
+#define TARGET_SSE4 __attribute__((target("ssse3,sse4.1")))
+#define TARGET_AVX2 __attribute__((target("ssse3,sse4.1,avx2")))
+#endif
+
+#if defined(__ARM_NEON)
+#define U_FORMAT_CONVERT_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+
+DEBUG_GET_ONCE_OPTION(convert_impl, "U_FORMAT_CONVERT_IMPL", NULL)
+
+
+/*
+ *
+ * Scalar, the reference all others must match.
+ *
+ */
+
+static inline uint8_t
+clamp_to_byte(int v)
+{
+	if (v < 0) {
+		return 0;
+	}
+	if (v >= 255) {
+		return 255;
+	}
+	return (uint8_t)v;
+}
+
+/*!
+ * BT.601 limited range, all the SIMD kernels do exactly this math in 32 bit
+ * lanes and saturate through 16 bits, which is the same as the clamp here.
+ */
+static inline void
+yuv_to_rgb(int y, int u, int v, uint8_t *dst)
+{
+	int C = y - 16;
+	int D = u - 128;
+	int E = v - 128;
+
+	dst[0] = clamp_to_byte((298 * C + 409 * E + 128) >> 8);
+	dst[1] = clamp_to_byte((298 * C - 100 * D - 209 * E + 128) >> 8);
+	dst[2] = clamp_to_byte((298 * C + 516 * D + 128) >> 8);
+}
+
+static void
+scalar_L8_to_R8G8B8(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width)
+{
+	for (uint32_t x = 0; x < width; x++) {
+		dst[x * 3 + 2] = dst[x * 3 + 1] = dst[x * 3 + 0] = src[x];
+	}
+}
+
+static void
+scalar_YUYV422_to_R8G8B8(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width)
+{
+	for (uint32_t x = 0; x < width; x += 2) {
+		const uint8_t *s = src + x * 2;
+		yuv_to_rgb(s[0], s[1], s[3], dst + x * 3);
+		if (x + 1 < width) {
+			yuv_to_rgb(s[2], s[1], s[3], dst + x * 3 + 3);
+		}
+	}
+}
+
+static void
+scalar_UYVY422_to_R8G8B8(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width)
+{
+	for (uint32_t x = 0; x < width; x += 2) {
+		const uint8_t *s = src + x * 2;
+		yuv_to_rgb(s[1], s[0], s[2], dst + x * 3);
+		if (x + 1 < width) {
+			yuv_to_rgb(s[3], s[0], s[2], dst + x * 3 + 3);
+		}
+	}
+}
+
+static void
+scalar_YUV888_to_R8G8B8(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width)
+{
+	for (uint32_t x = 0; x < width; x++) {
+		const uint8_t *s = src + x * 3;
+		yuv_to_rgb(s[0], s[1], s[2], dst + x * 3);
+	}
+}
+
+static void
+scalar_BAYER_GR8_to_R8G8B8(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width)
+{
+	const uint8_t *src0 = src;
+	const uint8_t *src1 = src + src_stride;
+
+	for (uint32_t x = 0; x < width; x++) {
+		uint8_t g0 = src0[x * 2 + 0];
+		uint8_t r = src0[x * 2 + 1];
+		uint8_t b = src1[x * 2 + 0];
+		uint8_t g1 = src1[x * 2 + 1];
+
+		dst[x * 3 + 0] = r;
+		dst[x * 3 + 1] = (g0 + g1) / 2;
+		dst[x * 3 + 2] = b;
+	}
+}
+
+static const struct u_format_convert_kernels scalar_kernels = {
+    .impl = U_FORMAT_CONVERT_IMPL_SCALAR,
+    .name = "scalar",
+    .L8_to_R8G8B8 = scalar_L8_to_R8G8B8,
+    .YUYV422_to_R8G8B8 = scalar_YUYV422_to_R8G8B8,
+    .UYVY422_to_R8G8B8 = scalar_UYVY422_to_R8G8B8,
+    .YUV888_to_R8G8B8 = scalar_YUV888_to_R8G8B8,
+    .BAYER_GR8_to_R8G8B8 = scalar_BAYER_GR8_to_R8G8B8,
+};
+
+
+/*
+ *
+ * SSE4 and AVX2.
+ *
+ * Both work on 16 pixels at a time, split into four chunks of four pixels
+ * where each chunk is a vector with the pixel's source bytes at the offsets
+ * given by a @ref yuv_layout. The tail of a row goes to the scalar kernel.
+ *
+ */
+
+#ifdef U_FORMAT_CONVERT_HAVE_X86
+
+//! Offsets of the four pixels' Y, U and V bytes in a chunk.
+struct yuv_layout
+{
+	int8_t y[4];
+	int8_t u[4];
+	int8_t v[4];
+};
+
+static const struct yuv_layout layout_YUYV422 = {{0, 2, 4, 6}, {1, 1, 5, 5}, {3, 3, 7, 7}};
+static const struct yuv_layout layout_UYVY422 = {{1, 3, 5, 7}, {0, 0, 4, 4}, {2, 2, 6, 6}};
+static const struct yuv_layout layout_YUV888 = {{0, 3, 6, 9}, {1, 4, 7, 10}, {2, 5, 8, 11}};
+
+/*!
+ * Shuffles that interleave 16 R, G and B bytes into 48 bytes of R8G8B8,
+ * three per output vector, -1 zeroes the byte.
+ */
+static const int8_t interleave_rgb_masks[3][3][16] = {
+    {
+        {0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5},
+        {-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1},
+        {-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1},
+    },
+    {
+        {-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1},
+        {5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10},
+        {-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1},
+    },
+    {
+        {-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1},
+        {-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1},
+        {10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15},
+    },
+};
+
+TARGET_SSE4 static inline void
+sse4_store_rgb_16(uint8_t *dst, __m128i r, __m128i g, __m128i b)
+{
+	for (int o = 0; o < 3; o++) {
+		__m128i mr = _mm_loadu_si128((const __m128i *)interleave_rgb_masks[o][0]);
+		__m128i mg = _mm_loadu_si128((const __m128i *)interleave_rgb_masks[o][1]);
+		__m128i mb = _mm_loadu_si128((const __m128i *)interleave_rgb_masks[o][2]);
+
+		__m128i out = _mm_or_si128(_mm_shuffle_epi8(r, mr), _mm_shuffle_epi8(g, mg));
+		out = _mm_or_si128(out, _mm_shuffle_epi8(b, mb));
+		_mm_storeu_si128((__m128i *)(dst + o * 16), out);
+	}
+}
+
+//! Shuffle that zero extends the bytes at @p idx to four 32 bit lanes.
+TARGET_SSE4 static inline __m128i
+sse4_mask_epi32(const int8_t idx[4])
+{
+	return _mm_setr_epi8(idx[0], -1, -1, -1, idx[1], -1, -1, -1, idx[2], -1, -1, -1, idx[3], -1, -1, -1);
+}
+
+//! Shuffle that gathers the bytes at @p idx to the lowest four bytes.
+TARGET_SSE4 static inline __m128i
+sse4_mask_u8(const int8_t idx[4])
+{
+	return _mm_setr_epi8(idx[0], idx[1], idx[2], idx[3], -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+}
+
+TARGET_SSE4 static inline void
+sse4_yuv_to_rgb_4(__m128i y, __m128i u, __m128i v, __m128i *out_r, __m128i *out_g, __m128i *out_b)
+{
+	__m128i c = _mm_sub_epi32(y, _mm_set1_epi32(16));
+	__m128i d = _mm_sub_epi32(u, _mm_set1_epi32(128));
+	__m128i e = _mm_sub_epi32(v, _mm_set1_epi32(128));
+
+	__m128i c298 = _mm_add_epi32(_mm_mullo_epi32(c, _mm_set1_epi32(298)), _mm_set1_epi32(128));
+
+	__m128i r = _mm_add_epi32(c298, _mm_mullo_epi32(e, _mm_set1_epi32(409)));
+	__m128i g = _mm_sub_epi32(c298, _mm_mullo_epi32(d, _mm_set1_epi32(100)));
+	g = _mm_sub_epi32(g, _mm_mullo_epi32(e, _mm_set1_epi32(209)));
+	__m128i b = _mm_add_epi32(c298, _mm_mullo_epi32(d, _mm_set1_epi32(516)));
+
+	*out_r = _mm_srai_epi32(r, 8);
+	*out_g = _mm_srai_epi32(g, 8);
+	*out_b = _mm_srai_epi32(b, 8);
+}
+
+TARGET_SSE4 static inline void
+sse4_yuv_to_rgb_16(const __m128i chunks[4], const struct yuv_layout *layout, uint8_t *dst)
+{
+	__m128i my = sse4_mask_epi32(layout->y);
+	__m128i mu = sse4_mask_epi32(layout->u);
+	__m128i mv = sse4_mask_epi32(layout->v);
+
+	__m128i r[4];
+	__m128i g[4];
+	__m128i b[4];
+	for (int k = 0; k < 4; k++) {
+		__m128i y = _mm_shuffle_epi8(chunks[k], my);
+		__m128i u = _mm_shuffle_epi8(chunks[k], mu);
+		__m128i v = _mm_shuffle_epi8(chunks[k], mv);
+		sse4_yuv_to_rgb_4(y, u, v, &r[k], &g[k], &b[k]);
+	}
+
+	// Saturating through 16 bits is the same as clamping to [0, 255].
+	__m128i r8 = _mm_packus_epi16(_mm_packs_epi32(r[0], r[1]), _mm_packs_epi32(r[2], r[3]));
+	__m128i g8 = _mm_packus_epi16(_mm_packs_epi32(g[0], g[1]), _mm_packs_epi32(g[2], g[3]));
+	__m128i b8 = _mm_packus_epi16(_mm_packs_epi32(b[0], b[1]), _mm_packs_epi32(b[2], b[3]));
+
+	sse4_store_rgb_16(dst, r8, g8, b8);
+}
+
+//! Chunks for YUYV and UYVY, 16 pixels are 32 bytes.
+TARGET_SSE4 static inline void
+sse4_load_chunks_422(const uint8_t *src, __m128i chunks[4])
+{
+	__m128i a = _mm_loadu_si128((const __m128i *)src);
+	__m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+
+	chunks[0] = a;
+	chunks[1] = _mm_srli_si128(a, 8);
+	chunks[2] = b;
+	chunks[3] = _mm_srli_si128(b, 8);
+}
+
+//! Chunks for YUV888, 16 pixels are 48 bytes.
+TARGET_SSE4 static inline void
+sse4_load_chunks_888(const uint8_t *src, __m128i chunks[4])
+{
+	__m128i s0 = _mm_loadu_si128((const __m128i *)src);
+	__m128i s1 = _mm_loadu_si128((const __m128i *)(src + 16));
+	__m128i s2 = _mm_loadu_si128((const __m128i *)(src + 32));
+
+	chunks[0] = s0;
+	chunks[1] = _mm_alignr_epi8(s1, s0, 12);
+	chunks[2] = _mm_alignr_epi8(s2, s1, 8);
+	chunks[3] = _mm_srli_si128(s2, 4);
+}
+
+TARGET_SSE4 static void
+sse4_L8_to_R8G8B8(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width)
+{
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16) {
+		__m128i l = _mm_loadu_si128((const __m128i *)(src + x));
+		sse4_store_rgb_16(dst + x * 3, l, l, l);
+	}
+
+	scalar_L8_to_R8G8B8(src + x, src_stride, dst + x * 3, width - x);
+}
+
+TARGET_SSE4 static void
+sse4_YUYV422_to_R8G8B8(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width)
+{
+	__m128i chunks[4];
+
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16) {
+		sse4_load_chunks_422(src + x * 2, chunks);
+		sse4_yuv_to_rgb_16(chunks, &layout_YUYV422, dst + x * 3);
+	}
+
+	scalar_YUYV422_to_R8G8B8(src + x * 2, src_stride, dst + x * 3, width - x);
+}
+
+TARGET_SSE4 static void
+sse4_UYVY422_to_R8G8B8(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width)
+{
+	__m128i chunks[4];
+
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16) {
+		sse4_load_chunks_422(src + x * 2, chunks);
+		sse4_yuv_to_rgb_16(chunks, &layout_UYVY422, dst + x * 3);
+	}
+
+	scalar_UYVY422_to_R8G8B8(src + x * 2, src_stride, dst + x * 3, width - x);
+}
+
+TARGET_SSE4 static void
+sse4_YUV888_to_R8G8B8(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width)
+{
+	__m128i chunks[4];
+
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16) {
+		sse4_load_chunks_888(src + x * 3, chunks);
+		sse4_yuv_to_rgb_16(chunks, &layout_YUV888, dst + x * 3);
+	}
+
+	scalar_YUV888_to_R8G8B8(src + x * 3, src_stride, dst + x * 3, width - x);
+}
+
+TARGET_SSE4 static void
+sse4_BAYER_GR8_to_R8G8B8(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width)
+{
+	const uint8_t *src0 = src;
+	const uint8_t *src1 = src + src_stride;
+	const __m128i low = _mm_set1_epi16(0x00ff);
+
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16) {
+		// G R G R ... and B G B G ..., split into 16 bit lanes.
+		__m128i gr0 = _mm_loadu_si128((const __m128i *)(src0 + x * 2));
+		__m128i gr1 = _mm_loadu_si128((const __m128i *)(src0 + x * 2 + 16));
+		__m128i bg0 = _mm_loadu_si128((const __m128i *)(src1 + x * 2));
+		__m128i bg1 = _mm_loadu_si128((const __m128i *)(src1 + x * 2 + 16));
+
+		__m128i r = _mm_packus_epi16(_mm_srli_epi16(gr0, 8), _mm_srli_epi16(gr1, 8));
+		__m128i b = _mm_packus_epi16(_mm_and_si128(bg0, low), _mm_and_si128(bg1, low));
+
+		// Truncating average, _mm_avg_epu8 rounds up.
+		__m128i g0 = _mm_add_epi16(_mm_and_si128(gr0, low), _mm_srli_epi16(bg0, 8));
+		__m128i g1 = _mm_add_epi16(_mm_and_si128(gr1, low), _mm_srli_epi16(bg1, 8));
+		__m128i g = _mm_packus_epi16(_mm_srli_epi16(g0, 1), _mm_srli_epi16(g1, 1));
+
+		sse4_store_rgb_16(dst + x * 3, r, g, b);
+	}
+
+	scalar_BAYER_GR8_to_R8G8B8(src + x * 2, src_stride, dst + x * 3, width - x);
+}
+
+static const struct u_format_convert_kernels sse4_kernels = {
+    .impl = U_FORMAT_CONVERT_IMPL_SSE4,
+    .name = "sse4",
+    .L8_to_R8G8B8 = sse4_L8_to_R8G8B8,
+    .YUYV422_to_R8G8B8 = sse4_YUYV422_to_R8G8B8,
+    .UYVY422_to_R8G8B8 = sse4_UYVY422_to_R8G8B8,
+    .YUV888_to_R8G8B8 = sse4_YUV888_to_R8G8B8,
+    .BAYER_GR8_to_R8G8B8 = sse4_BAYER_GR8_to_R8G8B8,
+};
+
+/*!
+ * Does the YUV math on eight pixels per vector, the interleaving is still
+ * done 128 bits at a time since the shuffles can't cross lanes.
+ */
+TARGET_AVX2 static inline void
+avx2_yuv_to_rgb_16(const __m128i chunks[4], const struct yuv_layout *layout, uint8_t *dst)
+{
+	__m128i my = sse4_mask_u8(layout->y);
+	__m128i mu = sse4_mask_u8(layout->u);
+	__m128i mv = sse4_mask_u8(layout->v);
+
+	__m128i r16[2];
+	__m128i g16[2];
+	__m128i b16[2];
+	for (int h = 0; h < 2; h++) {
+		const __m128i *c = &chunks[h * 2];
+
+		// Eight pixels in the low bytes.
+		__m128i y8 = _mm_unpacklo_epi32(_mm_shuffle_epi8(c[0], my), _mm_shuffle_epi8(c[1], my));
+		__m128i u8 = _mm_unpacklo_epi32(_mm_shuffle_epi8(c[0], mu), _mm_shuffle_epi8(c[1], mu));
+		__m128i v8 = _mm_unpacklo_epi32(_mm_shuffle_epi8(c[0], mv), _mm_shuffle_epi8(c[1], mv));
+
+		__m256i C = _mm256_sub_epi32(_mm256_cvtepu8_epi32(y8), _mm256_set1_epi32(16));
+		__m256i D = _mm256_sub_epi32(_mm256_cvtepu8_epi32(u8), _mm256_set1_epi32(128));
+		__m256i E = _mm256_sub_epi32(_mm256_cvtepu8_epi32(v8), _mm256_set1_epi32(128));
+
+		__m256i c298 = _mm256_add_epi32(_mm256_mullo_epi32(C, _mm256_set1_epi32(298)), _mm256_set1_epi32(128));
+
+		__m256i r = _mm256_add_epi32(c298, _mm256_mullo_epi32(E, _mm256_set1_epi32(409)));
+		__m256i g = _mm256_sub_epi32(c298, _mm256_mullo_epi32(D, _mm256_set1_epi32(100)));
+		g = _mm256_sub_epi32(g, _mm256_mullo_epi32(E, _mm256_set1_epi32(209)));
+		__m256i b = _mm256_add_epi32(c298, _mm256_mullo_epi32(D, _mm256_set1_epi32(516)));
+
+		r = _mm256_srai_epi32(r, 8);
+		g = _mm256_srai_epi32(g, 8);
+		b = _mm256_srai_epi32(b, 8);
+
+		r16[h] = _mm_packs_epi32(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1));
+		g16[h] = _mm_packs_epi32(_mm256_castsi256_si128(g), _mm256_extracti128_si256(g, 1));
+		b16[h] = _mm_packs_epi32(_mm256_castsi256_si128(b), _mm256_extracti128_si256(b, 1));
+	}
+
+	__m128i r8 = _mm_packus_epi16(r16[0], r16[1]);
+	__m128i g8 = _mm_packus_epi16(g16[0], g16[1]);
+	__m128i b8 = _mm_packus_epi16(b16[0], b16[1]);
+
+	sse4_store_rgb_16(dst, r8, g8, b8);
+}
+
+TARGET_AVX2 static void
+avx2_YUYV422_to_R8G8B8(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width)
+{
+	__m128i chunks[4];
+
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16) {
+		sse4_load_chunks_422(src + x * 2, chunks);
+		avx2_yuv_to_rgb_16(chunks, &layout_YUYV422, dst + x * 3);
+	}
+
+	scalar_YUYV422_to_R8G8B8(src + x * 2, src_stride, dst + x * 3, width - x);
+}
+
+TARGET_AVX2 static void
+avx2_UYVY422_to_R8G8B8(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width)
+{
+	__m128i chunks[4];
+
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16) {
+		sse4_load_chunks_422(src + x * 2, chunks);
+		avx2_yuv_to_rgb_16(chunks, &layout_UYVY422, dst + x * 3);
+	}
+
+	scalar_UYVY422_to_R8G8B8(src + x * 2, src_stride, dst + x * 3, width - x);
+}
+
+TARGET_AVX2 static void
+avx2_YUV888_to_R8G8B8(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width)
+{
+	__m128i chunks[4];
+
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16) {
+		sse4_load_chunks_888(src + x * 3, chunks);
+		avx2_yuv_to_rgb_16(chunks, &layout_YUV888, dst + x * 3);
+	}
+
+	scalar_YUV888_to_R8G8B8(src + x * 3, src_stride, dst + x * 3, width - x);
+}
+
+/*!
+ * L8 and Bayer are bound by the byte shuffling, which AVX2 can't do any
+ * wider for R8G8B8, so they use the SSE4 kernels.
+ */
+static const struct u_format_convert_kernels avx2_kernels = {
+    .impl = U_FORMAT_CONVERT_IMPL_AVX2,
+    .name = "avx2",
+    .L8_to_R8G8B8 = sse4_L8_to_R8G8B8,
+    .YUYV422_to_R8G8B8 = avx2_YUYV422_to_R8G8B8,
+    .UYVY422_to_R8G8B8 = avx2_UYVY422_to_R8G8B8,
+    .YUV888_to_R8G8B8 = avx2_YUV888_to_R8G8B8,
+    .BAYER_GR8_to_R8G8B8 = sse4_BAYER_GR8_to_R8G8B8,
+};
+
+#endif // U_FORMAT_CONVERT_HAVE_X86
+
+
+/*
+ *
+ * NEON, the structured loads and stores do all of the interleaving.
+ *
+ */
+
+#ifdef U_FORMAT_CONVERT_HAVE_NEON
+
+static inline int16x4_t
+neon_yuv_channel(int32x4_t v)
+{
+	return vqmovn_s32(vshrq_n_s32(v, 8));
+}
+
+static inline void
+neon_yuv_to_rgb_8(uint8x8_t y, uint8x8_t u, uint8x8_t v, uint8x8_t *out_r, uint8x8_t *out_g, uint8x8_t *out_b)
+{
+	int16x8_t c = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(y)), vdupq_n_s16(16));
+	int16x8_t d = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u)), vdupq_n_s16(128));
+	int16x8_t e = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v)), vdupq_n_s16(128));
+
+	int32x4_t c298_lo = vmlal_n_s16(vdupq_n_s32(128), vget_low_s16(c), 298);
+	int32x4_t c298_hi = vmlal_n_s16(vdupq_n_s32(128), vget_high_s16(c), 298);
+
+	int32x4_t r_lo = vmlal_n_s16(c298_lo, vget_low_s16(e), 409);
+	int32x4_t r_hi = vmlal_n_s16(c298_hi, vget_high_s16(e), 409);
+
+	int32x4_t g_lo = vmlsl_n_s16(vmlsl_n_s16(c298_lo, vget_low_s16(d), 100), vget_low_s16(e), 209);
+	int32x4_t g_hi = vmlsl_n_s16(vmlsl_n_s16(c298_hi, vget_high_s16(d), 100), vget_high_s16(e), 209);
+
+	int32x4_t b_lo = vmlal_n_s16(c298_lo, vget_low_s16(d), 516);
+	int32x4_t b_hi = vmlal_n_s16(c298_hi, vget_high_s16(d), 516);
+
+	// Saturating through 16 bits is the same as clamping to [0, 255].
+	*out_r = vqmovun_s16(vcombine_s16(neon_yuv_channel(r_lo), neon_yuv_channel(r_hi)));
+	*out_g = vqmovun_s16(vcombine_s16(neon_yuv_channel(g_lo), neon_yuv_channel(g_hi)));
+	*out_b = vqmovun_s16(vcombine_s16(neon_yuv_channel(b_lo), neon_yuv_channel(b_hi)));
+}
+
+//! Converts the even and odd pixels of a 4:2:2 row and stores them interleaved.
+static inline void
+neon_yuv422_to_rgb_16(uint8x8_t y_even, uint8x8_t y_odd, uint8x8_t u, uint8x8_t v, uint8_t *dst)
+{
+	uint8x8_t r[2];
+	uint8x8_t g[2];
+	uint8x8_t b[2];
+	neon_yuv_to_rgb_8(y_even, u, v, &r[0], &g[0], &b[0]);
+	neon_yuv_to_rgb_8(y_odd, u, v, &r[1], &g[1], &b[1]);
+
+	uint8x8x2_t rz = vzip_u8(r[0], r[1]);
+	uint8x8x2_t gz = vzip_u8(g[0], g[1]);
+	uint8x8x2_t bz = vzip_u8(b[0], b[1]);
+
+	uint8x16x3_t rgb;
+	rgb.val[0] = vcombine_u8(rz.val[0], rz.val[1]);
+	rgb.val[1] = vcombine_u8(gz.val[0], gz.val[1]);
+	rgb.val[2] = vcombine_u8(bz.val[0], bz.val[1]);
+	vst3q_u8(dst, rgb);
+}
+
+static void
+neon_L8_to_R8G8B8(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width)
+{
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16) {
+		uint8x16_t l = vld1q_u8(src + x);
+		uint8x16x3_t rgb = {{l, l, l}};
+		vst3q_u8(dst + x * 3, rgb);
+	}
+
+	scalar_L8_to_R8G8B8(src + x, src_stride, dst + x * 3, width - x);
+}
+
+static void
+neon_YUYV422_to_R8G8B8(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width)
+{
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16) {
+		uint8x8x4_t yuyv = vld4_u8(src + x * 2);
+		neon_yuv422_to_rgb_16(yuyv.val[0], yuyv.val[2], yuyv.val[1], yuyv.val[3], dst + x * 3);
+	}
+
+	scalar_YUYV422_to_R8G8B8(src + x * 2, src_stride, dst + x * 3, width - x);
+}
+
+static void
+neon_UYVY422_to_R8G8B8(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width)
+{
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16) {
+		uint8x8x4_t uyvy = vld4_u8(src + x * 2);
+		neon_yuv422_to_rgb_16(uyvy.val[1], uyvy.val[3], uyvy.val[0], uyvy.val[2], dst + x * 3);
+	}
+
+	scalar_UYVY422_to_R8G8B8(src + x * 2, src_stride, dst + x * 3, width - x);
+}
+
+static void
+neon_YUV888_to_R8G8B8(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width)
+{
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16) {
+		uint8x16x3_t yuv = vld3q_u8(src + x * 3);
+
+		uint8x8_t r[2];
+		uint8x8_t g[2];
+		uint8x8_t b[2];
+		neon_yuv_to_rgb_8(vget_low_u8(yuv.val[0]), vget_low_u8(yuv.val[1]), vget_low_u8(yuv.val[2]), &r[0],
+		                  &g[0], &b[0]);
+		neon_yuv_to_rgb_8(vget_high_u8(yuv.val[0]), vget_high_u8(yuv.val[1]), vget_high_u8(yuv.val[2]), &r[1],
+		                  &g[1], &b[1]);
+
+		uint8x16x3_t rgb;
+		rgb.val[0] = vcombine_u8(r[0], r[1]);
+		rgb.val[1] = vcombine_u8(g[0], g[1]);
+		rgb.val[2] = vcombine_u8(b[0], b[1]);
+		vst3q_u8(dst + x * 3, rgb);
+	}
+
+	scalar_YUV888_to_R8G8B8(src + x * 3, src_stride, dst + x * 3, width - x);
+}
+
+static void
+neon_BAYER_GR8_to_R8G8B8(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width)
+{
+	const uint8_t *src0 = src;
+	const uint8_t *src1 = src + src_stride;
+
+	uint32_t x = 0;
+	for (; x + 16 <= width; x += 16) {
+		uint8x16x2_t gr = vld2q_u8(src0 + x * 2);
+		uint8x16x2_t bg = vld2q_u8(src1 + x * 2);
+
+		uint8x16x3_t rgb;
+		rgb.val[0] = gr.val[1];
+		rgb.val[1] = vhaddq_u8(gr.val[0], bg.val[1]); // Truncating like the scalar one.
+		rgb.val[2] = bg.val[0];
+		vst3q_u8(dst + x * 3, rgb);
+	}
+
+	scalar_BAYER_GR8_to_R8G8B8(src + x * 2, src_stride, dst + x * 3, width - x);
+}
+
+static const struct u_format_convert_kernels neon_kernels = {
+    .impl = U_FORMAT_CONVERT_IMPL_NEON,
+    .name = "neon",
+    .L8_to_R8G8B8 = neon_L8_to_R8G8B8,
+    .YUYV422_to_R8G8B8 = neon_YUYV422_to_R8G8B8,
+    .UYVY422_to_R8G8B8 = neon_UYVY422_to_R8G8B8,
+    .YUV888_to_R8G8B8 = neon_YUV888_to_R8G8B8,
+    .BAYER_GR8_to_R8G8B8 = neon_BAYER_GR8_to_R8G8B8,
+};
+
+#endif // U_FORMAT_CONVERT_HAVE_NEON
+
+
+/*
+ *
+ * Dispatch.
+ *
+ */
+
+static const char *impl_names[U_FORMAT_CONVERT_IMPL_COUNT] = {
+    [U_FORMAT_CONVERT_IMPL_SCALAR] = "scalar",
+    [U_FORMAT_CONVERT_IMPL_SSE4] = "sse4",
+    [U_FORMAT_CONVERT_IMPL_AVX2] = "avx2",
+    [U_FORMAT_CONVERT_IMPL_NEON] = "neon",
+};
+
+const struct u_format_convert_kernels *
+u_format_convert_get_kernels(enum u_format_convert_impl impl)
+{
+	switch (impl) {
+	case U_FORMAT_CONVERT_IMPL_SCALAR: return &scalar_kernels;
+#ifdef U_FORMAT_CONVERT_HAVE_X86
+	case U_FORMAT_CONVERT_IMPL_SSE4:
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.1")) {
+			return &sse4_kernels;
+		}
+		return NULL;
+	case U_FORMAT_CONVERT_IMPL_AVX2:
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) {
+			return &avx2_kernels;
+		}
+		return NULL;
+#endif
+#ifdef U_FORMAT_CONVERT_HAVE_NEON
+	case U_FORMAT_CONVERT_IMPL_NEON: return &neon_kernels;
+#endif
+	default: return NULL;
+	}
+}
+
+const struct u_format_convert_kernels *
+u_format_convert_best_kernels(void)
+{
+	static const struct u_format_convert_kernels *best = NULL;
+	if (best != NULL) {
+		return best;
+	}
+
+	const struct u_format_convert_kernels *kernels = NULL;
+
+	const char *forced = debug_get_option_convert_impl();
+	if (forced != NULL) {
+		for (int i = 0; i < U_FORMAT_CONVERT_IMPL_COUNT; i++) {
+			if (strcmp(forced, impl_names[i]) == 0) {
+				kernels = u_format_convert_get_kernels((enum u_format_convert_impl)i);
+			}
+		}
+		if (kernels == NULL) {
+			U_LOG_W("U_FORMAT_CONVERT_IMPL='%s' is not available, picking one", forced);
+		}
+	}
+
+	// Fastest first.
+	for (int i = U_FORMAT_CONVERT_IMPL_COUNT - 1; i >= 0 && kernels == NULL; i--) {
+		kernels = u_format_convert_get_kernels((enum u_format_convert_impl)i);
+	}
+
+	U_LOG_D("Using '%s' format conversion kernels", kernels->name);
+
+	// Same answer on every thread, so a racing first call is harmless.
+	best = kernels;
+
+	return best;
+}
@@ -0,0 +1,85 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Row kernels for converting camera formats to R8G8B8.
+ * @ingroup aux_util
+ */
+
+#pragma once
+
+#include "xrt/xrt_compiler.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*!
+ * Implementations of @ref u_format_convert_kernels, the scalar one is always
+ * available and is the reference the others must match bit for bit.
+ *
+ * @ingroup aux_util
+ */
+enum u_format_convert_impl
+{
+	U_FORMAT_CONVERT_IMPL_SCALAR,
+	U_FORMAT_CONVERT_IMPL_SSE4,
+	U_FORMAT_CONVERT_IMPL_AVX2,
+	U_FORMAT_CONVERT_IMPL_NEON,
+	U_FORMAT_CONVERT_IMPL_COUNT,
+};
+
+/*!
+ * Converts one row of @p width output pixels from @p src to R8G8B8 in @p dst.
+ * Only the Bayer kernel reads two source rows, the second @p src_stride
+ * bytes after the first, and outputs half the source resolution.
+ *
+ * @ingroup aux_util
+ */
+typedef void (*u_format_convert_row_func_t)(const uint8_t *src, size_t src_stride, uint8_t *dst, uint32_t width);
+
+/*!
+ * One set of row kernels, get them with @ref u_format_convert_get_kernels.
+ *
+ * @ingroup aux_util
+ */
+struct u_format_convert_kernels
+{
+	enum u_format_convert_impl impl;
+	const char *name;
+
+	u_format_convert_row_func_t L8_to_R8G8B8;
+	u_format_convert_row_func_t YUYV422_to_R8G8B8;
+	u_format_convert_row_func_t UYVY422_to_R8G8B8;
+	u_format_convert_row_func_t YUV888_to_R8G8B8;
+	u_format_convert_row_func_t BAYER_GR8_to_R8G8B8;
+};
+
+/*!
+ * Returns the kernels of @p impl, or NULL if it was not compiled in or the
+ * CPU does not support it.
+ *
+ * @ingroup aux_util
+ */
+const struct u_format_convert_kernels *
+u_format_convert_get_kernels(enum u_format_convert_impl impl);
+
+/*!
+ * Returns the fastest kernels the CPU supports, picked once on first call.
+ * Can be forced with the `U_FORMAT_CONVERT_IMPL` environment variable, set
+ * to one of "scalar", "sse4", "avx2" or "neon".
+ *
+ * @ingroup aux_util
+ */
+const struct u_format_convert_kernels *
+u_format_convert_best_kernels(void);
+
+
+#ifdef __cplusplus
+}
+#endif
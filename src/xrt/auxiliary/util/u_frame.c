@@ -10,18 +10,262 @@
 #include "util/u_misc.h"
 #include "util/u_frame.h"
 #include "util/u_format.h"
+#include "util/u_debug.h"
+#include "util/u_var.h"
+
+#include "os/os_threading.h"
 
 #include <assert.h>
+#include <string.h>
+
+
+/*
+ *
+ * Pool.
+ *
+ */
+
+DEBUG_GET_ONCE_NUM_OPTION(frame_pool_max_frames, "U_FRAME_POOL_MAX_FRAMES", 8)
+DEBUG_GET_ONCE_NUM_OPTION(frame_pool_max_mb, "U_FRAME_POOL_MAX_MB", 128)
+
+//! Different buffer sizes kept at the same time, a few cameras with a few conversions each.
+#define POOL_BUCKET_COUNT 16
+
+/*!
+ * A frame from @ref u_frame_create_one_off or @ref u_frame_clone, its buffer
+ * is recycled through the pool when the frame is destroyed.
+ */
+struct pooled_frame
+{
+	struct xrt_frame base;
+
+	//! Next free frame in the same bucket, only used while in the pool.
+	struct pooled_frame *next;
+
+	//! Bytes allocated for data, the key to the bucket.
+	size_t capacity;
+};
+
+/*!
+ * Free frames with buffers of the same size. Frames are only matched on the
+ * byte size of the buffer, format and dimensions are filled in when handed out.
+ */
+struct pool_bucket
+{
+	size_t capacity;
+	uint32_t count;
+	struct pooled_frame *head;
+};
+
+static struct
+{
+	struct os_mutex mutex;
+
+	struct pool_bucket buckets[POOL_BUCKET_COUNT];
+
+	//! Limits, can be tweaked from the debug UI.
+	int32_t max_frames_per_size;
+	int32_t max_cached_mb;
+
+	//! Stats, protected by the mutex.
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t cached_bytes;
+	uint32_t cached_frames;
+} g_pool;
+
+static struct os_once g_pool_once = OS_ONCE_INIT;
+
+static void
+pool_init_once(void)
+{
+	os_mutex_init(&g_pool.mutex);
+	g_pool.max_frames_per_size = (int32_t)debug_get_num_option_frame_pool_max_frames();
+	g_pool.max_cached_mb = (int32_t)debug_get_num_option_frame_pool_max_mb();
+
+	u_var_add_root(&g_pool, "Frame pool", false);
+	u_var_add_i32(&g_pool, &g_pool.max_frames_per_size, "Max frames per size");
+	u_var_add_i32(&g_pool, &g_pool.max_cached_mb, "Max cached (MB)");
+	u_var_add_ro_u64(&g_pool, &g_pool.hits, "Hits");
+	u_var_add_ro_u64(&g_pool, &g_pool.misses, "Misses");
+	u_var_add_ro_u32(&g_pool, &g_pool.cached_frames, "Cached frames");
+	u_var_add_ro_u64(&g_pool, &g_pool.cached_bytes, "Cached bytes");
+}
+
+static void
+pool_init(void)
+{
+	os_once_call(&g_pool_once, pool_init_once);
+}
 
+static void
+pooled_frame_free(struct pooled_frame *pf)
+{
+	free(pf->base.data);
+	free(pf);
+}
+
+//! Frees frames until the pool is within its limits, mutex must be held
+static void
+pool_trim_locked(uint32_t max_frames_per_size, uint64_t max_bytes)
+{
+	for (uint32_t i = 0; i < POOL_BUCKET_COUNT; i++) {
+		struct pool_bucket *b = &g_pool.buckets[i];
+		while (b->head != NULL && (b->count > max_frames_per_size || g_pool.cached_bytes > max_bytes)) {
+			struct pooled_frame *pf = b->head;
+			b->head = pf->next;
+			b->count--;
+			g_pool.cached_frames--;
+			g_pool.cached_bytes -= pf->capacity;
+			pooled_frame_free(pf);
+		}
+	}
+}
 
 static void
-free_one_off(struct xrt_frame *xf)
+pool_release(struct xrt_frame *xf)
 {
 	assert(xf->reference.count == 0);
-	free(xf->data);
-	free(xf);
+	struct pooled_frame *pf = (struct pooled_frame *)xf;
+
+	os_mutex_lock(&g_pool.mutex);
+
+	// Negative values from the UI mean no pooling.
+	uint32_t max_frames = g_pool.max_frames_per_size > 0 ? (uint32_t)g_pool.max_frames_per_size : 0;
+	uint64_t max_bytes = g_pool.max_cached_mb > 0 ? (uint64_t)g_pool.max_cached_mb * 1024 * 1024 : 0;
+
+	// Find the bucket for this size, or claim an empty one.
+	struct pool_bucket *bucket = NULL;
+	for (uint32_t i = 0; i < POOL_BUCKET_COUNT; i++) {
+		struct pool_bucket *b = &g_pool.buckets[i];
+		if (b->capacity == pf->capacity) {
+			bucket = b;
+			break;
+		}
+		if (bucket == NULL && b->count == 0) {
+			bucket = b;
+		}
+	}
+
+	bool keep = bucket != NULL &&                 //
+	            bucket->count < max_frames &&      //
+	            g_pool.cached_bytes + pf->capacity <= max_bytes;
+
+	if (keep) {
+		bucket->capacity = pf->capacity;
+		pf->next = bucket->head;
+		bucket->head = pf;
+		bucket->count++;
+		g_pool.cached_frames++;
+		g_pool.cached_bytes += pf->capacity;
+	}
+
+	// Limits might have been lowered from the UI.
+	pool_trim_locked(max_frames, max_bytes);
+
+	os_mutex_unlock(&g_pool.mutex);
+
+	if (!keep) {
+		pooled_frame_free(pf);
+	}
+}
+
+/*!
+ * Gets a frame with a buffer of @p size bytes from the pool or allocates a new
+ * one, every field but data is cleared.
+ */
+static struct xrt_frame *
+pool_acquire(size_t size)
+{
+	pool_init();
+
+	struct pooled_frame *pf = NULL;
+
+	os_mutex_lock(&g_pool.mutex);
+	for (uint32_t i = 0; i < POOL_BUCKET_COUNT; i++) {
+		struct pool_bucket *b = &g_pool.buckets[i];
+		if (b->capacity != size || b->head == NULL) {
+			continue;
+		}
+
+		pf = b->head;
+		b->head = pf->next;
+		b->count--;
+		g_pool.cached_frames--;
+		g_pool.cached_bytes -= pf->capacity;
+		break;
+	}
+
+	if (pf != NULL) {
+		g_pool.hits++;
+	} else {
+		g_pool.misses++;
+	}
+	os_mutex_unlock(&g_pool.mutex);
+
+	uint8_t *data = NULL;
+	if (pf != NULL) {
+		data = pf->base.data;
+	} else {
+		pf = U_TYPED_CALLOC(struct pooled_frame);
+		pf->capacity = size;
+		data = (uint8_t *)malloc(size);
+	}
+
+	memset(&pf->base, 0, sizeof(pf->base));
+	pf->next = NULL;
+	pf->base.data = data;
+	pf->base.size = size;
+	pf->base.destroy = pool_release;
+
+	return &pf->base;
+}
+
+void
+u_frame_pool_set_limits(uint32_t max_frames_per_size, uint32_t max_cached_mb)
+{
+	pool_init();
+
+	max_frames_per_size = max_frames_per_size > INT32_MAX ? INT32_MAX : max_frames_per_size;
+	max_cached_mb = max_cached_mb > INT32_MAX ? INT32_MAX : max_cached_mb;
+
+	os_mutex_lock(&g_pool.mutex);
+	g_pool.max_frames_per_size = (int32_t)max_frames_per_size;
+	g_pool.max_cached_mb = (int32_t)max_cached_mb;
+	pool_trim_locked(max_frames_per_size, (uint64_t)max_cached_mb * 1024 * 1024);
+	os_mutex_unlock(&g_pool.mutex);
+}
+
+void
+u_frame_pool_get_stats(struct u_frame_pool_stats *out_stats)
+{
+	pool_init();
+
+	os_mutex_lock(&g_pool.mutex);
+	out_stats->hits = g_pool.hits;
+	out_stats->misses = g_pool.misses;
+	out_stats->cached_frames = g_pool.cached_frames;
+	out_stats->cached_bytes = g_pool.cached_bytes;
+	os_mutex_unlock(&g_pool.mutex);
 }
 
+void
+u_frame_pool_trim(void)
+{
+	pool_init();
+
+	os_mutex_lock(&g_pool.mutex);
+	pool_trim_locked(0, 0);
+	os_mutex_unlock(&g_pool.mutex);
+}
+
+
+/*
+ *
+ * Frame functions.
+ *
+ */
+
 void
 u_frame_create_one_off(enum xrt_format f, uint32_t width, uint32_t height, struct xrt_frame **out_frame)
 {
@@ -29,38 +273,29 @@ u_frame_create_one_off(enum xrt_format f, uint32_t width, uint32_t height, struc
 	assert(height > 0);
 	assert(u_format_is_blocks(f));
 
-	struct xrt_frame *xf = U_TYPED_CALLOC(struct xrt_frame);
+	size_t stride = 0;
+	size_t size = 0;
+	u_format_size_for_dimensions(f, width, height, &stride, &size);
+
+	struct xrt_frame *xf = pool_acquire(size);
 
 	xf->format = f;
 	xf->width = width;
 	xf->height = height;
-	xf->destroy = free_one_off;
-
-	u_format_size_for_dimensions(f, width, height, &xf->stride, &xf->size);
-
-	xf->data = (uint8_t *)realloc(xf->data, xf->size);
+	xf->stride = stride;
 
 	xrt_frame_reference(out_frame, xf);
 }
 
-static void
-free_clone(struct xrt_frame *xf)
-{
-	assert(xf->reference.count == 0);
-	free(xf->data);
-	free(xf);
-}
-
 void
 u_frame_clone(struct xrt_frame *to_copy, struct xrt_frame **out_frame)
 {
-	struct xrt_frame *xf = U_TYPED_CALLOC(struct xrt_frame);
+	struct xrt_frame *xf = pool_acquire(to_copy->size);
 
 	// Explicitly only copy the fields we want
 	xf->width = to_copy->width;
 	xf->height = to_copy->height;
 	xf->stride = to_copy->stride;
-	xf->size = to_copy->size;
 
 	xf->format = to_copy->format;
 	xf->stereo_format = to_copy->stereo_format;
@@ -70,10 +305,6 @@ u_frame_clone(struct xrt_frame *to_copy, struct xrt_frame **out_frame)
 	xf->source_sequence = to_copy->source_sequence;
 	xf->source_id = to_copy->source_id;
 
-	xf->destroy = free_clone;
-
-	xf->data = malloc(xf->size);
-
 	memcpy(xf->data, to_copy->data, xf->size);
 
 	xrt_frame_reference(out_frame, xf);
@@ -143,3 +374,139 @@ u_frame_create_roi(struct xrt_frame *original, struct xrt_rect roi, struct xrt_f
 
 	xrt_frame_reference(out_frame, xf);
 }
+
+
+/*
+ *
+ * Side-by-side views.
+ *
+ */
+
+/*!
+ * A side-by-side frame made of two frames, never has any data of its own.
+ */
+struct sbs_view_frame
+{
+	struct xrt_frame base;
+
+	//! Left and right, wrapping the original frames with the view's timestamp.
+	struct xrt_frame *eyes[2];
+};
+
+static void
+free_sbs_view(struct xrt_frame *xf)
+{
+	struct sbs_view_frame *view = (struct sbs_view_frame *)xf;
+
+	xrt_frame_reference(&view->eyes[0], NULL);
+	xrt_frame_reference(&view->eyes[1], NULL);
+	free(view);
+}
+
+static struct sbs_view_frame *
+sbs_view_or_null(struct xrt_frame *xf)
+{
+	if (xf == NULL || xf->destroy != free_sbs_view) {
+		return NULL;
+	}
+	return (struct sbs_view_frame *)xf;
+}
+
+static void
+wrap_eye(struct xrt_frame *original, uint64_t timestamp, struct xrt_frame **out_frame)
+{
+	struct xrt_rect all = {.extent = {.w = (int)original->width, .h = (int)original->height}};
+	struct xrt_frame *xf = NULL;
+	u_frame_create_roi(original, all, &xf);
+
+	// Not pushed anywhere yet, so still ours to change.
+	xf->timestamp = timestamp;
+	xf->stereo_format = original->stereo_format;
+
+	*out_frame = xf;
+}
+
+void
+u_frame_create_sbs_view(struct xrt_frame *left, struct xrt_frame *right, struct xrt_frame **out_frame)
+{
+	assert(left->height == right->height);
+	assert(left->format == right->format);
+	assert(u_format_is_blocks(left->format) && u_format_block_height(left->format) == 1);
+	assert(left->width % u_format_block_width(left->format) == 0);
+
+	uint32_t width = left->width + right->width;
+	uint32_t height = left->height;
+
+	// Middle of both frames, what the copying combiner always gave the combined frame.
+	int64_t diff_ns = (int64_t)(left->timestamp - right->timestamp);
+	uint64_t timestamp = left->timestamp - (diff_ns / 2);
+
+	struct sbs_view_frame *view = U_TYPED_CALLOC(struct sbs_view_frame);
+	wrap_eye(left, timestamp, &view->eyes[0]);
+	wrap_eye(right, timestamp, &view->eyes[1]);
+
+	struct xrt_frame *xf = &view->base;
+	xf->destroy = free_sbs_view;
+
+	// What the packed frame will look like, data is always NULL.
+	u_format_size_for_dimensions(left->format, width, height, &xf->stride, &xf->size);
+	xf->width = width;
+	xf->height = height;
+	xf->format = left->format;
+	xf->stereo_format = XRT_STEREO_FORMAT_SBS;
+
+	xf->timestamp = timestamp;
+	xf->source_timestamp = left->source_timestamp;
+	xf->source_sequence = left->source_sequence;
+	xf->source_id = left->source_id;
+
+	xrt_frame_reference(out_frame, xf);
+}
+
+bool
+u_frame_sbs_view_get_eyes(struct xrt_frame *xf, struct xrt_frame **out_left, struct xrt_frame **out_right)
+{
+	struct sbs_view_frame *view = sbs_view_or_null(xf);
+	if (view == NULL) {
+		return false;
+	}
+
+	xrt_frame_reference(out_left, view->eyes[0]);
+	xrt_frame_reference(out_right, view->eyes[1]);
+
+	return true;
+}
+
+void
+u_frame_pack_sbs_view(struct xrt_frame *xf, struct xrt_frame **out_frame)
+{
+	struct sbs_view_frame *view = sbs_view_or_null(xf);
+	if (view == NULL) {
+		xrt_frame_reference(out_frame, xf);
+		return;
+	}
+
+	struct xrt_frame *l = view->eyes[0];
+	struct xrt_frame *r = view->eyes[1];
+	struct xrt_frame *packed = NULL;
+	u_frame_create_one_off(xf->format, xf->width, xf->height, &packed);
+
+	uint32_t bw = u_format_block_width(l->format);
+	size_t bsz = u_format_block_size(l->format);
+	size_t l_bytes = l->width / bw * bsz;
+	size_t r_bytes = r->width / bw * bsz;
+	for (uint32_t y = 0; y < xf->height; y++) {
+		uint8_t *dst = packed->data + packed->stride * y;
+		memcpy(dst, l->data + l->stride * y, l_bytes);
+		memcpy(dst + l_bytes, r->data + r->stride * y, r_bytes);
+	}
+
+	packed->stereo_format = xf->stereo_format;
+	packed->timestamp = xf->timestamp;
+	packed->source_timestamp = xf->source_timestamp;
+	packed->source_sequence = xf->source_sequence;
+	packed->source_id = xf->source_id;
+
+	xrt_frame_reference(out_frame, packed);
+	xrt_frame_reference(&packed, NULL);
+}
@@ -17,15 +17,48 @@ extern "C" {
 
 
 /*!
- * Creates a single non-pooled frame, when the reference reaches zero it is
- * freed.
+ * Stats of the pool that @ref u_frame_create_one_off and @ref u_frame_clone
+ * recycle frame buffers through.
+ */
+struct u_frame_pool_stats
+{
+	//! Frames handed out with a recycled buffer.
+	uint64_t hits;
+	//! Frames that had to allocate a new buffer.
+	uint64_t misses;
+	//! Free frames currently kept in the pool.
+	uint32_t cached_frames;
+	//! Bytes of buffers currently kept in the pool.
+	uint64_t cached_bytes;
+};
+
+/*!
+ * Sets how many free frames of the same buffer size, and how many megabytes in
+ * total, the pool keeps around. Setting either to zero disables recycling.
+ * Defaults come from `U_FRAME_POOL_MAX_FRAMES` and `U_FRAME_POOL_MAX_MB`.
+ */
+void
+u_frame_pool_set_limits(uint32_t max_frames_per_size, uint32_t max_cached_mb);
+
+void
+u_frame_pool_get_stats(struct u_frame_pool_stats *out_stats);
+
+/*!
+ * Frees all free frames kept in the pool.
+ */
+void
+u_frame_pool_trim(void);
+
+/*!
+ * Creates a single frame, when the reference reaches zero its buffer is
+ * returned to the frame pool, or freed if the pool is full.
  */
 void
 u_frame_create_one_off(enum xrt_format f, uint32_t width, uint32_t height, struct xrt_frame **out_frame);
 
 /*!
  * Clones a frame. The cloned frame is not freed when the original frame is freed; instead the cloned frame is freed
- * when its reference reaches zero.
+ * when its reference reaches zero. Allocates from the same pool as @ref u_frame_create_one_off.
  */
 void
 u_frame_clone(struct xrt_frame *to_copy, struct xrt_frame **out_frame);
@@ -37,6 +70,35 @@ u_frame_clone(struct xrt_frame *to_copy, struct xrt_frame **out_frame);
 void
 u_frame_create_roi(struct xrt_frame *original, struct xrt_rect roi, struct xrt_frame **out_frame);
 
+/*!
+ * Creates a side-by-side stereo frame out of @p left and @p right without
+ * copying them, referencing both instead. It has the dimensions, format,
+ * stride and middle timestamp of the packed frame, but @ref xrt_frame::data
+ * is always NULL, use @ref u_frame_pack_sbs_view to get a frame with data.
+ *
+ * Sinks that understand views get the eyes back with
+ * @ref u_frame_sbs_view_get_eyes and never pay for the copy.
+ */
+void
+u_frame_create_sbs_view(struct xrt_frame *left, struct xrt_frame *right, struct xrt_frame **out_frame);
+
+/*!
+ * If @p xf was made by @ref u_frame_create_sbs_view references its left and
+ * right frames into @p out_left and @p out_right and returns true. They share
+ * the data of the original frames but carry the timestamp of the view.
+ */
+bool
+u_frame_sbs_view_get_eyes(struct xrt_frame *xf, struct xrt_frame **out_left, struct xrt_frame **out_right);
+
+/*!
+ * Packs a side-by-side view into a new frame from the pool and references it
+ * into @p out_frame, all other frames are referenced as they are. Never
+ * changes @p xf, so do this once before fanning a view out to sinks that
+ * read the data rather than in each of them.
+ */
+void
+u_frame_pack_sbs_view(struct xrt_frame *xf, struct xrt_frame **out_frame);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,4 +1,4 @@
-// Copyright 2019-2020, Collabora, Ltd.
+// Copyright 2019-2024, Collabora, Ltd.
 // SPDX-License-Identifier: BSL-1.0
 /*!
  * @file
@@ -11,8 +11,8 @@
 #include "util/u_hashset.h"
 
 #include <cstring>
-#include <string>
-#include <unordered_map>
+#include <functional>
+#include <string_view>
 #include <vector>
 
 
@@ -22,11 +22,119 @@
  *
  */
 
+/*!
+ * Keeps the hash next to the item pointer so probing only touches the item
+ * on a likely match.
+ */
+struct u_hashset_slot
+{
+	size_t hash;
+	struct u_hashset_item *item;
+};
+
+/*!
+ * Open addressing with linear probing, the number of slots is always a power
+ * of two and at most half of them are used. Erasing shifts the following
+ * items back, so there are no tombstones.
+ */
 struct u_hashset
 {
-	std::unordered_map<std::string, struct u_hashset_item *> map = {};
+	std::vector<u_hashset_slot> slots = std::vector<u_hashset_slot>(16);
+	size_t count = 0;
 };
 
+static inline size_t
+hash_str(std::string_view str)
+{
+	return std::hash<std::string_view>{}(str);
+}
+
+static inline std::string_view
+item_str(struct u_hashset_item *item)
+{
+	return std::string_view(item->c_str(), item->length);
+}
+
+/*!
+ * Returns the slot holding @p str, or the empty slot it would go in.
+ */
+static size_t
+find_slot(const struct u_hashset *hs, size_t hash, std::string_view str)
+{
+	size_t mask = hs->slots.size() - 1;
+	size_t i = hash & mask;
+
+	while (true) {
+		const u_hashset_slot &slot = hs->slots[i];
+		if (slot.item == NULL) {
+			return i;
+		}
+		if (slot.hash == hash && item_str(slot.item) == str) {
+			return i;
+		}
+		i = (i + 1) & mask;
+	}
+}
+
+static void
+grow_if_needed(struct u_hashset *hs)
+{
+	if ((hs->count + 1) * 2 <= hs->slots.size()) {
+		return;
+	}
+
+	std::vector<u_hashset_slot> old(hs->slots.size() * 2);
+	old.swap(hs->slots);
+
+	size_t mask = hs->slots.size() - 1;
+	for (const u_hashset_slot &slot : old) {
+		if (slot.item == NULL) {
+			continue;
+		}
+
+		// All strings are unique, just find the first empty slot.
+		size_t i = slot.hash & mask;
+		while (hs->slots[i].item != NULL) {
+			i = (i + 1) & mask;
+		}
+		hs->slots[i] = slot;
+	}
+}
+
+static void
+erase_slot(struct u_hashset *hs, size_t i)
+{
+	size_t mask = hs->slots.size() - 1;
+	size_t j = i;
+
+	// Move back any following items that would no longer be found past the hole.
+	while (true) {
+		j = (j + 1) & mask;
+		if (hs->slots[j].item == NULL) {
+			break;
+		}
+
+		size_t home = hs->slots[j].hash & mask;
+		bool can_move = i <= j ? (home <= i || home > j) : (home <= i && home > j);
+		if (can_move) {
+			hs->slots[i] = hs->slots[j];
+			i = j;
+		}
+	}
+
+	hs->slots[i] = {};
+	hs->count--;
+}
+
+static void
+erase(struct u_hashset *hs, std::string_view str)
+{
+	size_t i = find_slot(hs, hash_str(str), str);
+	if (hs->slots[i].item != NULL) {
+		erase_slot(hs, i);
+	}
+}
+
 
 /*
  *
@@ -53,11 +161,11 @@ u_hashset_destroy(struct u_hashset **hs)
 extern "C" int
 u_hashset_find_str(struct u_hashset *hs, const char *str, size_t length, struct u_hashset_item **out_item)
 {
-	std::string key = std::string(str, length);
-	auto search = hs->map.find(key);
+	std::string_view key(str, length);
+	size_t i = find_slot(hs, hash_str(key), key);
 
-	if (search != hs->map.end()) {
-		*out_item = search->second;
+	if (hs->slots[i].item != NULL) {
+		*out_item = hs->slots[i].item;
 		return 0;
 	}
 	return -1;
@@ -73,21 +181,32 @@ u_hashset_find_c_str(struct u_hashset *hs, const char *c_str, struct u_hashset_i
 extern "C" int
 u_hashset_insert_item(struct u_hashset *hs, struct u_hashset_item *item)
 {
-	std::string key = std::string(item->c_str(), item->length);
-	hs->map[key] = item;
+	grow_if_needed(hs);
+
+	std::string_view key = item_str(item);
+	item->hash = hash_str(key);
+
+	size_t i = find_slot(hs, item->hash, key);
+	if (hs->slots[i].item == NULL) {
+		hs->count++;
+	}
+	hs->slots[i] = {item->hash, item};
+
 	return 0;
 }
 
 extern "C" int
 u_hashset_create_and_insert_str(struct u_hashset *hs, const char *str, size_t length, struct u_hashset_item **out_item)
 {
-	struct u_hashset_item *unused = NULL;
 	struct u_hashset_item *item = NULL;
 	size_t size = 0;
-	int ret;
 
-	ret = u_hashset_find_str(hs, str, length, &unused);
-	if (ret >= 0) {
+	grow_if_needed(hs);
+
+	std::string_view key(str, length);
+	size_t hash = hash_str(key);
+	size_t i = find_slot(hs, hash, key);
+	if (hs->slots[i].item != NULL) {
 		return -1;
 	}
 
@@ -101,16 +220,17 @@ u_hashset_create_and_insert_str(struct u_hashset *hs, const char *str, size_t le
 		return -1;
 	}
 
+	item->hash = hash;
 	item->length = length;
 	// Yes a const cast! D:
 	char *store = const_cast<char *>(item->c_str());
-	for (size_t i = 0; i < length; i++) {
-		store[i] = str[i];
+	for (size_t k = 0; k < length; k++) {
+		store[k] = str[k];
 	}
 	store[length] = '\0';
 
-	std::string key = std::string(item->c_str(), item->length);
-	hs->map[key] = item;
+	hs->slots[i] = {hash, item};
+	hs->count++;
 
 	*out_item = item;
 
@@ -127,16 +247,14 @@ u_hashset_create_and_insert_str_c(struct u_hashset *hs, const char *c_str, struc
 extern "C" int
 u_hashset_erase_item(struct u_hashset *hs, struct u_hashset_item *item)
 {
-	std::string key = std::string(item->c_str(), item->length);
-	hs->map.erase(key);
+	erase(hs, item_str(item));
 	return 0;
 }
 
 extern "C" int
 u_hashset_erase_str(struct u_hashset *hs, const char *str, size_t length)
 {
-	std::string key = std::string(str, length);
-	hs->map.erase(key);
+	erase(hs, std::string_view(str, length));
 	return 0;
 }
 
@@ -151,13 +269,16 @@ extern "C" void
 u_hashset_clear_and_call_for_each(struct u_hashset *hs, u_hashset_callback cb, void *priv)
 {
 	std::vector<struct u_hashset_item *> tmp;
-	tmp.reserve(hs->map.size());
+	tmp.reserve(hs->count);
 
-	for (auto &n : hs->map) {
-		tmp.push_back(n.second);
+	for (u_hashset_slot &slot : hs->slots) {
+		if (slot.item != NULL) {
+			tmp.push_back(slot.item);
+		}
+		slot = {};
 	}
 
-	hs->map.clear();
+	hs->count = 0;
 
 	for (auto *n : tmp) {
 		cb(n, priv);
@@ -24,6 +24,9 @@ extern "C" {
  * allocating and freeing the items themselves.
  *
  * This allows embedding the @ref u_hashset_item at the end of structs.
+ *
+ * Lookups hash the given string in place and never allocate, which matters
+ * as OpenXR paths are interned through one of these.
  */
 struct u_hashset;
 
@@ -35,6 +38,7 @@ struct u_hashset;
  */
 struct u_hashset_item
 {
+	//! Hash of the string, set when the item is inserted.
 	size_t hash;
 	size_t length;
 
@@ -9,8 +9,12 @@
 
 #include "os/os_threading.h"
 
+#include "util/u_var.h"
+#include "util/u_misc.h"
 #include "util/u_metrics.h"
 #include "util/u_debug.h"
+#include "util/u_time.h"
+#include "util/u_trace_marker.h"
 
 #include "monado_metrics.pb.h"
 #include "pb_encode.h"
@@ -20,11 +24,64 @@
 #define VERSION_MAJOR 1
 #define VERSION_MINOR 1
 
+/*!
+ * Number of records that can be queued up before the writer thread has had a
+ * chance to drain them, must be a power of two. At a few records per frame this
+ * is several seconds worth of headroom.
+ */
+#define RING_SIZE (4096)
+#define RING_MASK (RING_SIZE - 1)
+
+//! Wake the writer early when this many records are queued.
+#define RING_WAKE_THRESHOLD (RING_SIZE / 4)
+
+//! How often the writer thread drains the ring when not woken up early.
+#define WRITER_PERIOD_NS (10 * U_TIME_1MS_IN_NS)
+
+/*!
+ * Size of the buffer encoded records are gathered in before being written to
+ * the file, each record is at most @ref monado_metrics_Record_size plus the
+ * submessage length prefix.
+ */
+#define BATCH_SIZE (64 * 1024)
+
+/*!
+ * A slot in the ring, the sequence number is what makes the ring lock-free for
+ * multiple producers: a producer owns the slot once it has claimed the
+ * position, and hands it over to the writer by bumping the sequence.
+ */
+struct ring_slot
+{
+	xrt_atomic_s32_t sequence;
+	monado_metrics_Record record;
+};
+
 static FILE *g_file = NULL;
-static struct os_mutex g_file_mutex;
 static bool g_metrics_initialized = false;
 static bool g_metrics_early_flush = false;
 
+static struct
+{
+	struct ring_slot *slots;
+
+	//! Next position to be claimed by a producer.
+	xrt_atomic_s32_t enqueue_pos;
+
+	//! Next position to be read, only touched by the writer thread.
+	uint32_t dequeue_pos;
+
+	//! Records thrown away because the ring was full.
+	xrt_atomic_s32_t dropped;
+
+	//! Records written to the file.
+	int32_t written;
+
+	struct os_thread_helper oth;
+	struct os_semaphore wake;
+
+	uint8_t batch[BATCH_SIZE];
+} g_ring;
+
 DEBUG_GET_ONCE_OPTION(metrics_file, "XRT_METRICS_FILE", NULL)
 DEBUG_GET_ONCE_BOOL_OPTION(metrics_early_flush, "XRT_METRICS_EARLY_FLUSH", false)
 
@@ -32,34 +89,156 @@ DEBUG_GET_ONCE_BOOL_OPTION(metrics_early_flush, "XRT_METRICS_EARLY_FLUSH", false
 
 /*
  *
- * Helper functions.
+ * Ring functions.
  *
  */
 
 static void
-write_record(monado_metrics_Record *r)
+ring_init(void)
 {
-	uint8_t buffer[monado_metrics_Record_size + 10]; // Including submessage
+	g_ring.slots = U_TYPED_ARRAY_CALLOC(struct ring_slot, RING_SIZE);
+	for (int32_t i = 0; i < RING_SIZE; i++) {
+		g_ring.slots[i].sequence = i;
+	}
 
+	g_ring.enqueue_pos = 0;
+	g_ring.dequeue_pos = 0;
+	g_ring.dropped = 0;
+	g_ring.written = 0;
+}
 
-	pb_ostream_t stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
-	bool ret = pb_encode_submessage(&stream, &monado_metrics_Record_msg, r);
-	if (!ret) {
-		U_LOG_E("Failed to encode metrics message!");
-		return;
+/*!
+ * Called from any thread, never blocks, drops the record if the ring is full.
+ */
+static void
+ring_push(const monado_metrics_Record *r)
+{
+	uint32_t pos = (uint32_t)xrt_atomic_s32_load(&g_ring.enqueue_pos);
+	struct ring_slot *slot = NULL;
+
+	while (true) {
+		slot = &g_ring.slots[pos & RING_MASK];
+		uint32_t seq = (uint32_t)xrt_atomic_s32_load(&slot->sequence);
+		int32_t diff = (int32_t)(seq - pos);
+
+		if (diff == 0) {
+			// Slot is free, try to claim the position.
+			uint32_t old = (uint32_t)xrt_atomic_s32_cmpxchg(&g_ring.enqueue_pos, (int32_t)pos,
+			                                                (int32_t)(pos + 1));
+			if (old == pos) {
+				break;
+			}
+			pos = old;
+		} else if (diff < 0) {
+			// The writer has not yet consumed the record a lap ago, full.
+			xrt_atomic_s32_inc_return(&g_ring.dropped);
+			return;
+		} else {
+			// Another producer got here first.
+			pos = (uint32_t)xrt_atomic_s32_load(&g_ring.enqueue_pos);
+		}
+	}
+
+	slot->record = *r;
+	xrt_atomic_s32_store(&slot->sequence, (int32_t)(pos + 1));
+
+	// Don't make the writer wait for its period if we are filling up fast.
+	if ((pos & (RING_WAKE_THRESHOLD - 1)) == 0) {
+		os_semaphore_release(&g_ring.wake);
 	}
+}
+
+/*!
+ * Only called from the writer thread.
+ */
+static bool
+ring_pop(monado_metrics_Record *out_r)
+{
+	uint32_t pos = g_ring.dequeue_pos;
+	struct ring_slot *slot = &g_ring.slots[pos & RING_MASK];
+	uint32_t seq = (uint32_t)xrt_atomic_s32_load(&slot->sequence);
+
+	if ((int32_t)(seq - (pos + 1)) < 0) {
+		return false;
+	}
+
+	*out_r = slot->record;
+	xrt_atomic_s32_store(&slot->sequence, (int32_t)(pos + RING_SIZE));
+	g_ring.dequeue_pos = pos + 1;
+
+	return true;
+}
 
-	os_mutex_lock(&g_file_mutex);
 
-	fwrite(buffer, stream.bytes_written, 1, g_file);
+/*
+ *
+ * Writer thread functions.
+ *
+ */
 
-	if (g_metrics_early_flush) {
+/*!
+ * Encode everything currently in the ring and write it out in as few calls as
+ * possible, only called from the writer thread or after it has stopped.
+ */
+static void
+drain_ring(void)
+{
+	monado_metrics_Record record;
+	size_t offset = 0;
+	int32_t count = 0;
+
+	while (ring_pop(&record)) {
+		pb_ostream_t stream = pb_ostream_from_buffer(g_ring.batch + offset, BATCH_SIZE - offset);
+		bool ret = pb_encode_submessage(&stream, &monado_metrics_Record_msg, &record);
+		if (!ret && offset > 0) {
+			// Out of space, flush what we have and try again.
+			fwrite(g_ring.batch, offset, 1, g_file);
+			offset = 0;
+
+			stream = pb_ostream_from_buffer(g_ring.batch, BATCH_SIZE);
+			ret = pb_encode_submessage(&stream, &monado_metrics_Record_msg, &record);
+		}
+		if (!ret) {
+			U_LOG_E("Failed to encode metrics message!");
+			continue;
+		}
+
+		offset += stream.bytes_written;
+		count++;
+	}
+
+	if (offset > 0) {
+		fwrite(g_ring.batch, offset, 1, g_file);
+	}
+
+	if (count > 0 && g_metrics_early_flush) {
 		fflush(g_file);
 	}
 
-	os_mutex_unlock(&g_file_mutex);
+	g_ring.written += count;
+}
+
+static void *
+writer_thread(void *ptr)
+{
+	U_TRACE_SET_THREAD_NAME("Metrics Writer");
+	os_thread_helper_name(&g_ring.oth, "Metrics Writer");
+
+	while (os_thread_helper_is_running(&g_ring.oth)) {
+		os_semaphore_wait(&g_ring.wake, WRITER_PERIOD_NS);
+		drain_ring();
+	}
+
+	return NULL;
 }
 
+
+/*
+ *
+ * Helper functions.
+ *
+ */
+
 static void
 write_version(uint32_t major, uint32_t minor)
 {
@@ -74,7 +253,7 @@ write_version(uint32_t major, uint32_t minor)
 	record.record.version.major = major;
 	record.record.version.minor = minor;
 
-	write_record(&record);
+	ring_push(&record);
 }
 
 
@@ -99,13 +278,32 @@ u_metrics_init(void)
 		return;
 	}
 
-	os_mutex_init(&g_file_mutex);
+	ring_init();
+	os_semaphore_init(&g_ring.wake, 0);
+	os_thread_helper_init(&g_ring.oth);
 
 	g_metrics_initialized = true;
 	g_metrics_early_flush = debug_get_bool_option_metrics_early_flush();
 
 	write_version(VERSION_MAJOR, VERSION_MINOR);
 
+	int ret = os_thread_helper_start(&g_ring.oth, writer_thread, NULL);
+	if (ret != 0) {
+		U_LOG_E("Failed to start metrics writer thread!");
+		g_metrics_initialized = false;
+		os_thread_helper_destroy(&g_ring.oth);
+		os_semaphore_destroy(&g_ring.wake);
+		free(g_ring.slots);
+		g_ring.slots = NULL;
+		fclose(g_file);
+		g_file = NULL;
+		return;
+	}
+
+	u_var_add_root(&g_ring, "Metrics", false);
+	u_var_add_ro_i32(&g_ring, (int32_t *)&g_ring.dropped, "Dropped records");
+	u_var_add_ro_i32(&g_ring, &g_ring.written, "Written records");
+
 	U_LOG_I("Opened metrics file: '%s'", str);
 }
 
@@ -118,16 +316,30 @@ u_metrics_close(void)
 
 	U_LOG_I("Closing metrics file: '%s'", debug_get_option_metrics_file());
 
-	// At least try to avoid races.
-	os_mutex_lock(&g_file_mutex);
+	// Stop accepting new records, at least try to avoid races.
+	g_metrics_initialized = false;
+
+	u_var_remove_root(&g_ring);
+
+	// Wake the writer so we don't have to wait for a whole period.
+	os_semaphore_release(&g_ring.wake);
+	os_thread_helper_destroy(&g_ring.oth);
+
+	// Writer is gone, pick up anything it didn't get to.
+	drain_ring();
+
+	int32_t dropped = xrt_atomic_s32_load(&g_ring.dropped);
+	if (dropped > 0) {
+		U_LOG_W("Dropped %i metrics records, the writer could not keep up!", dropped);
+	}
+
 	fflush(g_file);
 	fclose(g_file);
 	g_file = NULL;
-	os_mutex_unlock(&g_file_mutex);
 
-	os_mutex_destroy(&g_file_mutex);
-
-	g_metrics_initialized = false;
+	os_semaphore_destroy(&g_ring.wake);
+	free(g_ring.slots);
+	g_ring.slots = NULL;
 }
 
 bool
@@ -136,6 +348,12 @@ u_metrics_is_active(void)
 	return g_metrics_initialized;
 }
 
+uint32_t
+u_metrics_get_dropped_count(void)
+{
+	return (uint32_t)xrt_atomic_s32_load(&g_ring.dropped);
+}
+
 void
 u_metrics_write_session_frame(struct u_metrics_session_frame *umsf)
 {
@@ -153,7 +371,7 @@ u_metrics_write_session_frame(struct u_metrics_session_frame *umsf)
 #undef COPY
 
 
-	write_record(&record);
+	ring_push(&record);
 }
 
 void
@@ -173,7 +391,7 @@ u_metrics_write_used(struct u_metrics_used *umu)
 #undef COPY
 
 
-	write_record(&record);
+	ring_push(&record);
 }
 
 void
@@ -193,7 +411,7 @@ u_metrics_write_system_frame(struct u_metrics_system_frame *umsf)
 #undef COPY
 
 
-	write_record(&record);
+	ring_push(&record);
 }
 
 void
@@ -213,7 +431,7 @@ u_metrics_write_system_gpu_info(struct u_metrics_system_gpu_info *umgi)
 #undef COPY
 
 
-	write_record(&record);
+	ring_push(&record);
 }
 
 void
@@ -233,5 +451,5 @@ u_metrics_write_system_present_info(struct u_metrics_system_present_info *umpi)
 #undef COPY
 
 
-	write_record(&record);
+	ring_push(&record);
 }
@@ -89,6 +89,13 @@ u_metrics_close(void);
 bool
 u_metrics_is_active(void);
 
+/*!
+ * Number of records thrown away because the writer thread could not keep up,
+ * the write functions never block so this is how overflow is reported.
+ */
+uint32_t
+u_metrics_get_dropped_count(void);
+
 void
 u_metrics_write_session_frame(struct u_metrics_session_frame *umsf);
 
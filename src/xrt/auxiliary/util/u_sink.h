@@ -13,6 +13,7 @@
 #include "os/os_threading.h"
 #include "xrt/xrt_frame.h"
 #include "xrt/xrt_tracking.h"
+#include "util/u_frame.h"
 
 
 #ifdef __cplusplus
@@ -143,7 +144,8 @@ u_sink_split_create(struct xrt_frame_context *xfctx,
                     struct xrt_frame_sink **out_xfs);
 
 /*!
- * Splits Stereo SBS frames into two independent frames
+ * Splits Stereo SBS frames into two independent frames, side-by-side views
+ * from @ref u_sink_combiner_create_views are split without touching the data.
  */
 void
 u_sink_stereo_sbs_to_slam_sbs_create(struct xrt_frame_context *xfctx,
@@ -161,6 +163,27 @@ u_sink_combiner_create(struct xrt_frame_context *xfctx,
                        struct xrt_frame_sink **out_left_xfs,
                        struct xrt_frame_sink **out_right_xfs);
 
+/*!
+ * Like @ref u_sink_combiner_create but pushes @ref u_frame_create_sbs_view
+ * frames without packing them, for @p downstream that can handle those. Put
+ * a @ref u_sink_sbs_pack_create before the stream reaches sinks that can't.
+ */
+bool
+u_sink_combiner_create_views(struct xrt_frame_context *xfctx,
+                             struct xrt_frame_sink *downstream,
+                             struct xrt_frame_sink **out_left_xfs,
+                             struct xrt_frame_sink **out_right_xfs);
+
+/*!
+ * Packs side-by-side views into new frames before passing them on, other
+ * frames are passed on as they are. Put it before the point where the stream
+ * fans out, not once per branch.
+ */
+void
+u_sink_sbs_pack_create(struct xrt_frame_context *xfctx,
+                       struct xrt_frame_sink *downstream,
+                       struct xrt_frame_sink **out_xfs);
+
 /*!
  * Enforces left-right push order on frames and forces them to be within a reasonable amount of time from each other
  */
@@ -211,7 +234,11 @@ u_sink_debug_push_frame(struct u_sink_debug *usd, struct xrt_frame *xf)
 {
 	os_mutex_lock(&usd->mutex);
 	if (usd->sink != NULL) {
-		xrt_sink_push_frame(usd->sink, xf);
+		// Debug UI sinks read the data, only pack views when watched.
+		struct xrt_frame *packed = NULL;
+		u_frame_pack_sbs_view(xf, &packed);
+		xrt_sink_push_frame(usd->sink, packed);
+		xrt_frame_reference(&packed, NULL);
 	}
 	os_mutex_unlock(&usd->mutex);
 }
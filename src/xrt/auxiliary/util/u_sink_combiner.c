@@ -22,6 +22,8 @@
  * An @ref xrt_frame_sink combiner, frames pushed to the left and right side will be combined into one @ref xrt_frame
  * with format XRT_STEREO_FORMAT_SBS. Will drop stale frames if the combining work takes too long.
  *
+ * The combined frame is a @ref u_frame_create_sbs_view of the two frames.
+ *
  * @implements xrt_frame_sink
  * @implements xrt_frame_node
  */
@@ -50,53 +52,6 @@ struct u_sink_combiner
 	bool running;
 };
 
-static void
-combine_frames_l8(struct xrt_frame *l, struct xrt_frame *r, struct xrt_frame *f)
-{
-	SINK_TRACE_MARKER();
-
-
-	uint32_t height = l->height;
-
-	for (uint32_t y = 0; y < height; y++) {
-		uint8_t *dst = f->data + f->stride * y;
-		uint8_t *src = l->data + l->stride * y;
-
-		for (uint32_t x = 0; x < l->width; x++) {
-			*dst++ = *src++;
-		}
-
-		dst = f->data + f->stride * y + l->width;
-		src = r->data + r->stride * y;
-		for (uint32_t x = 0; x < r->width; x++) {
-			*dst++ = *src++;
-		}
-	}
-}
-
-static void
-combine_frames_r8g8b8(struct xrt_frame *l, struct xrt_frame *r, struct xrt_frame *f)
-{
-	SINK_TRACE_MARKER();
-
-	uint32_t height = l->height;
-
-	for (uint32_t y = 0; y < height; y++) {
-		uint8_t *dst = f->data + f->stride * y;
-		uint8_t *src = l->data + l->stride * y;
-
-		for (uint32_t x = 0; x < l->width * 3; x++) {
-			*dst++ = *src++;
-		}
-
-		dst = f->data + f->stride * y + l->width * 3;
-		src = r->data + r->stride * y;
-		for (uint32_t x = 0; x < r->width * 3; x++) {
-			*dst++ = *src++;
-		}
-	}
-}
-
 static void
 combine_frames(struct xrt_frame *l, struct xrt_frame *r, struct xrt_frame **out_frame)
 {
@@ -107,33 +62,8 @@ combine_frames(struct xrt_frame *l, struct xrt_frame *r, struct xrt_frame **out_
 	assert(l->format == r->format);
 	assert((l->format == XRT_FORMAT_L8) || (l->format == XRT_FORMAT_R8G8B8));
 
-	int64_t diff_ns = l->timestamp - r->timestamp;
-	uint32_t height = l->height;
-	uint32_t width = l->width + r->width;
-	enum xrt_format format = l->format;
-
-	u_frame_create_one_off(format, width, height, out_frame);
-
-	struct xrt_frame *f = *out_frame;
-	f->timestamp = l->timestamp - (diff_ns / 2); // Middle of both frames.
-	f->stereo_format = XRT_STEREO_FORMAT_SBS;
-	f->source_sequence = l->source_sequence;
-
-	switch (l->format) {
-	case XRT_FORMAT_L8: {
-		combine_frames_l8(l, r, f);
-		break;
-	}
-	case XRT_FORMAT_R8G8B8: {
-		combine_frames_r8g8b8(l, r, f);
-		break;
-	}
-	default: assert(!"Unimplemented!");
-	}
-#if 0
-	// So that we can test if this works on a really slow computer
-	os_nanosleep(0.1f * U_TIME_1S_IN_NS);
-#endif
+	// No copy here, packed by a u_sink_sbs_pack if the data is needed.
+	u_frame_create_sbs_view(l, r, out_frame);
 }
 
 static void
@@ -250,10 +180,10 @@ combiner_destroy(struct xrt_frame_node *node)
  */
 
 bool
-u_sink_combiner_create(struct xrt_frame_context *xfctx,
-                       struct xrt_frame_sink *downstream,
-                       struct xrt_frame_sink **out_left_xfs,
-                       struct xrt_frame_sink **out_right_xfs)
+u_sink_combiner_create_views(struct xrt_frame_context *xfctx,
+                             struct xrt_frame_sink *downstream,
+                             struct xrt_frame_sink **out_left_xfs,
+                             struct xrt_frame_sink **out_right_xfs)
 {
 	struct u_sink_combiner *q = U_TYPED_CALLOC(struct u_sink_combiner);
 	int ret = 0;
@@ -280,3 +210,15 @@ u_sink_combiner_create(struct xrt_frame_context *xfctx,
 
 	return true;
 }
+
+bool
+u_sink_combiner_create(struct xrt_frame_context *xfctx,
+                       struct xrt_frame_sink *downstream,
+                       struct xrt_frame_sink **out_left_xfs,
+                       struct xrt_frame_sink **out_right_xfs)
+{
+	struct xrt_frame_sink *packer = NULL;
+	u_sink_sbs_pack_create(xfctx, downstream, &packer);
+
+	return u_sink_combiner_create_views(xfctx, packer, out_left_xfs, out_right_xfs);
+}
@@ -14,6 +14,9 @@
 #include "util/u_sink.h"
 #include "util/u_frame.h"
 #include "util/u_format.h"
+#include "util/u_format_convert.h"
+#include "util/u_debug.h"
+#include "util/u_worker.h"
 #include "util/u_trace_marker.h"
 
 #include <stdio.h>
@@ -23,6 +26,14 @@
 #endif
 
 
+//! Frames smaller than this are converted on the pushing thread only.
+#define CONVERTER_THREADED_MIN_PIXELS (640 * 480)
+
+#define CONVERTER_MAX_THREADS 8
+
+DEBUG_GET_ONCE_NUM_OPTION(converter_threads, "U_SINK_CONVERTER_THREADS", 2)
+
+
 /*
  *
  * Structs
@@ -42,193 +53,151 @@ struct u_sink_converter
 	struct xrt_frame_sink *downstream;
 
 	enum xrt_format format;
+
+	//! For converting large frames in parallel, made on first use.
+	struct u_worker_thread_pool *pool;
+	struct u_worker_group *group;
 };
 
 
 /*
  *
- * L8 functions.
+ * Row conversion.
  *
  */
 
+//! One horizontal band of a frame, converted by one thread.
+struct convert_job
+{
+	u_format_convert_row_func_t func;
+
+	const uint8_t *src;
+	size_t src_stride;
+	//! Source bytes per output row, more than @ref src_stride for Bayer.
+	size_t src_row_step;
+
+	uint8_t *dst;
+	size_t dst_stride;
+
+	uint32_t width;
+	uint32_t first_row;
+	uint32_t row_count;
+};
+
 static void
-from_L8_to_R8G8B8(struct xrt_frame *dst_frame, uint32_t w, uint32_t h, size_t stride, const uint8_t *data)
+convert_job_run(void *ptr)
 {
 	SINK_TRACE_MARKER();
 
-	for (uint32_t y = 0; y < h; y++) {
-		for (uint32_t x = 0; x < w; x += 1) {
-			const uint8_t *src = data;
-			uint8_t *dst = dst_frame->data;
+	struct convert_job *job = (struct convert_job *)ptr;
 
-			src = src + (y * stride) + x;
-			dst = dst + (y * dst_frame->stride) + (x * 3);
-			dst[2] = dst[1] = dst[0] = src[0];
-		}
+	for (uint32_t y = job->first_row; y < job->first_row + job->row_count; y++) {
+		const uint8_t *src = job->src + y * job->src_row_step;
+		uint8_t *dst = job->dst + y * job->dst_stride;
+		job->func(src, job->src_stride, dst, job->width);
 	}
 }
 
-
-/*
- *
- * YUV functions.
- *
- */
-
-static inline int
-clamp_to_byte(int v)
+static uint32_t
+get_thread_count(void)
 {
-	if (v < 0) {
-		return 0;
+	int64_t count = debug_get_num_option_converter_threads();
+	if (count < 1) {
+		return 1;
 	}
-	if (v >= 255) {
-		return 255;
+	if (count > CONVERTER_MAX_THREADS) {
+		return CONVERTER_MAX_THREADS;
 	}
-	return v;
-}
-
-static inline uint32_t
-YUV444_to_RGBX8888(int y, int u, int v)
-{
-	int C = y - 16;
-	int D = u - 128;
-	int E = v - 128;
-
-	int R = clamp_to_byte((298 * C + 409 * E + 128) >> 8);
-	int G = clamp_to_byte((298 * C - 100 * D - 209 * E + 128) >> 8);
-	int B = clamp_to_byte((298 * C + 516 * D + 128) >> 8);
-
-	return B << 16 | G << 8 | R;
+	return (uint32_t)count;
 }
 
-#undef USE_TABLE
-#ifdef USE_TABLE
-static uint32_t lookup_YUV_to_RGBX[256][256][256] = {0};
-
+/*!
+ * Converts @p h rows, splitting them over the sink's worker threads if the
+ * frame is large enough for that to pay off.
+ */
 static void
-generate_lookup_YUV_to_RGBX()
-{
-	if (lookup_YUV_to_RGBX[255][255][255] != 0) {
-		return;
+convert_rows(struct u_sink_converter *s,
+             u_format_convert_row_func_t func,
+             struct xrt_frame *dst_frame,
+             uint32_t w,
+             uint32_t h,
+             size_t stride,
+             uint32_t src_rows_per_row,
+             const uint8_t *data)
+{
+	struct convert_job jobs[CONVERTER_MAX_THREADS];
+
+	uint32_t thread_count = get_thread_count();
+	if ((uint64_t)w * h < CONVERTER_THREADED_MIN_PIXELS) {
+		thread_count = 1;
 	}
 
-	int y;
-	int u;
-	int v;
+	uint32_t rows_per_job = (h + thread_count - 1) / thread_count;
+	uint32_t job_count = 0;
+	for (uint32_t first_row = 0; first_row < h; first_row += rows_per_job) {
+		jobs[job_count++] = (struct convert_job){
+		    .func = func,
+		    .src = data,
+		    .src_stride = stride,
+		    .src_row_step = stride * src_rows_per_row,
+		    .dst = dst_frame->data,
+		    .dst_stride = dst_frame->stride,
+		    .width = w,
+		    .first_row = first_row,
+		    .row_count = rows_per_job < h - first_row ? rows_per_job : h - first_row,
+		};
+	}
 
-	for (y = 0; y < 256; y++) {
-		for (u = 0; u < 256; u++) {
-			for (v = 0; v < 256; v++) {
-				lookup_YUV_to_RGBX[y][u][v] = YUV444_to_RGBX8888(y, u, v);
-			}
+	if (job_count <= 1) {
+		for (uint32_t i = 0; i < job_count; i++) {
+			convert_job_run(&jobs[i]);
 		}
+		return;
 	}
-}
-#endif
 
-XRT_MAYBE_UNUSED inline static void
-YUYV422_to_R8G8B8X8(const uint8_t *input, uint32_t *rgb1, uint32_t *rgb2)
-{
-	uint8_t y0 = input[0];
-	uint8_t u = input[1];
-	uint8_t y1 = input[2];
-	uint8_t v = input[3];
-
-#ifdef USE_TABLE
-	*rgb1 = lookup_YUV_to_RGBX[y0][u][v];
-	*rgb2 = lookup_YUV_to_RGBX[y1][u][v];
-#else
-	*rgb1 = YUV444_to_RGBX8888(y0, u, v);
-	*rgb2 = YUV444_to_RGBX8888(y1, u, v);
-#endif
-}
+	// Made on first use, most converters only ever pass frames through.
+	if (s->group == NULL) {
+		s->pool = u_worker_thread_pool_create(thread_count - 1, thread_count, "Sink Converter");
+		s->group = u_worker_group_create(s->pool);
+	}
 
-inline static void
-YUYV422_to_R8G8B8(const uint8_t *input, uint8_t *dst)
-{
-	uint8_t y0 = input[0];
-	uint8_t u = input[1];
-	uint8_t y1 = input[2];
-	uint8_t v = input[3];
-
-#ifdef USE_TABLE
-	uint8_t *rgb1 = (uint8_t *)&lookup_YUV_to_RGBX[y0][u][v];
-	uint8_t *rgb2 = (uint8_t *)&lookup_YUV_to_RGBX[y1][u][v];
-#else
-	uint32_t rgb1v = YUV444_to_RGBX8888(y0, u, v);
-	uint32_t rgb2v = YUV444_to_RGBX8888(y1, u, v);
-	uint8_t *rgb1 = (uint8_t *)&rgb1v;
-	uint8_t *rgb2 = (uint8_t *)&rgb2v;
-#endif
+	for (uint32_t i = 0; i < job_count; i++) {
+		u_worker_group_push(s->group, convert_job_run, &jobs[i]);
+	}
 
-	dst[0] = rgb1[0];
-	dst[1] = rgb1[1];
-	dst[2] = rgb1[2];
-	dst[3] = rgb2[0];
-	dst[4] = rgb2[1];
-	dst[5] = rgb2[2];
+	u_worker_group_wait_all(s->group);
 }
 
-inline static void
-UYVY422_to_R8G8B8(const uint8_t *input, uint8_t *dst)
-{
-	uint8_t u = input[0];
-	uint8_t y0 = input[1];
-	uint8_t v = input[2];
-	uint8_t y1 = input[3];
-
-#ifdef USE_TABLE
-	uint8_t *rgb1 = (uint8_t *)&lookup_YUV_to_RGBX[y0][u][v];
-	uint8_t *rgb2 = (uint8_t *)&lookup_YUV_to_RGBX[y1][u][v];
-#else
-	uint32_t rgb1v = YUV444_to_RGBX8888(y0, u, v);
-	uint32_t rgb2v = YUV444_to_RGBX8888(y1, u, v);
-	uint8_t *rgb1 = (uint8_t *)&rgb1v;
-	uint8_t *rgb2 = (uint8_t *)&rgb2v;
-#endif
 
-	dst[0] = rgb1[0];
-	dst[1] = rgb1[1];
-	dst[2] = rgb1[2];
-	dst[3] = rgb2[0];
-	dst[4] = rgb2[1];
-	dst[5] = rgb2[2];
-}
+/*
+ *
+ * L8 functions.
+ *
+ */
 
-inline static void
-YUV444_to_R8G8B8(const uint8_t *input, uint8_t *dst)
+static void
+from_L8_to_R8G8B8(
+    struct u_sink_converter *s, struct xrt_frame *dst_frame, uint32_t w, uint32_t h, size_t stride, const uint8_t *data)
 {
-	uint8_t y = input[0];
-	uint8_t u = input[1];
-	uint8_t v = input[2];
-
-#ifdef USE_TABLE
-	uint8_t *rgb = (uint8_t *)&lookup_YUV_to_RGBX[y][u][v];
-#else
-	uint32_t rgbv = YUV444_to_RGBX8888(y, u, v);
-	uint8_t *rgb = (uint8_t *)&rgbv;
-#endif
+	SINK_TRACE_MARKER();
 
-	dst[0] = rgb[0];
-	dst[1] = rgb[1];
-	dst[2] = rgb[2];
+	convert_rows(s, u_format_convert_best_kernels()->L8_to_R8G8B8, dst_frame, w, h, stride, 1, data);
 }
 
+
+/*
+ *
+ * YUV functions.
+ *
+ */
+
 static void
-from_YUYV422_to_R8G8B8(struct xrt_frame *dst_frame, uint32_t w, uint32_t h, size_t stride, const uint8_t *data)
+from_YUYV422_to_R8G8B8(
+    struct u_sink_converter *s, struct xrt_frame *dst_frame, uint32_t w, uint32_t h, size_t stride, const uint8_t *data)
 {
 	SINK_TRACE_MARKER();
 
-	for (uint32_t y = 0; y < h; y++) {
-		for (uint32_t x = 0; x < w; x += 2) {
-			const uint8_t *src = data;
-			uint8_t *dst = dst_frame->data;
-
-			src = src + (y * stride) + (x * 2);
-			dst = dst + (y * dst_frame->stride) + (x * 3);
-			YUYV422_to_R8G8B8(src, dst);
-		}
-	}
+	convert_rows(s, u_format_convert_best_kernels()->YUYV422_to_R8G8B8, dst_frame, w, h, stride, 1, data);
 }
 
 static void
@@ -247,38 +216,21 @@ from_YUYV422_to_L8(struct xrt_frame *dst_frame, uint32_t w, uint32_t h, size_t s
 }
 
 static void
-from_UYVY422_to_R8G8B8(struct xrt_frame *dst_frame, uint32_t w, uint32_t h, size_t stride, const uint8_t *data)
+from_UYVY422_to_R8G8B8(
+    struct u_sink_converter *s, struct xrt_frame *dst_frame, uint32_t w, uint32_t h, size_t stride, const uint8_t *data)
 {
 	SINK_TRACE_MARKER();
 
-	for (uint32_t y = 0; y < h; y++) {
-		for (uint32_t x = 0; x < w; x += 2) {
-			const uint8_t *src = data;
-			uint8_t *dst = dst_frame->data;
-
-			src = src + (y * stride) + (x * 2);
-			dst = dst + (y * dst_frame->stride) + (x * 3);
-			UYVY422_to_R8G8B8(src, dst);
-		}
-	}
+	convert_rows(s, u_format_convert_best_kernels()->UYVY422_to_R8G8B8, dst_frame, w, h, stride, 1, data);
 }
 
-
 static void
-from_YUV888_to_R8G8B8(struct xrt_frame *dst_frame, uint32_t w, uint32_t h, size_t stride, const uint8_t *data)
+from_YUV888_to_R8G8B8(
+    struct u_sink_converter *s, struct xrt_frame *dst_frame, uint32_t w, uint32_t h, size_t stride, const uint8_t *data)
 {
 	SINK_TRACE_MARKER();
 
-	for (uint32_t y = 0; y < h; y++) {
-		for (uint32_t x = 0; x < w; x++) {
-			const uint8_t *src = data;
-			uint8_t *dst = dst_frame->data;
-
-			src = src + (y * stride) + (x * 3);
-			dst = dst + (y * dst_frame->stride) + (x * 3);
-			YUV444_to_R8G8B8(src, dst);
-		}
-	}
+	convert_rows(s, u_format_convert_best_kernels()->YUV888_to_R8G8B8, dst_frame, w, h, stride, 1, data);
 }
 
 
@@ -397,37 +349,16 @@ from_MJPEG_to_YUV888(struct xrt_frame *dst_frame, size_t size, const uint8_t *da
  *
  */
 
+/*!
+ * Outputs half the resolution, every 2x2 block becomes one pixel.
+ */
 static void
-from_BAYER_GR8_to_R8G8B8(struct xrt_frame *dst_frame, uint32_t w, uint32_t h, size_t stride, const uint8_t *data)
+from_BAYER_GR8_to_R8G8B8(
+    struct u_sink_converter *s, struct xrt_frame *dst_frame, uint32_t w, uint32_t h, size_t stride, const uint8_t *data)
 {
 	SINK_TRACE_MARKER();
 
-	const uint8_t *src_data = data;
-	size_t src_stride = stride;
-
-	uint8_t *dst_data = dst_frame->data;
-	size_t dst_stride = dst_frame->stride;
-
-	for (uint32_t y = 0; y < h; y++) {
-		const uint8_t *src0 = src_data + (y * 2) * src_stride;
-		const uint8_t *src1 = src_data + (y * 2 + 1) * src_stride;
-		uint8_t *dst = dst_data + (y * dst_stride);
-
-		for (uint32_t x = 0; x < w; x++) {
-			uint8_t g0 = src0[0];
-			uint8_t r = src0[1];
-			uint8_t b = src1[0];
-			uint8_t g1 = src1[1];
-
-			dst[0] = r;
-			dst[1] = (g0 + g1) / 2;
-			dst[2] = b;
-
-			src0 += 2;
-			src1 += 2;
-			dst += 3;
-		}
-	}
+	convert_rows(s, u_format_convert_best_kernels()->BAYER_GR8_to_R8G8B8, dst_frame, w, h, stride, 2, data);
 }
 
 
@@ -440,8 +371,7 @@ from_BAYER_GR8_to_R8G8B8(struct xrt_frame *dst_frame, uint32_t w, uint32_t h, si
 
 /*!
  * Creates a frame that the conversion should happen to, allows to set the size.
- *
- * @todo Allocate from a pool of frames.
+ * Comes from the @ref u_frame_create_one_off pool.
  */
 static bool
 create_frame_with_format_of_size(
@@ -519,25 +449,25 @@ convert_frame_r8g8b8_or_l8(struct xrt_frame_sink *xs, struct xrt_frame *xf)
 		if (!create_frame_with_format_of_size(xf, w, h, XRT_FORMAT_R8G8B8, &converted)) {
 			return;
 		}
-		from_BAYER_GR8_to_R8G8B8(converted, w, h, xf->stride, xf->data);
+		from_BAYER_GR8_to_R8G8B8(s, converted, w, h, xf->stride, xf->data);
 		break;
 	case XRT_FORMAT_YUYV422:
 		if (!create_frame_with_format(xf, XRT_FORMAT_R8G8B8, &converted)) {
 			return;
 		}
-		from_YUYV422_to_R8G8B8(converted, xf->width, xf->height, xf->stride, xf->data);
+		from_YUYV422_to_R8G8B8(s, converted, xf->width, xf->height, xf->stride, xf->data);
 		break;
 	case XRT_FORMAT_UYVY422:
 		if (!create_frame_with_format(xf, XRT_FORMAT_R8G8B8, &converted)) {
 			return;
 		}
-		from_UYVY422_to_R8G8B8(converted, xf->width, xf->height, xf->stride, xf->data);
+		from_UYVY422_to_R8G8B8(s, converted, xf->width, xf->height, xf->stride, xf->data);
 		break;
 	case XRT_FORMAT_YUV888:
 		if (!create_frame_with_format(xf, XRT_FORMAT_R8G8B8, &converted)) {
 			return;
 		}
-		from_YUV888_to_R8G8B8(converted, xf->width, xf->height, xf->stride, xf->data);
+		from_YUV888_to_R8G8B8(s, converted, xf->width, xf->height, xf->stride, xf->data);
 		break;
 #ifdef XRT_HAVE_JPEG
 	case XRT_FORMAT_MJPEG:
@@ -593,19 +523,19 @@ convert_frame_r8g8b8_bayer_or_l8(struct xrt_frame_sink *xs, struct xrt_frame *xf
 		if (!create_frame_with_format(xf, XRT_FORMAT_R8G8B8, &converted)) {
 			return;
 		}
-		from_YUYV422_to_R8G8B8(converted, xf->width, xf->height, xf->stride, xf->data);
+		from_YUYV422_to_R8G8B8(s, converted, xf->width, xf->height, xf->stride, xf->data);
 		break;
 	case XRT_FORMAT_UYVY422:
 		if (!create_frame_with_format(xf, XRT_FORMAT_R8G8B8, &converted)) {
 			return;
 		}
-		from_UYVY422_to_R8G8B8(converted, xf->width, xf->height, xf->stride, xf->data);
+		from_UYVY422_to_R8G8B8(s, converted, xf->width, xf->height, xf->stride, xf->data);
 		break;
 	case XRT_FORMAT_YUV888:
 		if (!create_frame_with_format(xf, XRT_FORMAT_R8G8B8, &converted)) {
 			return;
 		}
-		from_YUV888_to_R8G8B8(converted, xf->width, xf->height, xf->stride, xf->data);
+		from_YUV888_to_R8G8B8(s, converted, xf->width, xf->height, xf->stride, xf->data);
 		break;
 #ifdef XRT_HAVE_JPEG
 	case XRT_FORMAT_MJPEG:
@@ -643,7 +573,7 @@ convert_frame_r8g8b8(struct xrt_frame_sink *xs, struct xrt_frame *xf)
 		if (!create_frame_with_format(xf, XRT_FORMAT_R8G8B8, &converted)) {
 			return;
 		}
-		from_L8_to_R8G8B8(converted, xf->width, xf->height, xf->stride, xf->data);
+		from_L8_to_R8G8B8(s, converted, xf->width, xf->height, xf->stride, xf->data);
 		break;
 	case XRT_FORMAT_BAYER_GR8:;
 		uint32_t w = xf->width / 2;
@@ -651,25 +581,25 @@ convert_frame_r8g8b8(struct xrt_frame_sink *xs, struct xrt_frame *xf)
 		if (!create_frame_with_format_of_size(xf, w, h, XRT_FORMAT_R8G8B8, &converted)) {
 			return;
 		}
-		from_BAYER_GR8_to_R8G8B8(converted, w, h, xf->stride, xf->data);
+		from_BAYER_GR8_to_R8G8B8(s, converted, w, h, xf->stride, xf->data);
 		break;
 	case XRT_FORMAT_YUYV422:
 		if (!create_frame_with_format(xf, XRT_FORMAT_R8G8B8, &converted)) {
 			return;
 		}
-		from_YUYV422_to_R8G8B8(converted, xf->width, xf->height, xf->stride, xf->data);
+		from_YUYV422_to_R8G8B8(s, converted, xf->width, xf->height, xf->stride, xf->data);
 		break;
 	case XRT_FORMAT_UYVY422:
 		if (!create_frame_with_format(xf, XRT_FORMAT_R8G8B8, &converted)) {
 			return;
 		}
-		from_UYVY422_to_R8G8B8(converted, xf->width, xf->height, xf->stride, xf->data);
+		from_UYVY422_to_R8G8B8(s, converted, xf->width, xf->height, xf->stride, xf->data);
 		break;
 	case XRT_FORMAT_YUV888:
 		if (!create_frame_with_format(xf, XRT_FORMAT_R8G8B8, &converted)) {
 			return;
 		}
-		from_YUV888_to_R8G8B8(converted, xf->width, xf->height, xf->stride, xf->data);
+		from_YUV888_to_R8G8B8(s, converted, xf->width, xf->height, xf->stride, xf->data);
 		break;
 #ifdef XRT_HAVE_JPEG
 	case XRT_FORMAT_MJPEG:
@@ -812,7 +742,7 @@ convert_frame_bayer(struct xrt_frame_sink *xs, struct xrt_frame *xf)
 		return;
 	}
 
-	from_BAYER_GR8_to_R8G8B8(converted, w, h, xf->stride, xf->data);
+	from_BAYER_GR8_to_R8G8B8(s, converted, w, h, xf->stride, xf->data);
 
 	s->downstream->push_frame(s->downstream, converted);
 
@@ -829,6 +759,9 @@ destroy(struct xrt_frame_node *node)
 {
 	struct u_sink_converter *s = container_of(node, struct u_sink_converter, node);
 
+	u_worker_group_reference(&s->group, NULL);
+	u_worker_thread_pool_reference(&s->pool, NULL);
+
 	free(s);
 }
 
@@ -855,10 +788,6 @@ u_sink_create_format_converter(struct xrt_frame_context *xfctx,
 	default: U_LOG_E("Format '%s' not supported", u_format_str(format)); return;
 	}
 
-#ifdef USE_TABLE
-	generate_lookup_YUV_to_RGBX();
-#endif
-
 	struct u_sink_converter *s = U_TYPED_CALLOC(struct u_sink_converter);
 	s->base.push_frame = func;
 	s->node.break_apart = break_apart;
@@ -883,10 +812,6 @@ u_sink_create_to_r8g8b8_or_l8(struct xrt_frame_context *xfctx,
 	s->node.destroy = destroy;
 	s->downstream = downstream;
 
-#ifdef USE_TABLE
-	generate_lookup_YUV_to_RGBX();
-#endif
-
 	xrt_frame_context_add(xfctx, &s->node);
 
 	*out_xfs = &s->base;
@@ -905,10 +830,6 @@ u_sink_create_to_r8g8b8_r8g8b8a8_r8g8b8x8_or_l8(struct xrt_frame_context *xfctx,
 	s->node.destroy = destroy;
 	s->downstream = downstream;
 
-#ifdef USE_TABLE
-	generate_lookup_YUV_to_RGBX();
-#endif
-
 	xrt_frame_context_add(xfctx, &s->node);
 
 	*out_xfs = &s->base;
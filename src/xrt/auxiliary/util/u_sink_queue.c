@@ -14,17 +14,17 @@
 #include <stdio.h>
 #include <pthread.h>
 
-struct u_sink_queue_elem
-{
-	struct xrt_frame *frame;
-	struct u_sink_queue_elem *next;
-};
+//! Starting capacity of the ring of an unbounded queue, grows as needed.
+#define UNBOUNDED_INITIAL_CAPACITY (8)
 
 /*!
  * An @ref xrt_frame_sink queue, any frames received will be pushed to the
  * downstream consumer on the queue thread. Will drop frames should multiple
  * frames be queued up.
  *
+ * The frames are kept in a ring of frame pointers allocated up front, so no
+ * allocations are made per frame.
+ *
  * @implements xrt_frame_sink
  * @implements xrt_frame_node
  */
@@ -38,11 +38,14 @@ struct u_sink_queue
 	//! The consumer of the frames that are queued.
 	struct xrt_frame_sink *consumer;
 
-	//! Front of the queue (oldest frame, first to be consumed)
-	struct u_sink_queue_elem *front;
+	//! Ring of queued frames, holds a reference to each.
+	struct xrt_frame **slots;
+
+	//! Number of elements in @ref slots.
+	uint64_t capacity;
 
-	//! Back of the queue (newest frame, back->next is always null)
-	struct u_sink_queue_elem *back;
+	//! Index of the front of the queue (oldest frame, first to be consumed).
+	uint64_t front;
 
 	//! Number of currently enqueued frames
 	uint64_t size;
@@ -75,21 +78,34 @@ queue_is_full(struct u_sink_queue *q)
 	return q->size >= q->max_size && !is_unbounded;
 }
 
+//! Doubles the ring of an unbounded queue, keeping the order of the frames.
+//! Call with q->mutex locked.
+static void
+queue_grow(struct u_sink_queue *q)
+{
+	uint64_t new_capacity = q->capacity * 2;
+	struct xrt_frame **slots = U_TYPED_ARRAY_CALLOC(struct xrt_frame *, new_capacity);
+
+	for (uint64_t i = 0; i < q->size; i++) {
+		slots[i] = q->slots[(q->front + i) % q->capacity];
+	}
+
+	free(q->slots);
+	q->slots = slots;
+	q->capacity = new_capacity;
+	q->front = 0;
+}
+
 //! Pops the oldest frame, reference counting unchanged.
 //! Call with q->mutex locked.
 static struct xrt_frame *
 queue_pop(struct u_sink_queue *q)
 {
 	assert(!queue_is_empty(q));
-	struct xrt_frame *frame = q->front->frame;
-	struct u_sink_queue_elem *old_front = q->front;
-	q->front = q->front->next;
-	free(old_front);
+	struct xrt_frame *frame = q->slots[q->front];
+	q->slots[q->front] = NULL;
+	q->front = (q->front + 1) % q->capacity;
 	q->size--;
-	if (q->front == NULL) {
-		assert(queue_is_empty(q));
-		q->back = NULL;
-	}
 	return frame;
 }
 
@@ -101,15 +117,12 @@ queue_try_refpush(struct u_sink_queue *q, struct xrt_frame *xf)
 	if (queue_is_full(q)) {
 		return false;
 	}
-	struct u_sink_queue_elem *elem = U_TYPED_CALLOC(struct u_sink_queue_elem);
-	xrt_frame_reference(&elem->frame, xf);
-	elem->next = NULL;
-	if (q->back == NULL) { // First frame
-		q->front = elem;
-	} else { // Next frame
-		q->back->next = elem;
+	if (q->size == q->capacity) {
+		// Only unbounded queues can get here.
+		queue_grow(q);
 	}
-	q->back = elem;
+	uint64_t back = (q->front + q->size) % q->capacity;
+	xrt_frame_reference(&q->slots[back], xf);
 	q->size++;
 	return true;
 }
@@ -120,7 +133,6 @@ static void
 queue_refclear(struct u_sink_queue *q)
 {
 	while (!queue_is_empty(q)) {
-		assert((q->size > 1) ^ (q->front == q->back));
 		struct xrt_frame *xf = queue_pop(q);
 		xrt_frame_reference(&xf, NULL);
 	}
@@ -240,6 +252,7 @@ queue_destroy(struct xrt_frame_node *node)
 	// Destroy resources.
 	pthread_mutex_destroy(&q->mutex);
 	pthread_cond_destroy(&q->cond);
+	free(q->slots);
 	free(q);
 }
 
@@ -268,8 +281,12 @@ u_sink_queue_create(struct xrt_frame_context *xfctx,
 	q->size = 0;
 	q->max_size = max_size;
 
+	q->capacity = max_size != 0 ? max_size : UNBOUNDED_INITIAL_CAPACITY;
+	q->slots = U_TYPED_ARRAY_CALLOC(struct xrt_frame *, q->capacity);
+
 	ret = pthread_mutex_init(&q->mutex, NULL);
 	if (ret != 0) {
+		free(q->slots);
 		free(q);
 		return false;
 	}
@@ -277,6 +294,7 @@ u_sink_queue_create(struct xrt_frame_context *xfctx,
 	ret = pthread_cond_init(&q->cond, NULL);
 	if (ret) {
 		pthread_mutex_destroy(&q->mutex);
+		free(q->slots);
 		free(q);
 		return false;
 	}
@@ -285,6 +303,7 @@ u_sink_queue_create(struct xrt_frame_context *xfctx,
 	if (ret != 0) {
 		pthread_cond_destroy(&q->cond);
 		pthread_mutex_destroy(&q->mutex);
+		free(q->slots);
 		free(q);
 		return false;
 	}
@@ -0,0 +1,82 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  An @ref xrt_frame_sink that packs side-by-side views.
+ * @ingroup aux_util
+ */
+
+#include "util/u_misc.h"
+#include "util/u_sink.h"
+#include "util/u_frame.h"
+#include "util/u_trace_marker.h"
+
+
+/*!
+ * An @ref xrt_frame_sink that makes sure frames have their data, for
+ * consumers that don't understand @ref u_frame_create_sbs_view frames. Goes
+ * in front of any fan-out, so a view is packed once per frame.
+ *
+ * @implements xrt_frame_sink
+ * @implements xrt_frame_node
+ */
+struct u_sink_sbs_pack
+{
+	struct xrt_frame_sink base;
+	struct xrt_frame_node node;
+
+	struct xrt_frame_sink *downstream;
+};
+
+static void
+pack_frame(struct xrt_frame_sink *xfs, struct xrt_frame *xf)
+{
+	SINK_TRACE_MARKER();
+
+	struct u_sink_sbs_pack *s = (struct u_sink_sbs_pack *)xfs;
+
+	struct xrt_frame *packed = NULL;
+	u_frame_pack_sbs_view(xf, &packed);
+
+	xrt_sink_push_frame(s->downstream, packed);
+
+	xrt_frame_reference(&packed, NULL);
+}
+
+static void
+pack_break_apart(struct xrt_frame_node *node)
+{
+	// Noop
+}
+
+static void
+pack_destroy(struct xrt_frame_node *node)
+{
+	struct u_sink_sbs_pack *s = container_of(node, struct u_sink_sbs_pack, node);
+
+	free(s);
+}
+
+
+/*
+ *
+ * Exported functions.
+ *
+ */
+
+void
+u_sink_sbs_pack_create(struct xrt_frame_context *xfctx,
+                       struct xrt_frame_sink *downstream,
+                       struct xrt_frame_sink **out_xfs)
+{
+	struct u_sink_sbs_pack *s = U_TYPED_CALLOC(struct u_sink_sbs_pack);
+
+	s->base.push_frame = pack_frame;
+	s->node.break_apart = pack_break_apart;
+	s->node.destroy = pack_destroy;
+	s->downstream = downstream;
+
+	xrt_frame_context_add(xfctx, &s->node);
+
+	*out_xfs = &s->base;
+}
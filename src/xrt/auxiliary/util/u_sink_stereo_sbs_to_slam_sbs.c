@@ -36,6 +36,19 @@ split_frame(struct xrt_frame_sink *xfs, struct xrt_frame *xf)
 
 	struct u_sink_stereo_sbs_to_slam_sbs *s = (struct u_sink_stereo_sbs_to_slam_sbs *)xfs;
 
+	struct xrt_frame *xf_left = NULL;
+	struct xrt_frame *xf_right = NULL;
+
+	// Made by a combiner, hand out the original data with the combined timestamp.
+	if (u_frame_sbs_view_get_eyes(xf, &xf_left, &xf_right)) {
+		xrt_sink_push_frame(s->downstream_left, xf_left);
+		xrt_sink_push_frame(s->downstream_right, xf_right);
+
+		xrt_frame_reference(&xf_left, NULL);
+		xrt_frame_reference(&xf_right, NULL);
+		return;
+	}
+
 	assert(xf->width % 2 == 0);
 
 	int one_frame_width = xf->width / 2;
@@ -52,8 +65,6 @@ split_frame(struct xrt_frame_sink *xfs, struct xrt_frame *xf)
 	right.offset.w = one_frame_width;
 	right.extent.h = xf->height;
 	right.extent.w = one_frame_width;
-	struct xrt_frame *xf_left = NULL;
-	struct xrt_frame *xf_right = NULL;
 	u_frame_create_roi(xf, left, &xf_left);
 	u_frame_create_roi(xf, right, &xf_right);
 
@@ -18,12 +18,14 @@
 #include "math/m_space.h"
 
 #include "util/u_misc.h"
+#include "util/u_time.h"
 #include "util/u_hashmap.h"
 #include "util/u_logging.h"
 #include "util/u_space_overseer.h"
 
 #include <assert.h>
 #include <math.h>
+#include <string.h>
 #include <pthread.h>
 
 
@@ -76,6 +78,48 @@ struct u_space
 	};
 };
 
+/*!
+ * Number of device poses that can be held in one snapshot.
+ */
+#define U_SPACE_SNAPSHOT_MAX_ENTRIES (32)
+
+/*!
+ * Number of snapshots (timestamps) kept at the same time, the app, the
+ * compositor and other sessions might query at different timestamps.
+ */
+#define U_SPACE_SNAPSHOT_COUNT (4)
+
+/*!
+ * Default for how long a snapshot is valid for, this keeps queries for the
+ * same timestamp within one frame consistent and cheap, while later queries
+ * for that same timestamp will get a fresh prediction from the device.
+ *
+ * @see u_space_overseer_set_snapshot_max_age
+ */
+#define U_SPACE_SNAPSHOT_MAX_AGE_NS (2 * U_TIME_1MS_IN_NS)
+
+/*!
+ * Device poses resolved for a single timestamp, so that a device that is in
+ * the chain of multiple spaces is only asked once per timestamp.
+ */
+struct u_space_snapshot
+{
+	//! The timestamp the poses were resolved at, zero if unused.
+	uint64_t at_timestamp_ns;
+
+	//! When this snapshot was started, used for aging out.
+	uint64_t created_ns;
+
+	uint32_t entry_count;
+
+	struct
+	{
+		struct xrt_device *xdev;
+		enum xrt_input_name name;
+		struct xrt_space_relation relation;
+	} entries[U_SPACE_SNAPSHOT_MAX_ENTRIES];
+};
+
 /*!
  * Default implementation of the xrt_space_overseer object.
  */
@@ -113,6 +157,15 @@ struct u_space_overseer
 	 * spaces and that they share the same parent.
 	 */
 	bool can_do_local_spaces_recenter;
+
+	//! Protects the snapshots, separate from the graph lock.
+	pthread_mutex_t snapshot_lock;
+
+	//! Cached device poses, see @ref u_space_snapshot.
+	struct u_space_snapshot snapshots[U_SPACE_SNAPSHOT_COUNT];
+
+	//! How long a snapshot is valid for, protected by the snapshot lock.
+	uint64_t snapshot_max_age_ns;
 };
 
 
@@ -299,6 +352,104 @@ notify_ref_space_usage_device(struct u_space_overseer *uso, enum xrt_reference_s
 }
 
 
+/*
+ *
+ * Pose snapshot functions.
+ *
+ */
+
+static inline bool
+snapshot_is_valid(const struct u_space_snapshot *snap, uint64_t at_timestamp_ns, uint64_t now_ns, uint64_t max_age_ns)
+{
+	return snap->at_timestamp_ns == at_timestamp_ns && now_ns - snap->created_ns <= max_age_ns;
+}
+
+/*!
+ * Returns the snapshot for the given timestamp, creating it by recycling the
+ * oldest one if needed.
+ */
+static struct u_space_snapshot *
+snapshot_get_or_create_locked(struct u_space_overseer *uso, uint64_t at_timestamp_ns, uint64_t now_ns)
+{
+	struct u_space_snapshot *oldest = &uso->snapshots[0];
+
+	for (uint32_t i = 0; i < U_SPACE_SNAPSHOT_COUNT; i++) {
+		struct u_space_snapshot *snap = &uso->snapshots[i];
+		if (snapshot_is_valid(snap, at_timestamp_ns, now_ns, uso->snapshot_max_age_ns)) {
+			return snap;
+		}
+		if (snap->created_ns < oldest->created_ns) {
+			oldest = snap;
+		}
+	}
+
+	oldest->at_timestamp_ns = at_timestamp_ns;
+	oldest->created_ns = now_ns;
+	oldest->entry_count = 0;
+
+	return oldest;
+}
+
+static bool
+snapshot_find_locked(struct u_space_snapshot *snap,
+                     struct xrt_device *xdev,
+                     enum xrt_input_name name,
+                     struct xrt_space_relation *out_relation)
+{
+	for (uint32_t i = 0; i < snap->entry_count; i++) {
+		if (snap->entries[i].xdev == xdev && snap->entries[i].name == name) {
+			*out_relation = snap->entries[i].relation;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*!
+ * Gets the tracked pose of the device, each device input is only asked once
+ * per timestamp for a short while, see @ref u_space_overseer_set_snapshot_max_age.
+ */
+static void
+get_tracked_pose_snapshot(struct u_space_overseer *uso,
+                          struct xrt_device *xdev,
+                          enum xrt_input_name name,
+                          uint64_t at_timestamp_ns,
+                          struct xrt_space_relation *out_relation)
+{
+	uint64_t now_ns = os_monotonic_get_ns();
+	struct u_space_snapshot *snap;
+	bool found;
+
+	pthread_mutex_lock(&uso->snapshot_lock);
+	snap = snapshot_get_or_create_locked(uso, at_timestamp_ns, now_ns);
+	found = snapshot_find_locked(snap, xdev, name, out_relation);
+	pthread_mutex_unlock(&uso->snapshot_lock);
+
+	if (found) {
+		return;
+	}
+
+	// Don't hold the lock while calling into the driver.
+	xrt_device_get_tracked_pose(xdev, name, at_timestamp_ns, out_relation);
+
+	pthread_mutex_lock(&uso->snapshot_lock);
+
+	// The snapshot might have been recycled while unlocked, get it again.
+	snap = snapshot_get_or_create_locked(uso, at_timestamp_ns, now_ns);
+
+	struct xrt_space_relation dummy;
+	if (!snapshot_find_locked(snap, xdev, name, &dummy) && snap->entry_count < U_SPACE_SNAPSHOT_MAX_ENTRIES) {
+		uint32_t index = snap->entry_count++;
+		snap->entries[index].xdev = xdev;
+		snap->entries[index].name = name;
+		snap->entries[index].relation = *out_relation;
+	}
+
+	pthread_mutex_unlock(&uso->snapshot_lock);
+}
+
+
 /*
  *
  * Graph traversing functions.
@@ -312,7 +463,10 @@ notify_ref_space_usage_device(struct u_space_overseer *uso, enum xrt_reference_s
  * order.
  */
 static void
-push_then_traverse(struct xrt_relation_chain *xrc, struct u_space *space, uint64_t at_timestamp_ns)
+push_then_traverse(struct u_space_overseer *uso,
+                   struct xrt_relation_chain *xrc,
+                   struct u_space *space,
+                   uint64_t at_timestamp_ns)
 {
 	switch (space->type) {
 	case U_SPACE_TYPE_NULL: break; // No-op
@@ -321,7 +475,7 @@ push_then_traverse(struct xrt_relation_chain *xrc, struct u_space *space, uint64
 		assert(space->pose.xname != 0);
 
 		struct xrt_space_relation xsr;
-		xrt_device_get_tracked_pose(space->pose.xdev, space->pose.xname, at_timestamp_ns, &xsr);
+		get_tracked_pose_snapshot(uso, space->pose.xdev, space->pose.xname, at_timestamp_ns, &xsr);
 		m_relation_chain_push_relation(xrc, &xsr);
 	} break;
 	case U_SPACE_TYPE_OFFSET: m_relation_chain_push_pose_if_not_identity(xrc, &space->offset.pose); break;
@@ -330,7 +484,7 @@ push_then_traverse(struct xrt_relation_chain *xrc, struct u_space *space, uint64
 
 	// Please tail-call optimise this miss compiler.
 	assert(space->next != NULL);
-	push_then_traverse(xrc, space->next, at_timestamp_ns);
+	push_then_traverse(uso, xrc, space->next, at_timestamp_ns);
 }
 
 /*!
@@ -340,7 +494,10 @@ push_then_traverse(struct xrt_relation_chain *xrc, struct u_space *space, uint64
  * the reversed order.
  */
 static void
-traverse_then_push_inverse(struct xrt_relation_chain *xrc, struct u_space *space, uint64_t at_timestamp_ns)
+traverse_then_push_inverse(struct u_space_overseer *uso,
+                           struct xrt_relation_chain *xrc,
+                           struct u_space *space,
+                           uint64_t at_timestamp_ns)
 {
 	// Done traversing.
 	switch (space->type) {
@@ -352,7 +509,7 @@ traverse_then_push_inverse(struct xrt_relation_chain *xrc, struct u_space *space
 
 	// Can't tail-call optimise this one :(
 	assert(space->next != NULL);
-	traverse_then_push_inverse(xrc, space->next, at_timestamp_ns);
+	traverse_then_push_inverse(uso, xrc, space->next, at_timestamp_ns);
 
 	switch (space->type) {
 	case U_SPACE_TYPE_NULL: break; // No-op
@@ -361,7 +518,7 @@ traverse_then_push_inverse(struct xrt_relation_chain *xrc, struct u_space *space
 		assert(space->pose.xname != 0);
 
 		struct xrt_space_relation xsr;
-		xrt_device_get_tracked_pose(space->pose.xdev, space->pose.xname, at_timestamp_ns, &xsr);
+		get_tracked_pose_snapshot(uso, space->pose.xdev, space->pose.xname, at_timestamp_ns, &xsr);
 		m_relation_chain_push_inverted_relation(xrc, &xsr);
 	} break;
 	case U_SPACE_TYPE_OFFSET: m_relation_chain_push_inverted_pose_if_not_identity(xrc, &space->offset.pose); break;
@@ -380,8 +537,8 @@ build_relation_chain_read_locked(struct u_space_overseer *uso,
 	assert(base != NULL);
 	assert(target != NULL);
 
-	push_then_traverse(xrc, target, at_timestamp_ns);
-	traverse_then_push_inverse(xrc, base, at_timestamp_ns);
+	push_then_traverse(uso, xrc, target, at_timestamp_ns);
+	traverse_then_push_inverse(uso, xrc, base, at_timestamp_ns);
 }
 
 static void
@@ -572,14 +729,47 @@ pose_approx(const struct xrt_pose *a, const struct xrt_pose *b)
 	       fabsf(a->position.z - b->position.z) < e;
 }
 
+/*!
+ * Slots of the on stack table used by @ref locate_spaces to find spaces
+ * already located, the table is kept at most half full so this covers 64
+ * spaces, more than that falls back to a heap allocated table.
+ */
+#define SAME_SPACE_STACK_SLOTS (128)
+
+static uint32_t
+same_space_slot(const struct xrt_space *xs, uint32_t mask)
+{
+	// Fibonacci hashing, the low bits of pointers are always zero.
+	uint64_t v = (uint64_t)(uintptr_t)xs * 0x9E3779B97F4A7C15ull;
+	return (uint32_t)(v >> 32) & mask;
+}
+
+/*!
+ * Returns the index of an earlier space with the same pointer and offset,
+ * otherwise adds @p space_index to the table and returns -1. The table is
+ * open addressed with linear probing and @p mask + 1 slots set to -1 when
+ * empty, so each lookup is expected constant time instead of going over
+ * all earlier spaces.
+ */
 static int32_t
-find_same_space_before(struct xrt_space **spaces, const struct xrt_pose *offsets, uint32_t space_index)
+find_or_add_same_space(int32_t *slots,
+                       uint32_t mask,
+                       struct xrt_space **spaces,
+                       const struct xrt_pose *offsets,
+                       uint32_t space_index)
 {
-	for (int32_t i = 0; i < (int32_t)space_index; i++) {
+	uint32_t slot = same_space_slot(spaces[space_index], mask);
+
+	while (slots[slot] >= 0) {
+		int32_t i = slots[slot];
 		if (spaces[i] == spaces[space_index] && pose_approx(&offsets[i], &offsets[space_index])) {
 			return i;
 		}
+		slot = (slot + 1) & mask;
 	}
+
+	slots[slot] = (int32_t)space_index;
+
 	return -1;
 }
 
@@ -597,16 +787,32 @@ locate_spaces(struct xrt_space_overseer *xso,
 
 	struct u_space *ubase_space = u_space(base_space);
 
+	// Power of two at least twice the space count, so there are always empty slots.
+	uint32_t slot_count = SAME_SPACE_STACK_SLOTS;
+	while (slot_count < space_count * 2) {
+		slot_count *= 2;
+	}
+
+	int32_t stack_slots[SAME_SPACE_STACK_SLOTS];
+	int32_t *slots = stack_slots;
+	if (slot_count > SAME_SPACE_STACK_SLOTS) {
+		slots = U_TYPED_ARRAY_CALLOC(int32_t, slot_count);
+	}
+	if (slots != NULL) {
+		// All bits set is -1, marks the slot as empty.
+		memset(slots, 0xff, sizeof(int32_t) * slot_count);
+	}
+
 	for (uint32_t i = 0; i < space_count; i++) {
 		// spaces are allowed to be NULL
 		if (spaces[i] == NULL) {
-			out_relations->relation_flags = XRT_SPACE_RELATION_BITMASK_NONE;
+			out_relations[i].relation_flags = XRT_SPACE_RELATION_BITMASK_NONE;
 			continue;
 		}
 
 		// crude optimization: If space ptr is equal to one already located, don't locate again, just copy
-		{
-			int32_t found = find_same_space_before(spaces, offsets, i);
+		if (slots != NULL) {
+			int32_t found = find_or_add_same_space(slots, slot_count - 1, spaces, offsets, i);
 			if (found >= 0) {
 				out_relations[i] = out_relations[found];
 				continue;
@@ -630,6 +836,10 @@ locate_spaces(struct xrt_space_overseer *xso,
 		special_resolve(&xrc, &out_relations[i]);
 	}
 
+	if (slots != stack_slots) {
+		free(slots);
+	}
+
 	return XRT_SUCCESS;
 }
 
@@ -1020,6 +1230,7 @@ destroy(struct xrt_space_overseer *xso)
 		xrt_space_reference(xslocal_ptr, NULL);
 	}
 
+	pthread_mutex_destroy(&uso->snapshot_lock);
 	pthread_rwlock_destroy(&uso->lock);
 
 	free(uso);
@@ -1057,6 +1268,10 @@ u_space_overseer_create(struct xrt_session_event_sink *broadcast)
 	ret = pthread_rwlock_init(&uso->lock, NULL);
 	assert(ret == 0);
 
+	ret = pthread_mutex_init(&uso->snapshot_lock, NULL);
+	assert(ret == 0);
+	uso->snapshot_max_age_ns = U_SPACE_SNAPSHOT_MAX_AGE_NS;
+
 	ret = u_hashmap_int_create(&uso->xdev_map);
 	assert(ret == 0);
 
@@ -1068,6 +1283,14 @@ u_space_overseer_create(struct xrt_session_event_sink *broadcast)
 	return uso;
 }
 
+void
+u_space_overseer_set_snapshot_max_age(struct u_space_overseer *uso, uint64_t max_age_ns)
+{
+	pthread_mutex_lock(&uso->snapshot_lock);
+	uso->snapshot_max_age_ns = max_age_ns;
+	pthread_mutex_unlock(&uso->snapshot_lock);
+}
+
 void
 u_space_overseer_legacy_setup(struct u_space_overseer *uso,
                               struct xrt_device **xdevs,
@@ -35,6 +35,15 @@ struct xrt_session_event_sink;
 struct u_space_overseer *
 u_space_overseer_create(struct xrt_session_event_sink *broadcast);
 
+/*!
+ * Set for how long device poses located for one timestamp are reused, after
+ * that a query for the same timestamp asks the devices again. Defaults to 2ms.
+ *
+ * @ingroup aux_util
+ */
+void
+u_space_overseer_set_snapshot_max_age(struct u_space_overseer *uso, uint64_t max_age_ns);
+
 /*!
  * Sets up the space overseer and all semantic spaces in a way that works with
  * the old @ref xrt_tracking_origin information. Will automatically create local
@@ -15,7 +15,8 @@
 #if defined(XRT_DOXYGEN)
 
 /*!
- * OS specific tweak to wait time.
+ * OS specific tweak to wait time, not used on Linux where the
+ * @ref os_precise_sleeper learns it instead.
  *
  * @todo Measure on Windows.
  * @ingroup aux_util
@@ -49,7 +50,12 @@ u_wait_until(struct os_precise_sleeper *sleeper, uint64_t until_ns)
 		return;
 	}
 
+#if defined(XRT_OS_LINUX)
+	// Sleeps on the deadline, then spins the learned wake up latency.
+	os_precise_sleeper_wait_until(sleeper, until_ns);
+#else
 	// Sufficiently in the future.
 	uint32_t delay = (uint32_t)(until_ns - now_ns - U_WAIT_MEASURED_SCHEDULER_LATENCY_NS);
 	os_precise_sleeper_nanosleep(sleeper, delay);
+#endif
 }
@@ -1,4 +1,4 @@
-// Copyright 2022, Collabora, Ltd.
+// Copyright 2022-2024, Collabora, Ltd.
 // SPDX-License-Identifier: BSL-1.0
 /*!
  * @file
@@ -10,13 +10,16 @@
 
 #include "os/os_threading.h"
 
+#include "util/u_misc.h"
 #include "util/u_logging.h"
 #include "util/u_worker.h"
 #include "util/u_trace_marker.h"
 
+#include <stdio.h>
 
-#define MAX_TASK_COUNT (64)
-#define MAX_THREAD_COUNT (16)
+
+//! Starting size of each thread's deque, they grow as needed.
+#define INITIAL_DEQUE_CAPACITY (16)
 
 struct group;
 struct pool;
@@ -33,11 +36,34 @@ struct task
 	void *data;
 };
 
+/*!
+ * Growable ring buffer of tasks, one per thread. The owning thread takes the
+ * newest task, other threads steal the oldest. Each has its own mutex so
+ * threads only contend when they touch the same deque.
+ */
+struct deque
+{
+	struct os_mutex mutex;
+
+	//! Ring buffer of tasks, @ref capacity is always a power of two.
+	struct task *tasks;
+	size_t capacity;
+
+	//! Index of the oldest task.
+	size_t first;
+
+	//! Number of tasks in the ring buffer.
+	size_t count;
+};
+
 struct thread
 {
 	//! Pool this thread belongs to.
 	struct pool *p;
 
+	//! Tasks pushed to this thread.
+	struct deque deque;
+
 	// Native thread.
 	struct os_thread thread;
 
@@ -49,38 +75,50 @@ struct pool
 {
 	struct u_worker_thread_pool base;
 
-	//! Big contenious mutex.
-	struct os_mutex mutex;
+	//! Number of tasks in all deques, counted before they are added.
+	xrt_atomic_s32_t queued_count;
+
+	//! Given at creation.
+	uint32_t initial_worker_limit;
 
-	//! Array of tasks.
-	struct task tasks[MAX_TASK_COUNT];
+	//! Currently the number of works that can work, waiting increases this.
+	xrt_atomic_s32_t worker_limit;
 
-	//! Number of tasks in array.
-	size_t tasks_in_array_count;
+	//! Number of threads working on tasks.
+	xrt_atomic_s32_t working_count;
+
+	//! Spreads pushed tasks over the deques.
+	xrt_atomic_s32_t next_push;
+
+	/*!
+	 * Number of woken threads that have not found a task yet, while there
+	 * are any nobody else is woken, they wake the next one when they do.
+	 */
+	xrt_atomic_s32_t searching_count;
 
 	struct
 	{
-		size_t count;
+		struct os_mutex mutex;
 		struct os_cond cond;
-	} available; //!< For worker threads.
 
-	//! Given at creation.
-	uint32_t initial_worker_limit;
+		//! Threads in @ref thread_wait_for_work, read without the mutex.
+		xrt_atomic_s32_t count;
 
-	//! Currently the number of works that can work, waiting increases this.
-	uint32_t worker_limit;
+		//! Threads waiting on the cond, protected by the mutex.
+		int32_t waiting;
 
-	//! Number of threads working on tasks.
-	size_t working_count;
+		//! Wake ups not yet taken by a waiting thread, protected by the mutex.
+		int32_t notified;
+	} sleeping; //!< For worker threads without anything to do.
 
 	//! Number of created threads.
 	size_t thread_count;
 
 	//! The worker threads.
-	struct thread threads[MAX_THREAD_COUNT];
+	struct thread *threads;
 
 	//! Is the pool up and running?
-	bool running;
+	xrt_atomic_s32_t running;
 
 	//! Prefix to use for thread names.
 	char prefix[32];
@@ -95,10 +133,16 @@ struct group
 	struct u_worker_thread_pool *uwtp;
 
 	//! Number of tasks that is pending or being worked on in this group.
-	size_t current_submitted_tasks_count;
+	xrt_atomic_s32_t current_submitted_tasks_count;
 
-	//! Number of threads that have been released or newly entered wait.
-	size_t released_count;
+	//! Number of tasks of this group still in a deque.
+	xrt_atomic_s32_t queued_count;
+
+	/*!
+	 * Finished tasks are counted with this held, so once a waiter has seen
+	 * the last one finish under it no thread will touch the group again.
+	 */
+	struct os_mutex mutex;
 
 	struct
 	{
@@ -129,174 +173,261 @@ pool(struct u_worker_thread_pool *uwtp)
 
 /*
  *
- * Internal pool functions.
+ * Deque functions.
  *
  */
 
-static void
-locked_pool_pop_task(struct pool *p, struct task *out_task)
+static int
+deque_init(struct deque *d)
 {
-	assert(p->tasks_in_array_count > 0);
+	d->tasks = U_TYPED_ARRAY_CALLOC(struct task, INITIAL_DEQUE_CAPACITY);
+	d->capacity = INITIAL_DEQUE_CAPACITY;
+	d->first = 0;
+	d->count = 0;
 
-	for (size_t i = 0; i < MAX_TASK_COUNT; i++) {
-		if (p->tasks[i].func == NULL) {
-			continue;
-		}
+	return os_mutex_init(&d->mutex);
+}
 
-		*out_task = p->tasks[i];
-		p->tasks[i] = (struct task){NULL, NULL, NULL};
-		p->tasks_in_array_count--;
-		return;
-	}
+static void
+deque_fini(struct deque *d)
+{
+	os_mutex_destroy(&d->mutex);
+	free(d->tasks);
+	d->tasks = NULL;
+}
 
-	assert(false);
+static inline struct task *
+locked_deque_at(struct deque *d, size_t i)
+{
+	return &d->tasks[(d->first + i) & (d->capacity - 1)];
 }
 
 static void
-locked_pool_push_task(struct pool *p, struct group *g, u_worker_group_func_t func, void *data)
+locked_deque_push(struct deque *d, struct task task)
 {
-	assert(p->tasks_in_array_count < MAX_TASK_COUNT);
-
-	for (size_t i = 0; i < MAX_TASK_COUNT; i++) {
-		if (p->tasks[i].func != NULL) {
-			continue;
+	if (d->count == d->capacity) {
+		// Double it and unwrap the ring while copying.
+		size_t new_capacity = d->capacity * 2;
+		struct task *tasks = U_TYPED_ARRAY_CALLOC(struct task, new_capacity);
+		for (size_t i = 0; i < d->count; i++) {
+			tasks[i] = *locked_deque_at(d, i);
 		}
 
-		p->tasks[i] = (struct task){g, func, data};
-		p->tasks_in_array_count++;
-		g->current_submitted_tasks_count++;
-		return;
+		free(d->tasks);
+		d->tasks = tasks;
+		d->capacity = new_capacity;
+		d->first = 0;
 	}
 
-	assert(false);
+	*locked_deque_at(d, d->count) = task;
+	d->count++;
 }
 
-static void
-locked_pool_wake_worker_if_allowed(struct pool *p)
+static bool
+locked_deque_pop_newest(struct deque *d, struct task *out_task)
 {
-	// No tasks in array, don't wake any thread.
-	if (p->tasks_in_array_count == 0) {
-		return;
+	if (d->count == 0) {
+		return false;
 	}
 
-	// The number of working threads is at the limit.
-	if (p->working_count >= p->worker_limit) {
-		return;
+	d->count--;
+	*out_task = *locked_deque_at(d, d->count);
+
+	return true;
+}
+
+static bool
+locked_deque_pop_oldest(struct deque *d, struct task *out_task)
+{
+	if (d->count == 0) {
+		return false;
 	}
 
-	// No waiting thread.
-	if (p->available.count == 0) {
-		//! @todo Is this a error?
-		return;
+	*out_task = *locked_deque_at(d, 0);
+	d->first = (d->first + 1) & (d->capacity - 1);
+	d->count--;
+
+	return true;
+}
+
+static bool
+locked_deque_pop_from_group(struct deque *d, struct group *g, struct task *out_task)
+{
+	for (size_t i = 0; i < d->count; i++) {
+		struct task *task = locked_deque_at(d, i);
+		if (task->g != g) {
+			continue;
+		}
+
+		// Fill the hole with the oldest task, tasks have no order anyway.
+		*out_task = *task;
+		*task = *locked_deque_at(d, 0);
+		d->first = (d->first + 1) & (d->capacity - 1);
+		d->count--;
+
+		return true;
 	}
 
-	os_cond_signal(&p->available.cond);
+	return false;
 }
 
 
 /*
  *
- * Thread group functions.
+ * Internal pool functions.
  *
  */
 
+static void
+pool_push_task(struct pool *p, struct group *g, u_worker_group_func_t func, void *data)
+{
+	// Counted before it can be taken, so the counts never go negative.
+	xrt_atomic_s32_inc_return(&g->current_submitted_tasks_count);
+	xrt_atomic_s32_inc_return(&g->queued_count);
+	xrt_atomic_s32_inc_return(&p->queued_count);
+
+	uint32_t index = (uint32_t)xrt_atomic_s32_inc_return(&p->next_push) % p->thread_count;
+	struct deque *d = &p->threads[index].deque;
+
+	os_mutex_lock(&d->mutex);
+	locked_deque_push(d, (struct task){g, func, data});
+	os_mutex_unlock(&d->mutex);
+}
+
+static void
+pool_count_taken(struct pool *p, struct task *task)
+{
+	xrt_atomic_s32_dec_return(&task->g->queued_count);
+	xrt_atomic_s32_dec_return(&p->queued_count);
+}
+
+/*!
+ * Takes a task from the thread's own deque, or steals one from another.
+ */
 static bool
-locked_group_should_enter_wait_loop(struct pool *p, struct group *g)
+pool_take_task(struct pool *p, struct thread *t, struct task *out_task)
 {
-	if (g->current_submitted_tasks_count == 0) {
+	if (xrt_atomic_s32_load(&p->queued_count) <= 0) {
 		return false;
 	}
 
-	// Enter the loop as a released thread.
-	g->released_count++;
+	bool taken = false;
+	size_t index = (size_t)(t - p->threads);
 
-	return true;
+	for (size_t i = 0; i < p->thread_count && !taken; i++) {
+		struct deque *d = &p->threads[(index + i) % p->thread_count].deque;
+
+		os_mutex_lock(&d->mutex);
+		taken = i == 0 ? locked_deque_pop_newest(d, out_task) : locked_deque_pop_oldest(d, out_task);
+		os_mutex_unlock(&d->mutex);
+	}
+
+	if (taken) {
+		pool_count_taken(p, out_task);
+	}
+
+	return taken;
 }
 
 static bool
-locked_group_should_wait(struct pool *p, struct group *g)
+pool_take_task_from_group(struct pool *p, struct group *g, struct task *out_task)
 {
-	/*
-	 * There are several cases that needs to be covered by this function.
-	 *
-	 * A thread is entering the wait_all function for the first time, and
-	 * work is outstanding what we should do then is increase the worker
-	 * limit and wait on the conditional.
-	 *
-	 * Similar to preceding, we were woken up, there are more work outstanding
-	 * on the group and we had been released, remove one released and up the
-	 * worker limit, then wait on the conditional.
-	 *
-	 * A thread (or more) has been woken up and no new tasks has been
-	 * submitted, then break out of the loop and decrement the released
-	 * count.
-	 *
-	 * As preceding, but we were one of many woken up but only one thread had
-	 * been released and that released count had been taken, then we should
-	 * do nothing and wait again.
-	 */
-
-	// Tasks available.
-	if (g->current_submitted_tasks_count > 0) {
+	if (xrt_atomic_s32_load(&g->queued_count) <= 0) {
+		return false;
+	}
 
-		// We have been released or newly entered the loop.
-		if (g->released_count > 0) {
-			g->released_count--;
-			p->worker_limit++;
+	bool taken = false;
 
-			// Wake a worker with the new worker limit.
-			locked_pool_wake_worker_if_allowed(p);
-		}
+	for (size_t i = 0; i < p->thread_count && !taken; i++) {
+		struct deque *d = &p->threads[i].deque;
 
-		return true;
+		os_mutex_lock(&d->mutex);
+		taken = locked_deque_pop_from_group(d, g, out_task);
+		os_mutex_unlock(&d->mutex);
 	}
 
-	// No tasks, and we have been released, party!
-	if (g->released_count > 0) {
-		g->released_count--;
-		return false;
+	if (taken) {
+		pool_count_taken(p, out_task);
 	}
 
-	// We where woken up, but nothing had been released, loop again.
-	return true;
+	return taken;
+}
+
+static bool
+pool_has_work_for_worker(struct pool *p)
+{
+	return xrt_atomic_s32_load(&p->queued_count) > 0 &&
+	       xrt_atomic_s32_load(&p->working_count) < xrt_atomic_s32_load(&p->worker_limit);
 }
 
 static void
-locked_group_wake_waiter_if_allowed(struct pool *p, struct group *g)
+pool_wake_worker(struct pool *p)
 {
-	// Are there still outstanding tasks?
-	if (g->current_submitted_tasks_count > 0) {
+	/*
+	 * The callers have just changed the counts with an atomic operation,
+	 * which is a full barrier, and sleeping workers increment the count
+	 * before checking them. So either they see the change or we see them,
+	 * same with searching threads that decrement it before going to sleep.
+	 * Don't wake anybody that would just go back to sleep.
+	 */
+	if (xrt_atomic_s32_load(&p->sleeping.count) == 0 || xrt_atomic_s32_load(&p->searching_count) > 0 ||
+	    !pool_has_work_for_worker(p)) {
 		return;
 	}
 
-	// Is there a thread waiting or not?
-	if (g->waiting.count == 0) {
-		return;
+	os_mutex_lock(&p->sleeping.mutex);
+
+	if (p->sleeping.notified < p->sleeping.waiting) {
+		// The woken thread owns this, see run_func.
+		xrt_atomic_s32_inc_return(&p->searching_count);
+		p->sleeping.notified++;
+		os_cond_signal(&p->sleeping.cond);
 	}
 
-	// Wake one waiting thread.
-	os_cond_signal(&g->waiting.cond);
+	os_mutex_unlock(&p->sleeping.mutex);
+}
 
-	assert(p->worker_limit > p->initial_worker_limit);
+static void
+pool_stop_searching(struct pool *p, bool *searching)
+{
+	if (*searching) {
+		xrt_atomic_s32_dec_return(&p->searching_count);
+		*searching = false;
+	}
+}
 
-	// Remove one waiting threads.
-	p->worker_limit--;
+static bool
+pool_try_start_working(struct pool *p)
+{
+	while (true) {
+		int32_t working = xrt_atomic_s32_load(&p->working_count);
+		if (working >= xrt_atomic_s32_load(&p->worker_limit)) {
+			return false;
+		}
 
-	// We have released one thread.
-	g->released_count++;
+		if (xrt_atomic_s32_cmpxchg(&p->working_count, working, working + 1) == working) {
+			return true;
+		}
+	}
 }
 
+
+/*
+ *
+ * Thread group functions.
+ *
+ */
+
 static void
-locked_group_wait(struct pool *p, struct group *g)
+group_task_done(struct group *g)
 {
-	// Update tracking.
-	g->waiting.count++;
+	os_mutex_lock(&g->mutex);
 
-	// The wait, also unlocks the mutex.
-	os_cond_wait(&g->waiting.cond, &p->mutex);
+	if (xrt_atomic_s32_dec_return(&g->current_submitted_tasks_count) == 0 && g->waiting.count > 0) {
+		os_cond_signal(&g->waiting.cond);
+	}
 
-	// Update tracking.
-	g->waiting.count--;
+	os_mutex_unlock(&g->mutex);
 }
 
 
@@ -306,33 +437,40 @@ locked_group_wait(struct pool *p, struct group *g)
  *
  */
 
+/*!
+ * Returns true if this thread was woken by @ref pool_wake_worker, and so is
+ * counted as searching for a task.
+ */
 static bool
-locked_thread_allowed_to_work(struct pool *p)
+thread_wait_for_work(struct pool *p)
 {
-	// No work for you!
-	if (p->tasks_in_array_count == 0) {
-		return false;
-	}
+	bool notified = false;
 
-	// Reached the limit.
-	if (p->working_count >= p->worker_limit) {
-		return false;
-	}
+	os_mutex_lock(&p->sleeping.mutex);
 
-	return true;
-}
+	xrt_atomic_s32_inc_return(&p->sleeping.count);
 
-static void
-locked_thread_wait_for_work(struct pool *p)
-{
-	// Update tracking.
-	p->available.count++;
+	// Checked after the increment above, see pool_wake_worker.
+	while (xrt_atomic_s32_load(&p->running) && !pool_has_work_for_worker(p)) {
+		p->sleeping.waiting++;
+
+		// The wait, also unlocks the mutex.
+		os_cond_wait(&p->sleeping.cond, &p->sleeping.mutex);
+
+		p->sleeping.waiting--;
+
+		if (p->sleeping.notified > 0) {
+			p->sleeping.notified--;
+			notified = true;
+			break;
+		}
+	}
 
-	// The wait, also unlocks the mutex.
-	os_cond_wait(&p->available.cond, &p->mutex);
+	xrt_atomic_s32_dec_return(&p->sleeping.count);
 
-	// Update tracking.
-	p->available.count--;
+	os_mutex_unlock(&p->sleeping.mutex);
+
+	return notified;
 }
 
 static void *
@@ -344,46 +482,46 @@ run_func(void *ptr)
 	snprintf(t->name, sizeof(t->name), "%s: Worker", p->prefix);
 	U_TRACE_SET_THREAD_NAME(t->name);
 
-	os_mutex_lock(&p->mutex);
-
-	while (p->running) {
-
-		if (!locked_thread_allowed_to_work(p)) {
-			locked_thread_wait_for_work(p);
+	bool searching = false;
 
-			// Check running first when woken up.
+	while (xrt_atomic_s32_load(&p->running)) {
+		if (!pool_try_start_working(p)) {
+			pool_stop_searching(p, &searching);
+			searching = thread_wait_for_work(p);
 			continue;
 		}
 
-		// Pop a task from the pool.
 		struct task task = {NULL, NULL, NULL};
-		locked_pool_pop_task(p, &task);
+		if (!pool_take_task(p, t, &task)) {
+			xrt_atomic_s32_dec_return(&p->working_count);
+			pool_stop_searching(p, &searching);
+			searching = thread_wait_for_work(p);
+			continue;
+		}
 
-		// We are now counting as working, needed for wake below.
-		p->working_count++;
+		pool_stop_searching(p, &searching);
 
-		// Signal another thread if conditions are met.
-		locked_pool_wake_worker_if_allowed(p);
+		// Get another thread going if there is more.
+		if (xrt_atomic_s32_load(&p->queued_count) > 0) {
+			pool_wake_worker(p);
+		}
 
 		// Do the actual work here.
-		os_mutex_unlock(&p->mutex);
 		task.func(task.data);
-		os_mutex_lock(&p->mutex);
 
 		// No longer working.
-		p->working_count--;
-
-		// Only now decrement the task count on the owning group.
-		task.g->current_submitted_tasks_count--;
+		xrt_atomic_s32_dec_return(&p->working_count);
 
-		// Wake up any waiter.
-		locked_group_wake_waiter_if_allowed(p, task.g);
+		// Only now decrement the task count on the owning group, wakes waiters.
+		group_task_done(task.g);
 	}
 
-	// Make sure all threads are woken up.
-	os_cond_signal(&p->available.cond);
+	pool_stop_searching(p, &searching);
 
-	os_mutex_unlock(&p->mutex);
+	// Make sure all threads are woken up.
+	os_mutex_lock(&p->sleeping.mutex);
+	os_cond_signal(&p->sleeping.cond);
+	os_mutex_unlock(&p->sleeping.mutex);
 
 	return NULL;
 }
@@ -406,31 +544,32 @@ u_worker_thread_pool_create(uint32_t starting_worker_count, uint32_t thread_coun
 		return NULL;
 	}
 
-	assert(thread_count <= MAX_THREAD_COUNT);
-	if (thread_count > MAX_THREAD_COUNT) {
-		return NULL;
-	}
-
 	struct pool *p = U_TYPED_CALLOC(struct pool);
 	p->base.reference.count = 1;
 	p->initial_worker_limit = starting_worker_count;
-	p->worker_limit = starting_worker_count;
+	p->worker_limit = (int32_t)starting_worker_count;
 	p->thread_count = thread_count;
-	p->running = true;
+	p->running = 1;
 	snprintf(p->prefix, sizeof(p->prefix), "%s", prefix);
 
-	ret = os_mutex_init(&p->mutex);
+	ret = os_mutex_init(&p->sleeping.mutex);
 	if (ret != 0) {
 		goto err_alloc;
 	}
 
-	ret = os_cond_init(&p->available.cond);
+	ret = os_cond_init(&p->sleeping.cond);
 	if (ret != 0) {
 		goto err_mutex;
 	}
 
+	// All deques before any thread starts, they steal from each other.
+	p->threads = U_TYPED_ARRAY_CALLOC(struct thread, thread_count);
 	for (size_t i = 0; i < thread_count; i++) {
 		p->threads[i].p = p;
+		deque_init(&p->threads[i].deque);
+	}
+
+	for (size_t i = 0; i < thread_count; i++) {
 		os_thread_init(&p->threads[i].thread);
 		os_thread_start(&p->threads[i].thread, run_func, &p->threads[i]);
 	}
@@ -439,7 +578,7 @@ u_worker_thread_pool_create(uint32_t starting_worker_count, uint32_t thread_coun
 
 
 err_mutex:
-	os_mutex_destroy(&p->mutex);
+	os_mutex_destroy(&p->sleeping.mutex);
 
 err_alloc:
 	free(p);
@@ -454,11 +593,11 @@ u_worker_thread_pool_destroy(struct u_worker_thread_pool *uwtp)
 
 	struct pool *p = pool(uwtp);
 
-	os_mutex_lock(&p->mutex);
+	xrt_atomic_s32_store(&p->running, 0);
 
-	p->running = false;
-	os_cond_signal(&p->available.cond);
-	os_mutex_unlock(&p->mutex);
+	os_mutex_lock(&p->sleeping.mutex);
+	os_cond_signal(&p->sleeping.cond);
+	os_mutex_unlock(&p->sleeping.mutex);
 
 	// Wait for all threads.
 	for (size_t i = 0; i < p->thread_count; i++) {
@@ -466,9 +605,14 @@ u_worker_thread_pool_destroy(struct u_worker_thread_pool *uwtp)
 		os_thread_destroy(&p->threads[i].thread);
 	}
 
-	os_mutex_destroy(&p->mutex);
-	os_cond_destroy(&p->available.cond);
+	for (size_t i = 0; i < p->thread_count; i++) {
+		deque_fini(&p->threads[i].deque);
+	}
+
+	os_mutex_destroy(&p->sleeping.mutex);
+	os_cond_destroy(&p->sleeping.cond);
 
+	free(p->threads);
 	free(p);
 }
 
@@ -488,6 +632,7 @@ u_worker_group_create(struct u_worker_thread_pool *uwtp)
 	g->base.reference.count = 1;
 	u_worker_thread_pool_reference(&g->uwtp, uwtp);
 
+	os_mutex_init(&g->mutex);
 	os_cond_init(&g->waiting.cond);
 
 	return (struct u_worker_group *)g;
@@ -501,24 +646,10 @@ u_worker_group_push(struct u_worker_group *uwg, u_worker_group_func_t f, void *d
 	struct group *g = group(uwg);
 	struct pool *p = pool(g->uwtp);
 
-	os_mutex_lock(&p->mutex);
-	while (p->tasks_in_array_count >= MAX_TASK_COUNT) {
-		os_mutex_unlock(&p->mutex);
-
-		//! @todo Don't wait all, wait one.
-		u_worker_group_wait_all(uwg);
-
-		os_mutex_lock(&p->mutex);
-	}
-
-	locked_pool_push_task(p, g, f, data);
+	pool_push_task(p, g, f, data);
 
-	// There are worker threads available, wake one up.
-	if (p->available.count > 0) {
-		os_cond_signal(&p->available.cond);
-	}
-
-	os_mutex_unlock(&p->mutex);
+	// There might be worker threads available, wake one up.
+	pool_wake_worker(p);
 }
 
 void
@@ -529,21 +660,44 @@ u_worker_group_wait_all(struct u_worker_group *uwg)
 	struct group *g = group(uwg);
 	struct pool *p = pool(g->uwtp);
 
-	os_mutex_lock(&p->mutex);
+	while (true) {
+		// Help with our own tasks rather than sleep while they are queued.
+		struct task task = {NULL, NULL, NULL};
+		if (pool_take_task_from_group(p, g, &task)) {
+			task.func(task.data);
+			group_task_done(g);
+			continue;
+		}
 
-	// Can we early out?
-	if (!locked_group_should_enter_wait_loop(p, g)) {
-		os_mutex_unlock(&p->mutex);
-		return;
-	}
+		os_mutex_lock(&g->mutex);
 
-	// Wait here until all work been started and completed.
-	while (locked_group_should_wait(p, g)) {
-		// Do the wait.
-		locked_group_wait(p, g);
-	}
+		// All done, pass it on to any other waiter.
+		if (xrt_atomic_s32_load(&g->current_submitted_tasks_count) == 0) {
+			if (g->waiting.count > 0) {
+				os_cond_signal(&g->waiting.cond);
+			}
+			os_mutex_unlock(&g->mutex);
+			return;
+		}
+
+		/*
+		 * The rest are being worked on, or about to be queued. Donate this
+		 * thread to the pool while waiting, like before it helped.
+		 */
+		xrt_atomic_s32_inc_return(&p->worker_limit);
+		pool_wake_worker(p);
 
-	os_mutex_unlock(&p->mutex);
+		g->waiting.count++;
+
+		// The wait, also unlocks the mutex.
+		os_cond_wait(&g->waiting.cond, &g->mutex);
+
+		g->waiting.count--;
+
+		xrt_atomic_s32_dec_return(&p->worker_limit);
+
+		os_mutex_unlock(&g->mutex);
+	}
 }
 
 void
@@ -559,6 +713,7 @@ u_worker_group_destroy(struct u_worker_group *uwg)
 	u_worker_thread_pool_reference(&g->uwtp, NULL);
 
 	os_cond_destroy(&g->waiting.cond);
+	os_mutex_destroy(&g->mutex);
 
 	free(uwg);
 }
@@ -127,8 +127,9 @@ void
 u_worker_group_push(struct u_worker_group *uwg, u_worker_group_func_t f, void *data);
 
 /*!
- * Wait for all pushed tasks to be completed, "donates" this thread to the
- * shared thread pool.
+ * Wait for all pushed tasks to be completed, runs the group's tasks that no
+ * worker has picked up yet on this thread and then "donates" this thread to
+ * the shared thread pool while the rest finish.
  *
  * @ingroup aux_util
  */
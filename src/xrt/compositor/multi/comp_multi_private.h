@@ -16,6 +16,7 @@
 #include "os/os_time.h"
 #include "os/os_threading.h"
 
+#include "util/u_var.h"
 #include "util/u_pacing.h"
 
 #ifdef __cplusplus
@@ -39,6 +40,14 @@ extern "C" {
  */
 #define MULTI_MAX_LAYERS 16
 
+/*!
+ * Number of bins in the wait frame wake up error histogram, each is 10us
+ * wide and the last one has everything later than that.
+ *
+ * @ingroup comp_multi
+ */
+#define MULTI_WAKE_ERROR_BIN_COUNT 20
+
 
 /*
  *
@@ -363,6 +372,20 @@ struct multi_system_compositor
 		uint64_t diff_ns;
 	} last_timings;
 
+	struct
+	{
+		//! How late wait frame woke up, only updated on the render loop thread.
+		float bins[MULTI_WAKE_ERROR_BIN_COUNT];
+		struct u_var_histogram_f32 ui;
+
+		//! From the render loop's @ref os_precise_sleeper.
+		int64_t spin_ns;
+		int64_t last_error_ns;
+
+		//! The sleeper's wait count when it was last looked at.
+		uint64_t wait_count;
+	} wake_error;
+
 	//! List of active clients.
 	struct multi_compositor *clients[MULTI_MAX_CLIENTS];
 };
@@ -392,13 +392,40 @@ broadcast_timings_to_pacers(struct multi_system_compositor *msc,
 }
 
 static void
-wait_frame(struct os_precise_sleeper *sleeper, struct xrt_compositor *xc, int64_t frame_id, uint64_t wake_up_time_ns)
+update_wake_error(struct multi_system_compositor *msc, struct os_precise_sleeper *sleeper)
+{
+#ifdef XRT_OS_LINUX
+	// Nothing was waited for as it was already (about) time to wake up.
+	if (sleeper->wait_count == msc->wake_error.wait_count) {
+		return;
+	}
+	msc->wake_error.wait_count = sleeper->wait_count;
+
+	int64_t bin = sleeper->last_error_ns / (U_TIME_1MS_IN_NS / 100);
+	if (bin >= MULTI_WAKE_ERROR_BIN_COUNT) {
+		bin = MULTI_WAKE_ERROR_BIN_COUNT - 1;
+	}
+
+	msc->wake_error.bins[bin] += 1.0f;
+	msc->wake_error.spin_ns = sleeper->spin_ns;
+	msc->wake_error.last_error_ns = sleeper->last_error_ns;
+#endif
+}
+
+static void
+wait_frame(struct multi_system_compositor *msc,
+           struct os_precise_sleeper *sleeper,
+           struct xrt_compositor *xc,
+           int64_t frame_id,
+           uint64_t wake_up_time_ns)
 {
 	COMP_TRACE_MARKER();
 
 	// Wait until the given wake up time.
 	u_wait_until(sleeper, wake_up_time_ns);
 
+	update_wake_error(msc, sleeper);
+
 	uint64_t now_ns = os_monotonic_get_ns();
 
 	// Signal that we woke up.
@@ -524,7 +551,7 @@ multi_main_loop(struct multi_system_compositor *msc)
 		broadcast_timings_to_clients(msc, predicted_display_time_ns);
 
 		// Now we can wait.
-		wait_frame(&sleeper, xc, frame_id, wake_up_time_ns);
+		wait_frame(msc, &sleeper, xc, frame_id, wake_up_time_ns);
 
 		uint64_t now_ns = os_monotonic_get_ns();
 		uint64_t diff_ns = predicted_display_time_ns - now_ns;
@@ -699,6 +726,8 @@ system_compositor_destroy(struct xrt_system_compositor *xsc)
 	// Destroy the render thread first, destroy also stops the thread.
 	os_thread_helper_destroy(&msc->oth);
 
+	u_var_remove_root(msc);
+
 	u_paf_destroy(&msc->upaf);
 
 	xrt_comp_native_destroy(&msc->xcn);
@@ -765,8 +794,17 @@ comp_multi_create_system_compositor(struct xrt_compositor_native *xcn,
 	msc->last_timings.predicted_display_period_ns = U_TIME_1MS_IN_NS * 16; // Just a wild guess.
 	msc->last_timings.diff_ns = U_TIME_1MS_IN_NS * 5;                      // Make sure it's not zero at least.
 
+	msc->wake_error.ui.values = msc->wake_error.bins;
+	msc->wake_error.ui.count = MULTI_WAKE_ERROR_BIN_COUNT;
+
+	u_var_add_root(msc, "Multi-client system compositor", false);
+	u_var_add_histogram_f32(msc, &msc->wake_error.ui, "Wait frame wake up error (10us bins)");
+	u_var_add_ro_i64(msc, &msc->wake_error.last_error_ns, "Wait frame last wake up error (ns)");
+	u_var_add_ro_i64(msc, &msc->wake_error.spin_ns, "Wait frame spin (ns)");
+
 	int ret = os_thread_helper_init(&msc->oth);
 	if (ret < 0) {
+		u_var_remove_root(msc);
 		return XRT_ERROR_THREADING_INIT_FAILURE;
 	}
 
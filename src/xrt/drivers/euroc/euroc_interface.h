@@ -47,6 +47,7 @@ struct euroc_player_playback_config
 	bool use_source_ts;       //!< If true, use the original timestamps from the dataset
 	bool play_from_start;     //!< If set, the euroc player does not wait for user input to start
 	bool print_progress;      //!< Whether to print progress to stdout (useful for CLI runs)
+	int prefetch_count;       //!< Frames decoded ahead, read on stream start, 0 decodes right before pushing
 };
 
 /*!
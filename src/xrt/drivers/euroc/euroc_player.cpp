@@ -16,6 +16,8 @@
 #include "util/u_time.h"
 #include "util/u_var.h"
 #include "util/u_sink.h"
+#include "util/u_worker.h"
+#include "tracking/t_euroc_container.h"
 #include "tracking/t_frame_cv_mat_wrapper.hpp"
 #include "math/m_api.h"
 #include "math/m_filter_fifo.h"
@@ -25,11 +27,13 @@
 
 #include <algorithm>
 #include <chrono>
+#include <condition_variable>
 #include <cstring>
 #include <stdint.h>
 #include <stdio.h>
 #include <fstream>
 #include <future>
+#include <mutex>
 #include <thread>
 #include <inttypes.h>
 
@@ -48,12 +52,22 @@ DEBUG_GET_ONCE_BOOL_OPTION(send_all_imus_first, "EUROC_SEND_ALL_IMUS_FIRST", fal
 DEBUG_GET_ONCE_BOOL_OPTION(use_source_ts, "EUROC_USE_SOURCE_TS", false)
 DEBUG_GET_ONCE_BOOL_OPTION(play_from_start, "EUROC_PLAY_FROM_START", false)
 DEBUG_GET_ONCE_BOOL_OPTION(print_progress, "EUROC_PRINT_PROGRESS", false)
+DEBUG_GET_ONCE_NUM_OPTION(prefetch_count, "EUROC_PREFETCH", 16)
 
 #define EUROC_PLAYER_STR "Euroc Player"
 
 //! Match max cameras to slam sinks max camera count
 #define EUROC_MAX_CAMS XRT_TRACKING_MAX_SLAM_CAMS
 
+//! Threads decoding frames ahead of the playback when prefetching
+#define EUROC_DECODE_THREADS 4
+
+/*!
+ * Bounds the memory held by decoded frames, each slot keeps one image per
+ * camera, so 32 stereo 1280x800 grayscale frames are already about 64 MB.
+ */
+#define EUROC_MAX_PREFETCH 32
+
 using std::async;
 using std::find_if;
 using std::ifstream;
@@ -68,6 +82,8 @@ using std::vector;
 
 using img_sample = pair<timepoint_ns, string>;
 
+struct euroc_prefetcher;
+
 using imu_samples = vector<xrt_imu_sample>;
 using img_samples = vector<img_sample>;
 using gt_trajectory = vector<xrt_pose_sample>;
@@ -115,6 +131,10 @@ struct euroc_player
 	vector<img_samples> *imgs; //!< List of all image names to read from the dataset per camera
 	gt_trajectory *gt;         //!< List of all groundtruth poses read from the dataset
 
+	//! Mapped capture container if the dataset is one instead of a folder, frames are served from it without
+	//! decoding. `imgs` is still filled in, with empty image names.
+	struct t_euroc_container *container;
+
 	// Timestamp correction fields (can be disabled through `use_source_ts`)
 	timepoint_ns base_ts;   //!< First sample timestamp, stream timestamps are relative to this
 	timepoint_ns start_ts;  //!< When did the dataset started to be played
@@ -128,6 +148,12 @@ struct euroc_player
 	struct u_sink_debug ui_cam_sinks[EUROC_MAX_CAMS]; //!< Sinks to display cam frames in UI
 	struct m_ff_vec3_f32 *gyro_ff;                    //!< Used for displaying IMU data
 	struct m_ff_vec3_f32 *accel_ff;                   //!< Same as `gyro_ff`
+
+	// Prefetching
+	struct euroc_prefetcher *prefetcher; //!< Decodes frames ahead of time, null if disabled or not streaming
+	int32_t prefetch_ready;              //!< Frames decoded and waiting to be pushed, for the UI
+	float decode_ms;                     //!< Average time to decode the frames of all cameras
+	float wait_ms;                       //!< Average time the stream had to wait on a decode
 };
 
 static void
@@ -304,9 +330,50 @@ euroc_player_match_cams_seqs(struct euroc_player *ep)
 	}
 }
 
+//! Same as the preload functions above but from a container, `imgs` get empty image names
+static void
+euroc_player_preload_container(struct euroc_player *ep)
+{
+	struct t_euroc_container *c = ep->container;
+
+	ep->imus->clear();
+	ep->imus->resize(c->imu_count);
+	for (uint32_t i = 0; i < c->imu_count; i++) {
+		t_euroc_container_get_imu(c, i, &ep->imus->at(i));
+	}
+
+	for (img_samples &imgs : *ep->imgs) {
+		imgs.clear();
+	}
+	for (uint32_t i = 0; i < c->frame_count; i++) {
+		const t_euroc_container_index_entry &e = c->frames[i];
+		if (e.cam_index < ep->imgs->size()) {
+			ep->imgs->at(e.cam_index).push_back({e.timestamp_ns, string{}});
+		}
+	}
+	for (img_samples &imgs : *ep->imgs) {
+		std::stable_sort(imgs.begin(), imgs.end(),
+		                 [](const img_sample &a, const img_sample &b) { return a.first < b.first; });
+	}
+
+	if (ep->dataset.has_gt) {
+		ep->gt->clear();
+		ep->gt->resize(c->gt_count);
+		for (uint32_t i = 0; i < c->gt_count; i++) {
+			t_euroc_container_get_gt(c, i, &ep->gt->at(i));
+		}
+	}
+}
+
 static void
 euroc_player_preload(struct euroc_player *ep)
 {
+	if (ep->container != NULL) {
+		euroc_player_preload_container(ep);
+		euroc_player_match_cams_seqs(ep);
+		return;
+	}
+
 	ep->imus->clear();
 	euroc_player_preload_imu_data(ep->dataset.path, ep->imus);
 
@@ -358,6 +425,23 @@ static void
 euroc_player_fill_dataset_info(const char *path, euroc_player_dataset_info *dataset)
 {
 	(void)snprintf(dataset->path, sizeof(dataset->path), "%s", path);
+
+	struct t_euroc_container *c = NULL;
+	if (t_euroc_container_open(path, &c)) {
+		EUROC_ASSERT(c->frame_count > 0 && c->imu_count > 0, "Invalid dataset %s", path);
+
+		struct xrt_frame *first = NULL;
+		t_euroc_container_get_frame(c, 0, &first);
+		dataset->cam_count = (int)c->cam_count;
+		dataset->is_colored = first->format == XRT_FORMAT_R8G8B8;
+		dataset->has_gt = c->gt_count > 0;
+		dataset->width = first->width;
+		dataset->height = first->height;
+
+		xrt_frame_reference(&first, NULL);
+		t_euroc_container_reference(&c, NULL);
+		return;
+	}
 	img_samples samples;
 	imu_samples _1;
 	gt_trajectory _2;
@@ -422,21 +506,10 @@ euroc_player_mapped_playback_ts(struct euroc_player *ep, timepoint_ns ts)
 	return euroc_player_mapped_ts(ep, ts);
 }
 
-static void
-euroc_player_load_next_frame(struct euroc_player *ep, int cam_index, struct xrt_frame *&xf)
+//! Reads an image from disk, applying the color and scale playback options
+static cv::Mat
+euroc_player_decode_img(const string &img_name, bool allow_color, float scale)
 {
-	using xrt::auxiliary::tracking::FrameMat;
-	img_sample sample = ep->imgs->at(cam_index).at(ep->img_seq);
-	ep->playback.scale = CLAMP(ep->playback.scale, 1.0 / 16, 4);
-
-	// Load will be influenced by these playback options
-	bool allow_color = ep->playback.color;
-	float scale = ep->playback.scale;
-
-	// Load image from disk
-	timepoint_ns timestamp = euroc_player_mapped_playback_ts(ep, sample.first);
-	string img_name = sample.second;
-	EUROC_TRACE(ep, "cam%d img t = %ld filename = %s", cam_index, timestamp, img_name.c_str());
 	cv::ImreadModes read_mode = allow_color ? cv::IMREAD_ANYCOLOR : cv::IMREAD_GRAYSCALE;
 	cv::Mat img = cv::imread(img_name, read_mode); // If colored, reads in BGR order
 
@@ -446,6 +519,175 @@ euroc_player_load_next_frame(struct euroc_player *ep, int cam_index, struct xrt_
 		img = tmp;
 	}
 
+	return img;
+}
+
+//! Exponential moving average for the UI stats
+static void
+euroc_player_stat_push(float *stat, float value)
+{
+	constexpr float a = 1.0f / 32;
+	*stat = (1 - a) * *stat + a * value;
+}
+
+
+/*
+ *
+ * Prefetching.
+ *
+ */
+
+/*!
+ * A decoded frame per camera for one sequence number.
+ */
+struct euroc_prefetch_slot
+{
+	struct euroc_prefetcher *prefetcher;
+	uint64_t seq;
+	bool ready;
+	bool allow_color;
+	float scale;
+	time_duration_ns decode_ns;
+	cv::Mat imgs[EUROC_MAX_CAMS];
+};
+
+/*!
+ * Bounded look-ahead of decoded frames. Frame `seq` lives in slot
+ * `seq % slots.size()`, it is scheduled on the decode pool as soon as the
+ * frame that previously used that slot is taken, so the pool always works on
+ * the next `slots.size()` frames and they are handed out in order.
+ */
+struct euroc_prefetcher
+{
+	struct euroc_player *ep;
+	struct u_worker_thread_pool *pool = nullptr;
+	struct u_worker_group *group = nullptr;
+
+	std::mutex mutex;
+	std::condition_variable cond;
+	vector<euroc_prefetch_slot> slots;
+	int32_t ready_count = 0;
+};
+
+static void
+euroc_prefetch_decode_task(void *ptr)
+{
+	struct euroc_prefetch_slot *slot = (struct euroc_prefetch_slot *)ptr;
+	struct euroc_prefetcher *pf = slot->prefetcher;
+	struct euroc_player *ep = pf->ep;
+
+	timepoint_ns start = os_monotonic_get_ns();
+
+	// Only this task touches the slot until it is marked ready.
+	for (int i = 0; i < ep->playback.cam_count; i++) {
+		const string &img_name = ep->imgs->at(i).at(slot->seq).second;
+		slot->imgs[i] = euroc_player_decode_img(img_name, slot->allow_color, slot->scale);
+	}
+
+	std::unique_lock lock(pf->mutex);
+	slot->decode_ns = os_monotonic_get_ns() - start;
+	slot->ready = true;
+	pf->ready_count++;
+	pf->cond.notify_all();
+}
+
+//! Queues the decode of frame @p seq, if there is such frame, mutex must be held
+static void
+euroc_prefetch_schedule(struct euroc_prefetcher *pf, uint64_t seq)
+{
+	struct euroc_player *ep = pf->ep;
+	if (seq >= ep->imgs->at(0).size()) {
+		return;
+	}
+
+	struct euroc_prefetch_slot &slot = pf->slots[seq % pf->slots.size()];
+	slot.seq = seq;
+	slot.ready = false;
+	slot.allow_color = ep->playback.color;
+	slot.scale = CLAMP(ep->playback.scale, 1.0 / 16, 4);
+
+	u_worker_group_push(pf->group, euroc_prefetch_decode_task, &slot);
+}
+
+static struct euroc_prefetcher *
+euroc_prefetch_create(struct euroc_player *ep, uint32_t count)
+{
+	struct euroc_prefetcher *pf = new euroc_prefetcher{};
+	pf->ep = ep;
+	pf->slots.resize(MIN(count, EUROC_MAX_PREFETCH));
+	for (euroc_prefetch_slot &slot : pf->slots) {
+		slot.prefetcher = pf;
+	}
+
+	pf->pool = u_worker_thread_pool_create(EUROC_DECODE_THREADS - 1, EUROC_DECODE_THREADS, "EuRoC Decode");
+	pf->group = u_worker_group_create(pf->pool);
+
+	std::unique_lock lock(pf->mutex);
+	for (uint64_t seq = ep->img_seq; seq < ep->img_seq + pf->slots.size(); seq++) {
+		euroc_prefetch_schedule(pf, seq);
+	}
+
+	return pf;
+}
+
+//! Waits for frame @p seq to be decoded, moves its images out and queues the decode of a later frame
+static void
+euroc_prefetch_take(struct euroc_prefetcher *pf, uint64_t seq, cv::Mat *out_imgs)
+{
+	struct euroc_player *ep = pf->ep;
+	struct euroc_prefetch_slot &slot = pf->slots[seq % pf->slots.size()];
+
+	timepoint_ns start = os_monotonic_get_ns();
+
+	std::unique_lock lock(pf->mutex);
+	EUROC_ASSERT(slot.seq == seq, "Prefetch out of order, expected %" PRIu64 " got %" PRIu64, seq, slot.seq);
+	pf->cond.wait(lock, [&slot] { return slot.ready; });
+
+	for (int i = 0; i < ep->playback.cam_count; i++) {
+		out_imgs[i] = std::move(slot.imgs[i]);
+	}
+	pf->ready_count--;
+
+	euroc_player_stat_push(&ep->decode_ms, (float)time_ns_to_ms_f(slot.decode_ns));
+	euroc_player_stat_push(&ep->wait_ms, (float)time_ns_to_ms_f(os_monotonic_get_ns() - start));
+	ep->prefetch_ready = pf->ready_count;
+
+	euroc_prefetch_schedule(pf, seq + pf->slots.size());
+}
+
+static void
+euroc_prefetch_destroy(struct euroc_prefetcher **pf_ptr)
+{
+	struct euroc_prefetcher *pf = *pf_ptr;
+	if (pf == NULL) {
+		return;
+	}
+
+	// The tasks point into the slots.
+	u_worker_group_wait_all(pf->group);
+	u_worker_group_reference(&pf->group, NULL);
+	u_worker_thread_pool_reference(&pf->pool, NULL);
+
+	delete pf;
+	*pf_ptr = NULL;
+}
+
+
+/*
+ *
+ * Streaming.
+ *
+ */
+
+static void
+euroc_player_load_next_frame(struct euroc_player *ep, int cam_index, cv::Mat img, struct xrt_frame *&xf)
+{
+	using xrt::auxiliary::tracking::FrameMat;
+	img_sample sample = ep->imgs->at(cam_index).at(ep->img_seq);
+
+	timepoint_ns timestamp = euroc_player_mapped_playback_ts(ep, sample.first);
+	EUROC_TRACE(ep, "cam%d img t = %ld filename = %s", cam_index, timestamp, sample.second.c_str());
+
 	// Create xrt_frame, it will be freed by FrameMat destructor
 	EUROC_ASSERT(xf == NULL || xf->reference.count > 0, "Must be given a valid or NULL frame ptr");
 	EUROC_ASSERT(timestamp >= 0, "Unexpected negative timestamp");
@@ -462,14 +704,100 @@ euroc_player_load_next_frame(struct euroc_player *ep, int cam_index, struct xrt_
 	xf->source_id = ep->base.source_id;
 }
 
+/*!
+ * Hands out the frame straight from the container mapping, only copies if the
+ * playback options ask for a different color or scale than what is stored.
+ */
+static void
+euroc_player_load_container_frame(struct euroc_player *ep, int cam_index, struct xrt_frame *&xf)
+{
+	img_sample sample = ep->imgs->at(cam_index).at(ep->img_seq);
+
+	uint32_t index = 0;
+	bool found = t_euroc_container_find_frame(ep->container, cam_index, sample.first, &index);
+	EUROC_ASSERT(found, "cam%d has no frame at t = %" PRId64, cam_index, sample.first);
+
+	struct xrt_frame *mapped = NULL;
+	t_euroc_container_get_frame(ep->container, index, &mapped);
+
+	ep->playback.scale = CLAMP(ep->playback.scale, 1.0 / 16, 4);
+	bool to_gray = mapped->format == XRT_FORMAT_R8G8B8 && !ep->playback.color;
+
+	if (to_gray || ep->playback.scale != 1.0) {
+		auto type = mapped->format == XRT_FORMAT_R8G8B8 ? CV_8UC3 : CV_8UC1;
+		cv::Mat img{(int)mapped->height, (int)mapped->width, type, mapped->data, mapped->stride};
+		cv::Mat converted = img;
+		if (to_gray) {
+			cv::cvtColor(converted, converted, cv::COLOR_BGR2GRAY); // Stored as read, BGR
+		}
+		if (ep->playback.scale != 1.0) {
+			cv::Mat tmp;
+			cv::resize(converted, tmp, cv::Size(), ep->playback.scale, ep->playback.scale);
+			converted = tmp;
+		}
+
+		// Both paths above allocate, so it doesn't point into the mapping anymore.
+		euroc_player_load_next_frame(ep, cam_index, converted, xf);
+		xrt_frame_reference(&mapped, NULL);
+		return;
+	}
+
+	timepoint_ns timestamp = euroc_player_mapped_playback_ts(ep, sample.first);
+	EUROC_TRACE(ep, "cam%d img t = %ld (container)", cam_index, timestamp);
+	EUROC_ASSERT(timestamp >= 0, "Unexpected negative timestamp");
+
+	// Freshly created for us, fine to fill in.
+	mapped->timestamp = timestamp;
+	mapped->owner = ep;
+	mapped->source_timestamp = sample.first;
+	mapped->source_sequence = ep->img_seq;
+	mapped->source_id = ep->base.source_id;
+
+	xrt_frame_reference(&xf, NULL);
+	xf = mapped;
+}
+
+//! Gets the images of the next frame, from the prefetcher or by decoding them right now
+static void
+euroc_player_get_next_imgs(struct euroc_player *ep, cv::Mat *out_imgs)
+{
+	if (ep->prefetcher != NULL) {
+		euroc_prefetch_take(ep->prefetcher, ep->img_seq, out_imgs);
+		return;
+	}
+
+	ep->playback.scale = CLAMP(ep->playback.scale, 1.0 / 16, 4);
+
+	timepoint_ns start = os_monotonic_get_ns();
+	for (int i = 0; i < ep->playback.cam_count; i++) {
+		const string &img_name = ep->imgs->at(i).at(ep->img_seq).second;
+		out_imgs[i] = euroc_player_decode_img(img_name, ep->playback.color, ep->playback.scale);
+	}
+	float decode_ms = (float)time_ns_to_ms_f(os_monotonic_get_ns() - start);
+	euroc_player_stat_push(&ep->decode_ms, decode_ms);
+	euroc_player_stat_push(&ep->wait_ms, decode_ms);
+}
+
 static void
 euroc_player_push_next_frame(struct euroc_player *ep)
 {
 	int cam_count = ep->playback.cam_count;
 
 	vector<xrt_frame *> xfs(cam_count, nullptr);
-	for (int i = 0; i < cam_count; i++) {
-		euroc_player_load_next_frame(ep, i, xfs[i]);
+	if (ep->container != NULL) {
+		timepoint_ns start = os_monotonic_get_ns();
+		for (int i = 0; i < cam_count; i++) {
+			euroc_player_load_container_frame(ep, i, xfs[i]);
+		}
+		float load_ms = (float)time_ns_to_ms_f(os_monotonic_get_ns() - start);
+		euroc_player_stat_push(&ep->decode_ms, load_ms);
+		euroc_player_stat_push(&ep->wait_ms, load_ms);
+	} else {
+		cv::Mat imgs[EUROC_MAX_CAMS];
+		euroc_player_get_next_imgs(ep, imgs);
+		for (int i = 0; i < cam_count; i++) {
+			euroc_player_load_next_frame(ep, i, imgs[i], xfs[i]);
+		}
 	}
 
 	// TODO: Some SLAM systems expect synced frames, but that's not an
@@ -622,6 +950,15 @@ euroc_player_stream(void *ptr)
 		euroc_player_push_all_gt(ep);
 	}
 
+	/*
+	 * Start decoding frames ahead of the image stream, containers have
+	 * nothing to decode. The prefetch count is only read here, changing it
+	 * in the UI applies to the next time the stream is started.
+	 */
+	if (ep->playback.prefetch_count > 0 && ep->container == NULL) {
+		ep->prefetcher = euroc_prefetch_create(ep, ep->playback.prefetch_count);
+	}
+
 	// Launch image and IMU producers
 	auto serve_imus = async(launch::async, [ep] { euroc_player_stream_samples<imu_samples>(ep); });
 	auto serve_imgs = async(launch::async, [ep] { euroc_player_stream_samples<img_samples>(ep); });
@@ -632,6 +969,9 @@ euroc_player_stream(void *ptr)
 	serve_imgs.get();
 	serve_imus.get();
 
+	euroc_prefetch_destroy(&ep->prefetcher);
+	ep->prefetch_ready = 0;
+
 	ep->is_running = false;
 
 	EUROC_INFO(ep, "Euroc dataset playback finished");
@@ -801,6 +1141,7 @@ euroc_player_destroy(struct xrt_frame_node *node)
 	delete ep->gt;
 	delete ep->imus;
 	delete ep->imgs;
+	t_euroc_container_reference(&ep->container, NULL);
 
 	u_var_remove_root(ep);
 	for (int i = 0; i < ep->dataset.cam_count; i++) {
@@ -910,6 +1251,12 @@ euroc_player_setup_gui(struct euroc_player *ep)
 	u_var_add_f64(ep, &ep->playback.speed, "Speed");
 	u_var_add_bool(ep, &ep->playback.send_all_imus_first, "Send all IMU samples first");
 	u_var_add_bool(ep, &ep->playback.use_source_ts, "Use original timestamps");
+	u_var_add_i32(ep, &ep->playback.prefetch_count, "Frames to decode ahead (on start)");
+
+	u_var_add_gui_header(ep, NULL, "Decoding");
+	u_var_add_ro_i32(ep, &ep->prefetch_ready, "Decoded frames queued");
+	u_var_add_ro_f32(ep, &ep->decode_ms, "Decode time (ms)");
+	u_var_add_ro_f32(ep, &ep->wait_ms, "Waited on decode (ms)");
 
 	u_var_add_gui_header(ep, NULL, "Streams");
 	u_var_add_ro_ff_vec3_f32(ep, ep->gyro_ff, "Gyroscope");
@@ -946,6 +1293,7 @@ euroc_player_fill_default_config_for(struct euroc_player_config *config, const c
 	playback.use_source_ts = debug_get_bool_option_use_source_ts();
 	playback.play_from_start = debug_get_bool_option_play_from_start();
 	playback.print_progress = debug_get_bool_option_print_progress();
+	playback.prefetch_count = (int)debug_get_num_option_prefetch_count();
 
 	config->log_level = debug_get_log_option_euroc_log();
 	config->dataset = dataset;
@@ -991,6 +1339,11 @@ euroc_player_create(struct xrt_frame_context *xfctx, const char *path, struct eu
 	ep->imus = new imu_samples{};
 	ep->imgs = new vector<img_samples>(ep->dataset.cam_count);
 
+	// Not a container if it's a folder, played from the folder then.
+	if (t_euroc_container_open(ep->dataset.path, &ep->container)) {
+		EUROC_INFO(ep, "Playing from a capture container");
+	}
+
 	euroc_player_setup_gui(ep);
 
 	EUROC_ASSERT(receive_cam[ARRAY_SIZE(receive_cam) - 1] != nullptr, "See `receive_cam` docs");
@@ -158,6 +158,17 @@ rift_s_compute_distortion(struct xrt_device *xdev, uint32_t view, float u, float
 	return u_compute_distortion_panotools(&hmd->distortion_vals[view], u, v, result);
 }
 
+static bool
+rift_s_compute_distortion_batch(struct xrt_device *xdev,
+                                uint32_t view,
+                                uint32_t count,
+                                const struct xrt_vec2 *uvs,
+                                struct xrt_uv_triplet *results)
+{
+	struct rift_s_hmd *hmd = (struct rift_s_hmd *)(xdev);
+	return u_compute_distortion_panotools_batch(&hmd->distortion_vals[view], count, uvs, results);
+}
+
 #if 0
 static int
 dump_fw_block(struct os_hid_device *handle, uint8_t block_id) {
@@ -318,6 +329,7 @@ rift_s_hmd_create(struct rift_s_system *sys, const unsigned char *hmd_serial_no,
 	hmd->base.hmd->distortion.models = XRT_DISTORTION_MODEL_COMPUTE;
 	hmd->base.hmd->distortion.preferred = XRT_DISTORTION_MODEL_COMPUTE;
 	hmd->base.compute_distortion = rift_s_compute_distortion;
+	hmd->base.compute_distortion_batch = rift_s_compute_distortion_batch;
 	u_distortion_mesh_fill_in_compute(&hmd->base);
 
 	/* Set Opaque blend mode */
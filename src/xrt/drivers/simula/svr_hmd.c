@@ -14,6 +14,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
 
 #include "svr_interface.h"
 
@@ -34,11 +38,22 @@
 #include "util/u_time.h"
 #include "util/u_json.h"
 #include "util/u_misc.h"
+#include "util/u_file.h"
 #include "util/u_logging.h"
 #include "util/u_distortion_mesh.h"
 
 
 DEBUG_GET_ONCE_LOG_OPTION(svr_log, "SIMULA_LOG", U_LOGGING_INFO)
+DEBUG_GET_ONCE_BOOL_OPTION(svr_mesh_cache, "SIMULA_MESH_CACHE", true)
+
+//! Bump when the mesh generation or the cache file layout changes.
+#define SVR_MESH_CACHE_VERSION 1
+
+//! Magic at the start of cache files, "SVRM".
+#define SVR_MESH_CACHE_MAGIC 0x4d525653
+
+//! Samples evaluated at once, sized so the temporaries stay in registers/L1.
+#define SVR_BATCH_SIZE 64
 
 #define SVR_TRACE(d, ...) U_LOG_XDEV_IFL_T(&d->base, d->log_level, __VA_ARGS__)
 #define SVR_DEBUG(d, ...) U_LOG_XDEV_IFL_D(&d->base, d->log_level, __VA_ARGS__)
@@ -46,12 +61,31 @@ DEBUG_GET_ONCE_LOG_OPTION(svr_log, "SIMULA_LOG", U_LOGGING_INFO)
 #define SVR_WARN(d, ...) U_LOG_XDEV_IFL_W(&d->base, d->log_level, __VA_ARGS__)
 #define SVR_ERROR(d, ...) U_LOG_XDEV_IFL_E(&d->base, d->log_level, __VA_ARGS__)
 
+/*!
+ * Per view constants of the distortion model, everything that doesn't depend
+ * on the sample position is computed once here.
+ */
+struct svr_view_constants
+{
+	//! Display size in mm, converts uv to display coordinates.
+	struct xrt_vec2 display_size_mm;
+
+	//! Converts tan angles to texture coordinates: 1 / (2 * tan(fov / 2)).
+	float tan_to_tc_x;
+	float tan_to_tc_y;
+
+	//! Polynomial coefficients k1, k3, k5, k7, k9 for r, g and b.
+	float k[3][5];
+};
+
 struct svr_hmd
 {
 	struct xrt_device base;
 
 	struct svr_two_displays_distortion distortion;
 
+	struct svr_view_constants view_constants[2];
+
 	enum u_logging_level log_level;
 };
 
@@ -125,82 +159,300 @@ svr_hmd_get_view_poses(struct xrt_device *xdev,
 	}
 }
 
+/*
+ *
+ * Distortion.
+ *
+ */
+
+static void
+svr_view_constants_init(struct svr_view_constants *c, const struct svr_one_display_distortion *dist)
+{
+	/* Field of view aspect ratio (fovH/fovV), equals to 1 if fovH = fovV */
+	const float aspect = 1.0f;
+
+	/* Half of the horizontal field of view (in radians) fovH/2 */
+	const float tan_half_fov = tanf(dist->half_fov);
+
+	// Note for people expecting everything to be in meters: no, really, this is millimeters.
+	c->display_size_mm = dist->display_size_mm;
+	c->tan_to_tc_x = 1.0f / (2.0f * tan_half_fov);
+	c->tan_to_tc_y = aspect / (2.0f * tan_half_fov);
+
+	const struct svr_display_distortion_polynomial_values *channels[3] = {&dist->red, &dist->green, &dist->blue};
+	for (int i = 0; i < 3; i++) {
+		c->k[i][0] = channels[i]->k1;
+		c->k[i][1] = channels[i]->k3;
+		c->k[i][2] = channels[i]->k5;
+		c->k[i][3] = channels[i]->k7;
+		c->k[i][4] = channels[i]->k9;
+	}
+}
+
+/*!
+ * Evaluates the distortion for @p count samples. The model is a 9 degree odd
+ * polynomial of the radius in mm on the display:
+ *
+ *   k(r) = r * (k1 + k3 * r^2 + k5 * r^4 + k7 * r^6 + k9 * r^8)
+ *   tan(H), tan(V) = k(r) * (x, y) / r
+ *
+ * The r cancels out, so neither the square root nor the division are needed,
+ * which also takes care of the r = 0 case. The loops are kept branch free and
+ * over plain arrays so the compiler can vectorize them.
+ */
+static void
+svr_eval_batch(const struct svr_view_constants *c,
+               const struct xrt_vec2 *uvs,
+               uint32_t count,
+               struct xrt_uv_triplet *out_results)
+{
+	assert(count <= SVR_BATCH_SIZE);
+
+	float x[SVR_BATCH_SIZE];
+	float y[SVR_BATCH_SIZE];
+	float r2[SVR_BATCH_SIZE];
+	float tc_x[SVR_BATCH_SIZE];
+	float tc_y[SVR_BATCH_SIZE];
+
+	// Denormalization: from uv (origin at bottom left corner) to mm with (0, 0) at the center of the display.
+	for (uint32_t i = 0; i < count; i++) {
+		x[i] = c->display_size_mm.x * (uvs[i].x - 0.5f);
+		y[i] = c->display_size_mm.y * (uvs[i].y - 0.5f);
+		r2[i] = x[i] * x[i] + y[i] * y[i];
+	}
+
+	for (int ch = 0; ch < 3; ch++) {
+		const float k1 = c->k[ch][0];
+		const float k3 = c->k[ch][1];
+		const float k5 = c->k[ch][2];
+		const float k7 = c->k[ch][3];
+		const float k9 = c->k[ch][4];
+
+		for (uint32_t i = 0; i < count; i++) {
+			const float q = r2[i];
+			const float k_over_r = k1 + q * (k3 + q * (k5 + q * (k7 + q * k9)));
+
+			// Normalization: from (tan(H), tan(V)) to tc with origin at the bottom left corner.
+			tc_x[i] = k_over_r * x[i] * c->tan_to_tc_x + 0.5f;
+			tc_y[i] = k_over_r * y[i] * c->tan_to_tc_y + 0.5f;
+		}
+
+		// A triplet is three vec2s, so six floats per sample.
+		float *out = (float *)out_results + ch * 2;
+
+		for (uint32_t i = 0; i < count; i++) {
+			out[i * 6 + 0] = tc_x[i];
+			out[i * 6 + 1] = tc_y[i];
+		}
+	}
+}
+
 //!@todo: remove hard-coding and move to u_distortion_mesh
 bool
 svr_mesh_calc(struct xrt_device *xdev, uint32_t view, float u, float v, struct xrt_uv_triplet *result)
 {
 	struct svr_hmd *svr = svr_hmd(xdev);
 
-	struct svr_one_display_distortion *dist = &svr->distortion.views[view];
+	struct xrt_vec2 uv = {u, v};
+	svr_eval_batch(&svr->view_constants[view], &uv, 1, result);
 
-	struct svr_display_distortion_polynomial_values *distortion_channels[3] = {&dist->red, &dist->green,
-	                                                                           &dist->blue};
+	return true;
+}
 
+static bool
+svr_mesh_calc_batch(struct xrt_device *xdev,
+                    uint32_t view,
+                    uint32_t count,
+                    const struct xrt_vec2 *uvs,
+                    struct xrt_uv_triplet *results)
+{
+	struct svr_hmd *svr = svr_hmd(xdev);
 
-	// Somewhere at the program (constants definition)
-	/* Display size in mm */
-	// note for people expecting everything to be in meters: no, really, this is millimeters and we don't need a
-	// scaling factor
-	// float _DispDimsX = 51.7752;
-	// float _DispDimsY = 51.7752;
-	/* Half of the horizontal field of view (in radians) fovH/2 */
-	float _FoVh_2 = dist->half_fov;
-	/* Field of view aspect ratio (fovH/fovV), equals to 1 if fovH = fovV */
-	float _aspect = 1.0f;
+	for (uint32_t i = 0; i < count; i += SVR_BATCH_SIZE) {
+		svr_eval_batch(&svr->view_constants[view], uvs + i, MIN(SVR_BATCH_SIZE, count - i), results + i);
+	}
 
+	return true;
+}
 
-	// Results r/g/b.
-	struct xrt_vec2 tc[3] = {{0, 0}, {0, 0}, {0, 0}};
 
-	// Dear compiler, please vectorize.
-	for (int i = 0; i < 3; i++) {
+/*
+ *
+ * Mesh cache.
+ *
+ */
 
-		// Just before applying the polynomial (maybe before the loop or at the beginning of it)
-		// Denormalization: conversion from uv texture coordinates (origin at bottom left corner) to mm display
-		// coordinates
-		struct xrt_vec2 XoYo = {0, 0}; // Assuming (0,0) at the center of the display: -DispDimsX/2 <= XoYo.x <=
-		                               // DispDimsX/2; -DispDimsY <= XoYo.y <= DispDimsY
-		XoYo.x = dist->display_size_mm.x * (u - 0.5f);
-		XoYo.y = dist->display_size_mm.y * (v - 0.5f);
-
-		struct xrt_vec2 tanH_tanV = {
-		    0, 0}; // Resulting angular coordinates (tan(H), tan(V)) of input image corresponding to the
-		           // coordinates of the input texture whose color will be sampled
-
-		float r2 = m_vec2_dot(XoYo, XoYo);
-		float r = sqrtf(r2);
-
-		// 9 degree polynomial (only odd coefficients)
-		struct svr_display_distortion_polynomial_values *vals = distortion_channels[i];
-		float k1 = vals->k1;
-		float k3 = vals->k3;
-		float k5 = vals->k5;
-		float k7 = vals->k7;
-		float k9 = vals->k9;
-
-		float k = r * (k1 + r2 * (k3 + r2 * (k5 + r2 * (k7 + r2 * k9))));
-
-		// Avoid problems when r = 0
-		if (r > 0) {
-			tanH_tanV.x = (k * XoYo.x) / r;
-			tanH_tanV.y = (k * XoYo.y) / r;
-		} else {
-			tanH_tanV.x = 0;
-			tanH_tanV.y = 0;
-		}
+struct svr_mesh_cache_header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t num;
+	uint32_t float_count;
+	uint64_t params_hash;
+	uint64_t data_hash;
+};
+
+//! FNV-1a, good enough to tell parameter sets and truncated files apart.
+static uint64_t
+svr_hash(uint64_t hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static uint64_t
+svr_mesh_params_hash(struct svr_hmd *svr, uint32_t num)
+{
+	const uint32_t version = SVR_MESH_CACHE_VERSION;
+
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	hash = svr_hash(hash, &version, sizeof(version));
+	hash = svr_hash(hash, &num, sizeof(num));
+	hash = svr_hash(hash, &svr->distortion, sizeof(svr->distortion));
+	return hash;
+}
+
+static void
+svr_mesh_cache_filename(uint64_t params_hash, char *out, size_t size)
+{
+	snprintf(out, size, "simula_%016" PRIx64 ".bin", params_hash);
+}
 
-		// Normalization: Transformation from angular coordinates (tan(H), tan(V)) of input image to tc
-		// (normalized coordinates with origin at the bottom left corner)
-		tc[i].x = (tanH_tanV.x + tanf(_FoVh_2)) / (2 * tanf(_FoVh_2));
-		tc[i].y = ((tanH_tanV.y + tanf(_FoVh_2) / _aspect) / (2 * tanf(_FoVh_2))) * _aspect;
+static float *
+svr_mesh_cache_load(struct svr_hmd *svr, uint64_t params_hash, uint32_t num, size_t float_count)
+{
+	char filename[64];
+	svr_mesh_cache_filename(params_hash, filename, sizeof(filename));
 
-		// SVR_TRACE(svr, "Distortion %f %f -> %i %f %f", u, v, i, tc[i].x, tc[i].y);
+	FILE *file = u_file_open_file_in_config_dir_subpath("mesh_cache", filename, "rb");
+	if (file == NULL) {
+		SVR_DEBUG(svr, "No cached mesh '%s'", filename);
+		return NULL;
 	}
-	result->r = tc[0];
-	result->g = tc[1];
-	result->b = tc[2];
 
-	return true;
+	struct svr_mesh_cache_header header = {0};
+	float *verts = NULL;
+
+	if (fread(&header, sizeof(header), 1, file) != 1 ||   //
+	    header.magic != SVR_MESH_CACHE_MAGIC ||           //
+	    header.version != SVR_MESH_CACHE_VERSION ||       //
+	    header.num != num ||                              //
+	    header.float_count != float_count ||              //
+	    header.params_hash != params_hash) {              //
+		SVR_WARN(svr, "Ignoring mismatching cached mesh '%s'", filename);
+		goto out;
+	}
+
+	verts = U_TYPED_ARRAY_CALLOC(float, float_count);
+	if (fread(verts, sizeof(float), float_count, file) != float_count ||
+	    svr_hash(0xcbf29ce484222325ULL, verts, sizeof(float) * float_count) != header.data_hash) {
+		SVR_WARN(svr, "Ignoring truncated or corrupt cached mesh '%s'", filename);
+		free(verts);
+		verts = NULL;
+		goto out;
+	}
+
+	SVR_DEBUG(svr, "Loaded cached mesh '%s'", filename);
+
+out:
+	fclose(file);
+	return verts;
+}
+
+static void
+svr_mesh_cache_store(struct svr_hmd *svr, uint64_t params_hash, uint32_t num, const float *verts, size_t float_count)
+{
+	char filename[64];
+	svr_mesh_cache_filename(params_hash, filename, sizeof(filename));
+
+	/*
+	 * Written to a temporary file that is renamed over the real one once
+	 * complete, so a crash or another service writing at the same time
+	 * never leaves a half written cache file behind.
+	 */
+	char tmp_filename[96];
+	snprintf(tmp_filename, sizeof(tmp_filename), "%s.%d.tmp", filename, (int)getpid());
+
+	char path[PATH_MAX];
+	char tmp_path[PATH_MAX];
+	char subpath[128];
+	snprintf(subpath, sizeof(subpath), "mesh_cache/%s", filename);
+	ssize_t ret = u_file_get_path_in_config_dir(subpath, path, sizeof(path));
+	snprintf(subpath, sizeof(subpath), "mesh_cache/%s", tmp_filename);
+	ssize_t tmp_ret = u_file_get_path_in_config_dir(subpath, tmp_path, sizeof(tmp_path));
+	if (ret < 0 || ret >= (ssize_t)sizeof(path) || tmp_ret < 0 || tmp_ret >= (ssize_t)sizeof(tmp_path)) {
+		SVR_WARN(svr, "Could not get the path for the mesh cache '%s'", filename);
+		return;
+	}
+
+	FILE *file = u_file_open_file_in_config_dir_subpath("mesh_cache", tmp_filename, "wb");
+	if (file == NULL) {
+		SVR_WARN(svr, "Could not open '%s' for writing the mesh cache", tmp_filename);
+		return;
+	}
+
+	struct svr_mesh_cache_header header = {
+	    .magic = SVR_MESH_CACHE_MAGIC,
+	    .version = SVR_MESH_CACHE_VERSION,
+	    .num = num,
+	    .float_count = (uint32_t)float_count,
+	    .params_hash = params_hash,
+	    .data_hash = svr_hash(0xcbf29ce484222325ULL, verts, sizeof(float) * float_count),
+	};
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+	               fwrite(verts, sizeof(float), float_count, file) == float_count;
+
+	// Buffered data can still fail to be written out.
+	if (fclose(file) != 0) {
+		written = false;
+	}
+
+	if (!written) {
+		SVR_WARN(svr, "Failed to write the mesh cache '%s'", tmp_filename);
+		remove(tmp_path);
+		return;
+	}
+
+	if (rename(tmp_path, path) != 0) {
+		SVR_WARN(svr, "Failed to rename '%s' to '%s': %s", tmp_filename, filename, strerror(errno));
+		remove(tmp_path);
+		return;
+	}
+
+	SVR_DEBUG(svr, "Stored cached mesh '%s'", filename);
+}
+
+static void
+svr_mesh_fill_in(struct svr_hmd *svr)
+{
+	const uint32_t num = u_distortion_mesh_get_size();
+	const uint32_t vert_rows = num + 1;
+	const size_t float_count = (size_t)vert_rows * vert_rows * U_DISTORTION_MESH_STRIDE_IN_FLOATS * 2;
+	const bool use_cache = debug_get_bool_option_svr_mesh_cache();
+	const uint64_t params_hash = svr_mesh_params_hash(svr, num);
+
+	float *verts = NULL;
+	if (use_cache) {
+		verts = svr_mesh_cache_load(svr, params_hash, num, float_count);
+	}
+
+	if (verts != NULL) {
+		u_distortion_mesh_fill_in_vertices(&svr->base, verts, num);
+		return;
+	}
+
+	// Split over threads by u_distortion_mesh, svr_mesh_calc_batch does the math.
+	u_distortion_mesh_fill_in_compute_with_size(&svr->base, num);
+
+	const float *generated = svr->base.hmd->distortion.mesh.vertices;
+	if (use_cache && generated != NULL) {
+		svr_mesh_cache_store(svr, params_hash, num, generated, float_count);
+	}
 }
 
 
@@ -219,6 +471,9 @@ svr_hmd_create(struct svr_two_displays_distortion *distortion)
 
 	// Slow copy. Could refcount it but who cares, this runs once.
 	svr->distortion = *distortion;
+	for (int view = 0; view < 2; view++) {
+		svr_view_constants_init(&svr->view_constants[view], &svr->distortion.views[view]);
+	}
 
 	svr->log_level = debug_get_log_option_svr_log();
 
@@ -265,6 +520,7 @@ svr_hmd_create(struct svr_two_displays_distortion *distortion)
 	svr->base.hmd->distortion.models = XRT_DISTORTION_MODEL_COMPUTE;
 	svr->base.hmd->distortion.preferred = XRT_DISTORTION_MODEL_COMPUTE;
 	svr->base.compute_distortion = svr_mesh_calc;
+	svr->base.compute_distortion_batch = svr_mesh_calc_batch;
 
 	// Setup variable tracker.
 	u_var_add_root(svr, "Simula HMD", true);
@@ -284,7 +540,7 @@ svr_hmd_create(struct svr_two_displays_distortion *distortion)
 	uint64_t end;
 
 	start = os_monotonic_get_ns();
-	u_distortion_mesh_fill_in_compute(&svr->base);
+	svr_mesh_fill_in(svr);
 	end = os_monotonic_get_ns();
 
 	float diff = (end - start);
@@ -976,6 +976,29 @@ compute_distortion(struct xrt_device *xdev, uint32_t view, float u, float v, str
 	return status;
 }
 
+static bool
+compute_distortion_batch(struct xrt_device *xdev,
+                         uint32_t view,
+                         uint32_t count,
+                         const struct xrt_vec2 *uvs,
+                         struct xrt_uv_triplet *results)
+{
+	XRT_TRACE_MARKER();
+
+	struct vive_device *d = vive_device(xdev);
+	bool status = u_compute_distortion_vive_batch(&d->config.distortion.values[view], count, uvs, results);
+
+	if (d->config.variant == VIVE_VARIANT_PRO2) {
+		// Flip Y coordinates
+		for (uint32_t i = 0; i < count; i++) {
+			results[i].r.y = 1.0f - results[i].r.y;
+			results[i].g.y = 1.0f - results[i].g.y;
+			results[i].b.y = 1.0f - results[i].b.y;
+		}
+	}
+	return status;
+}
+
 void
 vive_set_trackers_status(struct vive_device *d, struct vive_tracking_status status)
 {
@@ -1092,6 +1115,7 @@ vive_device_create(struct os_hid_device *mainboard_dev,
 	d->base.hmd->distortion.models = XRT_DISTORTION_MODEL_COMPUTE;
 	d->base.hmd->distortion.preferred = XRT_DISTORTION_MODEL_COMPUTE;
 	d->base.compute_distortion = compute_distortion;
+	d->base.compute_distortion_batch = compute_distortion_batch;
 
 	if (d->mainboard_dev) {
 		vive_mainboard_power_on(d);
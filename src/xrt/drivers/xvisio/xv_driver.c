@@ -13,13 +13,17 @@
 #include "xrt/xrt_frameserver.h"
 
 #include "math/m_relation_history.h"
+#include "math/m_clock_offset.h"
 #include "math/m_api.h"
 #include "util/u_device.h"
 #include "util/u_logging.h"
 #include "util/u_debug.h"
+#include "util/u_time.h"
+#include "util/u_var.h"
 
 
 #include <stdio.h>
+#include <pthread.h>
 #include "os/os_time.h"
 
 #include "xv_interface.h"
@@ -31,6 +35,7 @@
 // #include <xvsdk.h>
 
 DEBUG_GET_ONCE_LOG_OPTION(xv_log, "XV_LOG", U_LOGGING_WARN)
+DEBUG_GET_ONCE_BOOL_OPTION(xv_orientation_only, "XV_ORIENTATION_ONLY", false)
 
 #define XV_TRACE(d, ...) U_LOG_IFL_T(d->log_level, __VA_ARGS__)
 #define XV_DEBUG(d, ...) U_LOG_IFL_D(d->log_level, __VA_ARGS__)
@@ -38,108 +43,197 @@ DEBUG_GET_ONCE_LOG_OPTION(xv_log, "XV_LOG", U_LOGGING_WARN)
 #define XV_WARN(d, ...) U_LOG_IFL_W(d->log_level, __VA_ARGS__)
 #define XV_ERROR(d, ...) U_LOG_IFL_E(d->log_level, __VA_ARGS__)
 
-//Using dirty global state so that the xvisio orientation callback has access to our xv_device.
-//There's probably a more elegant way of doing this...
-static struct xv_device *g_xv_device = NULL;
+//! Roughly how often the SDK calls us with a new pose, used to tune the clock offset filter.
+#define XV_POSE_FREQUENCY 500.0f
 
 struct xv_device
 {
 	struct xrt_device base;
 	enum u_logging_level log_level;
 	struct m_relation_history *relation_hist; //<- where all of the orientation data is jammed
+
+	//! Has this device started the SDK, and so has to stop it.
+	bool sdk_started;
+
+	//! Filtered offset from the SDK host clock to our monotonic clock.
+	time_duration_ns hw2mono;
+
+	struct
+	{
+		//! Offset as a float, for the debug UI.
+		float hw2mono_ms;
+
+		//! Time from the sample to the callback being called, last sample.
+		float latency_ms;
+
+		//! Samples where the SDK didn't give us a timestamp.
+		int32_t missing_timestamps;
+	} stats;
 };
 
-//Jams XR50 orientation data into the g_xv_device->relation_hist, so monado has access to it.
+/*!
+ * Convert the SDK host timestamp (in seconds) of a sample into our monotonic
+ * clock, smoothing out the jitter of when the SDK gets around to calling us.
+ * Falls back to the callback time if the sample has no timestamp.
+ */
+static timepoint_ns
+xv_sample_time_to_mono(struct xv_device *xv, double host_timestamp_s)
+{
+	timepoint_ns now_ns = (timepoint_ns)os_monotonic_get_ns();
+
+	if (host_timestamp_s <= 0.0) {
+		xv->stats.missing_timestamps++;
+		return now_ns;
+	}
+
+	timepoint_ns host_ns = time_s_to_ns(host_timestamp_s);
+	timepoint_ns sample_ns = m_clock_offset_a2b(XV_POSE_FREQUENCY, host_ns, now_ns, &xv->hw2mono);
+
+	// Never claim a sample from the future.
+	if (sample_ns > now_ns) {
+		sample_ns = now_ns;
+	}
+
+	xv->stats.hw2mono_ms = time_ns_to_ms_f(xv->hw2mono);
+	xv->stats.latency_ms = time_ns_to_ms_f(now_ns - sample_ns);
+
+	return sample_ns;
+}
+
+//Jams XR50 orientation data into the device's relation_hist, so monado has access to it.
 static void
-xv_orientation_callback(const C_Orientation* orientation)
+xv_handle_orientation(struct xv_device *xv, const C_Orientation *orientation)
 {
-    if (g_xv_device == NULL) {
-	printf("g_xv_device is NULL so returning early from xv_orientation_callback\n");
-	//snprintf(xdev->serial, XRT_DEVICE_NAME_LEN, "g_xv_device is NULL so returning early from xv_orientation_callback (printf)");
-        return;
-    }
-
-    struct xrt_space_relation relation = {0};
-
-    //Since the XR50 only provides orientation data...
-    relation.pose.orientation.x = orientation->quaternion[0];
-    relation.pose.orientation.y = orientation->quaternion[1];
-    relation.pose.orientation.z = orientation->quaternion[2];
-    relation.pose.orientation.w = orientation->quaternion[3];
-
-    // ...we set position and velocities to zero.
-    relation.pose.position.x = 0;
-    relation.pose.position.y = 0;
-    relation.pose.position.z = 0;
-    relation.linear_velocity.x = 0;
-    relation.linear_velocity.y = 0;
-    relation.linear_velocity.z = 0;
-    relation.angular_velocity.x = 0;
-    relation.angular_velocity.y = 0;
-    relation.angular_velocity.z = 0;
-
-    relation.relation_flags = XRT_SPACE_RELATION_ORIENTATION_VALID_BIT |
-                              XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT;
-
-    //Then push to the relation history
-    uint64_t timestamp_ns = os_monotonic_get_ns();
-    m_relation_history_push(g_xv_device->relation_hist, &relation, timestamp_ns);
+	struct xrt_space_relation relation = {0};
+
+	//Since the XR50 only provides orientation data...
+	relation.pose.orientation.x = orientation->quaternion[0];
+	relation.pose.orientation.y = orientation->quaternion[1];
+	relation.pose.orientation.z = orientation->quaternion[2];
+	relation.pose.orientation.w = orientation->quaternion[3];
+
+	// ...position and velocities are left at zero.
+	relation.relation_flags = XRT_SPACE_RELATION_ORIENTATION_VALID_BIT |
+	                          XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT;
+
+	//Then push to the relation history
+	timepoint_ns timestamp_ns = xv_sample_time_to_mono(xv, orientation->hostTimestamp);
+	m_relation_history_push(xv->relation_hist, &relation, timestamp_ns);
 }
 
-//6dof version of the xv_orientation_callback
+//6dof version of xv_handle_orientation
 static void
-xv_pose_callback(const C_Pose* pose)
+xv_handle_pose(struct xv_device *xv, const C_Pose *pose)
 {
-    //Print 6dof data for debugging purposes
-    /*
-    XV_DEBUG(g_xv_device, "xv_pose_callback fired with pose: p=(%f,%f,%f), q=(%f,%f,%f,%f), conf=%f",
-             pose->position[0], pose->position[1], pose->position[2],
-             pose->quaternion[0], pose->quaternion[1], pose->quaternion[2], pose->quaternion[3],
-             pose->confidence);
-
-	printf("xv_pose_callback: Received pose timestamp=%f\n", pose->hostTimestamp);
-    */
-
-
-    if (g_xv_device == NULL) {
-	printf("g_xv_device is NULL so returning early from xv_pose_callback");
-        return;
-    }
-
-    struct xrt_space_relation relation = {0};
-
-    // Set orientation (quaternion)
-    relation.pose.orientation.x = pose->quaternion[0];
-    relation.pose.orientation.y = pose->quaternion[1];
-    relation.pose.orientation.z = pose->quaternion[2];
-    relation.pose.orientation.w = pose->quaternion[3];
-
-    // Set position (translation)
-    relation.pose.position.x = pose->position[0];
-    relation.pose.position.y = pose->position[1];
-    relation.pose.position.z = pose->position[2];
-
-    // Set velocities
-    relation.linear_velocity.x = pose->linearVelocity[0];
-    relation.linear_velocity.y = pose->linearVelocity[1];
-    relation.linear_velocity.z = pose->linearVelocity[2];
-
-    relation.angular_velocity.x = pose->angularVelocity[0];
-    relation.angular_velocity.y = pose->angularVelocity[1];
-    relation.angular_velocity.z = pose->angularVelocity[2];
-
-    // Update flags to indicate we have full tracking
-    relation.relation_flags =
-        XRT_SPACE_RELATION_ORIENTATION_VALID_BIT |
-        XRT_SPACE_RELATION_POSITION_VALID_BIT |
-        XRT_SPACE_RELATION_LINEAR_VELOCITY_VALID_BIT |
-        XRT_SPACE_RELATION_ANGULAR_VELOCITY_VALID_BIT |
-        XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT |
-        XRT_SPACE_RELATION_POSITION_TRACKED_BIT;
-
-    uint64_t timestamp_ns = os_monotonic_get_ns();
-
-    m_relation_history_push(g_xv_device->relation_hist, &relation, timestamp_ns);
+	XV_TRACE(xv, "Pose: p=(%f,%f,%f), q=(%f,%f,%f,%f), conf=%f, t=%f",       //
+	         pose->position[0], pose->position[1], pose->position[2],         //
+	         pose->quaternion[0], pose->quaternion[1], pose->quaternion[2],   //
+	         pose->quaternion[3], pose->confidence, pose->hostTimestamp);     //
+
+	struct xrt_space_relation relation = {0};
+
+	// Set orientation (quaternion)
+	relation.pose.orientation.x = pose->quaternion[0];
+	relation.pose.orientation.y = pose->quaternion[1];
+	relation.pose.orientation.z = pose->quaternion[2];
+	relation.pose.orientation.w = pose->quaternion[3];
+
+	// Set position (translation)
+	relation.pose.position.x = pose->position[0];
+	relation.pose.position.y = pose->position[1];
+	relation.pose.position.z = pose->position[2];
+
+	// Set velocities
+	relation.linear_velocity.x = pose->linearVelocity[0];
+	relation.linear_velocity.y = pose->linearVelocity[1];
+	relation.linear_velocity.z = pose->linearVelocity[2];
+
+	relation.angular_velocity.x = pose->angularVelocity[0];
+	relation.angular_velocity.y = pose->angularVelocity[1];
+	relation.angular_velocity.z = pose->angularVelocity[2];
+
+	// Update flags to indicate we have full tracking
+	relation.relation_flags = XRT_SPACE_RELATION_ORIENTATION_VALID_BIT |       //
+	                          XRT_SPACE_RELATION_POSITION_VALID_BIT |          //
+	                          XRT_SPACE_RELATION_LINEAR_VELOCITY_VALID_BIT |   //
+	                          XRT_SPACE_RELATION_ANGULAR_VELOCITY_VALID_BIT |  //
+	                          XRT_SPACE_RELATION_ORIENTATION_TRACKED_BIT |     //
+	                          XRT_SPACE_RELATION_POSITION_TRACKED_BIT;         //
+
+	timepoint_ns timestamp_ns = xv_sample_time_to_mono(xv, pose->hostTimestamp);
+
+	m_relation_history_push(xv->relation_hist, &relation, timestamp_ns);
+}
+
+
+/*
+ *
+ * Callback routing.
+ *
+ */
+
+/*!
+ * The C wrapper starts "the" device and its callbacks carry neither a device
+ * selector nor user data, so there can only be one device. The lock is held
+ * while a callback uses the device, so once the device has been detached no
+ * callback can touch it anymore, even if the SDK is still delivering.
+ *
+ * @todo Route per device once the wrapper can select a device and pass a
+ * context pointer to its callbacks.
+ */
+static struct
+{
+	pthread_mutex_t mutex;
+	struct xv_device *device;
+} g_route = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static void
+xv_orientation_callback(const C_Orientation *orientation)
+{
+	pthread_mutex_lock(&g_route.mutex);
+	if (g_route.device != NULL) {
+		xv_handle_orientation(g_route.device, orientation);
+	}
+	pthread_mutex_unlock(&g_route.mutex);
+}
+
+static void
+xv_pose_callback(const C_Pose *pose)
+{
+	pthread_mutex_lock(&g_route.mutex);
+	if (g_route.device != NULL) {
+		xv_handle_pose(g_route.device, pose);
+	}
+	pthread_mutex_unlock(&g_route.mutex);
+}
+
+//! Returns false if there already is a device.
+static bool
+xv_route_attach(struct xv_device *xv)
+{
+	bool attached = false;
+
+	pthread_mutex_lock(&g_route.mutex);
+	if (g_route.device == NULL) {
+		g_route.device = xv;
+		attached = true;
+	}
+	pthread_mutex_unlock(&g_route.mutex);
+
+	return attached;
+}
+
+//! After this returns no callback is using, or will use, the device.
+static void
+xv_route_detach(struct xv_device *xv)
+{
+	pthread_mutex_lock(&g_route.mutex);
+	if (g_route.device == xv) {
+		g_route.device = NULL;
+	}
+	pthread_mutex_unlock(&g_route.mutex);
 }
 
 static inline struct xv_device *
@@ -153,11 +247,16 @@ xv_device_destroy(struct xrt_device *xdev)
 {
 	struct xv_device *xv = xv_device(xdev);
 
-	m_relation_history_destroy(&xv->relation_hist);
+	u_var_remove_root(xv);
+
+	// Stop routing callbacks here, waits for any in flight one to finish.
+	xv_route_detach(xv);
 
-	xv_cleanup();
+	if (xv->sdk_started) {
+		xv_cleanup();
+	}
 
-	g_xv_device = NULL;
+	m_relation_history_destroy(&xv->relation_hist);
 
 	u_device_free(xdev);
 }
@@ -200,18 +299,37 @@ xv_create_tracked_device_internal_slam(void)
 
 	m_relation_history_create(&xv->relation_hist);
 
-    const char* device_id = xv_init_and_start_slam(xv_pose_callback);
-    //const char* device_id = xv_init_and_start_imu(xv_orientation_callback); //uncomment for just orientation tracking
+	// Before starting, so no samples are lost.
+	if (!xv_route_attach(xv)) {
+		XV_ERROR(xv, "Only one Xvisio device is supported at a time");
+		xv_device_destroy(xdev);
+		return NULL;
+	}
+
+	const char *device_id = NULL;
+	if (debug_get_bool_option_xv_orientation_only()) {
+		device_id = xv_init_and_start_imu(xv_orientation_callback);
+	} else {
+		device_id = xv_init_and_start_slam(xv_pose_callback);
+	}
+
+	if (device_id == NULL) {
+		XV_ERROR(xv, "Failed to initialize Xvisio device");
+		xv_device_destroy(xdev);
+		return NULL;
+	}
+
+	xv->sdk_started = true;
 
-    if (device_id == NULL) {
-        XV_ERROR(xv, "Failed to initialize Xvisio device");
-        xv_device_destroy(xdev);
-        return NULL;
-    }
+	XV_DEBUG(xv, "Xvisio device created with ID: %s", device_id);
 
-    XV_DEBUG(xv, "Xvisio device created with ID: %s", device_id);
+	snprintf(xdev->serial, XRT_DEVICE_NAME_LEN, "%s", device_id);
 
-    g_xv_device = xv;
+	u_var_add_root(xv, "Xvisio SeerSense XR50", true);
+	u_var_add_log_level(xv, &xv->log_level, "Log level");
+	u_var_add_ro_f32(xv, &xv->stats.hw2mono_ms, "Host to monotonic offset (ms)");
+	u_var_add_ro_f32(xv, &xv->stats.latency_ms, "Sample to callback latency (ms)");
+	u_var_add_ro_i32(xv, &xv->stats.missing_timestamps, "Samples without timestamp");
 
-    return xdev;
+	return xdev;
 }
@@ -35,7 +35,8 @@ struct xrt_auto_prober *
 xv_create_auto_prober(void);
 
 /*!
- * Creates an xrt_device that exposes the tracking of a Xvisio device
+ * Creates an xrt_device that exposes the tracking of a Xvisio device, only one
+ * may be alive at a time as the SDK wrapper has no way to select a device.
  * @return An xrt_device that you can call get_tracked_pose on with XRT_INPUT_GENERIC_TRACKER_POSE
  */
 struct xrt_device *
@@ -458,6 +458,30 @@ struct xrt_device
 	bool (*compute_distortion)(
 	    struct xrt_device *xdev, uint32_t view, float u, float v, struct xrt_uv_triplet *out_result);
 
+	/*!
+	 * Compute the distortion for many points at once, optional.
+	 *
+	 * Same as @ref compute_distortion but for @p count points, lets the
+	 * device hoist per view work out of the loop and the compiler
+	 * vectorize it. Mesh generation splits the points of a view into
+	 * chunks and calls this from multiple threads at the same time, so it
+	 * must not modify the device.
+	 *
+	 * If not implemented @ref xrt_device_compute_distortion_batch falls
+	 * back to calling @ref compute_distortion for each point.
+	 *
+	 * @param xdev             the device
+	 * @param view             the view index
+	 * @param count            number of points
+	 * @param uvs              @p count u,v coordinates in screen/output space
+	 * @param[out] out_results @p count u,v triplets, one per input point.
+	 */
+	bool (*compute_distortion_batch)(struct xrt_device *xdev,
+	                                 uint32_t view,
+	                                 uint32_t count,
+	                                 const struct xrt_vec2 *uvs,
+	                                 struct xrt_uv_triplet *out_results);
+
 	/*!
 	 * Get the visibility mask for this device.
 	 *
@@ -654,6 +678,34 @@ xrt_device_compute_distortion(
 	return xdev->compute_distortion(xdev, view, u, v, out_result);
 }
 
+/*!
+ * Helper function for @ref xrt_device::compute_distortion_batch, falls back
+ * to calling @ref xrt_device::compute_distortion for each point.
+ *
+ * @copydoc xrt_device::compute_distortion_batch
+ *
+ * @public @memberof xrt_device
+ */
+static inline bool
+xrt_device_compute_distortion_batch(struct xrt_device *xdev,
+                                    uint32_t view,
+                                    uint32_t count,
+                                    const struct xrt_vec2 *uvs,
+                                    struct xrt_uv_triplet *out_results)
+{
+	if (xdev->compute_distortion_batch != NULL) {
+		return xdev->compute_distortion_batch(xdev, view, count, uvs, out_results);
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (!xdev->compute_distortion(xdev, view, uvs[i].x, uvs[i].y, &out_results[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 /*!
  * Helper function for @ref xrt_device::get_visibility_mask.
  *
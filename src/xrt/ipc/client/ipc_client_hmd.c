@@ -117,6 +117,84 @@ out:
 	ipc_client_connection_unlock(ipc_c);
 }
 
+/*!
+ * Fetches the whole distortion mesh from the service in a single call, this
+ * avoids doing one round-trip per sample through compute_distortion.
+ */
+static bool
+call_get_distortion_mesh(ipc_client_hmd_t *ich)
+{
+	struct ipc_connection *ipc_c = ich->ipc_c;
+	struct xrt_hmd_parts *hmd = ich->base.hmd;
+	struct ipc_distortion_mesh_info info = {0};
+	float *vertices = NULL;
+	int *indices = NULL;
+	xrt_result_t xret;
+
+	ipc_client_connection_lock(ipc_c);
+
+	xret = ipc_send_device_get_distortion_mesh_locked(ipc_c, ich->device_id);
+	IPC_CHK_WITH_GOTO(ipc_c, xret, "ipc_send_device_get_distortion_mesh_locked", err_unlock);
+
+	xret = ipc_receive_device_get_distortion_mesh_locked(ipc_c, &info);
+	IPC_CHK_WITH_GOTO(ipc_c, xret, "ipc_receive_device_get_distortion_mesh_locked", err_unlock);
+
+	/*
+	 * The service only sends vertex and index data if none of these are
+	 * zero, it zeroes the whole info otherwise, so nothing more to read.
+	 */
+	if (info.vertex_count == 0 || info.stride == 0 || info.index_count_total == 0) {
+		goto err_unlock;
+	}
+
+	// Stride is in bytes, always a whole number of floats.
+	size_t vertices_size = (size_t)info.vertex_count * info.stride;
+	size_t indices_size = sizeof(int) * info.index_count_total;
+	vertices = U_TYPED_ARRAY_CALLOC(float, vertices_size / sizeof(float));
+	indices = U_TYPED_ARRAY_CALLOC(int, info.index_count_total);
+	if (vertices == NULL || indices == NULL) {
+		IPC_ERROR(ipc_c, "Failed to allocate distortion mesh");
+
+		// Keep the channel in sync, the data is still coming.
+		xret = ipc_receive_discard(&ipc_c->imc, vertices_size);
+		IPC_CHK_WITH_GOTO(ipc_c, xret, "ipc_receive_discard(vertices)", err_free);
+		xret = ipc_receive_discard(&ipc_c->imc, indices_size);
+		IPC_CHK_WITH_GOTO(ipc_c, xret, "ipc_receive_discard(indices)", err_free);
+
+		goto err_free;
+	}
+
+	xret = ipc_receive(&ipc_c->imc, vertices, vertices_size);
+	IPC_CHK_WITH_GOTO(ipc_c, xret, "ipc_receive(vertices)", err_free);
+
+	xret = ipc_receive(&ipc_c->imc, indices, indices_size);
+	IPC_CHK_WITH_GOTO(ipc_c, xret, "ipc_receive(indices)", err_free);
+
+	ipc_client_connection_unlock(ipc_c);
+
+	hmd->distortion.models = info.models;
+	hmd->distortion.preferred = info.preferred;
+	hmd->distortion.mesh.vertices = vertices;
+	hmd->distortion.mesh.vertex_count = info.vertex_count;
+	hmd->distortion.mesh.stride = info.stride;
+	hmd->distortion.mesh.uv_channels_count = info.uv_channels_count;
+	hmd->distortion.mesh.indices = indices;
+	hmd->distortion.mesh.index_count_total = info.index_count_total;
+	for (uint32_t i = 0; i < XRT_MAX_VIEWS; i++) {
+		hmd->distortion.mesh.index_counts[i] = info.index_counts[i];
+		hmd->distortion.mesh.index_offsets[i] = info.index_offsets[i];
+	}
+
+	return true;
+
+err_free:
+	free(vertices);
+	free(indices);
+err_unlock:
+	ipc_client_connection_unlock(ipc_c);
+	return false;
+}
+
 
 /*
  *
@@ -360,8 +438,10 @@ ipc_client_hmd_create(struct ipc_connection *ipc_c, struct xrt_tracking_origin *
 		ich->base.hmd->views[i].display.h_pixels = ipc_c->ism->hmd.views[i].display.h_pixels;
 	}
 
-	// Distortion information, fills in xdev->compute_distortion().
-	u_distortion_mesh_set_none(&ich->base);
+	// Distortion information, get the service's mesh in one go or fill in xdev->compute_distortion().
+	if (!call_get_distortion_mesh(ich)) {
+		u_distortion_mesh_set_none(&ich->base);
+	}
 
 	// Setup variable tracker.
 	u_var_add_root(ich, ich->base.str, true);
@@ -2024,6 +2024,65 @@ ipc_handle_device_compute_distortion(volatile struct ipc_client_state *ics,
 	return XRT_SUCCESS;
 }
 
+xrt_result_t
+ipc_handle_device_get_distortion_mesh(volatile struct ipc_client_state *ics, uint32_t id)
+{
+	struct ipc_message_channel *imc = (struct ipc_message_channel *)&ics->imc;
+	struct ipc_device_get_distortion_mesh_reply reply = XRT_STRUCT_INIT;
+	struct ipc_server *s = ics->server;
+	xrt_result_t xret;
+
+	// To make the code a bit more readable.
+	uint32_t device_id = id;
+	struct xrt_device *xdev = get_xdev(ics, device_id);
+	struct xrt_hmd_parts *hmd = xdev->hmd;
+
+	/*
+	 * Only send a mesh if there is one, the client falls back otherwise.
+	 * Empty meshes are not sent either, so the data that follows the reply
+	 * is never zero sized, the client checks the same counts.
+	 */
+	bool has_mesh = hmd != NULL && hmd->distortion.mesh.vertices != NULL && hmd->distortion.mesh.indices != NULL &&
+	                hmd->distortion.mesh.vertex_count > 0 && hmd->distortion.mesh.stride > 0 &&
+	                hmd->distortion.mesh.index_count_total > 0;
+	if (has_mesh) {
+		reply.info.models = hmd->distortion.models;
+		reply.info.preferred = hmd->distortion.preferred;
+		reply.info.vertex_count = hmd->distortion.mesh.vertex_count;
+		reply.info.stride = hmd->distortion.mesh.stride;
+		reply.info.uv_channels_count = hmd->distortion.mesh.uv_channels_count;
+		reply.info.index_count_total = hmd->distortion.mesh.index_count_total;
+		for (uint32_t i = 0; i < XRT_MAX_VIEWS; i++) {
+			reply.info.index_counts[i] = hmd->distortion.mesh.index_counts[i];
+			reply.info.index_offsets[i] = hmd->distortion.mesh.index_offsets[i];
+		}
+	}
+
+	xret = ipc_send(imc, &reply, sizeof(reply));
+	if (xret != XRT_SUCCESS) {
+		IPC_ERROR(s, "Failed to send reply");
+		return xret;
+	}
+
+	if (!has_mesh) {
+		return XRT_SUCCESS;
+	}
+
+	xret = ipc_send(imc, hmd->distortion.mesh.vertices, (size_t)reply.info.vertex_count * reply.info.stride);
+	if (xret != XRT_SUCCESS) {
+		IPC_ERROR(s, "Failed to send vertices");
+		return xret;
+	}
+
+	xret = ipc_send(imc, hmd->distortion.mesh.indices, sizeof(int) * reply.info.index_count_total);
+	if (xret != XRT_SUCCESS) {
+		IPC_ERROR(s, "Failed to send indices");
+		return xret;
+	}
+
+	return XRT_SUCCESS;
+}
+
 xrt_result_t
 ipc_handle_device_set_output(volatile struct ipc_client_state *ics,
                              uint32_t id,
@@ -166,29 +166,57 @@ client_loop(volatile struct ipc_client_state *ics)
 			break;
 		}
 
-		// Peek the first 4 bytes to get the command type
-		enum ipc_command cmd;
-		ssize_t len = recv(ics->imc.ipc_handle, &cmd, sizeof(cmd), MSG_PEEK);
-		if (len != sizeof(cmd)) {
-			IPC_ERROR(ics->server, "Invalid command received.");
+		/*
+		 * Read the whole command with one syscall. The client always
+		 * waits for the reply before sending anything else, so at most
+		 * one command is ever pending on the socket and a read sized to
+		 * the largest command can not run into the next one. Any extra
+		 * variable length data is read in the dispatch function.
+		 */
+		uint8_t buf[IPC_BUF_SIZE] = {0};
+		size_t len = 0;
+
+		xrt_result_t xret = ipc_receive_some((struct ipc_message_channel *)&ics->imc, buf, sizeof(buf), &len);
+		if (xret != XRT_SUCCESS) {
+			IPC_ERROR(ics->server, "Failed to receive command, disconnecting client.");
 			break;
 		}
 
-		size_t cmd_size = ipc_command_size(cmd);
-		if (cmd_size == 0) {
-			IPC_ERROR(ics->server, "Invalid command size.");
+		if (len == 0) {
+			IPC_INFO(ics->server, "Client disconnected.");
 			break;
 		}
 
-		// Read the whole command now that we know its size
-		uint8_t buf[IPC_BUF_SIZE] = {0};
+		// Very unlikely on a local socket, but the command can arrive in pieces.
+		if (len < sizeof(ipc_command_t)) {
+			xret = ipc_receive((struct ipc_message_channel *)&ics->imc, buf + len, sizeof(ipc_command_t) - len);
+			if (xret != XRT_SUCCESS) {
+				IPC_ERROR(ics->server, "Invalid command received.");
+				break;
+			}
+			len = sizeof(ipc_command_t);
+		}
 
-		len = recv(ics->imc.ipc_handle, &buf, cmd_size, 0);
-		if (len != (ssize_t)cmd_size) {
-			IPC_ERROR(ics->server, "Invalid packet received, disconnecting client.");
+		size_t cmd_size = ipc_command_size(*(ipc_command_t *)buf);
+		if (cmd_size == 0 || cmd_size > sizeof(buf)) {
+			IPC_ERROR(ics->server, "Invalid command size.");
+			break;
+		}
+
+		if (len > cmd_size) {
+			IPC_ERROR(ics->server, "Got %u bytes, expected %u, client broke lock-step, disconnecting.",
+			          (uint32_t)len, (uint32_t)cmd_size);
 			break;
 		}
 
+		if (len < cmd_size) {
+			xret = ipc_receive((struct ipc_message_channel *)&ics->imc, buf + len, cmd_size - len);
+			if (xret != XRT_SUCCESS) {
+				IPC_ERROR(ics->server, "Invalid packet received, disconnecting client.");
+				break;
+			}
+		}
+
 		// Check the first 4 bytes of the message and dispatch.
 		ipc_command_t *ipc_command = (ipc_command_t *)buf;
 
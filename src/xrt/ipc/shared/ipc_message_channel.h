@@ -72,6 +72,46 @@ ipc_send(struct ipc_message_channel *imc, const void *data, size_t size);
 xrt_result_t
 ipc_receive(struct ipc_message_channel *imc, void *out_data, size_t size);
 
+#ifdef XRT_OS_UNIX
+/*!
+ * Receive whatever is pending for one message with a single syscall.
+ *
+ * Unlike @ref ipc_receive the size of the message does not need to be known
+ * up front, this reads at most @p max_size bytes and reports how many bytes
+ * were actually read. Because the protocol is lock-step, the sender never
+ * has more than one command in flight, so a read into a buffer that is large
+ * enough for any command will not consume bytes from the next one. The caller
+ * is responsible for validating @p out_size and for reading any remainder if
+ * the message arrived in pieces.
+ *
+ * @param imc           Message channel to use
+ * @param[out] out_data Pointer to the buffer to fill with data. Must not be
+ *                      null.
+ * @param[in] max_size  Size of @p out_data, must be greater than 0
+ * @param[out] out_size Number of bytes read, zero if the other side closed
+ *                      the connection.
+ *
+ * @public @memberof ipc_message_channel
+ */
+xrt_result_t
+ipc_receive_some(struct ipc_message_channel *imc, void *out_data, size_t max_size, size_t *out_size);
+#endif // XRT_OS_UNIX
+
+/*!
+ * Read and throw away @p size bytes from the channel.
+ *
+ * Used when the receiver can not take the data that follows a reply, for
+ * instance when allocating the buffer for it failed, so that the channel
+ * stays in sync for the next call.
+ *
+ * @param imc      Message channel to use
+ * @param[in] size Number of bytes to discard, must be greater than 0
+ *
+ * @public @memberof ipc_message_channel
+ */
+xrt_result_t
+ipc_receive_discard(struct ipc_message_channel *imc, size_t size);
+
 /*!
  * @name File Descriptor or HANDLE utilities
  * @brief These are typically called from within the send/receive_handles
@@ -129,6 +129,59 @@ ipc_receive(struct ipc_message_channel *imc, void *out_data, size_t size)
 	return XRT_SUCCESS;
 }
 
+xrt_result_t
+ipc_receive_some(struct ipc_message_channel *imc, void *out_data, size_t max_size, size_t *out_size)
+{
+	assert(imc != NULL);
+	assert(out_data != NULL);
+	assert(max_size != 0);
+	assert(out_size != NULL);
+
+	ssize_t len = 0;
+	do {
+		len = recv(imc->ipc_handle, out_data, max_size, 0);
+	} while (len < 0 && errno == EINTR);
+
+	if (len < 0) {
+		int code = errno;
+		IPC_ERROR(imc, "recv(%i) failed: '%i' '%s'!", (int)imc->ipc_handle, code, strerror(code));
+		return XRT_ERROR_IPC_FAILURE;
+	}
+
+	// Zero means the other side did an orderly shutdown, let the caller decide.
+	*out_size = (size_t)len;
+
+	return XRT_SUCCESS;
+}
+
+xrt_result_t
+ipc_receive_discard(struct ipc_message_channel *imc, size_t size)
+{
+	assert(imc != NULL);
+	assert(size != 0);
+
+	uint8_t scratch[4096];
+
+	while (size > 0) {
+		size_t to_read = size < sizeof(scratch) ? size : sizeof(scratch);
+		size_t len = 0;
+
+		xrt_result_t xret = ipc_receive_some(imc, scratch, to_read, &len);
+		if (xret != XRT_SUCCESS) {
+			return xret;
+		}
+
+		if (len == 0) {
+			IPC_ERROR(imc, "Connection closed with %i bytes left to discard!", (int)size);
+			return XRT_ERROR_IPC_FAILURE;
+		}
+
+		size -= len;
+	}
+
+	return XRT_SUCCESS;
+}
+
 xrt_result_t
 ipc_receive_fds(struct ipc_message_channel *imc, void *out_data, size_t size, int *out_handles, uint32_t handle_count)
 {
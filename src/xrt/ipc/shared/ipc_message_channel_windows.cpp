@@ -127,6 +127,39 @@ ipc_receive(struct ipc_message_channel *imc, void *out_data, size_t size)
 	return XRT_SUCCESS;
 }
 
+xrt_result_t
+ipc_receive_discard(struct ipc_message_channel *imc, size_t size)
+{
+	assert(size != 0);
+
+	uint8_t scratch[4096];
+
+	while (size > 0) {
+		DWORD len = 0;
+		DWORD to_read = DWORD(size < sizeof(scratch) ? size : sizeof(scratch));
+
+		// A partial read of a message reports ERROR_MORE_DATA, keep going.
+		if (!ReadFile(imc->ipc_handle, scratch, to_read, &len, NULL)) {
+			DWORD err = GetLastError();
+			if (err != ERROR_MORE_DATA) {
+				IPC_ERROR(imc, "ReadFile from pipe %p failed: %d %s", imc->ipc_handle, err,
+				          ipc_winerror(err));
+				return XRT_ERROR_IPC_FAILURE;
+			}
+		}
+
+		if (len == 0) {
+			IPC_ERROR(imc, "Pipe %p returned no data with %i bytes left to discard", imc->ipc_handle,
+			          (int)size);
+			return XRT_ERROR_IPC_FAILURE;
+		}
+
+		size -= len;
+	}
+
+	return XRT_SUCCESS;
+}
+
 
 /*
  *
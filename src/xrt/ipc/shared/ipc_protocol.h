@@ -335,3 +335,29 @@ struct ipc_info_get_view_poses_2
 	struct xrt_pose poses[XRT_MAX_VIEWS];
 	struct xrt_space_relation head_relation;
 };
+
+/*!
+ * Layout of the distortion mesh of a device, the vertex and index data
+ * follows this reply on the channel, see @ref xrt_hmd_parts::distortion.
+ */
+struct ipc_distortion_mesh_info
+{
+	//! Same as xrt_hmd_parts::distortion::models.
+	enum xrt_distortion_model models;
+	//! Same as xrt_hmd_parts::distortion::preferred.
+	enum xrt_distortion_model preferred;
+
+	//! Number of vertices, zero if the device has no mesh.
+	uint32_t vertex_count;
+	//! Stride of vertices in bytes.
+	uint32_t stride;
+	//! 1 or 3 for (chromatic aberration).
+	uint32_t uv_channels_count;
+
+	//! Number of indices per view.
+	uint32_t index_counts[XRT_MAX_VIEWS];
+	//! Offsets for the indices per view.
+	uint32_t index_offsets[XRT_MAX_VIEWS];
+	//! Total number of indices sent.
+	uint32_t index_count_total;
+};
@@ -339,6 +339,8 @@ scene_render_select(struct gui_scene *scene, struct gui_program *p)
 	t_calibration_stereo_create(cs->xfctx, &cs->params, &cs->status, rgb, &cali);
 	u_sink_split_create(cs->xfctx, raw, cali, &cali);
 	u_sink_deinterleaver_create(cs->xfctx, cali, &cali);
+	// Both branches read the data, pack views once after the queue so dropped frames are never copied.
+	u_sink_sbs_pack_create(cs->xfctx, cali, &cali);
 	u_sink_simple_queue_create(cs->xfctx, cali, &cali);
 
 	// Just after the camera create a quirk stream.
@@ -355,7 +357,7 @@ scene_render_select(struct gui_scene *scene, struct gui_program *p)
 		struct xrt_frame_sink *tmp = cali;
 		struct xrt_slam_sinks sinks;
 		sinks.cam_count = 2;
-		u_sink_combiner_create(cs->xfctx, tmp, &sinks.cams[0], &sinks.cams[1]);
+		u_sink_combiner_create_views(cs->xfctx, tmp, &sinks.cams[0], &sinks.cams[1]);
 
 		xrt_fs_slam_stream_start(cs->xfs, &sinks);
 	} else {
@@ -1702,6 +1702,165 @@ oxr_clone_profiles_to_session(struct oxr_logger *log, struct oxr_instance *inst,
 	}
 }
 
+/*!
+ * Returns the bit for @p xdev in @ref oxr_action_set_attachment::xdev_mask.
+ */
+static uint32_t
+oxr_xdev_sync_bit(struct xrt_system_devices *xsysd, struct xrt_device *xdev)
+{
+	for (size_t i = 0; i < xsysd->xdev_count; i++) {
+		if (xsysd->xdevs[i] == xdev) {
+			return 1u << i;
+		}
+	}
+
+	// Not one of the system devices, update them all to be safe.
+	return UINT32_MAX;
+}
+
+void
+oxr_session_update_sync_index(struct oxr_session *sess)
+{
+	struct xrt_system_devices *xsysd = sess->sys->xsysd;
+
+	for (size_t i = 0; i < sess->action_set_attachment_count; i++) {
+		struct oxr_action_set_attachment *act_set_attached = &sess->act_set_attachments[i];
+		uint32_t mask = 0;
+
+		for (size_t k = 0; k < act_set_attached->action_attachment_count; k++) {
+			struct oxr_action_attachment *act_attached = &act_set_attached->act_attachments[k];
+
+#define ACCUMULATE_XDEVS(X)                                                                                            \
+	for (size_t n = 0; n < act_attached->X.input_count; n++) {                                                    \
+		mask |= oxr_xdev_sync_bit(xsysd, act_attached->X.inputs[n].xdev);                                      \
+	}                                                                                                              \
+	for (size_t n = 0; n < act_attached->X.output_count; n++) {                                                   \
+		mask |= oxr_xdev_sync_bit(xsysd, act_attached->X.outputs[n].xdev);                                     \
+	}
+			OXR_FOR_EACH_SUBACTION_PATH(ACCUMULATE_XDEVS)
+#undef ACCUMULATE_XDEVS
+		}
+
+		act_set_attached->xdev_mask = mask;
+	}
+
+	// The inputs have been replaced, nothing can be carried over.
+	sess->last_sync.valid = false;
+}
+
+/*!
+ * Is this sync requesting the same as the last one, in the same session state?
+ *
+ * @private @memberof oxr_session
+ */
+static bool
+oxr_session_sync_is_repeat(struct oxr_session *sess, uint32_t countActionSets, const XrActiveActionSet *actionSets)
+{
+	if (!sess->last_sync.valid || sess->last_sync.state != sess->state ||
+	    sess->last_sync.action_set_count != countActionSets) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < countActionSets; i++) {
+		if (sess->last_sync.action_sets[i].actionSet != actionSets[i].actionSet ||
+		    sess->last_sync.action_sets[i].subactionPath != actionSets[i].subactionPath) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*!
+ * @private @memberof oxr_session
+ */
+static void
+oxr_session_remember_sync(struct oxr_session *sess, uint32_t countActionSets, const XrActiveActionSet *actionSets)
+{
+	if (sess->last_sync.action_set_count != countActionSets) {
+		U_ARRAY_REALLOC_OR_FREE(sess->last_sync.action_sets, XrActiveActionSet, countActionSets);
+		sess->last_sync.action_set_count = countActionSets;
+	}
+
+	for (uint32_t i = 0; i < countActionSets; i++) {
+		sess->last_sync.action_sets[i] = actionSets[i];
+	}
+
+	sess->last_sync.state = sess->state;
+	sess->last_sync.valid = countActionSets == 0 || sess->last_sync.action_sets != NULL;
+}
+
+/*!
+ * Returns true if the input changed since it was last looked at, and
+ * remembers its current state.
+ */
+static bool
+oxr_action_input_refresh_synced(struct oxr_action_input *action_input)
+{
+	struct xrt_input *input = action_input->input;
+	struct xrt_input *dpad_activate = action_input->dpad_activate;
+
+	int64_t dpad_activate_timestamp = 0;
+	union xrt_input_value dpad_activate_value;
+	U_ZERO(&dpad_activate_value);
+	if (dpad_activate != NULL) {
+		dpad_activate_timestamp = dpad_activate->timestamp;
+		dpad_activate_value = dpad_activate->value;
+	}
+
+	// Some drivers change the value without touching the timestamp.
+	bool changed = action_input->synced.timestamp != input->timestamp ||
+	               action_input->synced.active != input->active ||
+	               memcmp(&action_input->synced.value, &input->value, sizeof(input->value)) != 0 ||
+	               action_input->synced.dpad_activate_timestamp != dpad_activate_timestamp ||
+	               memcmp(&action_input->synced.dpad_activate_value, &dpad_activate_value,
+	                      sizeof(dpad_activate_value)) != 0;
+
+	action_input->synced.timestamp = input->timestamp;
+	action_input->synced.value = input->value;
+	action_input->synced.active = input->active;
+	action_input->synced.dpad_activate_timestamp = dpad_activate_timestamp;
+	action_input->synced.dpad_activate_value = dpad_activate_value;
+
+	return changed;
+}
+
+/*!
+ * Returns true if any input of the action changed since the last sync.
+ *
+ * @private @memberof oxr_action_attachment
+ */
+static bool
+oxr_action_attachment_refresh_synced(struct oxr_action_attachment *act_attached)
+{
+	bool changed = false;
+
+#define REFRESH_INPUTS(X)                                                                                              \
+	for (size_t i = 0; i < act_attached->X.input_count; i++) {                                                    \
+		changed |= oxr_action_input_refresh_synced(&act_attached->X.inputs[i]);                                \
+	}
+	OXR_FOR_EACH_SUBACTION_PATH(REFRESH_INPUTS)
+#undef REFRESH_INPUTS
+
+	return changed;
+}
+
+/*!
+ * Recomputing the action from the same inputs would only clear the changed
+ * flags, so do just that.
+ *
+ * @private @memberof oxr_action_attachment
+ */
+static void
+oxr_action_attachment_mark_unchanged(struct oxr_action_attachment *act_attached)
+{
+#define MARK_UNCHANGED(X) act_attached->X.current.changed = false;
+	OXR_FOR_EACH_SUBACTION_PATH(MARK_UNCHANGED)
+#undef MARK_UNCHANGED
+
+	act_attached->any_state.changed = false;
+}
+
 XrResult
 oxr_session_attach_action_sets(struct oxr_logger *log,
                                struct oxr_session *sess,
@@ -1750,6 +1909,8 @@ oxr_session_attach_action_sets(struct oxr_logger *log,
 		}
 	}
 
+	oxr_session_update_sync_index(sess);
+
 #define POPULATE_PROFILE(X)                                                                                            \
 	sess->X = XR_NULL_PATH;                                                                                        \
 	if (profiles.X != NULL) {                                                                                      \
@@ -1775,6 +1936,8 @@ oxr_session_update_action_bindings(struct oxr_logger *log, struct oxr_session *s
 		}
 	}
 
+	oxr_session_update_sync_index(sess);
+
 #define POPULATE_PROFILE(X)                                                                                            \
 	sess->X = XR_NULL_PATH;                                                                                        \
 	if (profiles.X != NULL) {                                                                                      \
@@ -1810,9 +1973,17 @@ oxr_action_sync_data(struct oxr_logger *log,
 	// Synchronize outputs to this time.
 	int64_t now = time_state_get_now(sess->sys->inst->timekeeping);
 
-	// Loop over all xdev devices.
+	// Only the devices that the requested action sets are bound to.
+	uint32_t xdev_mask = 0;
+	for (uint32_t i = 0; i < countActionSets; i++) {
+		oxr_session_get_action_set_attachment(sess, actionSets[i].actionSet, &act_set_attached, &act_set);
+		xdev_mask |= act_set_attached->xdev_mask;
+	}
+
 	for (size_t i = 0; i < sess->sys->xsysd->xdev_count; i++) {
-		oxr_xdev_update(sess->sys->xsysd->xdevs[i]);
+		if ((xdev_mask & (1u << i)) != 0) {
+			oxr_xdev_update(sess->sys->xsysd->xdevs[i]);
+		}
 	}
 
 	// Reset all action set attachments.
@@ -1859,6 +2030,13 @@ oxr_action_sync_data(struct oxr_logger *log,
 		}
 	}
 
+	/*
+	 * With the same request as last time the suppression and selection of
+	 * inputs are the same, so an action only changes if its inputs have.
+	 * Outputs are always updated as they time out.
+	 */
+	bool repeat = oxr_session_sync_is_repeat(sess, countActionSets, actionSets);
+
 	// Now, update all action attachments
 	for (size_t i = 0; i < sess->action_set_attachment_count; ++i) {
 		act_set_attached = &sess->act_set_attachments[i];
@@ -1872,11 +2050,20 @@ oxr_action_sync_data(struct oxr_logger *log,
 				continue;
 			}
 
+			bool inputs_changed = oxr_action_attachment_refresh_synced(act_attached);
+			bool is_output = act_attached->act_ref->action_type == XR_ACTION_TYPE_VIBRATION_OUTPUT;
+			if (repeat && !inputs_changed && !is_output) {
+				oxr_action_attachment_mark_unchanged(act_attached);
+				continue;
+			}
+
 			oxr_action_attachment_update(log, sess, countActionSets, actionSets, act_attached, now,
 			                             subaction_paths);
 		}
 	}
 
+	oxr_session_remember_sync(sess, countActionSets, actionSets);
+
 	return oxr_session_success_focused_result(sess);
 }
 
@@ -482,6 +482,16 @@ oxr_session_attach_action_sets(struct oxr_logger *log,
 XrResult
 oxr_session_update_action_bindings(struct oxr_logger *log, struct oxr_session *sess);
 
+/*!
+ * Rebuilds which devices each attached action set is bound to, so that
+ * @ref oxr_action_sync_data only updates those. Called whenever the actions
+ * are bound.
+ *
+ * @public @memberof oxr_session
+ */
+void
+oxr_session_update_sync_index(struct oxr_session *sess);
+
 /*!
  * @public @memberof oxr_session
  */
@@ -1797,6 +1807,21 @@ struct oxr_session
 	 */
 	struct u_hashmap_int *act_attachments_by_key;
 
+	/*!
+	 * What the latest xrSyncActions requested, when the next one requests
+	 * the same only actions whose inputs changed are recomputed, see
+	 * @ref oxr_action_sync_data.
+	 */
+	struct
+	{
+		XrActiveActionSet *action_sets;
+		uint32_t action_set_count;
+		XrSessionState state;
+
+		//! Cleared when bindings change, forces a full recompute.
+		bool valid;
+	} last_sync;
+
 	/*!
 	 * Clone of all suggested binding profiles at the point of action set/session attachment.
 	 * @ref oxr_session_attach_action_sets
@@ -2076,6 +2101,12 @@ struct oxr_action_set_attachment
 	//! Which sub-action paths are requested on the latest sync.
 	struct oxr_subaction_paths requested_subaction_paths;
 
+	/*!
+	 * One bit per device in @ref xrt_system_devices::xdevs that any action
+	 * in this set is bound to, only those are updated when it's synced.
+	 */
+	uint32_t xdev_mask;
+
 	//! An array of action attachments we own.
 	struct oxr_action_attachment *act_attachments;
 
@@ -2139,6 +2170,19 @@ struct oxr_action_input
 	struct oxr_input_transform *transforms;
 	size_t transform_count;
 	XrPath bound_path;
+
+	/*!
+	 * The input as seen the last time the action was recomputed. Values are
+	 * kept too, as not all drivers update the timestamp with the value.
+	 */
+	struct
+	{
+		int64_t timestamp;
+		union xrt_input_value value;
+		int64_t dpad_activate_timestamp;
+		union xrt_input_value dpad_activate_value;
+		bool active;
+	} synced;
 };
 
 /*!
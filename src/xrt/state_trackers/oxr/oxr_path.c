@@ -11,7 +11,6 @@
 #include <string.h>
 #include <stdlib.h>
 
-#include "math/m_api.h"
 #include "util/u_misc.h"
 
 #include "oxr_objects.h"
@@ -107,9 +106,8 @@ oxr_allocate_path(
 	}
 	path->debug = OXR_XR_DEBUG_PATH;
 
-	// Setup the item.
+	// Setup the item, the hash is set when it's inserted.
 	item = get_item(path);
-	item->hash = math_hash_string(str, length);
 	item->length = length;
 
 	// Yes a const cast! D:
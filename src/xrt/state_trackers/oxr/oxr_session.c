@@ -822,6 +822,10 @@ oxr_session_destroy(struct oxr_logger *log, struct oxr_handle_base *hb)
 	sess->act_set_attachments = NULL;
 	sess->action_set_attachment_count = 0;
 
+	free(sess->last_sync.action_sets);
+	sess->last_sync.action_sets = NULL;
+	sess->last_sync.action_set_count = 0;
+
 	// If we tore everything down correctly, these are empty now.
 	assert(sess->act_sets_attachments_by_key == NULL || u_hashmap_int_empty(sess->act_sets_attachments_by_key));
 	assert(sess->act_attachments_by_key == NULL || u_hashmap_int_empty(sess->act_attachments_by_key));
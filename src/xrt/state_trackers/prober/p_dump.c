@@ -11,6 +11,7 @@
 #include "xrt/xrt_config_have.h"
 
 #include "util/u_misc.h"
+#include "util/u_time.h"
 #include "util/u_pretty_print.h"
 
 #include "p_prober.h"
@@ -167,3 +168,52 @@ p_dump_device(struct prober *p, struct prober_device *pdev, int id, bool use_std
 		U_LOG_RAW("%s", sink.buffer);
 	}
 }
+
+void
+p_dump_timings(struct prober *p, bool use_stdout)
+{
+	struct u_pp_sink_stack_only sink;
+	u_pp_delegate_t dg = u_pp_sink_stack_only_init(&sink);
+
+	struct prober_probe_timing *pt = &p->probe_timing;
+
+	PT("probe:             %.3fms", time_ns_to_ms_f(pt->total_ns));
+#ifdef XRT_HAVE_LIBUDEV
+	PTT("udev:             %.3fms (%u parsed, %u reused)", time_ns_to_ms_f(pt->udev_ns), pt->udev_parsed,
+	    pt->udev_reused);
+#endif
+#ifdef XRT_HAVE_LIBUSB
+	PTT("libusb:           %.3fms", time_ns_to_ms_f(pt->libusb_ns));
+#endif
+#ifdef XRT_HAVE_LIBUVC
+	PTT("libuvc:           %.3fms", time_ns_to_ms_f(pt->libuvc_ns));
+#endif
+#ifdef XRT_HAVE_LIBUDEV
+	if (p->hotplug.source != NULL) {
+		PT("hotplug:           %" PRIu64 " events, %" PRIu64 " devices", p->hotplug.event_count,
+		   p->hotplug.device_count);
+	}
+#endif
+
+	for (size_t i = 0; i < p->builder_count; i++) {
+		struct prober_builder_timing *bt = &p->builder_timings[i];
+		if (!bt->estimated && !bt->opened) {
+			continue;
+		}
+
+		PT("builder %s:", p->builders[i]->identifier);
+		if (bt->estimated) {
+			PTT("estimate:         %.3fms (head certain: %s, maybe: %s)", time_ns_to_ms_f(bt->estimate_ns),
+			    bt->estimate.certain.head ? "yes" : "no", bt->estimate.maybe.head ? "yes" : "no");
+		}
+		if (bt->opened) {
+			PTT("open:             %.3fms", time_ns_to_ms_f(bt->open_ns));
+		}
+	}
+
+	if (use_stdout) {
+		printf("%s", sink.buffer);
+	} else {
+		U_LOG_RAW("%s", sink.buffer);
+	}
+}
@@ -94,6 +94,71 @@ p_libusb_probe(struct prober *p)
 	return 0;
 }
 
+//! The libusb device at the same bus and address as @p pdev, if any.
+static libusb_device *
+p_libusb_find(libusb_device **list, ssize_t count, struct prober_device *pdev)
+{
+	for (ssize_t i = 0; i < count; i++) {
+		if (libusb_get_bus_number(list[i]) == pdev->usb.bus &&
+		    libusb_get_device_address(list[i]) == pdev->usb.addr) {
+			return list[i];
+		}
+	}
+
+	return NULL;
+}
+
+int
+p_libusb_refresh(struct prober *p, bool allow_missing)
+{
+	libusb_device **list = NULL;
+	ssize_t count = libusb_get_device_list(p->usb.ctx, &list);
+	if (count < 0) {
+		P_ERROR(p, "\tFailed to enumerate usb devices\n");
+		return -1;
+	}
+
+	// Only reads libusb's own list, doesn't touch the devices themselves.
+	int missing = 0;
+	for (size_t i = 0; i < p->device_count; i++) {
+		struct prober_device *pdev = &p->devices[i];
+		if (pdev->base.bus == XRT_BUS_TYPE_USB && p_libusb_find(list, count, pdev) == NULL) {
+			missing++;
+		}
+	}
+
+	// Keep the old list and attachments, try again later.
+	if (missing > 0 && !allow_missing) {
+		libusb_free_device_list(list, 1);
+		return missing;
+	}
+
+	for (size_t i = 0; i < p->device_count; i++) {
+		struct prober_device *pdev = &p->devices[i];
+		if (pdev->base.bus != XRT_BUS_TYPE_USB) {
+			continue;
+		}
+
+		// Attach the libusb device to it, if any.
+		libusb_device *device = p_libusb_find(list, count, pdev);
+		pdev->usb.dev = device;
+
+		if (device != NULL) {
+			int num = libusb_get_port_numbers(device, pdev->usb.ports, ARRAY_SIZE(pdev->usb.ports));
+			pdev->usb.num_ports = num > 0 ? num : 0;
+		}
+	}
+
+	// Every USB device now points into the new list, the old one can go.
+	if (p->usb.list != NULL) {
+		libusb_free_device_list(p->usb.list, 1);
+	}
+	p->usb.list = list;
+	p->usb.count = count;
+
+	return missing;
+}
+
 #define ENUM_TO_STR(r)                                                                                                 \
 	case r: return #r
 
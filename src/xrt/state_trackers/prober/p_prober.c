@@ -18,8 +18,10 @@
 #include "util/u_debug.h"
 #include "util/u_pretty_print.h"
 #include "util/u_trace_marker.h"
+#include "util/u_worker.h"
 
 #include "os/os_hid.h"
+#include "os/os_time.h"
 #include "p_prober.h"
 
 #ifdef XRT_HAVE_V4L2
@@ -57,6 +59,18 @@ DEBUG_GET_ONCE_BOOL_OPTION(qwerty_combine, "QWERTY_COMBINE", false)
 DEBUG_GET_ONCE_OPTION(vf_path, "VF_PATH", NULL)
 DEBUG_GET_ONCE_OPTION(euroc_path, "EUROC_PATH", NULL)
 DEBUG_GET_ONCE_NUM_OPTION(rs_source_index, "RS_SOURCE_INDEX", -1)
+DEBUG_GET_ONCE_BOOL_OPTION(prober_parallel, "PROBER_PARALLEL", false)
+DEBUG_GET_ONCE_BOOL_OPTION(prober_hotplug, "PROBER_HOTPLUG", false)
+
+
+/*
+ *
+ * Defines.
+ *
+ */
+
+//! Most threads used to estimate builders in parallel.
+#define P_PROBER_MAX_ESTIMATE_THREADS 8
 
 
 /*
@@ -71,6 +85,9 @@ add_device(struct prober *p, struct prober_device **out_dev);
 static int
 initialize(struct prober *p, struct xrt_prober_entry_lists *lists);
 
+static void
+teardown_device(struct prober_device *pdev);
+
 static void
 teardown_devices(struct prober *p);
 
@@ -242,6 +259,28 @@ p_dev_get_bluetooth_dev(struct prober *p,
 	return 0;
 }
 
+void
+p_dev_reset(struct prober_device *pdev)
+{
+	// Doesn't touch the libusb and libuvc devices.
+	teardown_device(pdev);
+}
+
+void
+p_dev_remove(struct prober *p, struct prober_device *pdev)
+{
+	size_t index = (size_t)(pdev - p->devices);
+	assert(index < p->device_count);
+
+	teardown_device(pdev);
+
+	// Keep the order of the rest, the list is only ever a handful long.
+	for (size_t i = index + 1; i < p->device_count; i++) {
+		p->devices[i - 1] = p->devices[i];
+	}
+	p->device_count--;
+}
+
 
 /*
  *
@@ -323,6 +362,8 @@ collect_entries(struct prober *p)
 		lists = lists->next;
 	}
 
+	p->builder_timings = U_TYPED_ARRAY_CALLOC(struct prober_builder_timing, p->builder_count);
+
 	return 0;
 }
 
@@ -455,11 +496,14 @@ initialize(struct prober *p, struct xrt_prober_entry_lists *lists)
 	p->json.file_loaded = false;
 	p->json.root = NULL;
 
+	int ret = os_mutex_init(&p->list_mutex);
+	if (ret != 0) {
+		return -1;
+	}
+
 	u_var_add_root((void *)p, "Prober", true);
 	u_var_add_log_level(p, &p->log_level, "Log level");
 
-	int ret;
-
 	u_config_json_open_or_create_main_file(&p->json);
 
 	ret = collect_entries(p);
@@ -499,77 +543,95 @@ initialize(struct prober *p, struct xrt_prober_entry_lists *lists)
 	parse_disabled_drivers(p);
 	disable_drivers_from_conflicts(p);
 
+#ifdef XRT_HAVE_LIBUDEV
+	// Not fatal, probe still works without it.
+	if (debug_get_bool_option_prober_hotplug()) {
+		ret = p_udev_hotplug_init(p, NULL);
+		if (ret == 0) {
+			ret = p_udev_hotplug_start_thread(p);
+		}
+		if (ret != 0) {
+			P_WARN(p, "Failed to start watching for hotplug, only probe will find new devices");
+			p_udev_hotplug_teardown(p);
+		}
+	}
+#endif
+
 	return 0;
 }
 
 static void
-teardown_devices(struct prober *p)
+teardown_device(struct prober_device *pdev)
 {
-	XRT_TRACE_MARKER();
-
-	// Need to free all devices.
-	for (size_t i = 0; i < p->device_count; i++) {
-		struct prober_device *pdev = &p->devices[i];
-
-		if (pdev->usb.product != NULL) {
-			free((char *)pdev->usb.product);
-			pdev->usb.product = NULL;
-		}
+	if (pdev->usb.product != NULL) {
+		free((char *)pdev->usb.product);
+		pdev->usb.product = NULL;
+	}
 
-		if (pdev->usb.manufacturer != NULL) {
-			free((char *)pdev->usb.manufacturer);
-			pdev->usb.manufacturer = NULL;
-		}
+	if (pdev->usb.manufacturer != NULL) {
+		free((char *)pdev->usb.manufacturer);
+		pdev->usb.manufacturer = NULL;
+	}
 
-		if (pdev->usb.serial != NULL) {
-			free((char *)pdev->usb.serial);
-			pdev->usb.serial = NULL;
-		}
+	if (pdev->usb.serial != NULL) {
+		free((char *)pdev->usb.serial);
+		pdev->usb.serial = NULL;
+	}
 
-		if (pdev->usb.path != NULL) {
-			free((char *)pdev->usb.path);
-			pdev->usb.path = NULL;
-		}
+	if (pdev->usb.path != NULL) {
+		free((char *)pdev->usb.path);
+		pdev->usb.path = NULL;
+	}
 
 #ifdef XRT_HAVE_LIBUSB
-		if (pdev->usb.dev != NULL) {
-			//! @todo Free somewhere else
-		}
+	if (pdev->usb.dev != NULL) {
+		//! @todo Free somewhere else
+	}
 #endif
 
 #ifdef XRT_HAVE_LIBUVC
-		if (pdev->uvc.dev != NULL) {
-			//! @todo Free somewhere else
-		}
+	if (pdev->uvc.dev != NULL) {
+		//! @todo Free somewhere else
+	}
 #endif
 
 #ifdef XRT_HAVE_V4L2
-		for (size_t j = 0; j < pdev->num_v4ls; j++) {
-			struct prober_v4l *v4l = &pdev->v4ls[j];
-			free((char *)v4l->path);
-			v4l->path = NULL;
-		}
+	for (size_t j = 0; j < pdev->num_v4ls; j++) {
+		struct prober_v4l *v4l = &pdev->v4ls[j];
+		free((char *)v4l->path);
+		v4l->path = NULL;
+	}
 
-		if (pdev->v4ls != NULL) {
-			free(pdev->v4ls);
-			pdev->v4ls = NULL;
-			pdev->num_v4ls = 0;
-		}
+	if (pdev->v4ls != NULL) {
+		free(pdev->v4ls);
+		pdev->v4ls = NULL;
+		pdev->num_v4ls = 0;
+	}
 #endif
 
 #ifdef XRT_OS_LINUX
-		for (size_t j = 0; j < pdev->num_hidraws; j++) {
-			struct prober_hidraw *hidraw = &pdev->hidraws[j];
-			free((char *)hidraw->path);
-			hidraw->path = NULL;
-		}
+	for (size_t j = 0; j < pdev->num_hidraws; j++) {
+		struct prober_hidraw *hidraw = &pdev->hidraws[j];
+		free((char *)hidraw->path);
+		hidraw->path = NULL;
+	}
 
-		if (pdev->hidraws != NULL) {
-			free(pdev->hidraws);
-			pdev->hidraws = NULL;
-			pdev->num_hidraws = 0;
-		}
+	if (pdev->hidraws != NULL) {
+		free(pdev->hidraws);
+		pdev->hidraws = NULL;
+		pdev->num_hidraws = 0;
+	}
 #endif
+}
+
+static void
+teardown_devices(struct prober *p)
+{
+	XRT_TRACE_MARKER();
+
+	// Need to free all devices.
+	for (size_t i = 0; i < p->device_count; i++) {
+		teardown_device(&p->devices[i]);
 	}
 
 	if (p->devices != NULL) {
@@ -587,6 +649,11 @@ teardown(struct prober *p)
 	// First remove the variable tracking.
 	u_var_remove_root((void *)p);
 
+#ifdef XRT_HAVE_LIBUDEV
+	// The hotplug thread calls into the builders and touches the devices.
+	p_udev_hotplug_teardown(p);
+#endif
+
 	// Clean up all setter uppers.
 	for (size_t i = 0; i < p->builder_count; i++) {
 		xrt_builder_destroy(&p->builders[i]);
@@ -594,6 +661,8 @@ teardown(struct prober *p)
 	p->builder_count = 0;
 	free(p->builders);
 	p->builders = NULL;
+	free(p->builder_timings);
+	p->builder_timings = NULL;
 
 	// Clean up all auto_probers.
 	for (int i = 0; i < XRT_MAX_AUTO_PROBERS && p->auto_probers[i]; i++) {
@@ -613,6 +682,10 @@ teardown(struct prober *p)
 
 	teardown_devices(p);
 
+#ifdef XRT_HAVE_LIBUDEV
+	p_udev_teardown(p);
+#endif
+
 #ifdef XRT_HAVE_LIBUVC
 	p_libuvc_teardown(p);
 #endif
@@ -624,6 +697,8 @@ teardown(struct prober *p)
 	u_config_json_close(&p->json);
 
 	free(p->disabled_drivers);
+
+	os_mutex_destroy(&p->list_mutex);
 }
 
 static void
@@ -838,6 +913,84 @@ find_builder_by_identifier(struct prober *p, const char *ident)
 	return NULL;
 }
 
+struct estimate_task
+{
+	struct prober *p;
+	size_t index;
+};
+
+static void
+estimate_builder(struct prober *p, size_t index)
+{
+	struct xrt_builder *xb = p->builders[index];
+	struct prober_builder_timing *bt = &p->builder_timings[index];
+
+	uint64_t then_ns = os_monotonic_get_ns();
+	xrt_builder_estimate_system(xb, p->json.root, &p->base, &bt->estimate);
+	bt->estimate_ns = os_monotonic_get_ns() - then_ns;
+	bt->estimated = true;
+}
+
+static void
+estimate_builder_task(void *ptr)
+{
+	struct estimate_task *task = (struct estimate_task *)ptr;
+	estimate_builder(task->p, task->index);
+}
+
+/*!
+ * Get the estimate of all builders that take part in automatic discovery. The
+ * estimates mostly wait on opening devices to read their strings, so with
+ * PROBER_PARALLEL they are done on a thread pool, selection still goes in
+ * builder order. Off by default, not all builders have been checked to be safe
+ * to estimate at the same time as the others.
+ */
+static void
+estimate_builders(struct prober *p)
+{
+	XRT_TRACE_MARKER();
+
+	struct estimate_task *tasks = U_TYPED_ARRAY_CALLOC(struct estimate_task, p->builder_count);
+	size_t task_count = 0;
+
+	for (size_t i = 0; i < p->builder_count; i++) {
+		if (p->builders[i]->exclude_from_automatic_discovery) {
+			continue;
+		}
+
+		tasks[task_count].p = p;
+		tasks[task_count].index = i;
+		task_count++;
+	}
+
+	if (!debug_get_bool_option_prober_parallel() || task_count <= 1) {
+		for (size_t i = 0; i < task_count; i++) {
+			estimate_builder_task(&tasks[i]);
+		}
+		free(tasks);
+		return;
+	}
+
+	// This thread helps out while waiting.
+	uint32_t thread_count = (uint32_t)task_count;
+	if (thread_count > P_PROBER_MAX_ESTIMATE_THREADS) {
+		thread_count = P_PROBER_MAX_ESTIMATE_THREADS;
+	}
+	struct u_worker_thread_pool *pool = u_worker_thread_pool_create(thread_count - 1, thread_count, "Prober");
+	struct u_worker_group *group = u_worker_group_create(pool);
+
+	for (size_t i = 0; i < task_count; i++) {
+		u_worker_group_push(group, estimate_builder_task, &tasks[i]);
+	}
+
+	u_worker_group_wait_all(group);
+
+	u_worker_group_reference(&group, NULL);
+	u_worker_thread_pool_reference(&pool, NULL);
+
+	free(tasks);
+}
+
 static void
 print_system_devices(u_pp_delegate_t dg, struct xrt_system_devices *xsysd)
 {
@@ -879,23 +1032,24 @@ print_system_devices(u_pp_delegate_t dg, struct xrt_system_devices *xsysd)
  *
  */
 
+//! Must be called with @ref prober::list_mutex held.
 static xrt_result_t
-p_probe(struct xrt_prober *xp)
+probe_devices(struct prober *p)
 {
-	XRT_TRACE_MARKER();
-
-	struct prober *p = (struct prober *)xp;
+	struct prober_probe_timing *pt = &p->probe_timing;
+	XRT_MAYBE_UNUSED uint64_t then_ns;
 	XRT_MAYBE_UNUSED int ret = 0;
 
-	if (p->list_locked) {
-		return XRT_ERROR_PROBER_LIST_LOCKED;
-	}
+	U_ZERO(pt);
+	uint64_t start_ns = os_monotonic_get_ns();
 
 	// Free old list first.
 	teardown_devices(p);
 
 #ifdef XRT_HAVE_LIBUDEV
+	then_ns = os_monotonic_get_ns();
 	ret = p_udev_probe(p);
+	pt->udev_ns = os_monotonic_get_ns() - then_ns;
 	if (ret != 0) {
 		P_ERROR(p, "Failed to enumerate udev devices\n");
 		return XRT_ERROR_PROBING_FAILED;
@@ -903,7 +1057,9 @@ p_probe(struct xrt_prober *xp)
 #endif
 
 #ifdef XRT_HAVE_LIBUSB
+	then_ns = os_monotonic_get_ns();
 	ret = p_libusb_probe(p);
+	pt->libusb_ns = os_monotonic_get_ns() - then_ns;
 	if (ret != 0) {
 		P_ERROR(p, "Failed to enumerate libusb devices\n");
 		return XRT_ERROR_PROBING_FAILED;
@@ -911,36 +1067,65 @@ p_probe(struct xrt_prober *xp)
 #endif
 
 #ifdef XRT_HAVE_LIBUVC
+	then_ns = os_monotonic_get_ns();
 	ret = p_libuvc_probe(p);
+	pt->libuvc_ns = os_monotonic_get_ns() - then_ns;
 	if (ret != 0) {
 		P_ERROR(p, "Failed to enumerate libuvc devices\n");
 		return XRT_ERROR_PROBING_FAILED;
 	}
 #endif
 
+	pt->total_ns = os_monotonic_get_ns() - start_ns;
+
 	return XRT_SUCCESS;
 }
 
 static xrt_result_t
-p_lock_list(struct xrt_prober *xp, struct xrt_prober_device ***out_devices, size_t *out_device_count)
+p_probe(struct xrt_prober *xp)
 {
+	XRT_TRACE_MARKER();
+
 	struct prober *p = (struct prober *)xp;
+	xrt_result_t xret;
 
-	if (p->list_locked) {
-		return XRT_ERROR_PROBER_LIST_LOCKED;
+	// Held all the way through so hotplug doesn't touch the devices meanwhile.
+	os_mutex_lock(&p->list_mutex);
+
+	if (p->list_lock_count > 0) {
+		xret = XRT_ERROR_PROBER_LIST_LOCKED;
+	} else {
+		xret = probe_devices(p);
 	}
 
+	os_mutex_unlock(&p->list_mutex);
+
+	return xret;
+}
+
+static xrt_result_t
+p_lock_list(struct xrt_prober *xp, struct xrt_prober_device ***out_devices, size_t *out_device_count)
+{
+	struct prober *p = (struct prober *)xp;
+
 	assert(out_devices != NULL);
 	assert(*out_devices == NULL);
 
+	/*
+	 * Several holders are fine, the builders lock the list from worker
+	 * threads when estimating in parallel. What matters is that probe
+	 * doesn't free the devices under any of them.
+	 */
+	os_mutex_lock(&p->list_mutex);
+	p->list_lock_count++;
+	os_mutex_unlock(&p->list_mutex);
+
 	// Build a list of all current probed devices.
 	struct xrt_prober_device **dev_list = U_TYPED_ARRAY_CALLOC(struct xrt_prober_device *, p->device_count);
 	for (size_t i = 0; i < p->device_count; i++) {
 		dev_list[i] = &p->devices[i].base;
 	}
 
-	p->list_locked = true;
-
 	*out_devices = dev_list;
 	*out_device_count = p->device_count;
 
@@ -952,13 +1137,19 @@ p_unlock_list(struct xrt_prober *xp, struct xrt_prober_device ***devices)
 {
 	struct prober *p = (struct prober *)xp;
 
-	if (!p->list_locked) {
-		return XRT_ERROR_PROBER_LIST_NOT_LOCKED;
+	assert(devices != NULL);
+
+	os_mutex_lock(&p->list_mutex);
+	bool was_locked = p->list_lock_count > 0;
+	if (was_locked) {
+		p->list_lock_count--;
 	}
+	os_mutex_unlock(&p->list_mutex);
 
-	assert(devices != NULL);
+	if (!was_locked) {
+		return XRT_ERROR_PROBER_LIST_NOT_LOCKED;
+	}
 
-	p->list_locked = false;
 	free(*devices);
 	*devices = NULL;
 
@@ -972,10 +1163,14 @@ p_dump(struct xrt_prober *xp, bool use_stdout)
 
 	struct prober *p = (struct prober *)xp;
 
+	os_mutex_lock(&p->list_mutex);
 	for (size_t i = 0; i < p->device_count; i++) {
 		struct prober_device *pdev = &p->devices[i];
 		p_dump_device(p, pdev, (int)i, use_stdout);
 	}
+	os_mutex_unlock(&p->list_mutex);
+
+	p_dump_timings(p, use_stdout);
 
 	return 0;
 }
@@ -1007,6 +1202,12 @@ p_create_system(struct xrt_prober *xp,
 	}
 
 
+	// Only the builders touched by this call have timings.
+	for (size_t i = 0; i < p->builder_count; i++) {
+		U_ZERO(&p->builder_timings[i]);
+	}
+
+
 	/*
 	 * Config.
 	 */
@@ -1031,20 +1232,17 @@ p_create_system(struct xrt_prober *xp,
 	 * Estimate.
 	 */
 
+	if (select == NULL) {
+		estimate_builders(p);
+	}
+
 	//! @todo Improve estimation selection logic.
 	if (select == NULL) {
 		for (size_t i = 0; i < p->builder_count; i++) {
-			struct xrt_builder *xb = p->builders[i];
+			struct prober_builder_timing *bt = &p->builder_timings[i];
 
-			if (xb->exclude_from_automatic_discovery) {
-				continue;
-			}
-
-			struct xrt_builder_estimate estimate = {0};
-			xrt_builder_estimate_system(xb, p->json.root, xp, &estimate);
-
-			if (estimate.certain.head) {
-				select = xb;
+			if (bt->estimated && bt->estimate.certain.head) {
+				select = p->builders[i];
 				break;
 			}
 		}
@@ -1058,17 +1256,10 @@ p_create_system(struct xrt_prober *xp,
 
 	if (select == NULL) {
 		for (size_t i = 0; i < p->builder_count; i++) {
-			struct xrt_builder *xb = p->builders[i];
+			struct prober_builder_timing *bt = &p->builder_timings[i];
 
-			if (xb->exclude_from_automatic_discovery) {
-				continue;
-			}
-
-			struct xrt_builder_estimate estimate = {0};
-			xrt_builder_estimate_system(xb, p->json.root, xp, &estimate);
-
-			if (estimate.maybe.head) {
-				select = xb;
+			if (bt->estimated && bt->estimate.maybe.head) {
+				select = p->builders[i];
 				break;
 			}
 		}
@@ -1082,6 +1273,8 @@ p_create_system(struct xrt_prober *xp,
 
 	if (select != NULL) {
 		u_pp(dg, "\n\tUsing builder %s: %s", select->identifier, select->name);
+
+		uint64_t then_ns = os_monotonic_get_ns();
 		xret = xrt_builder_open_system( //
 		    select,                     //
 		    p->json.root,               //
@@ -1089,6 +1282,14 @@ p_create_system(struct xrt_prober *xp,
 		    broadcast,                  //
 		    out_xsysd,                  //
 		    out_xso);                   //
+		uint64_t open_ns = os_monotonic_get_ns() - then_ns;
+
+		for (size_t i = 0; i < p->builder_count; i++) {
+			if (p->builders[i] == select) {
+				p->builder_timings[i].opened = true;
+				p->builder_timings[i].open_ns = open_ns;
+			}
+		}
 
 		if (xret == XRT_SUCCESS) {
 			print_system_devices(dg, *out_xsysd);
@@ -1289,6 +1490,11 @@ p_list_video_devices(struct xrt_prober *xp, xrt_prober_list_video_func_t cb, voi
 		cb(xp, NULL, "RealSense Source", "Collabora", "", ptr);
 	}
 
+	// Like a lock_list, keeps hotplug from changing the devices under us.
+	os_mutex_lock(&p->list_mutex);
+	p->list_lock_count++;
+	os_mutex_unlock(&p->list_mutex);
+
 	// Video sources from video devices
 	for (size_t i = 0; i < p->device_count; i++) {
 		struct prober_device *pdev = &p->devices[i];
@@ -1305,13 +1511,20 @@ p_list_video_devices(struct xrt_prober *xp, xrt_prober_list_video_func_t cb, voi
 			continue;
 		}
 
+		// Builders may list devices from several threads at once.
+		os_mutex_lock(&p->list_mutex);
 		if (pdev->usb.product == NULL) {
 			fill_out_product(p, pdev);
 		}
+		os_mutex_unlock(&p->list_mutex);
 
 		cb(xp, &pdev->base, pdev->usb.product, pdev->usb.manufacturer, pdev->usb.serial, ptr);
 	}
 
+	os_mutex_lock(&p->list_mutex);
+	p->list_lock_count--;
+	os_mutex_unlock(&p->list_mutex);
+
 	return 0;
 }
 
@@ -18,6 +18,8 @@
 #include "util/u_logging.h"
 #include "util/u_config_json.h"
 
+#include "os/os_threading.h"
+
 #ifdef XRT_HAVE_LIBUSB
 #include <libusb.h>
 #endif
@@ -30,6 +32,10 @@
 #include <sys/types.h>
 #endif
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /*
  *
  * Struct and defines
@@ -38,6 +44,8 @@
 
 #define P_PROBER_BLUETOOTH_PRODUCT_COUNT 64
 
+struct prober;
+
 #define P_TRACE(d, ...) U_LOG_IFL_T(d->log_level, __VA_ARGS__)
 #define P_DEBUG(d, ...) U_LOG_IFL_D(d->log_level, __VA_ARGS__)
 #define P_INFO(d, ...) U_LOG_IFL_I(d->log_level, __VA_ARGS__)
@@ -117,6 +125,119 @@ struct prober_device
 #endif
 };
 
+#ifdef XRT_HAVE_LIBUDEV
+/*!
+ * The udev subsystems enumerated by @ref p_udev_probe.
+ */
+enum prober_udev_entry_type
+{
+	PROBER_UDEV_ENTRY_USB,
+	PROBER_UDEV_ENTRY_V4L,
+	PROBER_UDEV_ENTRY_HIDRAW,
+};
+
+/*!
+ * What a udev enumeration entry was parsed into, kept between probes so only
+ * new or changed entries need to have their sysfs attributes read again.
+ */
+struct prober_udev_entry
+{
+	enum prober_udev_entry_type type;
+
+	//! Where in sysfs the entry is, first half of the key.
+	char *sysfs_path;
+
+	//! Device number of the entry and its USB device, changes on replug.
+	dev_t devnum;
+	dev_t usb_devnum;
+
+	//! Parsing failed or the entry was skipped, cached all the same.
+	bool skip;
+
+	//! Parsing failed, maybe due to a race with the device appearing, parse again next probe.
+	bool retry;
+
+	char *dev_path;
+	char *product;
+	char *manufacturer;
+	char *serial;
+
+	uint8_t dev_class;
+	uint16_t vendor_id;
+	uint16_t product_id;
+	uint16_t usb_bus;
+	uint16_t usb_addr;
+	uint16_t usb_iface;
+	uint32_t v4l_index;
+	uint32_t bus_type;
+	uint64_t bluetooth_id;
+	char bluetooth_product[P_PROBER_BLUETOOTH_PRODUCT_COUNT];
+};
+
+/*!
+ * What happened to a udev entry.
+ */
+enum prober_hotplug_action
+{
+	PROBER_HOTPLUG_ADD,
+	PROBER_HOTPLUG_REMOVE,
+};
+
+/*!
+ * A single udev entry that was plugged in or removed. With add the entry has
+ * been fully parsed, with remove only the type and sysfs path are filled in,
+ * the sysfs attributes are already gone by then.
+ */
+struct prober_hotplug_event
+{
+	enum prober_hotplug_action action;
+	struct prober_udev_entry entry;
+};
+
+/*!
+ * Where hotplug events come from, normally a udev monitor but tests can feed
+ * in events without udev.
+ */
+struct prober_hotplug_source
+{
+	//! File descriptor that becomes readable when there are events, or -1.
+	int (*get_fd)(struct prober_hotplug_source *src);
+
+	//! Get the next pending event without blocking, false if there is none.
+	bool (*next_event)(struct prober_hotplug_source *src, struct prober *p, struct prober_hotplug_event *out_event);
+
+	void (*destroy)(struct prober_hotplug_source *src);
+};
+#endif
+
+/*!
+ * Timing of the last probe, printed by @ref p_dump.
+ */
+struct prober_probe_timing
+{
+	uint64_t total_ns;
+	uint64_t udev_ns;
+	uint64_t libusb_ns;
+	uint64_t libuvc_ns;
+
+	//! udev entries parsed from sysfs and entries reused from the last probe.
+	uint32_t udev_parsed;
+	uint32_t udev_reused;
+};
+
+/*!
+ * Timing of a single builder in the last @ref xrt_prober::create_system call,
+ * printed by @ref p_dump.
+ */
+struct prober_builder_timing
+{
+	bool estimated;
+	bool opened;
+	uint64_t estimate_ns;
+	uint64_t open_ns;
+	struct xrt_builder_estimate estimate;
+};
+
 /*!
  * @implements xrt_prober
  */
@@ -139,9 +260,48 @@ struct prober
 	size_t builder_count;
 
 	/*!
-	 * Has the list been locked.
+	 * Per builder timing, same order and count as @ref builders.
+	 */
+	struct prober_builder_timing *builder_timings;
+
+	//! Protects @ref list_lock_count, the devices while probing or hotplugging and lazily filled in strings.
+	struct os_mutex list_mutex;
+
+	/*!
+	 * How many times the list has been locked, the builders lock it from
+	 * several threads at once when estimating in parallel.
 	 */
-	bool list_locked;
+	uint32_t list_lock_count;
+
+	struct prober_probe_timing probe_timing;
+
+#ifdef XRT_HAVE_LIBUDEV
+	struct
+	{
+		//! Entries from the last probe, in enumeration order.
+		struct prober_udev_entry *entries;
+		size_t entry_count;
+	} udev;
+
+	struct
+	{
+		//! Non-null when watching for hotplug.
+		struct prober_hotplug_source *source;
+
+		struct os_thread_helper oth;
+
+		//! Events that came in while the list was locked, in order.
+		struct prober_hotplug_event *pending;
+		size_t pending_count;
+
+		//! Polls left to wait for libusb to list new USB devices, zero if not waiting.
+		uint32_t usb_refresh_tries;
+
+		//! Events applied and devices rebuilt so far.
+		uint64_t event_count;
+		uint64_t device_count;
+	} hotplug;
+#endif
 
 #ifdef XRT_HAVE_LIBUSB
 	struct
@@ -192,6 +352,14 @@ struct prober
 void
 p_dump_device(struct prober *p, struct prober_device *pdev, int id, bool use_stdout);
 
+/*!
+ * Dump how long the last probe and each builder took to stdout.
+ *
+ * @public @memberof prober
+ */
+void
+p_dump_timings(struct prober *p, bool use_stdout);
+
 /*!
  * Get or create a @ref prober_device from the device.
  *
@@ -218,6 +386,23 @@ p_dev_get_bluetooth_dev(struct prober *p,
                         const char *product_name,
                         struct prober_device **out_pdev);
 
+/*!
+ * Free the strings and interfaces of the device, keeping it in the list with
+ * its libusb and libuvc devices attached.
+ *
+ * @public @memberof prober
+ */
+void
+p_dev_reset(struct prober_device *pdev);
+
+/*!
+ * Free the device and remove it from the list, moves the devices after it.
+ *
+ * @public @memberof prober
+ */
+void
+p_dev_remove(struct prober *p, struct prober_device *pdev);
+
 /*!
  * @name Tracking systems
  * @{
@@ -283,6 +468,21 @@ p_libusb_get_string_descriptor(struct prober *p,
 bool
 p_libusb_can_open(struct prober *p, struct prober_device *pdev);
 
+/*!
+ * Get a new device list from libusb and attach it to the existing USB devices,
+ * without adding any devices, used after devices have been hotplugged.
+ *
+ * libusb finds out about new devices on its own, so it can be behind. Unless
+ * @p allow_missing is set nothing is changed when any USB device is missing
+ * from its list, so that the current attachments stay until it has caught up.
+ *
+ * @return The number of USB devices missing from libusb's list, negative on error.
+ *
+ * @private @memberof prober
+ */
+int
+p_libusb_refresh(struct prober *p, bool allow_missing);
+
 /*!
  * @}
  */
@@ -326,7 +526,58 @@ p_libuvc_probe(struct prober *p);
  */
 int
 p_udev_probe(struct prober *p);
+
+/*!
+ * Free the entries kept between probes.
+ *
+ * @private @memberof prober
+ */
+void
+p_udev_teardown(struct prober *p);
+
+/*!
+ * Start watching for hotplug with the given source, creates a udev monitor
+ * source if @p src is NULL, takes ownership of the source. Events are only
+ * taken in by @ref p_udev_hotplug_poll, nothing runs them until
+ * @ref p_udev_hotplug_start_thread is called.
+ *
+ * @private @memberof prober
+ */
+int
+p_udev_hotplug_init(struct prober *p, struct prober_hotplug_source *src);
+
+/*!
+ * Start a thread that calls @ref p_udev_hotplug_poll whenever the source has
+ * events.
+ *
+ * @private @memberof prober
+ */
+int
+p_udev_hotplug_start_thread(struct prober *p);
+
+/*!
+ * Take in all events of the source and apply them to the devices, only the
+ * devices the events touch are rebuilt. Events are held back while the list is
+ * locked. Must not be called with @ref prober::list_mutex held.
+ *
+ * @private @memberof prober
+ */
+void
+p_udev_hotplug_poll(struct prober *p);
+
+/*!
+ * Stop the thread and destroy the source, safe to call if never started.
+ *
+ * @private @memberof prober
+ */
+void
+p_udev_hotplug_teardown(struct prober *p);
 /*!
  * @}
  */
 #endif
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -8,8 +8,10 @@
  */
 
 #include "util/u_misc.h"
+#include "util/u_trace_marker.h"
 #include "p_prober.h"
 
+#include <poll.h>
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
@@ -28,6 +30,55 @@
 #define HIDRAW_BUS_BLUETOOTH 5
 #define HIDRAW_BUS_I2C_MAYBE_QUESTION_MARK 24
 
+//! How often the hotplug thread wakes up without events, to stop or retry held back events.
+#define P_UDEV_HOTPLUG_POLL_MS 100
+
+//! How many polls to wait for libusb to list new USB devices, 5 seconds.
+#define P_UDEV_HOTPLUG_USB_TRIES 50
+
+
+/*
+ *
+ * Structs
+ *
+ */
+
+/*!
+ * Hotplug source reading from a udev monitor.
+ *
+ * @implements prober_hotplug_source
+ */
+struct p_udev_monitor
+{
+	struct prober_hotplug_source base;
+
+	struct udev *udev;
+	struct udev_monitor *monitor;
+};
+
+/*!
+ * Which @ref prober_device an entry ends up in, same matching as
+ * @ref p_dev_get_usb_dev and @ref p_dev_get_bluetooth_dev.
+ */
+struct p_udev_device_key
+{
+	bool bluetooth;
+	uint16_t usb_bus;
+	uint16_t usb_addr;
+	uint64_t bluetooth_id;
+};
+
+/*!
+ * A device rebuilt by hotplug, logged after the lock is dropped.
+ */
+struct p_udev_device_change
+{
+	struct p_udev_device_key key;
+	uint16_t vendor_id;
+	uint16_t product_id;
+	bool present;
+};
+
 
 /*
  *
@@ -36,7 +87,38 @@
  */
 
 static void
-p_udev_enumerate_usb(struct prober *p, struct udev *udev);
+p_udev_free_entry(struct prober_udev_entry *e);
+
+static void
+p_udev_free_entries(struct prober_udev_entry *entries, size_t entry_count);
+
+static int
+p_udev_monitor_create(struct prober *p, struct prober_hotplug_source **out_src);
+
+static void
+p_udev_hotplug_apply(struct prober *p,
+                     struct prober_hotplug_event *event,
+                     struct p_udev_device_change *changes,
+                     size_t *change_count,
+                     bool *out_new_usb);
+
+#ifdef XRT_HAVE_LIBUSB
+static void
+p_udev_hotplug_refresh_usb(struct prober *p);
+#endif
+
+static void *
+p_udev_hotplug_run(void *ptr);
+
+static void
+p_udev_enumerate(struct prober *p,
+                 struct udev *udev,
+                 enum prober_udev_entry_type type,
+                 struct prober_udev_entry **entries,
+                 size_t *entry_count);
+
+static void
+p_udev_add_entry(struct prober *p, struct prober_udev_entry *e);
 
 static void
 p_udev_add_usb(struct prober_device *pdev,
@@ -46,15 +128,9 @@ p_udev_add_usb(struct prober_device *pdev,
                const char *serial,
                const char *path);
 
-static void
-p_udev_enumerate_v4l2(struct prober *p, struct udev *udev);
-
 static void
 p_udev_add_v4l(struct prober_device *pdev, uint32_t v4l_index, uint32_t usb_iface, const char *path);
 
-static void
-p_udev_enumerate_hidraw(struct prober *p, struct udev *udev);
-
 static void
 p_udev_add_hidraw(struct prober_device *pdev, uint32_t interface, const char *path);
 
@@ -127,360 +203,529 @@ p_udev_probe(struct prober *p)
 		return -1;
 	}
 
-	p_udev_enumerate_usb(p, udev);
-
-	p_udev_enumerate_v4l2(p, udev);
+	struct prober_udev_entry *entries = NULL;
+	size_t entry_count = 0;
 
-	p_udev_enumerate_hidraw(p, udev);
+	// Entries that are still there are moved over from the last probe.
+	p_udev_enumerate(p, udev, PROBER_UDEV_ENTRY_USB, &entries, &entry_count);
+	p_udev_enumerate(p, udev, PROBER_UDEV_ENTRY_V4L, &entries, &entry_count);
+	p_udev_enumerate(p, udev, PROBER_UDEV_ENTRY_HIDRAW, &entries, &entry_count);
 
 	udev_unref(udev);
 
-	return 0;
-}
+	// What is left of the last probe has been unplugged.
+	p_udev_free_entries(p->udev.entries, p->udev.entry_count);
+	p->udev.entries = entries;
+	p->udev.entry_count = entry_count;
 
+	// In enumeration order, so the devices end up in the same order.
+	for (size_t i = 0; i < p->udev.entry_count; i++) {
+		if (!p->udev.entries[i].skip) {
+			p_udev_add_entry(p, &p->udev.entries[i]);
+		}
+	}
 
-/*
- *
- * Internal functions.
- *
- */
+	return 0;
+}
 
-static void
-p_udev_enumerate_usb(struct prober *p, struct udev *udev)
+void
+p_udev_teardown(struct prober *p)
 {
-	struct udev_enumerate *enumerate;
-	struct udev_list_entry *devices;
-	struct udev_list_entry *dev_list_entry;
-
-	enumerate = udev_enumerate_new(udev);
-	udev_enumerate_add_match_subsystem(enumerate, "usb");
-	udev_enumerate_add_match_property(enumerate, "DEVTYPE", "usb_device");
-	udev_enumerate_scan_devices(enumerate);
+	p_udev_free_entries(p->udev.entries, p->udev.entry_count);
+	p->udev.entries = NULL;
+	p->udev.entry_count = 0;
+}
 
-	devices = udev_enumerate_get_list_entry(enumerate);
-	udev_list_entry_foreach(dev_list_entry, devices)
-	{
-		struct prober_device *pdev = NULL;
-		struct udev_device *raw_dev = NULL;
-		const char *sysfs_path = NULL;
-		const char *dev_path = NULL;
-		const char *serial = NULL;
-		const char *product = NULL;
-		const char *manufacturer = NULL;
-		uint8_t dev_class = 0;
-		uint16_t vendor_id = 0;
-		uint16_t product_id = 0;
-		uint16_t usb_bus = 0;
-		uint16_t usb_addr = 0;
-		int ret;
+int
+p_udev_hotplug_init(struct prober *p, struct prober_hotplug_source *src)
+{
+	assert(p->hotplug.source == NULL);
 
-		// Where in the sysfs is.
-		sysfs_path = udev_list_entry_get_name(dev_list_entry);
-		// Raw sysfs node.
-		raw_dev = udev_device_new_from_syspath(udev, sysfs_path);
-		// The thing we will open.
-		dev_path = udev_device_get_devnode(raw_dev);
-		// Serial number.
-		serial = udev_device_get_sysattr_value(raw_dev, "serial");
-		// Product name.
-		product = udev_device_get_sysattr_value(raw_dev, "product");
-		// Manufacturer name.
-		manufacturer = udev_device_get_sysattr_value(raw_dev, "manufacturer");
-
-
-		ret = p_udev_get_usb_device_info(raw_dev, &dev_class, &vendor_id, &product_id, &usb_bus, &usb_addr);
+	if (src == NULL) {
+		int ret = p_udev_monitor_create(p, &src);
 		if (ret != 0) {
-			P_ERROR(p, "Failed to get usb device info");
-			goto next;
+			return ret;
 		}
+	}
+
+	int ret = os_thread_helper_init(&p->hotplug.oth);
+	if (ret != 0) {
+		src->destroy(src);
+		return ret;
+	}
 
-		ret = p_dev_get_usb_dev(p, usb_bus, usb_addr, vendor_id, product_id, &pdev);
-
-		P_TRACE(p,
-		        "usb\n"
-		        "\t\tptr:          %p (%i)\n"
-		        "\t\tsysfs_path:   '%s'\n"
-		        "\t\tdev_path:     '%s'\n"
-		        "\t\tdev_class:    %02x\n"
-		        "\t\tvendor_id:    %04x\n"
-		        "\t\tproduct_id:   %04x\n"
-		        "\t\tusb_bus:      %i\n"
-		        "\t\tusb_addr:     %i\n"
-		        "\t\tserial:       '%s'\n"
-		        "\t\tproduct:      '%s'\n"
-		        "\t\tmanufacturer: '%s'",
-		        (void *)pdev, ret, sysfs_path, dev_path, dev_class, vendor_id, product_id, usb_bus, usb_addr,
-		        serial, product, manufacturer);
+	p->hotplug.source = src;
 
-		if (ret != 0) {
-			P_ERROR(p, "p_dev_get_usb_device failed!");
-			goto next;
-		}
+	return 0;
+}
 
-		// Add info to usb device.
-		p_udev_add_usb(pdev, dev_class, product, manufacturer, serial, dev_path);
+int
+p_udev_hotplug_start_thread(struct prober *p)
+{
+	assert(p->hotplug.source != NULL);
 
-	next:
-		udev_device_unref(raw_dev);
+	int ret = os_thread_helper_start(&p->hotplug.oth, p_udev_hotplug_run, p);
+	if (ret != 0) {
+		P_ERROR(p, "Failed to start hotplug thread");
+		return ret;
 	}
 
-	udev_enumerate_unref(enumerate);
+	os_thread_helper_name(&p->hotplug.oth, "Prober: Hotplug");
+
+	return 0;
 }
 
-static void
-p_udev_add_usb(struct prober_device *pdev,
-               uint8_t dev_class,
-               const char *product,
-               const char *manufacturer,
-               const char *serial,
-               const char *path)
+void
+p_udev_hotplug_poll(struct prober *p)
 {
-	pdev->base.usb_dev_class = dev_class;
+	struct prober_hotplug_source *src = p->hotplug.source;
+	struct prober_hotplug_event event;
+
+	// Parsing reads sysfs so it's done without the lock, only we touch pending.
+	while (src->next_event(src, p, &event)) {
+		size_t count = p->hotplug.pending_count + 1;
+		U_ARRAY_REALLOC_OR_FREE(p->hotplug.pending, struct prober_hotplug_event, count);
+		p->hotplug.pending[p->hotplug.pending_count++] = event;
+	}
 
-	if (product != NULL) {
-		pdev->usb.product = strdup(product);
+	if (p->hotplug.pending_count == 0 && p->hotplug.usb_refresh_tries == 0) {
+		return;
 	}
-	if (manufacturer != NULL) {
-		pdev->usb.manufacturer = strdup(manufacturer);
+
+	XRT_TRACE_MARKER();
+
+	os_mutex_lock(&p->list_mutex);
+
+	// Someone is looking at the devices, try again on the next poll.
+	if (p->list_lock_count > 0) {
+		os_mutex_unlock(&p->list_mutex);
+		return;
 	}
-	if (serial != NULL) {
-		pdev->usb.serial = strdup(serial);
+
+	// Each event changes at most two devices, the old and new one of the entry.
+	struct p_udev_device_change *changes =
+	    U_TYPED_ARRAY_CALLOC(struct p_udev_device_change, p->hotplug.pending_count * 2);
+	size_t change_count = 0;
+	bool new_usb = false;
+
+	for (size_t i = 0; i < p->hotplug.pending_count; i++) {
+		p_udev_hotplug_apply(p, &p->hotplug.pending[i], changes, &change_count, &new_usb);
 	}
-	if (path != NULL) {
-		pdev->usb.path = strdup(path);
+
+	p->hotplug.event_count += p->hotplug.pending_count;
+	p->hotplug.device_count += change_count;
+	p->hotplug.pending_count = 0;
+
+#ifdef XRT_HAVE_LIBUSB
+	// New USB devices need their libusb device, only libusb's list is read.
+	if (new_usb && p->usb.ctx != NULL) {
+		p->hotplug.usb_refresh_tries = P_UDEV_HOTPLUG_USB_TRIES;
 	}
+	if (p->hotplug.usb_refresh_tries > 0) {
+		p_udev_hotplug_refresh_usb(p);
+	}
+#endif
+
+	os_mutex_unlock(&p->list_mutex);
+
+	for (size_t i = 0; i < change_count; i++) {
+		struct p_udev_device_change *c = &changes[i];
+		P_DEBUG(p, "Hotplug device %04x:%04x %s", c->vendor_id, c->product_id,
+		        c->present ? "changed" : "removed");
+	}
+
+	free(changes);
+}
+
+void
+p_udev_hotplug_teardown(struct prober *p)
+{
+	if (p->hotplug.source == NULL) {
+		return;
+	}
+
+	// Stops the thread if it was started.
+	os_thread_helper_destroy(&p->hotplug.oth);
+
+	p->hotplug.source->destroy(p->hotplug.source);
+	p->hotplug.source = NULL;
+
+	for (size_t i = 0; i < p->hotplug.pending_count; i++) {
+		p_udev_free_entry(&p->hotplug.pending[i].entry);
+	}
+	free(p->hotplug.pending);
+	p->hotplug.pending = NULL;
+	p->hotplug.pending_count = 0;
 }
 
+
+/*
+ *
+ * Internal functions.
+ *
+ */
+
 static void
-p_udev_enumerate_v4l2(struct prober *p, struct udev *udev)
+p_udev_free_entry(struct prober_udev_entry *e)
 {
-	struct udev_enumerate *enumerate;
-	struct udev_list_entry *devices;
-	struct udev_list_entry *dev_list_entry;
+	free(e->sysfs_path);
+	free(e->dev_path);
+	free(e->product);
+	free(e->manufacturer);
+	free(e->serial);
+	U_ZERO(e);
+}
 
-	enumerate = udev_enumerate_new(udev);
-	udev_enumerate_add_match_subsystem(enumerate, "video4linux");
-	udev_enumerate_scan_devices(enumerate);
+static void
+p_udev_free_entries(struct prober_udev_entry *entries, size_t entry_count)
+{
+	for (size_t i = 0; i < entry_count; i++) {
+		p_udev_free_entry(&entries[i]);
+	}
 
-	devices = udev_enumerate_get_list_entry(enumerate);
+	free(entries);
+}
 
-	udev_list_entry_foreach(dev_list_entry, devices)
-	{
-		struct prober_device *pdev = NULL;
-		struct udev_device *raw_dev = NULL;
-		struct udev_device *usb_device = NULL;
-		const char *sysfs_path = NULL;
-		const char *dev_path = NULL;
-		const char *serial = NULL;
-		const char *product = NULL;
-		const char *manufacturer = NULL;
-		uint8_t dev_class = 0;
-		uint16_t vendor_id = 0;
-		uint16_t product_id = 0;
-		uint16_t usb_bus = 0;
-		uint16_t usb_addr = 0;
-		uint16_t usb_iface = 0;
-		uint32_t v4l_index = 0;
-		int ret;
+static char *
+p_udev_strdup_or_null(const char *str)
+{
+	return str != NULL ? strdup(str) : NULL;
+}
 
-		// Where in the sysfs is.
-		sysfs_path = udev_list_entry_get_name(dev_list_entry);
-		// Raw sysfs node.
-		raw_dev = udev_device_new_from_syspath(udev, sysfs_path);
-		// The thing we will open.
-		dev_path = udev_device_get_devnode(raw_dev);
+static dev_t
+p_udev_get_usb_devnum(struct udev_device *raw_dev, enum prober_udev_entry_type type)
+{
+	if (type == PROBER_UDEV_ENTRY_USB) {
+		return udev_device_get_devnum(raw_dev);
+	}
 
-		ret = p_udev_try_usb_relation_get_address(raw_dev, &dev_class, &vendor_id, &product_id, &usb_bus,
-		                                          &usb_addr, &usb_device);
-		if (ret != 0) {
-			P_DEBUG(p, "skipping non-usb v4l device '%s'", dev_path);
-			goto next;
-		}
+	// No we should not unref usb_dev, valgrind agrees.
+	struct udev_device *usb_dev = udev_device_get_parent_with_subsystem_devtype(raw_dev, "usb", "usb_device");
+	if (usb_dev == NULL) {
+		return 0;
+	}
 
-		// Serial number.
-		serial = udev_device_get_sysattr_value(usb_device, "serial");
-		// Product name.
-		product = udev_device_get_sysattr_value(usb_device, "product");
-		// Manufacturer name.
-		manufacturer = udev_device_get_sysattr_value(usb_device, "manufacturer");
+	return udev_device_get_devnum(usb_dev);
+}
 
-		// USB interface.
-		ret = p_udev_get_interface_number(raw_dev, &usb_iface);
-		if (ret != 0) {
-			P_ERROR(p,
-			        "In enumerating V4L2 devices: "
-			        "Failed to get interface number for '%s'",
-			        sysfs_path);
-			goto next;
-		}
+/*!
+ * Move the entry from the last probe with the same key into @p out_entry, if
+ * there is one. The device numbers change when a device is replugged, even if
+ * it ends up at the same sysfs path.
+ */
+static bool
+p_udev_take_cached_entry(struct prober *p,
+                         enum prober_udev_entry_type type,
+                         const char *sysfs_path,
+                         dev_t devnum,
+                         dev_t usb_devnum,
+                         struct prober_udev_entry *out_entry)
+{
+	for (size_t i = 0; i < p->udev.entry_count; i++) {
+		struct prober_udev_entry *e = &p->udev.entries[i];
 
-		// USB interface.
-		ret = p_udev_get_sysattr_u32_base10(raw_dev, "index", &v4l_index);
-		if (ret != 0) {
-			P_ERROR(p, "Failed to get v4l index.");
-			goto next;
+		if (e->sysfs_path == NULL || e->retry || e->type != type || e->devnum != devnum ||
+		    e->usb_devnum != usb_devnum || strcmp(e->sysfs_path, sysfs_path) != 0) {
+			continue;
 		}
 
-		ret = p_dev_get_usb_dev(p, usb_bus, usb_addr, vendor_id, product_id, &pdev);
-
-		P_TRACE(p,
-		        "v4l\n"
-		        "\t\tptr:          %p (%i)\n"
-		        "\t\tsysfs_path:   '%s'\n"
-		        "\t\tdev_path:     '%s'\n"
-		        "\t\tvendor_id:    %04x\n"
-		        "\t\tproduct_id:   %04x\n"
-		        "\t\tv4l_index:    %u\n"
-		        "\t\tusb_iface:    %i\n"
-		        "\t\tusb_bus:      %i\n"
-		        "\t\tusb_addr:     %i\n"
-		        "\t\tserial:       '%s'\n"
-		        "\t\tproduct:      '%s'\n"
-		        "\t\tmanufacturer: '%s'",
-		        (void *)pdev, ret, sysfs_path, dev_path, vendor_id, product_id, v4l_index, usb_iface, usb_bus,
-		        usb_addr, serial, product, manufacturer);
+		*out_entry = *e;
+		U_ZERO(e);
 
-		if (ret != 0) {
-			P_ERROR(p, "p_dev_get_usb_device failed!");
-			goto next;
-		}
+		return true;
+	}
 
-		// Add this interface to the usb device.
-		p_udev_add_v4l(pdev, v4l_index, usb_iface, dev_path);
+	return false;
+}
 
-	next:
-		udev_device_unref(raw_dev);
+static void
+p_udev_parse_usb(struct prober *p, struct udev_device *raw_dev, struct prober_udev_entry *e)
+{
+	int ret = p_udev_get_usb_device_info(raw_dev, &e->dev_class, &e->vendor_id, &e->product_id, &e->usb_bus,
+	                                     &e->usb_addr);
+	if (ret != 0) {
+		P_ERROR(p, "Failed to get usb device info");
+		e->skip = e->retry = true;
+		return;
 	}
 
-	udev_enumerate_unref(enumerate);
+	// The thing we will open.
+	e->dev_path = p_udev_strdup_or_null(udev_device_get_devnode(raw_dev));
+	// Serial number.
+	e->serial = p_udev_strdup_or_null(udev_device_get_sysattr_value(raw_dev, "serial"));
+	// Product name.
+	e->product = p_udev_strdup_or_null(udev_device_get_sysattr_value(raw_dev, "product"));
+	// Manufacturer name.
+	e->manufacturer = p_udev_strdup_or_null(udev_device_get_sysattr_value(raw_dev, "manufacturer"));
 }
 
 static void
-p_udev_add_v4l(struct prober_device *pdev, uint32_t v4l_index, uint32_t usb_iface, const char *path)
+p_udev_parse_v4l2(struct prober *p, struct udev_device *raw_dev, struct prober_udev_entry *e)
 {
-#ifdef XRT_HAVE_V4L2
-	U_ARRAY_REALLOC_OR_FREE(pdev->v4ls, struct prober_v4l, (pdev->num_v4ls + 1));
+	struct udev_device *usb_device = NULL;
+	int ret;
 
-	struct prober_v4l *v4l = &pdev->v4ls[pdev->num_v4ls++];
-	U_ZERO(v4l);
+	// The thing we will open.
+	const char *dev_path = udev_device_get_devnode(raw_dev);
 
-	v4l->usb_iface = usb_iface;
-	v4l->v4l_index = v4l_index;
-	v4l->path = strdup(path);
-#endif
+	ret = p_udev_try_usb_relation_get_address(raw_dev, &e->dev_class, &e->vendor_id, &e->product_id, &e->usb_bus,
+	                                          &e->usb_addr, &usb_device);
+	if (ret != 0) {
+		P_DEBUG(p, "skipping non-usb v4l device '%s'", dev_path);
+		e->skip = true;
+		return;
+	}
+
+	// USB interface.
+	ret = p_udev_get_interface_number(raw_dev, &e->usb_iface);
+	if (ret != 0) {
+		P_ERROR(p,
+		        "In enumerating V4L2 devices: "
+		        "Failed to get interface number for '%s'",
+		        e->sysfs_path);
+		e->skip = e->retry = true;
+		return;
+	}
+
+	// USB interface.
+	ret = p_udev_get_sysattr_u32_base10(raw_dev, "index", &e->v4l_index);
+	if (ret != 0) {
+		P_ERROR(p, "Failed to get v4l index.");
+		e->skip = e->retry = true;
+		return;
+	}
+
+	e->dev_path = p_udev_strdup_or_null(dev_path);
+	// Serial number.
+	e->serial = p_udev_strdup_or_null(udev_device_get_sysattr_value(usb_device, "serial"));
+	// Product name.
+	e->product = p_udev_strdup_or_null(udev_device_get_sysattr_value(usb_device, "product"));
+	// Manufacturer name.
+	e->manufacturer = p_udev_strdup_or_null(udev_device_get_sysattr_value(usb_device, "manufacturer"));
+}
+
+static void
+p_udev_parse_hidraw(struct prober *p, struct udev_device *raw_dev, struct prober_udev_entry *e)
+{
+	int ret;
+
+	// Bus type, vendor_id and product_id.
+	ret = p_udev_get_and_parse_uevent(raw_dev, &e->bus_type, &e->vendor_id, &e->product_id,
+	                                  &e->bluetooth_product, &e->bluetooth_id);
+	if (ret != 0) {
+		P_ERROR(p, "Failed to get uevent info from device");
+		e->skip = e->retry = true;
+		return;
+	}
+
+	// Get USB bus and address to de-duplicate devices.
+	ret = p_udev_get_usb_hid_address(raw_dev, e->bus_type, &e->dev_class, &e->usb_bus, &e->usb_addr);
+	if (ret != 0) {
+		P_ERROR(p, "Failed to get USB bus and addr.");
+		e->skip = e->retry = true;
+		return;
+	}
+
+	switch (e->bus_type) {
+	case HIDRAW_BUS_BLUETOOTH:
+	case HIDRAW_BUS_USB: break;
+	case HIDRAW_BUS_I2C_MAYBE_QUESTION_MARK: e->skip = true; return;
+	default:
+		P_ERROR(p, "Unknown hidraw bus_type: '%i', ignoring.", e->bus_type);
+		e->skip = true;
+		return;
+	}
+
+	// HID interface.
+	ret = p_udev_get_interface_number(raw_dev, &e->usb_iface);
+	if (ret != 0) {
+		P_ERROR(p,
+		        "In enumerating hidraw devices: "
+		        "Failed to get interface number for '%s'",
+		        e->sysfs_path);
+		e->skip = e->retry = true;
+		return;
+	}
+
+	// The thing we will open.
+	e->dev_path = p_udev_strdup_or_null(udev_device_get_devnode(raw_dev));
+}
+
+static void
+p_udev_parse_entry(struct prober *p,
+                   struct udev_device *raw_dev,
+                   enum prober_udev_entry_type type,
+                   const char *sysfs_path,
+                   dev_t devnum,
+                   dev_t usb_devnum,
+                   struct prober_udev_entry *e)
+{
+	U_ZERO(e);
+	e->type = type;
+	e->sysfs_path = strdup(sysfs_path);
+	e->devnum = devnum;
+	e->usb_devnum = usb_devnum;
+
+	switch (type) {
+	case PROBER_UDEV_ENTRY_USB: p_udev_parse_usb(p, raw_dev, e); break;
+	case PROBER_UDEV_ENTRY_V4L: p_udev_parse_v4l2(p, raw_dev, e); break;
+	case PROBER_UDEV_ENTRY_HIDRAW: p_udev_parse_hidraw(p, raw_dev, e); break;
+	}
 }
 
 static void
-p_udev_enumerate_hidraw(struct prober *p, struct udev *udev)
+p_udev_enumerate(struct prober *p,
+                 struct udev *udev,
+                 enum prober_udev_entry_type type,
+                 struct prober_udev_entry **entries,
+                 size_t *entry_count)
 {
 	struct udev_enumerate *enumerate;
 	struct udev_list_entry *devices;
 	struct udev_list_entry *dev_list_entry;
 
 	enumerate = udev_enumerate_new(udev);
-	udev_enumerate_add_match_subsystem(enumerate, "hidraw");
+	switch (type) {
+	case PROBER_UDEV_ENTRY_USB:
+		udev_enumerate_add_match_subsystem(enumerate, "usb");
+		udev_enumerate_add_match_property(enumerate, "DEVTYPE", "usb_device");
+		break;
+	case PROBER_UDEV_ENTRY_V4L: udev_enumerate_add_match_subsystem(enumerate, "video4linux"); break;
+	case PROBER_UDEV_ENTRY_HIDRAW: udev_enumerate_add_match_subsystem(enumerate, "hidraw"); break;
+	}
 	udev_enumerate_scan_devices(enumerate);
 
 	devices = udev_enumerate_get_list_entry(enumerate);
-
 	udev_list_entry_foreach(dev_list_entry, devices)
 	{
-		struct prober_device *pdev = NULL;
-		struct udev_device *raw_dev = NULL;
-		uint16_t vendor_id;
-		uint16_t product_id;
-		uint16_t interface;
-		uint8_t dev_class = 0;
-		uint16_t usb_bus = 0;
-		uint16_t usb_addr = 0;
-		uint32_t bus_type = 0;
-		uint64_t bluetooth_id = 0;
-		char product_name[P_PROBER_BLUETOOTH_PRODUCT_COUNT] = {0};
-		const char *sysfs_path;
-		const char *dev_path;
-		int ret;
-
 		// Where in the sysfs is.
-		sysfs_path = udev_list_entry_get_name(dev_list_entry);
+		const char *sysfs_path = udev_list_entry_get_name(dev_list_entry);
 		// Raw sysfs node.
-		raw_dev = udev_device_new_from_syspath(udev, sysfs_path);
-		// The thing we will open.
-		dev_path = udev_device_get_devnode(raw_dev);
-
-		// Bus type, vendor_id and product_id.
-		ret = p_udev_get_and_parse_uevent(raw_dev, &bus_type, &vendor_id, &product_id, &product_name,
-		                                  &bluetooth_id);
-		if (ret != 0) {
-			P_ERROR(p, "Failed to get uevent info from device");
-			goto next;
+		struct udev_device *raw_dev = udev_device_new_from_syspath(udev, sysfs_path);
+		if (raw_dev == NULL) {
+			continue;
 		}
 
-		// Get USB bus and address to de-duplicate devices.
-		ret = p_udev_get_usb_hid_address(raw_dev, bus_type, &dev_class, &usb_bus, &usb_addr);
-		if (ret != 0) {
-			P_ERROR(p, "Failed to get USB bus and addr.");
-			goto next;
-		}
+		dev_t devnum = udev_device_get_devnum(raw_dev);
+		dev_t usb_devnum = p_udev_get_usb_devnum(raw_dev, type);
 
-		switch (bus_type) {
-		case HIDRAW_BUS_BLUETOOTH:
-		case HIDRAW_BUS_USB: break;
-		case HIDRAW_BUS_I2C_MAYBE_QUESTION_MARK: goto next;
-		default: P_ERROR(p, "Unknown hidraw bus_type: '%i', ignoring.", bus_type); goto next;
-		}
+		U_ARRAY_REALLOC_OR_FREE(*entries, struct prober_udev_entry, (*entry_count + 1));
+		struct prober_udev_entry *e = &(*entries)[(*entry_count)++];
 
-		// HID interface.
-		ret = p_udev_get_interface_number(raw_dev, &interface);
-		if (ret != 0) {
-			P_ERROR(p,
-			        "In enumerating hidraw devices: "
-			        "Failed to get interface number for '%s'",
-			        sysfs_path);
-			goto next;
+		if (p_udev_take_cached_entry(p, type, sysfs_path, devnum, usb_devnum, e)) {
+			p->probe_timing.udev_reused++;
+			udev_device_unref(raw_dev);
+			continue;
 		}
 
-		if (bus_type == HIDRAW_BUS_BLUETOOTH) {
-			ret = p_dev_get_bluetooth_dev(p, bluetooth_id, vendor_id, product_id, product_name, &pdev);
-		} else if (bus_type == HIDRAW_BUS_USB) {
-			ret = p_dev_get_usb_dev(p, usb_bus, usb_addr, vendor_id, product_id, &pdev);
-		} else {
-			// Right now only support USB & Bluetooth devices.
-			P_ERROR(p,
-			        "Ignoring none USB or Bluetooth hidraw device "
-			        "'%u'.",
-			        bus_type);
-			goto next;
-		}
+		p_udev_parse_entry(p, raw_dev, type, sysfs_path, devnum, usb_devnum, e);
 
-		P_TRACE(p,
-		        "hidraw\n"
-		        "\t\tptr:          %p (%i)\n"
-		        "\t\tsysfs_path:   '%s'\n"
-		        "\t\tdev_path:     '%s'\n"
-		        "\t\tbus_type:     %i\n"
-		        "\t\tvendor_id:    %04x\n"
-		        "\t\tproduct_id:   %04x\n"
-		        "\t\tproduct_name: '%s'\n"
-		        "\t\tinterface:    %i\n"
-		        "\t\tusb_bus:      %i\n"
-		        "\t\tusb_addr:     %i\n"
-		        "\t\tbluetooth_id: %012" PRIx64,
-		        (void *)pdev, ret, sysfs_path, dev_path, bus_type, vendor_id, product_id, product_name,
-		        interface, usb_bus, usb_addr, bluetooth_id);
+		p->probe_timing.udev_parsed++;
+		udev_device_unref(raw_dev);
+	}
 
-		if (ret != 0) {
-			P_ERROR(p, "p_dev_get_usb_device failed!");
-			goto next;
-		}
+	udev_enumerate_unref(enumerate);
+}
+
+static void
+p_udev_add_entry(struct prober *p, struct prober_udev_entry *e)
+{
+	struct prober_device *pdev = NULL;
+	const char *what = "usb";
+	int ret;
+
+	if (e->type == PROBER_UDEV_ENTRY_HIDRAW && e->bus_type == HIDRAW_BUS_BLUETOOTH) {
+		ret = p_dev_get_bluetooth_dev(p, e->bluetooth_id, e->vendor_id, e->product_id, e->bluetooth_product,
+		                              &pdev);
+	} else {
+		ret = p_dev_get_usb_dev(p, e->usb_bus, e->usb_addr, e->vendor_id, e->product_id, &pdev);
+	}
+
+	switch (e->type) {
+	case PROBER_UDEV_ENTRY_USB: what = "usb"; break;
+	case PROBER_UDEV_ENTRY_V4L: what = "v4l"; break;
+	case PROBER_UDEV_ENTRY_HIDRAW: what = "hidraw"; break;
+	}
+
+	P_TRACE(p,
+	        "%s\n"
+	        "\t\tptr:          %p (%i)\n"
+	        "\t\tsysfs_path:   '%s'\n"
+	        "\t\tdev_path:     '%s'\n"
+	        "\t\tdev_class:    %02x\n"
+	        "\t\tbus_type:     %i\n"
+	        "\t\tvendor_id:    %04x\n"
+	        "\t\tproduct_id:   %04x\n"
+	        "\t\tv4l_index:    %u\n"
+	        "\t\tusb_iface:    %i\n"
+	        "\t\tusb_bus:      %i\n"
+	        "\t\tusb_addr:     %i\n"
+	        "\t\tbluetooth_id: %012" PRIx64 "\n"
+	        "\t\tserial:       '%s'\n"
+	        "\t\tproduct:      '%s'\n"
+	        "\t\tmanufacturer: '%s'",
+	        what, (void *)pdev, ret, e->sysfs_path, e->dev_path, e->dev_class, e->bus_type, e->vendor_id,
+	        e->product_id, e->v4l_index, e->usb_iface, e->usb_bus, e->usb_addr, e->bluetooth_id, e->serial,
+	        e->type == PROBER_UDEV_ENTRY_HIDRAW ? e->bluetooth_product : e->product, e->manufacturer);
+
+	if (ret != 0) {
+		P_ERROR(p, "p_dev_get_usb_device failed!");
+		return;
+	}
 
+	switch (e->type) {
+	case PROBER_UDEV_ENTRY_USB:
+		// Add info to usb device.
+		p_udev_add_usb(pdev, e->dev_class, e->product, e->manufacturer, e->serial, e->dev_path);
+		break;
+	case PROBER_UDEV_ENTRY_V4L:
+		// Add this interface to the usb device.
+		p_udev_add_v4l(pdev, e->v4l_index, e->usb_iface, e->dev_path);
+		break;
+	case PROBER_UDEV_ENTRY_HIDRAW:
 		// Add this interface to the usb device.
-		p_udev_add_hidraw(pdev, interface, dev_path);
+		p_udev_add_hidraw(pdev, e->usb_iface, e->dev_path);
+		break;
+	}
+}
 
-	next:
-		udev_device_unref(raw_dev);
+static void
+p_udev_add_usb(struct prober_device *pdev,
+               uint8_t dev_class,
+               const char *product,
+               const char *manufacturer,
+               const char *serial,
+               const char *path)
+{
+	pdev->base.usb_dev_class = dev_class;
+
+	if (product != NULL) {
+		pdev->usb.product = strdup(product);
+	}
+	if (manufacturer != NULL) {
+		pdev->usb.manufacturer = strdup(manufacturer);
+	}
+	if (serial != NULL) {
+		pdev->usb.serial = strdup(serial);
+	}
+	if (path != NULL) {
+		pdev->usb.path = strdup(path);
 	}
+}
 
-	udev_enumerate_unref(enumerate);
+static void
+p_udev_add_v4l(struct prober_device *pdev, uint32_t v4l_index, uint32_t usb_iface, const char *path)
+{
+#ifdef XRT_HAVE_V4L2
+	U_ARRAY_REALLOC_OR_FREE(pdev->v4ls, struct prober_v4l, (pdev->num_v4ls + 1));
+
+	struct prober_v4l *v4l = &pdev->v4ls[pdev->num_v4ls++];
+	U_ZERO(v4l);
+
+	v4l->usb_iface = usb_iface;
+	v4l->v4l_index = v4l_index;
+	v4l->path = strdup(path);
+#endif
 }
 
 static void
@@ -828,3 +1073,368 @@ p_udev_dump_device(struct udev_device *udev_dev, const char *name)
 	U_LOG_I("\t\tsubsystem: %s", udev_device_get_subsystem(udev_dev));
 	U_LOG_I("\t\tsysfs.product: %s", udev_device_get_sysattr_value(udev_dev, "product"));
 }
+
+
+/*
+ *
+ * Hotplug functions.
+ *
+ */
+
+static struct p_udev_device_key
+p_udev_entry_key(const struct prober_udev_entry *e)
+{
+	struct p_udev_device_key key = {0};
+
+	if (e->type == PROBER_UDEV_ENTRY_HIDRAW && e->bus_type == HIDRAW_BUS_BLUETOOTH) {
+		key.bluetooth = true;
+		key.bluetooth_id = e->bluetooth_id;
+	} else {
+		key.usb_bus = e->usb_bus;
+		key.usb_addr = e->usb_addr;
+	}
+
+	return key;
+}
+
+static bool
+p_udev_key_equal(const struct p_udev_device_key *a, const struct p_udev_device_key *b)
+{
+	if (a->bluetooth != b->bluetooth) {
+		return false;
+	}
+	if (a->bluetooth) {
+		return a->bluetooth_id == b->bluetooth_id;
+	}
+	return a->usb_bus == b->usb_bus && a->usb_addr == b->usb_addr;
+}
+
+static struct prober_device *
+p_udev_find_device(struct prober *p, const struct p_udev_device_key *key)
+{
+	for (size_t i = 0; i < p->device_count; i++) {
+		struct prober_device *pdev = &p->devices[i];
+
+		if (key->bluetooth) {
+			if (pdev->base.bus == XRT_BUS_TYPE_BLUETOOTH && pdev->bluetooth.id == key->bluetooth_id) {
+				return pdev;
+			}
+		} else {
+			if (pdev->base.bus == XRT_BUS_TYPE_USB && pdev->usb.bus == key->usb_bus &&
+			    pdev->usb.addr == key->usb_addr) {
+				return pdev;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * Move the cached entry at the sysfs path out of the list, keeping the order
+ * of the rest.
+ */
+static bool
+p_udev_take_entry_by_path(struct prober *p,
+                          enum prober_udev_entry_type type,
+                          const char *sysfs_path,
+                          struct prober_udev_entry *out_entry)
+{
+	for (size_t i = 0; i < p->udev.entry_count; i++) {
+		struct prober_udev_entry *e = &p->udev.entries[i];
+
+		if (e->type != type || e->sysfs_path == NULL || strcmp(e->sysfs_path, sysfs_path) != 0) {
+			continue;
+		}
+
+		*out_entry = *e;
+
+		for (size_t k = i + 1; k < p->udev.entry_count; k++) {
+			p->udev.entries[k - 1] = p->udev.entries[k];
+		}
+		p->udev.entry_count--;
+
+		return true;
+	}
+
+	return false;
+}
+
+/*!
+ * Put the device back together from the cached entries that belong to it, the
+ * same way @ref p_udev_probe would, but without touching any other device.
+ */
+static void
+p_udev_rebuild_device(struct prober *p,
+                      const struct p_udev_device_key *key,
+                      struct p_udev_device_change *changes,
+                      size_t *change_count,
+                      bool *out_new_usb)
+{
+	struct p_udev_device_change change = {.key = *key};
+
+	struct prober_device *pdev = p_udev_find_device(p, key);
+	bool existed = pdev != NULL;
+	if (existed) {
+		change.vendor_id = pdev->base.vendor_id;
+		change.product_id = pdev->base.product_id;
+
+		// Keeps any libusb and libuvc device, the rest comes from udev.
+		p_dev_reset(pdev);
+	}
+
+	for (size_t i = 0; i < p->udev.entry_count; i++) {
+		struct prober_udev_entry *e = &p->udev.entries[i];
+		if (e->skip) {
+			continue;
+		}
+
+		struct p_udev_device_key e_key = p_udev_entry_key(e);
+		if (!p_udev_key_equal(&e_key, key)) {
+			continue;
+		}
+
+		p_udev_add_entry(p, e);
+
+		change.vendor_id = e->vendor_id;
+		change.product_id = e->product_id;
+		change.present = true;
+	}
+
+	if (!existed && !change.present) {
+		return;
+	}
+
+	if (existed && !change.present) {
+		// Nothing has been added, so the pointer is still good.
+		p_dev_remove(p, pdev);
+	}
+
+	if (!existed && !key->bluetooth) {
+		*out_new_usb = true;
+	}
+
+	// Several events for the same device in one go only count once.
+	for (size_t i = 0; i < *change_count; i++) {
+		if (p_udev_key_equal(&changes[i].key, key)) {
+			changes[i] = change;
+			return;
+		}
+	}
+
+	changes[(*change_count)++] = change;
+}
+
+static void
+p_udev_hotplug_apply(struct prober *p,
+                     struct prober_hotplug_event *event,
+                     struct p_udev_device_change *changes,
+                     size_t *change_count,
+                     bool *out_new_usb)
+{
+	struct prober_udev_entry old;
+	bool had_old = p_udev_take_entry_by_path(p, event->entry.type, event->entry.sysfs_path, &old);
+
+	struct p_udev_device_key key = {0};
+	bool added = false;
+
+	if (event->action == PROBER_HOTPLUG_ADD) {
+		// The entry is now owned by the list.
+		U_ARRAY_REALLOC_OR_FREE(p->udev.entries, struct prober_udev_entry, (p->udev.entry_count + 1));
+		struct prober_udev_entry *e = &p->udev.entries[p->udev.entry_count++];
+		*e = event->entry;
+
+		if (!e->skip) {
+			key = p_udev_entry_key(e);
+			added = true;
+			p_udev_rebuild_device(p, &key, changes, change_count, out_new_usb);
+		}
+	} else {
+		p_udev_free_entry(&event->entry);
+	}
+
+	U_ZERO(&event->entry);
+
+	if (!had_old) {
+		return;
+	}
+
+	// The entry used to belong to another device, or was removed.
+	struct p_udev_device_key old_key = p_udev_entry_key(&old);
+	if (!old.skip && !(added && p_udev_key_equal(&old_key, &key))) {
+		p_udev_rebuild_device(p, &old_key, changes, change_count, out_new_usb);
+	}
+
+	p_udev_free_entry(&old);
+}
+
+static bool
+p_udev_get_entry_type(struct udev_device *raw_dev, enum prober_udev_entry_type *out_type)
+{
+	const char *subsystem = udev_device_get_subsystem(raw_dev);
+	const char *devtype = udev_device_get_devtype(raw_dev);
+
+	if (subsystem == NULL) {
+		return false;
+	}
+
+	if (strcmp(subsystem, "usb") == 0 && devtype != NULL && strcmp(devtype, "usb_device") == 0) {
+		*out_type = PROBER_UDEV_ENTRY_USB;
+	} else if (strcmp(subsystem, "video4linux") == 0) {
+		*out_type = PROBER_UDEV_ENTRY_V4L;
+	} else if (strcmp(subsystem, "hidraw") == 0) {
+		*out_type = PROBER_UDEV_ENTRY_HIDRAW;
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+static int
+p_udev_monitor_get_fd(struct prober_hotplug_source *src)
+{
+	struct p_udev_monitor *m = (struct p_udev_monitor *)src;
+
+	return udev_monitor_get_fd(m->monitor);
+}
+
+static bool
+p_udev_monitor_next_event(struct prober_hotplug_source *src, struct prober *p, struct prober_hotplug_event *out_event)
+{
+	struct p_udev_monitor *m = (struct p_udev_monitor *)src;
+
+	while (true) {
+		// The monitor socket is non-blocking, NULL when drained.
+		struct udev_device *raw_dev = udev_monitor_receive_device(m->monitor);
+		if (raw_dev == NULL) {
+			return false;
+		}
+
+		enum prober_udev_entry_type type;
+		const char *action = udev_device_get_action(raw_dev);
+		const char *sysfs_path = udev_device_get_syspath(raw_dev);
+		bool add = action != NULL && strcmp(action, "add") == 0;
+		bool remove = action != NULL && strcmp(action, "remove") == 0;
+
+		// Things like bind and change don't change what we list.
+		if ((!add && !remove) || sysfs_path == NULL || !p_udev_get_entry_type(raw_dev, &type)) {
+			udev_device_unref(raw_dev);
+			continue;
+		}
+
+		U_ZERO(out_event);
+
+		if (add) {
+			dev_t devnum = udev_device_get_devnum(raw_dev);
+			dev_t usb_devnum = p_udev_get_usb_devnum(raw_dev, type);
+
+			out_event->action = PROBER_HOTPLUG_ADD;
+			p_udev_parse_entry(p, raw_dev, type, sysfs_path, devnum, usb_devnum, &out_event->entry);
+		} else {
+			out_event->action = PROBER_HOTPLUG_REMOVE;
+			out_event->entry.type = type;
+			out_event->entry.sysfs_path = strdup(sysfs_path);
+		}
+
+		P_DEBUG(p, "Hotplug %s '%s'", action, sysfs_path);
+
+		udev_device_unref(raw_dev);
+
+		return true;
+	}
+}
+
+static void
+p_udev_monitor_destroy(struct prober_hotplug_source *src)
+{
+	struct p_udev_monitor *m = (struct p_udev_monitor *)src;
+
+	udev_monitor_unref(m->monitor);
+	udev_unref(m->udev);
+	free(m);
+}
+
+static int
+p_udev_monitor_create(struct prober *p, struct prober_hotplug_source **out_src)
+{
+	struct udev *udev = udev_new();
+	if (udev == NULL) {
+		P_ERROR(p, "Can't create udev");
+		return -1;
+	}
+
+	struct udev_monitor *monitor = udev_monitor_new_from_netlink(udev, "udev");
+	if (monitor == NULL) {
+		P_ERROR(p, "Can't create udev monitor");
+		udev_unref(udev);
+		return -1;
+	}
+
+	// Same subsystems as p_udev_enumerate.
+	udev_monitor_filter_add_match_subsystem_devtype(monitor, "usb", "usb_device");
+	udev_monitor_filter_add_match_subsystem_devtype(monitor, "video4linux", NULL);
+	udev_monitor_filter_add_match_subsystem_devtype(monitor, "hidraw", NULL);
+
+	if (udev_monitor_enable_receiving(monitor) < 0) {
+		P_ERROR(p, "Can't start receiving udev events");
+		udev_monitor_unref(monitor);
+		udev_unref(udev);
+		return -1;
+	}
+
+	struct p_udev_monitor *m = U_TYPED_CALLOC(struct p_udev_monitor);
+	m->base.get_fd = p_udev_monitor_get_fd;
+	m->base.next_event = p_udev_monitor_next_event;
+	m->base.destroy = p_udev_monitor_destroy;
+	m->udev = udev;
+	m->monitor = monitor;
+
+	*out_src = &m->base;
+
+	return 0;
+}
+
+#ifdef XRT_HAVE_LIBUSB
+/*!
+ * libusb learns about new devices from its own hotplug thread, which can be
+ * behind our monitor, keep trying on the following polls before giving up.
+ */
+static void
+p_udev_hotplug_refresh_usb(struct prober *p)
+{
+	bool last_try = --p->hotplug.usb_refresh_tries == 0;
+
+	int missing = p_libusb_refresh(p, last_try);
+	if (missing <= 0) {
+		p->hotplug.usb_refresh_tries = 0;
+	} else if (last_try) {
+		P_WARN(p, "libusb never listed %i hotplugged USB device(s)", missing);
+	}
+}
+#endif
+
+static void *
+p_udev_hotplug_run(void *ptr)
+{
+	struct prober *p = (struct prober *)ptr;
+	struct prober_hotplug_source *src = p->hotplug.source;
+
+	U_TRACE_SET_THREAD_NAME("Prober: Hotplug");
+
+	// A negative fd is ignored by poll, then it's just a timeout.
+	struct pollfd pfd = {.fd = src->get_fd(src), .events = POLLIN};
+
+	os_thread_helper_lock(&p->hotplug.oth);
+	while (os_thread_helper_is_running_locked(&p->hotplug.oth)) {
+		os_thread_helper_unlock(&p->hotplug.oth);
+
+		poll(&pfd, 1, P_UDEV_HOTPLUG_POLL_MS);
+		p_udev_hotplug_poll(p);
+
+		os_thread_helper_lock(&p->hotplug.oth);
+	}
+	os_thread_helper_unlock(&p->hotplug.oth);
+
+	return NULL;
+}
@@ -0,0 +1,62 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief  Converts EuRoC datasets to and from capture containers.
+ */
+
+#include "xrt/xrt_config_have.h"
+#include "xrt/xrt_config_os.h"
+
+#include "cli_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#if defined(XRT_HAVE_OPENCV) && !defined(XRT_OS_WINDOWS)
+#include "tracking/t_euroc_container.h"
+#endif
+
+#define P(...) fprintf(stderr, __VA_ARGS__)
+
+
+int
+cli_cmd_euroc_convert(int argc, const char **argv)
+{
+#if !defined(XRT_HAVE_OPENCV) || defined(XRT_OS_WINDOWS)
+	P("Built without OpenCV or on Windows, can't convert EuRoC datasets.\n");
+	return EXIT_FAILURE;
+#else
+	if (argc != 4) {
+		P("Converts a EuRoC dataset folder to a capture container (" T_EUROC_CONTAINER_EXT ") or back.\n");
+		P("Usage: %s %s <input> <output>\n", argv[0], argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	const char *input = argv[2];
+	const char *output = argv[3];
+
+	struct stat st;
+	if (stat(input, &st) != 0) {
+		P("Could not find '%s'.\n", input);
+		return EXIT_FAILURE;
+	}
+
+	bool ok = false;
+	if (S_ISDIR(st.st_mode)) {
+		P("Converting dataset folder '%s' to container '%s'.\n", input, output);
+		ok = t_euroc_container_from_folder(input, output);
+	} else {
+		P("Converting container '%s' to dataset folder '%s'.\n", input, output);
+		ok = t_euroc_container_to_folder(input, output);
+	}
+
+	if (!ok) {
+		P("Conversion failed.\n");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+#endif
+}
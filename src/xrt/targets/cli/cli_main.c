@@ -34,6 +34,7 @@ cli_print_help(int argc, const char **argv)
 	P("  calibrate  - Calibrate a camera and save config (not implemented yet).\n");
 	P("  calib-dump - Load and dump a calibration to stdout.\n");
 	P("  slambatch  - Runs a sequence of EuRoC datasets with the SLAM tracker.\n");
+	P("  euroc-convert - Convert a EuRoC dataset folder to a capture container or back.\n");
 
 	return 1;
 }
@@ -68,5 +69,8 @@ main(int argc, const char **argv)
 	if (strcmp(argv[1], "slambatch") == 0) {
 		return cli_cmd_slambatch(argc, argv);
 	}
+	if (strcmp(argv[1], "euroc-convert") == 0) {
+		return cli_cmd_euroc_convert(argc, argv);
+	}
 	return cli_print_help(argc, argv);
 }
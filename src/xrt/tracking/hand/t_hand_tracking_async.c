@@ -53,6 +53,12 @@ struct ht_async_impl
 		struct xrt_hand_joint_set hands[2];
 		struct m_relation_history *relation_hist[2];
 		uint64_t timestamp;
+
+		/*!
+		 * The joints of @ref hands relative to their wrist, so getting a
+		 * predicted hand is only applying the predicted wrist to them.
+		 */
+		struct m_relation_set wrist_joints[2];
 	} present;
 
 	// in here:
@@ -77,6 +83,24 @@ ht_async_impl(struct t_hand_tracking_async *base)
 	return (struct ht_async_impl *)base;
 }
 
+static void
+joints_relative_to_wrist(const struct xrt_hand_joint_set *hand, struct m_relation_set *out_set)
+{
+	const struct xrt_hand_joint_value *joints = hand->values.hand_joint_set_default;
+
+	struct xrt_space_relation wrist = joints[XRT_HAND_JOINT_WRIST].relation;
+	struct xrt_space_relation inv_wrist;
+	m_space_relation_invert(&wrist, &inv_wrist);
+
+	struct m_relation_set set;
+	set.count = 0;
+	for (uint32_t i = 0; i < XRT_HAND_JOINT_COUNT; i++) {
+		m_relation_set_store(&set, i, &joints[i].relation);
+	}
+
+	m_relation_set_apply(&set, &inv_wrist, out_set);
+}
+
 static void *
 ht_async_mainloop(void *ptr)
 {
@@ -123,12 +147,19 @@ ht_async_mainloop(void *ptr)
 		 * Post process.
 		 */
 
+		// Done once per result instead of for every get_hand call.
+		struct m_relation_set wrist_joints[2];
+		for (int i = 0; i < 2; i++) {
+			joints_relative_to_wrist(&hta->working.hands[i], &wrist_joints[i]);
+		}
+
 		os_mutex_lock(&hta->present.mutex);
 
 		hta->present.timestamp = hta->working.timestamp;
 
 		for (int i = 0; i < 2; i++) {
 			hta->present.hands[i] = hta->working.hands[i];
+			hta->present.wrist_joints[i] = wrist_joints[i];
 		}
 
 		os_mutex_unlock(&hta->present.mutex);
@@ -271,19 +302,14 @@ ht_async_get_hand(struct t_hand_tracking_async *ht_async,
 		idx = 1;
 	}
 
-	os_mutex_lock(&hta->present.mutex);
-
-	struct xrt_hand_joint_set latest_hand = hta->present.hands[idx];
-
 	if (!hta->use_prediction) {
-		*out_value = latest_hand;
+		os_mutex_lock(&hta->present.mutex);
+		*out_value = hta->present.hands[idx];
 		*out_timestamp_ns = hta->present.timestamp;
 		os_mutex_unlock(&hta->present.mutex);
 		return;
 	}
 
-	os_mutex_unlock(&hta->present.mutex);
-
 	double prediction_offset_ns = (double)hta->prediction_offset_ms.val * (double)U_TIME_1MS_IN_NS;
 
 	desired_timestamp_ns += (uint64_t)prediction_offset_ns;
@@ -291,21 +317,16 @@ ht_async_get_hand(struct t_hand_tracking_async *ht_async,
 	struct xrt_space_relation predicted_wrist;
 	m_relation_history_get(hta->present.relation_hist[idx], desired_timestamp_ns, &predicted_wrist);
 
-	struct xrt_space_relation latest_wrist =
-	    latest_hand.values.hand_joint_set_default[XRT_HAND_JOINT_WRIST].relation;
-
-	*out_value = latest_hand;
+	// Apply the predicted wrist to all the joints, already relative to the latest wrist.
+	struct m_relation_set predicted_joints;
 
-	// apply the pose change from the latest wrist to the predicted wrist
-	// to all the joints on the hand.
+	os_mutex_lock(&hta->present.mutex);
+	*out_value = hta->present.hands[idx];
+	m_relation_set_apply(&hta->present.wrist_joints[idx], &predicted_wrist, &predicted_joints);
+	os_mutex_unlock(&hta->present.mutex);
 
-	//! @todo We could slightly reduce the total number of transforms by putting some of this in ht_async_mainloop
-	for (int i = 0; i < XRT_HAND_JOINT_COUNT; i++) {
-		struct xrt_relation_chain xrc = {0};
-		m_relation_chain_push_relation(&xrc, &latest_hand.values.hand_joint_set_default[i].relation);
-		m_relation_chain_push_inverted_relation(&xrc, &latest_wrist);
-		m_relation_chain_push_relation(&xrc, &predicted_wrist);
-		m_relation_chain_resolve(&xrc, &out_value->values.hand_joint_set_default[i].relation);
+	for (uint32_t i = 0; i < XRT_HAND_JOINT_COUNT; i++) {
+		m_relation_set_load(&predicted_joints, i, &out_value->values.hand_joint_set_default[i].relation);
 	}
 
 	*out_timestamp_ns = desired_timestamp_ns;
@@ -0,0 +1,333 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Action sync tests, on a session put together by hand.
+ */
+
+#include "xrt/xrt_device.h"
+#include "xrt/xrt_system.h"
+
+#include "util/u_hashmap.h"
+#include "util/u_time.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <oxr/oxr_input_transform.h>
+#include <oxr/oxr_logger.h>
+#include <oxr/oxr_objects.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+constexpr size_t DeviceCount = 6;
+constexpr size_t InputsPerDevice = 8;
+
+struct FakeDevice
+{
+	struct xrt_device base = {};
+	struct xrt_input inputs[InputsPerDevice] = {};
+	int updates = 0;
+
+	//! Write new values to all inputs on every update.
+	bool moving = false;
+
+	static void
+	update_inputs(struct xrt_device *xdev)
+	{
+		auto *d = (FakeDevice *)xdev;
+		d->updates++;
+
+		if (!d->moving) {
+			return;
+		}
+		for (struct xrt_input &input : d->inputs) {
+			input.timestamp++;
+			input.value.vec1.x = (float)(input.timestamp % 100) / 100.f;
+		}
+	}
+};
+
+/*!
+ * A focused session with action sets bound to @ref FakeDevice inputs, only
+ * the parts of the state tracker that xrSyncActions touches are filled in.
+ */
+struct FakeSession
+{
+	struct oxr_logger log = {};
+	struct oxr_instance inst = {};
+	struct oxr_system sys = {};
+	struct xrt_system_devices xsysd = {};
+	struct oxr_session sess = {};
+
+	FakeDevice devices[DeviceCount];
+	struct oxr_input_transform identity = {};
+
+	std::vector<std::unique_ptr<oxr_action_set_ref>> set_refs;
+	std::vector<std::unique_ptr<oxr_action_set>> sets;
+	std::vector<std::unique_ptr<oxr_action_ref>> act_refs;
+
+	//! Action set @p s has @p action_counts[s] float actions, spread over @p devices[s].
+	FakeSession(const std::vector<size_t> &action_counts, const std::vector<std::vector<size_t>> &set_devices)
+	{
+		oxr_log_init(&log, "test");
+
+		inst.timekeeping = time_state_create(0);
+		sys.inst = &inst;
+		sys.xsysd = &xsysd;
+		sess.sys = &sys;
+		sess.state = XR_SESSION_STATE_FOCUSED;
+
+		identity.type = INPUT_TRANSFORM_IDENTITY;
+		identity.result_type = XRT_INPUT_TYPE_VEC1_ZERO_TO_ONE;
+
+		for (size_t i = 0; i < DeviceCount; i++) {
+			FakeDevice &d = devices[i];
+			d.base.update_inputs = FakeDevice::update_inputs;
+			d.base.inputs = d.inputs;
+			d.base.input_count = InputsPerDevice;
+			for (struct xrt_input &input : d.inputs) {
+				input.name = XRT_INPUT_INDEX_TRIGGER_VALUE;
+				input.active = true;
+			}
+			xsysd.xdevs[xsysd.xdev_count++] = &d.base;
+		}
+
+		u_hashmap_int_create(&sess.act_sets_attachments_by_key);
+		sess.action_set_attachment_count = action_counts.size();
+		sess.act_set_attachments = U_TYPED_ARRAY_CALLOC(struct oxr_action_set_attachment, action_counts.size());
+
+		for (size_t s = 0; s < action_counts.size(); s++) {
+			set_refs.push_back(std::make_unique<oxr_action_set_ref>());
+			sets.push_back(std::make_unique<oxr_action_set>());
+			sets[s]->act_set_key = (uint32_t)s + 1;
+			sets[s]->data = set_refs[s].get();
+
+			struct oxr_action_set_attachment *act_set_attached = &sess.act_set_attachments[s];
+			act_set_attached->sess = &sess;
+			act_set_attached->act_set_ref = set_refs[s].get();
+			act_set_attached->act_set_key = sets[s]->act_set_key;
+			act_set_attached->action_attachment_count = action_counts[s];
+			act_set_attached->act_attachments =
+			    U_TYPED_ARRAY_CALLOC(struct oxr_action_attachment, action_counts[s]);
+			u_hashmap_int_insert(sess.act_sets_attachments_by_key, sets[s]->act_set_key, act_set_attached);
+
+			for (size_t a = 0; a < action_counts[s]; a++) {
+				act_refs.push_back(std::make_unique<oxr_action_ref>());
+				struct oxr_action_ref *act_ref = act_refs.back().get();
+				act_ref->action_type = XR_ACTION_TYPE_FLOAT_INPUT;
+				act_ref->subaction_paths.left = true;
+
+				FakeDevice &d = devices[set_devices[s][a % set_devices[s].size()]];
+				struct oxr_action_attachment *act_attached = &act_set_attached->act_attachments[a];
+				act_attached->act_set_attached = act_set_attached;
+				act_attached->act_ref = act_ref;
+				act_attached->sess = &sess;
+				act_attached->left.input_count = 1;
+				act_attached->left.inputs = U_TYPED_CALLOC(struct oxr_action_input);
+				act_attached->left.inputs->xdev = &d.base;
+				size_t input_index = (a / set_devices[s].size()) % InputsPerDevice;
+				act_attached->left.inputs->input = &d.inputs[input_index];
+				act_attached->left.inputs->transforms = &identity;
+				act_attached->left.inputs->transform_count = 1;
+			}
+		}
+
+		oxr_session_update_sync_index(&sess);
+	}
+
+	~FakeSession()
+	{
+		for (size_t s = 0; s < sess.action_set_attachment_count; s++) {
+			struct oxr_action_set_attachment *act_set_attached = &sess.act_set_attachments[s];
+			for (size_t a = 0; a < act_set_attached->action_attachment_count; a++) {
+				free(act_set_attached->act_attachments[a].left.inputs);
+			}
+			free(act_set_attached->act_attachments);
+		}
+		free(sess.act_set_attachments);
+		free(sess.last_sync.action_sets);
+		u_hashmap_int_destroy(&sess.act_sets_attachments_by_key);
+		time_state_destroy(&inst.timekeeping);
+	}
+
+	XrResult
+	sync(const std::vector<size_t> &active_sets)
+	{
+		std::vector<XrActiveActionSet> active;
+		for (size_t s : active_sets) {
+			active.push_back({(XrActionSet)(intptr_t)sets[s].get(), XR_NULL_PATH});
+		}
+		return oxr_action_sync_data(&log, &sess, (uint32_t)active.size(), active.data());
+	}
+
+	struct oxr_action_attachment &
+	action(size_t set, size_t index)
+	{
+		return sess.act_set_attachments[set].act_attachments[index];
+	}
+};
+
+bool
+same_state(const struct oxr_action_state &a, const struct oxr_action_state &b, bool check_timestamp)
+{
+	return a.active == b.active && a.changed == b.changed && a.value.vec1.x == b.value.vec1.x &&
+	       (!check_timestamp || a.timestamp == b.timestamp);
+}
+
+} // namespace
+
+
+TEST_CASE("oxr_action_sync_data")
+{
+	// Set 0 uses devices 0 to 3, set 1 uses 4 and 5.
+	std::vector<size_t> counts = {40, 20};
+	std::vector<std::vector<size_t>> set_devices = {{0, 1, 2, 3}, {4, 5}};
+
+	SECTION("only devices of active sets are updated")
+	{
+		FakeSession fs(counts, set_devices);
+
+		REQUIRE(fs.sync({0}) == XR_SUCCESS);
+		for (size_t i = 0; i < DeviceCount; i++) {
+			CAPTURE(i);
+			CHECK(fs.devices[i].updates == (i < 4 ? 1 : 0));
+		}
+
+		REQUIRE(fs.sync({0, 1}) == XR_SUCCESS);
+		for (size_t i = 0; i < DeviceCount; i++) {
+			CAPTURE(i);
+			CHECK(fs.devices[i].updates == (i < 4 ? 2 : 1));
+		}
+	}
+
+	SECTION("changed is only set on the sync a value changes")
+	{
+		FakeSession fs(counts, set_devices);
+		struct xrt_input &input = fs.devices[0].inputs[0];
+		struct oxr_action_attachment &act = fs.action(0, 0);
+		REQUIRE(act.left.inputs->input == &input);
+
+		input.value.vec1.x = 0.25f;
+		input.timestamp = 100;
+		fs.sync({0});
+		CHECK(act.left.current.active);
+		CHECK_FALSE(act.left.current.changed);
+		CHECK(act.left.current.value.vec1.x == 0.25f);
+
+		input.value.vec1.x = 0.5f;
+		input.timestamp = 200;
+		fs.sync({0});
+		CHECK(act.left.current.changed);
+		CHECK(act.any_state.changed);
+		CHECK(act.left.current.timestamp == 200);
+
+		// Nothing new, not recomputed but no longer changed.
+		fs.sync({0});
+		CHECK_FALSE(act.left.current.changed);
+		CHECK_FALSE(act.any_state.changed);
+		CHECK(act.left.current.value.vec1.x == 0.5f);
+		CHECK(act.left.current.timestamp == 200);
+
+		// Like drivers that only write the value, the timestamp stays.
+		input.value.vec1.x = 0.75f;
+		fs.sync({0});
+		CHECK(act.left.current.changed);
+		CHECK(act.left.current.value.vec1.x == 0.75f);
+
+		fs.sync({0});
+		CHECK_FALSE(act.left.current.changed);
+
+		// Losing focus resets everything even without new input.
+		fs.sess.state = XR_SESSION_STATE_VISIBLE;
+		fs.sync({0});
+		CHECK_FALSE(act.left.current.active);
+	}
+
+	SECTION("same result as recomputing every action")
+	{
+		FakeSession fs(counts, set_devices);
+		FakeSession full(counts, set_devices);
+
+		std::mt19937 rng(3);
+		std::uniform_int_distribution<int> device(0, DeviceCount - 1);
+		std::uniform_int_distribution<int> input(0, InputsPerDevice - 1);
+		std::uniform_int_distribution<int> what(0, 9);
+		const std::vector<std::vector<size_t>> requests = {{0}, {1}, {0, 1}};
+
+		uint32_t mismatches = 0;
+		int64_t ts = 1;
+		for (int step = 0; step < 500; step++) {
+			// A few inputs change, sometimes to the same value.
+			for (int n = what(rng); n > 0; n--) {
+				int d = device(rng);
+				int i = input(rng);
+				int w = what(rng);
+				// Not all drivers stamp their inputs.
+				bool stamped = what(rng) >= 3;
+				ts++;
+				for (FakeSession *f : {&fs, &full}) {
+					struct xrt_input &in = f->devices[d].inputs[i];
+					if (stamped) {
+						in.timestamp = ts;
+					}
+					if (w == 0) {
+						in.active = !in.active;
+					} else if (w > 3) {
+						in.value.vec1.x = (float)w / 10.f;
+					}
+				}
+			}
+
+			// Mostly the same request, so most syncs can skip actions.
+			const std::vector<size_t> &request = requests[what(rng) < 8 ? 0 : step % requests.size()];
+			full.sess.last_sync.valid = false;
+			fs.sync(request);
+			full.sync(request);
+
+			for (size_t s = 0; s < counts.size(); s++) {
+				for (size_t a = 0; a < counts[s]; a++) {
+					struct oxr_action_attachment &x = fs.action(s, a);
+					struct oxr_action_attachment &y = full.action(s, a);
+					mismatches += !same_state(x.left.current, y.left.current, true);
+					mismatches += !same_state(x.any_state, y.any_state, false);
+				}
+			}
+		}
+		CHECK(mismatches == 0);
+	}
+}
+
+/*!
+ * Hidden, run with: tests_action_sync "[benchmark]"
+ *
+ * One action set of 200 float actions spread over 6 devices.
+ */
+TEST_CASE("oxr_action_sync_data 200 actions", "[.][benchmark]")
+{
+	FakeSession fs({200}, {{0, 1, 2, 3, 4, 5}});
+
+	BENCHMARK("no input changes")
+	{
+		return fs.sync({0});
+	};
+
+	BENCHMARK("recompute everything")
+	{
+		fs.sess.last_sync.valid = false;
+		return fs.sync({0});
+	};
+
+	for (FakeDevice &d : fs.devices) {
+		d.moving = true;
+	}
+
+	BENCHMARK("all inputs change")
+	{
+		return fs.sync({0});
+	};
+}
@@ -0,0 +1,287 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Distortion mesh generation tests.
+ */
+
+#include "xrt/xrt_device.h"
+
+#include "util/u_device.h"
+#include "util/u_distortion_mesh.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+enum class model
+{
+	vive,
+	panotools,
+	cardboard,
+	ns_p2d,
+	ns_meshgrid,
+};
+
+constexpr model AllModels[] = {model::vive, model::panotools, model::cardboard, model::ns_p2d, model::ns_meshgrid};
+
+const char *
+model_name(model m)
+{
+	switch (m) {
+	case model::vive: return "vive";
+	case model::panotools: return "panotools";
+	case model::cardboard: return "cardboard";
+	case model::ns_p2d: return "ns_p2d";
+	case model::ns_meshgrid: return "ns_meshgrid";
+	}
+	return "unknown";
+}
+
+constexpr int GridPoints = 5;
+
+/*!
+ * A HMD that only does distortion, with made up but plausible values for
+ * each of the built-in models.
+ */
+struct fake_hmd
+{
+	struct xrt_device base;
+
+	model m;
+
+	struct u_vive_values vive[2];
+	struct u_panotools_values panotools;
+	struct u_cardboard_distortion_values cardboard[2];
+	struct u_ns_p2d_values p2d;
+	struct u_ns_meshgrid_values meshgrid;
+	struct xrt_vec2 grid[2][GridPoints * GridPoints];
+};
+
+bool
+fake_hmd_compute_distortion(struct xrt_device *xdev, uint32_t view, float u, float v, struct xrt_uv_triplet *result)
+{
+	auto *fh = (struct fake_hmd *)xdev;
+
+	switch (fh->m) {
+	case model::vive: return u_compute_distortion_vive(&fh->vive[view], u, v, result);
+	case model::panotools: return u_compute_distortion_panotools(&fh->panotools, u, v, result);
+	case model::cardboard: return u_compute_distortion_cardboard(&fh->cardboard[view], u, v, result);
+	case model::ns_p2d: return u_compute_distortion_ns_p2d(&fh->p2d, (int)view, u, v, result);
+	case model::ns_meshgrid: return u_compute_distortion_ns_meshgrid(&fh->meshgrid, (int)view, u, v, result);
+	}
+	return false;
+}
+
+bool
+fake_hmd_compute_distortion_batch(struct xrt_device *xdev,
+                                  uint32_t view,
+                                  uint32_t count,
+                                  const struct xrt_vec2 *uvs,
+                                  struct xrt_uv_triplet *results)
+{
+	auto *fh = (struct fake_hmd *)xdev;
+
+	switch (fh->m) {
+	case model::vive: return u_compute_distortion_vive_batch(&fh->vive[view], count, uvs, results);
+	case model::panotools: return u_compute_distortion_panotools_batch(&fh->panotools, count, uvs, results);
+	case model::cardboard: return u_compute_distortion_cardboard_batch(&fh->cardboard[view], count, uvs, results);
+	case model::ns_p2d: return u_compute_distortion_ns_p2d_batch(&fh->p2d, (int)view, count, uvs, results);
+	case model::ns_meshgrid:
+		return u_compute_distortion_ns_meshgrid_batch(&fh->meshgrid, (int)view, count, uvs, results);
+	}
+	return false;
+}
+
+void
+fake_hmd_destroy(struct xrt_device *xdev)
+{
+	u_device_free(xdev);
+}
+
+struct xrt_fov
+make_fov()
+{
+	struct xrt_fov fov = {};
+	fov.angle_left = -0.8f;
+	fov.angle_right = 0.7f;
+	fov.angle_up = 0.75f;
+	fov.angle_down = -0.8f;
+	return fov;
+}
+
+struct fake_hmd *
+fake_hmd_create(model m, bool batch)
+{
+	auto *fh = U_DEVICE_ALLOCATE(struct fake_hmd, U_DEVICE_ALLOC_HMD, 0, 0);
+	fh->base.destroy = fake_hmd_destroy;
+	fh->base.compute_distortion = fake_hmd_compute_distortion;
+	fh->base.compute_distortion_batch = batch ? fake_hmd_compute_distortion_batch : nullptr;
+	fh->m = m;
+
+	for (int view = 0; view < 2; view++) {
+		float side = view == 0 ? -1.f : 1.f;
+
+		struct u_vive_values &vv = fh->vive[view];
+		vv.aspect_x_over_y = 0.9f;
+		vv.grow_for_undistort = 0.6f;
+		vv.undistort_r2_cutoff = 1.1f;
+		for (int ch = 0; ch < 3; ch++) {
+			vv.center[ch] = {side * 0.05f + ch * 0.001f, 0.01f};
+			vv.coefficients[ch][0] = 0.2f + ch * 0.01f;
+			vv.coefficients[ch][1] = 0.1f;
+			vv.coefficients[ch][2] = 0.05f;
+			vv.coefficients[ch][3] = 0.f;
+		}
+
+		struct u_cardboard_distortion_values &cv = fh->cardboard[view];
+		cv.distortion_k[0] = 0.441f;
+		cv.distortion_k[1] = 0.156f;
+		cv.screen.size = {1.2f, 1.2f};
+		cv.screen.offset = {0.6f + side * 0.02f, 0.6f};
+		cv.texture.size = {1.5f, 1.5f};
+		cv.texture.offset = {0.75f, 0.75f};
+
+		fh->p2d.fov[view] = make_fov();
+		fh->meshgrid.fov[view] = make_fov();
+
+		// Bearings that are a slightly bent version of the fov.
+		for (int v = 0; v < GridPoints; v++) {
+			for (int u = 0; u < GridPoints; u++) {
+				float x = (float)u / (GridPoints - 1) * 2.f - 1.f;
+				float y = (float)v / (GridPoints - 1) * 2.f - 1.f;
+				fh->grid[view][v * GridPoints + u] = {x * (0.8f + 0.05f * y * y), y * (0.8f + 0.05f * x * x)};
+			}
+		}
+		fh->meshgrid.grid[view] = fh->grid[view];
+	}
+
+	fh->panotools.distortion_k[0] = 1.f;
+	fh->panotools.distortion_k[1] = 0.22f;
+	fh->panotools.distortion_k[2] = 0.24f;
+	fh->panotools.aberration_k[0] = 0.996f;
+	fh->panotools.aberration_k[1] = 1.f;
+	fh->panotools.aberration_k[2] = 1.014f;
+	fh->panotools.scale = 0.05f;
+	fh->panotools.lens_center = {0.0635f / 2.f, 0.0355f};
+	fh->panotools.viewport_size = {0.0635f, 0.071f};
+
+	// x = u - 0.5 and y = v - 0.5 with some cross terms.
+	fh->p2d.x_coefficients_left[0] = fh->p2d.x_coefficients_right[0] = -0.5f;
+	fh->p2d.x_coefficients_left[4] = fh->p2d.x_coefficients_right[4] = 1.f;
+	fh->p2d.x_coefficients_left[5] = fh->p2d.x_coefficients_right[5] = 0.05f;
+	fh->p2d.y_coefficients_left[0] = fh->p2d.y_coefficients_right[0] = -0.5f;
+	fh->p2d.y_coefficients_left[1] = fh->p2d.y_coefficients_right[1] = 1.f;
+	fh->p2d.y_coefficients_left[9] = fh->p2d.y_coefficients_right[9] = 0.05f;
+
+	fh->meshgrid.num_grid_points_u = GridPoints;
+	fh->meshgrid.num_grid_points_v = GridPoints;
+
+	return fh;
+}
+
+void
+free_mesh(struct xrt_device *xdev)
+{
+	free(xdev->hmd->distortion.mesh.vertices);
+	xdev->hmd->distortion.mesh.vertices = nullptr;
+	free(xdev->hmd->distortion.mesh.indices);
+	xdev->hmd->distortion.mesh.indices = nullptr;
+}
+
+} // namespace
+
+
+TEST_CASE("u_distortion_mesh batch")
+{
+	model m = GENERATE(from_range(std::begin(AllModels), std::end(AllModels)));
+	uint32_t num = GENERATE(1, 16, 33);
+	CAPTURE(model_name(m), num);
+
+	struct fake_hmd *per_sample = fake_hmd_create(m, false);
+	struct fake_hmd *batched = fake_hmd_create(m, true);
+
+	u_distortion_mesh_fill_in_compute_with_size(&per_sample->base, num);
+	u_distortion_mesh_fill_in_compute_with_size(&batched->base, num);
+
+	const auto &a = per_sample->base.hmd->distortion.mesh;
+	const auto &b = batched->base.hmd->distortion.mesh;
+
+	REQUIRE(a.vertices != nullptr);
+	REQUIRE(b.vertices != nullptr);
+	REQUIRE(a.vertex_count == (num + 1) * (num + 1) * 2);
+	REQUIRE(a.vertex_count == b.vertex_count);
+	REQUIRE(a.index_count_total == b.index_count_total);
+	CHECK(batched->base.hmd->distortion.models & XRT_DISTORTION_MODEL_MESHUV);
+
+	const size_t float_count = (size_t)a.vertex_count * U_DISTORTION_MESH_STRIDE_IN_FLOATS;
+	uint32_t mismatches = 0;
+	for (size_t i = 0; i < float_count; i++) {
+		if (std::fabs(a.vertices[i] - b.vertices[i]) > 1e-6f) {
+			mismatches++;
+		}
+	}
+	CHECK(mismatches == 0);
+
+	for (uint32_t i = 0; i < a.index_count_total; i++) {
+		CHECK(a.indices[i] == b.indices[i]);
+	}
+
+	struct xrt_device *xdev = &per_sample->base;
+	xrt_device_destroy(&xdev);
+	xdev = &batched->base;
+	xrt_device_destroy(&xdev);
+}
+
+TEST_CASE("u_distortion_mesh batch fallback")
+{
+	struct fake_hmd *fh = fake_hmd_create(model::vive, false);
+
+	struct xrt_vec2 uvs[3] = {{0.f, 0.f}, {0.5f, 0.25f}, {1.f, 1.f}};
+	struct xrt_uv_triplet batched[3] = {};
+	REQUIRE(xrt_device_compute_distortion_batch(&fh->base, 1, 3, uvs, batched));
+
+	for (int i = 0; i < 3; i++) {
+		struct xrt_uv_triplet single = {};
+		REQUIRE(xrt_device_compute_distortion(&fh->base, 1, uvs[i].x, uvs[i].y, &single));
+		CHECK(single.r.x == batched[i].r.x);
+		CHECK(single.g.y == batched[i].g.y);
+		CHECK(single.b.x == batched[i].b.x);
+	}
+
+	struct xrt_device *xdev = &fh->base;
+	xrt_device_destroy(&xdev);
+}
+
+/*!
+ * Hidden, run with: tests_distortion_mesh "[benchmark]"
+ */
+TEST_CASE("u_distortion_mesh generate", "[.][benchmark]")
+{
+	for (model m : AllModels) {
+		for (bool batch : {false, true}) {
+			struct fake_hmd *fh = fake_hmd_create(m, batch);
+
+			for (uint32_t num : {64u, 128u, 256u}) {
+				std::string name = std::string(model_name(m)) + " " + std::to_string(num) +
+				                   (batch ? ", batched" : ", per sample");
+
+				BENCHMARK(name.c_str())
+				{
+					u_distortion_mesh_fill_in_compute_with_size(&fh->base, num);
+					float first = fh->base.hmd->distortion.mesh.vertices[2];
+					free_mesh(&fh->base);
+					return first;
+				};
+			}
+
+			struct xrt_device *xdev = &fh->base;
+			xrt_device_destroy(&xdev);
+		}
+	}
+}
@@ -0,0 +1,301 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief EuRoC capture container tests.
+ */
+
+#include "util/u_frame.h"
+
+#include "tracking/t_euroc_container.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+
+namespace {
+
+constexpr uint32_t CamCount = 2;
+constexpr uint32_t FrameCount = 10;
+constexpr uint32_t ImuCount = 200;
+constexpr uint32_t GtCount = 20;
+constexpr uint32_t Width = 33; // Odd so the stride isn't a multiple of the alignment
+constexpr uint32_t Height = 17;
+
+std::string
+temp_path()
+{
+	return (std::filesystem::temp_directory_path() / ("tests_euroc_container_" + std::to_string(getpid()) +
+	                                                  T_EUROC_CONTAINER_EXT))
+	    .string();
+}
+
+int64_t
+frame_ts(uint32_t i)
+{
+	return 1000000000 + (int64_t)i * 33000000;
+}
+
+uint8_t
+pixel(uint32_t cam, uint32_t frame, uint32_t byte)
+{
+	return (uint8_t)(cam * 97 + frame * 13 + byte);
+}
+
+struct xrt_frame *
+make_frame(uint32_t cam, uint32_t i)
+{
+	struct xrt_frame *xf = nullptr;
+	u_frame_create_one_off(cam == 0 ? XRT_FORMAT_L8 : XRT_FORMAT_R8G8B8, Width, Height, &xf);
+	xf->timestamp = frame_ts(i);
+	for (size_t b = 0; b < xf->size; b++) {
+		xf->data[b] = pixel(cam, i, (uint32_t)b);
+	}
+	return xf;
+}
+
+bool
+write_container(const std::string &path)
+{
+	struct t_euroc_container_writer *w = nullptr;
+	REQUIRE(t_euroc_container_writer_create(path.c_str(), CamCount, true, &w));
+
+	for (uint32_t i = 0; i < ImuCount; i++) {
+		struct xrt_imu_sample s = {};
+		s.timestamp_ns = 1000000000 + (int64_t)i * 1000000;
+		s.accel_m_s2 = {0.1 * i, 9.81, -0.2};
+		s.gyro_rad_secs = {0.01, 0.02 * i, 0.03};
+		t_euroc_container_writer_push_imu(w, &s);
+	}
+
+	for (uint32_t i = 0; i < GtCount; i++) {
+		struct xrt_pose_sample s = {};
+		s.timestamp_ns = 1000000000 + (int64_t)i * 10000000;
+		s.pose.position = {0.5f * i, 1.6f, -1.f};
+		s.pose.orientation = {0.f, 0.f, 0.f, 1.f};
+		t_euroc_container_writer_push_gt(w, &s);
+	}
+
+	for (uint32_t i = 0; i < FrameCount; i++) {
+		for (uint32_t cam = 0; cam < CamCount; cam++) {
+			struct xrt_frame *xf = make_frame(cam, i);
+			t_euroc_container_writer_push_frame(w, cam, xf);
+			xrt_frame_reference(&xf, nullptr);
+		}
+	}
+
+	return t_euroc_container_writer_destroy(&w);
+}
+
+//! Overwrites the value at @p offset of the file, negative offsets are from the end
+template <typename T>
+void
+patch_file(const std::string &path, int64_t offset, T value)
+{
+	std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+	REQUIRE(f.is_open());
+	f.seekp(offset, offset < 0 ? std::ios::end : std::ios::beg);
+	f.write((const char *)&value, sizeof(value));
+	REQUIRE(f.good());
+}
+
+template <typename T>
+T
+read_file(const std::string &path, int64_t offset)
+{
+	T value = {};
+	std::ifstream f(path, std::ios::binary);
+	f.seekg(offset, offset < 0 ? std::ios::end : std::ios::beg);
+	f.read((char *)&value, sizeof(value));
+	REQUIRE(f.good());
+	return value;
+}
+
+void
+check_frames(struct t_euroc_container *c)
+{
+	REQUIRE(c->frame_count == FrameCount * CamCount);
+
+	for (uint32_t i = 0; i < FrameCount; i++) {
+		for (uint32_t cam = 0; cam < CamCount; cam++) {
+			CAPTURE(i, cam);
+
+			uint32_t index = 0;
+			REQUIRE(t_euroc_container_find_frame(c, cam, frame_ts(i), &index));
+
+			struct xrt_frame *xf = nullptr;
+			REQUIRE(t_euroc_container_get_frame(c, index, &xf));
+			CHECK(xf->format == (cam == 0 ? XRT_FORMAT_L8 : XRT_FORMAT_R8G8B8));
+			CHECK(xf->width == Width);
+			CHECK(xf->height == Height);
+			CHECK((int64_t)xf->timestamp == frame_ts(i));
+			CHECK((uintptr_t)xf->data % T_EUROC_CONTAINER_ALIGNMENT == 0);
+
+			uint32_t mismatches = 0;
+			for (size_t b = 0; b < xf->size; b++) {
+				if (xf->data[b] != pixel(cam, i, (uint32_t)b)) {
+					mismatches++;
+				}
+			}
+			CHECK(mismatches == 0);
+
+			xrt_frame_reference(&xf, nullptr);
+		}
+	}
+
+	uint32_t index = 0;
+	CHECK_FALSE(t_euroc_container_find_frame(c, 0, frame_ts(0) + 1, &index));
+	CHECK_FALSE(t_euroc_container_find_frame(c, CamCount, frame_ts(0), &index));
+}
+
+} // namespace
+
+
+TEST_CASE("t_euroc_container")
+{
+	std::string path = temp_path();
+	REQUIRE(write_container(path));
+
+	struct t_euroc_container *c = nullptr;
+	REQUIRE(t_euroc_container_open(path.c_str(), &c));
+	CHECK(c->cam_count == CamCount);
+	CHECK_FALSE(c->recovered);
+
+	SECTION("frames round trip")
+	{
+		check_frames(c);
+	}
+
+	SECTION("side tables round trip")
+	{
+		REQUIRE(c->imu_count == ImuCount);
+		struct xrt_imu_sample imu;
+		t_euroc_container_get_imu(c, 7, &imu);
+		CHECK(imu.timestamp_ns == 1007000000);
+		CHECK(imu.accel_m_s2.x == 0.1 * 7);
+		CHECK(imu.gyro_rad_secs.y == 0.02 * 7);
+
+		REQUIRE(c->gt_count == GtCount);
+		struct xrt_pose_sample gt;
+		t_euroc_container_get_gt(c, 3, &gt);
+		CHECK(gt.timestamp_ns == 1030000000);
+		CHECK(gt.pose.position.x == 1.5f);
+		CHECK(gt.pose.orientation.w == 1.f);
+	}
+
+	SECTION("frames keep the mapping alive")
+	{
+		struct xrt_frame *xf = nullptr;
+		REQUIRE(t_euroc_container_get_frame(c, 0, &xf));
+		t_euroc_container_reference(&c, nullptr);
+
+		CHECK(xf->data[1] == pixel(0, 0, 1));
+		xrt_frame_reference(&xf, nullptr);
+	}
+
+	t_euroc_container_reference(&c, nullptr);
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("t_euroc_container recovery")
+{
+	std::string path = temp_path();
+	REQUIRE(write_container(path));
+
+	// Cut the file in the middle of the index, as if recording had been killed.
+	std::filesystem::resize_file(path, std::filesystem::file_size(path) - 100);
+
+	struct t_euroc_container *c = nullptr;
+	REQUIRE(t_euroc_container_open(path.c_str(), &c));
+	CHECK(c->recovered);
+	CHECK(c->imu_count == 0);
+	CHECK(c->gt_count == 0);
+	check_frames(c);
+
+	t_euroc_container_reference(&c, nullptr);
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("t_euroc_container rejects corrupt records")
+{
+	std::string path = temp_path();
+	REQUIRE(write_container(path));
+
+	// The first record is right after the file header.
+	constexpr int64_t First = sizeof(t_euroc_container_file_header);
+	constexpr int64_t Footer = -(int64_t)sizeof(t_euroc_container_footer);
+	uint32_t stride = read_file<uint32_t>(path, First + offsetof(t_euroc_container_frame_header, stride));
+
+	// A broken first record means the index is rejected and recovery stops right away.
+	uint32_t expected_frames = 0;
+
+	SECTION("wider than its stride")
+	{
+		patch_file<uint32_t>(path, First + offsetof(t_euroc_container_frame_header, width), stride + 1);
+	}
+
+	SECTION("unknown format")
+	{
+		patch_file<uint32_t>(path, First + offsetof(t_euroc_container_frame_header, format), 7);
+	}
+
+	SECTION("unaligned record size")
+	{
+		uint64_t record_size =
+		    read_file<uint64_t>(path, First + offsetof(t_euroc_container_frame_header, record_size));
+		patch_file<uint64_t>(path, First + offsetof(t_euroc_container_frame_header, record_size),
+		                     record_size + 8);
+	}
+
+	SECTION("unaligned table in the footer")
+	{
+		int64_t at = Footer + (int64_t)offsetof(t_euroc_container_footer, imu_offset);
+		patch_file<uint64_t>(path, at, read_file<uint64_t>(path, at) + 8);
+
+		// The records themselves are fine.
+		expected_frames = FrameCount * CamCount;
+	}
+
+	struct t_euroc_container *c = nullptr;
+	REQUIRE(t_euroc_container_open(path.c_str(), &c));
+	CHECK(c->recovered);
+	CHECK(c->frame_count == expected_frames);
+
+	t_euroc_container_reference(&c, nullptr);
+	std::filesystem::remove(path);
+}
+
+TEST_CASE("t_euroc_container rejects other files")
+{
+	std::string path = temp_path();
+	struct t_euroc_container *c = nullptr;
+
+	SECTION("directory")
+	{
+		CHECK_FALSE(t_euroc_container_open(std::filesystem::temp_directory_path().c_str(), &c));
+	}
+
+	SECTION("missing")
+	{
+		CHECK_FALSE(t_euroc_container_open(path.c_str(), &c));
+	}
+
+	SECTION("not a container")
+	{
+		FILE *f = fopen(path.c_str(), "wb");
+		REQUIRE(f != nullptr);
+		fputs("#timestamp [ns],filename\r\n", f);
+		fclose(f);
+		CHECK_FALSE(t_euroc_container_open(path.c_str(), &c));
+		std::filesystem::remove(path);
+	}
+
+	CHECK(c == nullptr);
+}
@@ -0,0 +1,235 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Filter fifo tests.
+ */
+
+#include "math/m_filter_fifo.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <random>
+#include <vector>
+
+
+namespace {
+
+struct Sample
+{
+	xrt_vec3 value;
+	uint64_t timestamp_ns;
+};
+
+/*!
+ * Fills @p ff with @p count samples, some sharing a timestamp, and returns them
+ * newest first like the fifo indexes them.
+ */
+std::vector<Sample>
+fill(m_ff_vec3_f32 *ff, size_t count, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> value(-10.f, 10.f);
+	std::uniform_int_distribution<int> step(0, 3);
+
+	std::vector<Sample> samples;
+	uint64_t ts = 1000;
+	for (size_t i = 0; i < count; i++) {
+		Sample s = {{value(rng), value(rng), value(rng)}, ts};
+		m_ff_vec3_f32_push(ff, &s.value, s.timestamp_ns);
+		samples.insert(samples.begin(), s);
+		ts += step(rng);
+	}
+
+	size_t num = m_ff_vec3_f32_get_num(ff);
+	if (samples.size() > num) {
+		samples.resize(num);
+	}
+	return samples;
+}
+
+//! The plain walk over the samples the fifo used to do.
+size_t
+reference_filter(const std::vector<Sample> &samples, uint64_t start_ns, uint64_t stop_ns, xrt_vec3 *out_average)
+{
+	double x = 0, y = 0, z = 0;
+	size_t count = 0;
+
+	for (const Sample &s : samples) {
+		if (s.timestamp_ns < start_ns || s.timestamp_ns > stop_ns) {
+			continue;
+		}
+		x += s.value.x;
+		y += s.value.y;
+		z += s.value.z;
+		count++;
+	}
+
+	*out_average = count == 0 ? xrt_vec3{0, 0, 0} : xrt_vec3{float(x / count), float(y / count), float(z / count)};
+	return count;
+}
+
+} // namespace
+
+
+TEST_CASE("m_filter_fifo")
+{
+	constexpr size_t Num = 100;
+
+	m_ff_vec3_f32 *ff = nullptr;
+	m_ff_vec3_f32_alloc(&ff, Num);
+
+	// Partly filled, wrapped once, and wrapped many times to exercise the rebasing.
+	size_t pushed = GENERATE(1, 37, 100, 101, 250, 100000);
+	CAPTURE(pushed);
+	std::vector<Sample> samples = fill(ff, pushed, (uint32_t)pushed);
+
+	uint64_t newest = samples.front().timestamp_ns;
+	uint64_t oldest = samples.back().timestamp_ns;
+
+	SECTION("filter matches walking every sample")
+	{
+		std::mt19937 rng(7);
+		std::uniform_int_distribution<uint64_t> ts(oldest - 5, newest + 5);
+
+		for (int i = 0; i < 1000; i++) {
+			uint64_t start = ts(rng);
+			uint64_t stop = ts(rng);
+			CAPTURE(start, stop);
+
+			xrt_vec3 expected = {};
+			xrt_vec3 actual = {};
+			size_t expected_count = reference_filter(samples, start, stop, &expected);
+			if (start > stop) {
+				expected_count = 0;
+				expected = {0, 0, 0};
+			}
+
+			REQUIRE(m_ff_vec3_f32_filter(ff, start, stop, &actual) == expected_count);
+			CHECK(actual.x == Catch::Approx(expected.x).margin(1e-4));
+			CHECK(actual.y == Catch::Approx(expected.y).margin(1e-4));
+			CHECK(actual.z == Catch::Approx(expected.z).margin(1e-4));
+		}
+	}
+
+	SECTION("count since")
+	{
+		for (uint64_t start = oldest - 1; start <= newest + 1; start++) {
+			size_t expected = 0;
+			while (expected < samples.size() && samples[expected].timestamp_ns >= start) {
+				expected++;
+			}
+			CHECK(m_ff_vec3_f32_count_since(ff, start) == expected);
+		}
+	}
+
+	SECTION("batch matches get")
+	{
+		std::vector<float> x(Num), y(Num), z(Num);
+		std::vector<uint64_t> ts(Num);
+
+		size_t first = GENERATE(0, 1, 50, 99, 100);
+		CAPTURE(first);
+		size_t got = m_ff_vec3_f32_get_batch(ff, first, Num, x.data(), y.data(), z.data(), ts.data());
+		REQUIRE(got == Num - first);
+
+		for (size_t i = 0; i < got; i++) {
+			xrt_vec3 v = {};
+			uint64_t v_ts = 0;
+			REQUIRE(m_ff_vec3_f32_get(ff, first + i, &v, &v_ts));
+			CHECK(x[i] == v.x);
+			CHECK(y[i] == v.y);
+			CHECK(z[i] == v.z);
+			CHECK(ts[i] == v_ts);
+		}
+	}
+
+	m_ff_vec3_f32_free(&ff);
+}
+
+TEST_CASE("m_filter_fifo f64")
+{
+	m_ff_f64 *ff = nullptr;
+	m_ff_f64_alloc(&ff, 4);
+
+	for (int i = 1; i <= 10; i++) {
+		double v = i;
+		m_ff_f64_push(ff, &v, (uint64_t)i * 10);
+	}
+
+	// Holds 7 to 10 at 70 to 100.
+	double avg = -1;
+	CHECK(m_ff_f64_filter(ff, 0, 1000, &avg) == 4);
+	CHECK(avg == 8.5);
+	CHECK(m_ff_f64_filter(ff, 75, 95, &avg) == 2);
+	CHECK(avg == 8.5);
+	CHECK(m_ff_f64_filter(ff, 70, 70, &avg) == 1);
+	CHECK(avg == 7);
+	CHECK(m_ff_f64_filter(ff, 101, 200, &avg) == 0);
+	CHECK(avg == 0);
+	CHECK(m_ff_f64_filter(ff, 90, 80, &avg) == 0);
+
+	m_ff_f64_free(&ff);
+}
+
+/*!
+ * Hidden, run with: tests_filter_fifo "[benchmark]"
+ *
+ * Windows over a full 1000 sample fifo, like the IMU ones in the SLAM tracker,
+ * against walking the samples.
+ */
+TEST_CASE("m_filter_fifo windows", "[.][benchmark]")
+{
+	constexpr size_t Num = 1000;
+
+	m_ff_vec3_f32 *ff = nullptr;
+	m_ff_vec3_f32_alloc(&ff, Num);
+	std::vector<Sample> samples = fill(ff, Num * 3, 1);
+	uint64_t newest = samples.front().timestamp_ns;
+	uint64_t oldest = samples.back().timestamp_ns;
+
+	for (uint64_t span : {uint64_t(10), (newest - oldest) / 2, newest - oldest}) {
+		uint64_t start = newest - span;
+		xrt_vec3 avg = {};
+
+		BENCHMARK("filter " + std::to_string(span))
+		{
+			return m_ff_vec3_f32_filter(ff, start, newest, &avg);
+		};
+
+		BENCHMARK("walk " + std::to_string(span))
+		{
+			size_t count = 0;
+			xrt_vec3 sample = {};
+			uint64_t ts = 0;
+			for (size_t i = 0; m_ff_vec3_f32_get(ff, i, &sample, &ts); i++) {
+				if (ts < start) {
+					break;
+				}
+				avg.x += sample.x;
+				count++;
+			}
+			return count;
+		};
+	}
+
+	std::vector<float> x(Num), y(Num), z(Num);
+	std::vector<uint64_t> ts(Num);
+
+	BENCHMARK("get_batch all")
+	{
+		return m_ff_vec3_f32_get_batch(ff, 0, Num, x.data(), y.data(), z.data(), ts.data());
+	};
+
+	BENCHMARK("get all")
+	{
+		xrt_vec3 sample = {};
+		for (size_t i = 0; i < Num; i++) {
+			m_ff_vec3_f32_get(ff, i, &sample, &ts[i]);
+			x[i] = sample.x;
+		}
+		return x[0];
+	};
+
+	m_ff_vec3_f32_free(&ff);
+}
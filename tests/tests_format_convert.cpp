@@ -0,0 +1,321 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Format conversion kernel tests.
+ */
+
+#include "xrt/xrt_frame.h"
+
+#include "util/u_format_convert.h"
+#include "util/u_frame.h"
+#include "util/u_sink.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+using Kernel = u_format_convert_row_func_t u_format_convert_kernels::*;
+
+struct KernelInfo
+{
+	const char *name;
+	Kernel kernel;
+	//! Source bytes per output pixel in one row.
+	uint32_t src_bpp;
+	//! Source rows per output row.
+	uint32_t src_rows;
+	//! Output pixels per source block, 4:2:2 shares chroma between two.
+	uint32_t block_width;
+};
+
+const KernelInfo kernel_infos[] = {
+    {"L8", &u_format_convert_kernels::L8_to_R8G8B8, 1, 1, 1},
+    {"YUYV422", &u_format_convert_kernels::YUYV422_to_R8G8B8, 2, 1, 2},
+    {"UYVY422", &u_format_convert_kernels::UYVY422_to_R8G8B8, 2, 1, 2},
+    {"YUV888", &u_format_convert_kernels::YUV888_to_R8G8B8, 3, 1, 1},
+    {"BAYER_GR8", &u_format_convert_kernels::BAYER_GR8_to_R8G8B8, 4, 2, 1},
+};
+
+std::vector<const u_format_convert_kernels *>
+simd_kernels()
+{
+	std::vector<const u_format_convert_kernels *> ret;
+	for (int i = U_FORMAT_CONVERT_IMPL_SCALAR + 1; i < U_FORMAT_CONVERT_IMPL_COUNT; i++) {
+		const u_format_convert_kernels *k = u_format_convert_get_kernels((u_format_convert_impl)i);
+		if (k != nullptr) {
+			ret.push_back(k);
+		}
+	}
+	return ret;
+}
+
+std::vector<uint8_t>
+random_bytes(size_t size, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<int> dist(0, 255);
+
+	std::vector<uint8_t> ret(size);
+	for (uint8_t &b : ret) {
+		b = (uint8_t)dist(rng);
+	}
+	return ret;
+}
+
+/*!
+ * Size of one row of source, rounding up to whole blocks like
+ * u_format_size_for_dimensions does, the last 4:2:2 pair of an odd width is
+ * read in full.
+ */
+size_t
+src_size(const KernelInfo &info, uint32_t w)
+{
+	uint32_t blocks = (w + info.block_width - 1) / info.block_width;
+	return (size_t)blocks * info.block_width * info.src_bpp;
+}
+
+//! Runs @p kernel on one row, with guard bytes after it to catch overruns.
+std::vector<uint8_t>
+run_row(const u_format_convert_kernels *kernels, const KernelInfo &info, const std::vector<uint8_t> &src, uint32_t w)
+{
+	constexpr size_t Guard = 64;
+	std::vector<uint8_t> dst(w * 3 + Guard, 0xcd);
+
+	// Bayer reads two source rows, each 2 * w bytes, the second one stride after.
+	size_t src_stride = info.src_rows == 2 ? w * 2 : src_size(info, w);
+	(kernels->*info.kernel)(src.data(), src_stride, dst.data(), w);
+
+	uint32_t overrun = 0;
+	for (size_t i = w * 3; i < dst.size(); i++) {
+		overrun += dst[i] != 0xcd;
+	}
+	REQUIRE(overrun == 0);
+
+	dst.resize(w * 3);
+	return dst;
+}
+
+/*!
+ * End of the chain, keeps the last frame.
+ */
+struct keep_sink
+{
+	struct xrt_frame_sink base = {};
+	struct xrt_frame *frame = nullptr;
+
+	keep_sink()
+	{
+		base.push_frame = push_frame;
+	}
+
+	~keep_sink()
+	{
+		xrt_frame_reference(&frame, nullptr);
+	}
+
+	static void
+	push_frame(struct xrt_frame_sink *xfs, struct xrt_frame *xf)
+	{
+		auto *ks = (struct keep_sink *)xfs;
+		xrt_frame_reference(&ks->frame, xf);
+	}
+};
+
+} // namespace
+
+
+TEST_CASE("u_format_convert")
+{
+	const u_format_convert_kernels *scalar = u_format_convert_get_kernels(U_FORMAT_CONVERT_IMPL_SCALAR);
+	REQUIRE(scalar != nullptr);
+	REQUIRE(u_format_convert_best_kernels() != nullptr);
+
+	std::vector<const u_format_convert_kernels *> impls = simd_kernels();
+	if (impls.empty()) {
+		WARN("No SIMD kernels available, only checking the scalar ones");
+	}
+
+	SECTION("kernels match scalar for all widths")
+	{
+		for (const u_format_convert_kernels *impl : impls) {
+			for (const KernelInfo &info : kernel_infos) {
+				// Around the 16 pixel blocks, plus a real camera width.
+				std::vector<uint32_t> widths = {1280, 752};
+				for (uint32_t w = 1; w <= 67; w++) {
+					widths.push_back(w);
+				}
+
+				for (uint32_t w : widths) {
+					CAPTURE(impl->name, info.name, w);
+					std::vector<uint8_t> src = random_bytes(src_size(info, w), w);
+					bool same = run_row(impl, info, src, w) == run_row(scalar, info, src, w);
+					CHECK(same);
+				}
+			}
+		}
+	}
+
+	SECTION("YUV math matches scalar for every value")
+	{
+		// Each row is every U and V for one Y.
+		constexpr uint32_t W = 256 * 256;
+		std::vector<uint8_t> src(W * 3);
+		std::vector<uint8_t> expected(W * 3);
+		std::vector<uint8_t> actual(W * 3);
+
+		for (const u_format_convert_kernels *impl : impls) {
+			uint32_t mismatches = 0;
+			for (uint32_t y = 0; y < 256; y++) {
+				for (uint32_t uv = 0; uv < W; uv++) {
+					src[uv * 3 + 0] = (uint8_t)y;
+					src[uv * 3 + 1] = (uint8_t)(uv >> 8);
+					src[uv * 3 + 2] = (uint8_t)uv;
+				}
+
+				scalar->YUV888_to_R8G8B8(src.data(), src.size(), expected.data(), W);
+				impl->YUV888_to_R8G8B8(src.data(), src.size(), actual.data(), W);
+				mismatches += expected != actual;
+			}
+
+			CAPTURE(impl->name);
+			CHECK(mismatches == 0);
+		}
+	}
+
+	SECTION("known values")
+	{
+		// Limited range black, white and saturated red.
+		const uint8_t yuv[] = {16, 128, 128, 235, 128, 128, 81, 90, 240};
+		uint8_t rgb[9] = {};
+		scalar->YUV888_to_R8G8B8(yuv, sizeof(yuv), rgb, 3);
+
+		CHECK(rgb[0] == 0);
+		CHECK(rgb[1] == 0);
+		CHECK(rgb[2] == 0);
+		CHECK(rgb[3] == 255);
+		CHECK(rgb[4] == 255);
+		CHECK(rgb[5] == 255);
+		CHECK(rgb[6] == 255);
+		CHECK(rgb[7] == 0);
+		CHECK(rgb[8] == 0);
+	}
+}
+
+TEST_CASE("u_sink_converter threaded")
+{
+	constexpr uint32_t W = 1280;
+	constexpr uint32_t H = 800;
+
+	const u_format_convert_kernels *scalar = u_format_convert_get_kernels(U_FORMAT_CONVERT_IMPL_SCALAR);
+
+	struct xrt_frame_context xfctx = {};
+	keep_sink ks;
+	struct xrt_frame_sink *converter = nullptr;
+	u_sink_create_format_converter(&xfctx, XRT_FORMAT_R8G8B8, &ks.base, &converter);
+	REQUIRE(converter != nullptr);
+
+	SECTION("YUYV422")
+	{
+		struct xrt_frame *xf = nullptr;
+		u_frame_create_one_off(XRT_FORMAT_YUYV422, W, H, &xf);
+		std::vector<uint8_t> src = random_bytes(xf->size, 1);
+		memcpy(xf->data, src.data(), xf->size);
+
+		xrt_sink_push_frame(converter, xf);
+		xrt_frame_reference(&xf, nullptr);
+		REQUIRE(ks.frame != nullptr);
+		REQUIRE(ks.frame->format == XRT_FORMAT_R8G8B8);
+
+		uint32_t mismatches = 0;
+		std::vector<uint8_t> expected(W * 3);
+		for (uint32_t y = 0; y < H; y++) {
+			scalar->YUYV422_to_R8G8B8(src.data() + y * W * 2, W * 2, expected.data(), W);
+			mismatches += memcmp(expected.data(), ks.frame->data + y * ks.frame->stride, W * 3) != 0;
+		}
+		CHECK(mismatches == 0);
+	}
+
+	SECTION("BAYER_GR8")
+	{
+		struct xrt_frame *xf = nullptr;
+		u_frame_create_one_off(XRT_FORMAT_BAYER_GR8, W * 2, H * 2, &xf);
+		std::vector<uint8_t> src = random_bytes(xf->size, 2);
+		memcpy(xf->data, src.data(), xf->size);
+		size_t stride = xf->stride;
+
+		xrt_sink_push_frame(converter, xf);
+		xrt_frame_reference(&xf, nullptr);
+		REQUIRE(ks.frame != nullptr);
+		REQUIRE(ks.frame->width == W);
+		REQUIRE(ks.frame->height == H);
+
+		uint32_t mismatches = 0;
+		std::vector<uint8_t> expected(W * 3);
+		for (uint32_t y = 0; y < H; y++) {
+			scalar->BAYER_GR8_to_R8G8B8(src.data() + y * 2 * stride, stride, expected.data(), W);
+			mismatches += memcmp(expected.data(), ks.frame->data + y * ks.frame->stride, W * 3) != 0;
+		}
+		CHECK(mismatches == 0);
+	}
+
+	xrt_frame_context_destroy_nodes(&xfctx);
+}
+
+/*!
+ * Hidden, run with: tests_format_convert "[benchmark]"
+ *
+ * One 1280x800 frame per kernel and implementation, then the whole sink
+ * which also splits the frame over threads.
+ */
+TEST_CASE("u_format_convert kernels", "[.][benchmark]")
+{
+	constexpr uint32_t W = 1280;
+	constexpr uint32_t H = 800;
+
+	std::vector<const u_format_convert_kernels *> impls = simd_kernels();
+	impls.insert(impls.begin(), u_format_convert_get_kernels(U_FORMAT_CONVERT_IMPL_SCALAR));
+
+	std::vector<uint8_t> src = random_bytes((size_t)W * H * 4, 3);
+	std::vector<uint8_t> dst((size_t)W * H * 3);
+
+	for (const KernelInfo &info : kernel_infos) {
+		for (const u_format_convert_kernels *impl : impls) {
+			std::string name = std::string(info.name) + " " + impl->name;
+			size_t src_stride = (size_t)W * info.src_bpp / info.src_rows;
+			size_t src_row_step = src_stride * info.src_rows;
+			u_format_convert_row_func_t func = impl->*info.kernel;
+
+			BENCHMARK(name.c_str())
+			{
+				for (uint32_t y = 0; y < H; y++) {
+					func(src.data() + y * src_row_step, src_stride, dst.data() + y * W * 3, W);
+				}
+				return dst[0];
+			};
+		}
+	}
+
+	struct xrt_frame_context xfctx = {};
+	keep_sink ks;
+	struct xrt_frame_sink *converter = nullptr;
+	u_sink_create_format_converter(&xfctx, XRT_FORMAT_R8G8B8, &ks.base, &converter);
+
+	struct xrt_frame *xf = nullptr;
+	u_frame_create_one_off(XRT_FORMAT_YUYV422, W, H, &xf);
+	memcpy(xf->data, src.data(), xf->size);
+
+	BENCHMARK("YUYV422 sink")
+	{
+		xrt_sink_push_frame(converter, xf);
+		return ks.frame->data[0];
+	};
+
+	xrt_frame_reference(&xf, nullptr);
+	xrt_frame_context_destroy_nodes(&xfctx);
+}
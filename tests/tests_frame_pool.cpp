@@ -0,0 +1,256 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Frame pool tests.
+ */
+
+#include "xrt/xrt_frame.h"
+
+#include "util/u_frame.h"
+#include "util/u_sink.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <cstring>
+#include <vector>
+
+
+namespace {
+
+constexpr uint32_t DefaultMaxFrames = 8;
+constexpr uint32_t DefaultMaxMb = 128;
+
+struct u_frame_pool_stats
+get_stats()
+{
+	struct u_frame_pool_stats stats = {};
+	u_frame_pool_get_stats(&stats);
+	return stats;
+}
+
+//! Starts every test from an empty pool with the default limits.
+void
+reset_pool(uint32_t max_frames = DefaultMaxFrames, uint32_t max_mb = DefaultMaxMb)
+{
+	u_frame_pool_trim();
+	u_frame_pool_set_limits(max_frames, max_mb);
+}
+
+/*!
+ * End of the chain, drops everything.
+ */
+struct null_sink
+{
+	struct xrt_frame_sink base = {};
+	uint32_t count = 0;
+
+	null_sink()
+	{
+		base.push_frame = push_frame;
+	}
+
+	static void
+	push_frame(struct xrt_frame_sink *xfs, struct xrt_frame *xf)
+	{
+		auto *ns = (struct null_sink *)xfs;
+		ns->count++;
+	}
+};
+
+} // namespace
+
+
+TEST_CASE("u_frame_pool")
+{
+	reset_pool();
+
+	SECTION("buffers are recycled")
+	{
+		struct xrt_frame *xf = nullptr;
+		u_frame_create_one_off(XRT_FORMAT_L8, 64, 64, &xf);
+		uint8_t *data = xf->data;
+		xrt_frame_reference(&xf, nullptr);
+		CHECK(get_stats().cached_frames == 1);
+
+		struct u_frame_pool_stats before = get_stats();
+		u_frame_create_one_off(XRT_FORMAT_L8, 64, 64, &xf);
+		struct u_frame_pool_stats after = get_stats();
+
+		CHECK(after.hits == before.hits + 1);
+		CHECK(after.misses == before.misses);
+		CHECK(after.cached_frames == 0);
+		CHECK(xf->data == data);
+		xrt_frame_reference(&xf, nullptr);
+	}
+
+	SECTION("only the buffer size has to match")
+	{
+		struct xrt_frame *xf = nullptr;
+		u_frame_create_one_off(XRT_FORMAT_L8, 192, 64, &xf);
+		xf->timestamp = 1234;
+		xf->stereo_format = XRT_STEREO_FORMAT_SBS;
+		xrt_frame_reference(&xf, nullptr);
+
+		struct u_frame_pool_stats before = get_stats();
+		u_frame_create_one_off(XRT_FORMAT_R8G8B8, 64, 64, &xf);
+		CHECK(get_stats().hits == before.hits + 1);
+
+		// Nothing from the previous use leaks through.
+		CHECK(xf->format == XRT_FORMAT_R8G8B8);
+		CHECK(xf->width == 64);
+		CHECK(xf->height == 64);
+		CHECK(xf->stride == 64 * 3);
+		CHECK(xf->size == 64 * 64 * 3);
+		CHECK(xf->timestamp == 0);
+		CHECK(xf->stereo_format == XRT_STEREO_FORMAT_NONE);
+		CHECK(xf->reference.count == 1);
+		xrt_frame_reference(&xf, nullptr);
+
+		before = get_stats();
+		u_frame_create_one_off(XRT_FORMAT_L8, 64, 64, &xf);
+		CHECK(get_stats().misses == before.misses + 1);
+		xrt_frame_reference(&xf, nullptr);
+	}
+
+	SECTION("clones come from the pool")
+	{
+		struct xrt_frame *xf = nullptr;
+		u_frame_create_one_off(XRT_FORMAT_L8, 32, 32, &xf);
+		for (size_t i = 0; i < xf->size; i++) {
+			xf->data[i] = (uint8_t)i;
+		}
+		xf->source_sequence = 42;
+
+		struct xrt_frame *clone = nullptr;
+		u_frame_clone(xf, &clone);
+		xrt_frame_reference(&xf, nullptr);
+
+		struct xrt_frame *clone2 = nullptr;
+		struct u_frame_pool_stats before = get_stats();
+		u_frame_clone(clone, &clone2);
+		CHECK(get_stats().hits == before.hits + 1);
+
+		CHECK(clone2->source_sequence == 42);
+		CHECK(clone2->data != clone->data);
+		uint32_t mismatches = 0;
+		for (size_t i = 0; i < clone2->size; i++) {
+			if (clone2->data[i] != (uint8_t)i) {
+				mismatches++;
+			}
+		}
+		CHECK(mismatches == 0);
+
+		xrt_frame_reference(&clone, nullptr);
+		xrt_frame_reference(&clone2, nullptr);
+	}
+
+	SECTION("frame count limit")
+	{
+		reset_pool(2, DefaultMaxMb);
+
+		std::vector<struct xrt_frame *> frames(4, nullptr);
+		for (struct xrt_frame *&xf : frames) {
+			u_frame_create_one_off(XRT_FORMAT_L8, 64, 64, &xf);
+		}
+		for (struct xrt_frame *&xf : frames) {
+			xrt_frame_reference(&xf, nullptr);
+		}
+
+		CHECK(get_stats().cached_frames == 2);
+	}
+
+	SECTION("byte limit")
+	{
+		reset_pool(DefaultMaxFrames, 1);
+
+		// Two of these fit in a megabyte, the third doesn't.
+		std::vector<struct xrt_frame *> frames(3, nullptr);
+		for (struct xrt_frame *&xf : frames) {
+			u_frame_create_one_off(XRT_FORMAT_L8, 640, 640, &xf);
+		}
+		for (struct xrt_frame *&xf : frames) {
+			xrt_frame_reference(&xf, nullptr);
+		}
+
+		struct u_frame_pool_stats stats = get_stats();
+		CHECK(stats.cached_frames == 2);
+		CHECK(stats.cached_bytes == 2 * 640 * 640);
+	}
+
+	SECTION("lowering the limits frees frames")
+	{
+		struct xrt_frame *xf = nullptr;
+		u_frame_create_one_off(XRT_FORMAT_L8, 64, 64, &xf);
+		xrt_frame_reference(&xf, nullptr);
+		REQUIRE(get_stats().cached_frames == 1);
+
+		u_frame_pool_set_limits(0, 0);
+		CHECK(get_stats().cached_frames == 0);
+
+		u_frame_create_one_off(XRT_FORMAT_L8, 64, 64, &xf);
+		xrt_frame_reference(&xf, nullptr);
+		CHECK(get_stats().cached_frames == 0);
+	}
+
+	reset_pool();
+}
+
+/*!
+ * Hidden, run with: tests_frame_pool "[benchmark]"
+ *
+ * One second of a 90 Hz stereo camera, two 1280x800 L8 frames per tick. Once
+ * only allocating and filling the frames, once going through a converter to
+ * R8G8B8 like the debug UI sinks do.
+ */
+TEST_CASE("u_frame_pool converter chain", "[.][benchmark]")
+{
+	constexpr uint32_t Ticks = 90;
+	constexpr uint32_t Width = 1280;
+	constexpr uint32_t Height = 800;
+
+	for (bool pooled : {false, true}) {
+		reset_pool(pooled ? DefaultMaxFrames : 0, pooled ? DefaultMaxMb : 0);
+
+		struct xrt_frame_context xfctx = {};
+		null_sink ns;
+		struct xrt_frame_sink *converter = nullptr;
+		u_sink_create_format_converter(&xfctx, XRT_FORMAT_R8G8B8, &ns.base, &converter);
+		REQUIRE(converter != nullptr);
+
+		BENCHMARK(pooled ? "90 stereo frames, filled, pooled" : "90 stereo frames, filled, malloc")
+		{
+			uint32_t sum = 0;
+			for (uint32_t tick = 0; tick < Ticks * 2; tick++) {
+				struct xrt_frame *xf = nullptr;
+				u_frame_create_one_off(XRT_FORMAT_L8, Width, Height, &xf);
+				memset(xf->data, (int)tick, xf->size);
+				sum += xf->data[tick];
+				xrt_frame_reference(&xf, nullptr);
+			}
+			return sum;
+		};
+
+		BENCHMARK(pooled ? "90 stereo frames, converted, pooled" : "90 stereo frames, converted, malloc")
+		{
+			for (uint32_t tick = 0; tick < Ticks; tick++) {
+				for (uint32_t cam = 0; cam < 2; cam++) {
+					// Like a camera driver handing out a fresh frame.
+					struct xrt_frame *xf = nullptr;
+					u_frame_create_one_off(XRT_FORMAT_L8, Width, Height, &xf);
+					xf->data[0] = (uint8_t)tick;
+					xrt_sink_push_frame(converter, xf);
+					xrt_frame_reference(&xf, nullptr);
+				}
+			}
+			return ns.count;
+		};
+
+		struct u_frame_pool_stats stats = get_stats();
+		UNSCOPED_INFO("hits " << stats.hits << ", misses " << stats.misses);
+
+		xrt_frame_context_destroy_nodes(&xfctx);
+	}
+
+	reset_pool();
+}
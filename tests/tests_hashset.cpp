@@ -0,0 +1,227 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Hashset tests.
+ */
+
+#include "util/u_hashset.h"
+
+#include "bindings/b_generated_bindings.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+void
+free_callback(struct u_hashset_item *item, void *priv)
+{
+	(*(size_t *)priv)++;
+	free(item);
+}
+
+//! Every path string in the built-in interaction profiles.
+std::vector<std::string>
+binding_paths()
+{
+	std::set<std::string> paths;
+	for (const profile_template &profile : profile_templates) {
+		paths.insert(profile.path);
+		for (size_t i = 0; i < profile.binding_count; i++) {
+			const binding_template &binding = profile.bindings[i];
+			paths.insert(binding.subaction_path);
+			for (const char *path : binding.paths) {
+				if (path == nullptr) {
+					break;
+				}
+				paths.insert(path);
+			}
+		}
+	}
+	return {paths.begin(), paths.end()};
+}
+
+} // namespace
+
+
+TEST_CASE("u_hashset")
+{
+	struct u_hashset *hs = nullptr;
+	REQUIRE(u_hashset_create(&hs) == 0);
+
+	struct u_hashset_item *item = nullptr;
+
+	SECTION("find what was inserted")
+	{
+		REQUIRE(u_hashset_create_and_insert_str_c(hs, "/user/hand/left", &item) == 0);
+		CHECK(item->length == 15);
+		CHECK(std::string(item->c_str()) == "/user/hand/left");
+
+		struct u_hashset_item *found = nullptr;
+		CHECK(u_hashset_find_c_str(hs, "/user/hand/left", &found) == 0);
+		CHECK(found == item);
+
+		// Not null terminated, a prefix of a longer string.
+		const char *longer = "/user/hand/leftover";
+		CHECK(u_hashset_find_str(hs, longer, 15, &found) == 0);
+		CHECK(found == item);
+		CHECK(u_hashset_find_c_str(hs, longer, &found) != 0);
+
+		// Duplicates are refused.
+		struct u_hashset_item *dup = nullptr;
+		CHECK(u_hashset_create_and_insert_str_c(hs, "/user/hand/left", &dup) != 0);
+		CHECK(dup == nullptr);
+
+		u_hashset_erase_item(hs, item);
+		CHECK(u_hashset_find_c_str(hs, "/user/hand/left", &found) != 0);
+		free(item);
+	}
+
+	SECTION("matches std::set under random inserts and erases")
+	{
+		std::mt19937 rng(42);
+		std::uniform_int_distribution<int> key(0, 2000);
+		std::uniform_int_distribution<int> op(0, 2);
+		std::set<std::string> expected;
+		std::vector<struct u_hashset_item *> erased;
+
+		uint32_t mismatches = 0;
+		for (int i = 0; i < 20000; i++) {
+			std::string str = "/interaction_profiles/" + std::to_string(key(rng));
+			struct u_hashset_item *found = nullptr;
+			bool present = u_hashset_find_str(hs, str.data(), str.size(), &found) == 0;
+			mismatches += present != (expected.count(str) == 1);
+
+			if (op(rng) != 0) {
+				if (!present) {
+					u_hashset_create_and_insert_str(hs, str.data(), str.size(), &item);
+					expected.insert(str);
+				}
+			} else if (present) {
+				u_hashset_erase_str(hs, str.data(), str.size());
+				expected.erase(str);
+				erased.push_back(found);
+			}
+		}
+		CHECK(mismatches == 0);
+
+		for (const std::string &str : expected) {
+			struct u_hashset_item *found = nullptr;
+			REQUIRE(u_hashset_find_str(hs, str.data(), str.size(), &found) == 0);
+			CHECK(std::string(found->c_str(), found->length) == str);
+		}
+
+		for (struct u_hashset_item *n : erased) {
+			free(n);
+		}
+	}
+
+	SECTION("inserting an item replaces one with the same string")
+	{
+		struct u_hashset_item *first = nullptr;
+		REQUIRE(u_hashset_create_and_insert_str_c(hs, "/user/head", &first) == 0);
+
+		size_t size = sizeof(struct u_hashset_item) + sizeof("/user/head");
+		auto *second = (struct u_hashset_item *)calloc(1, size);
+		second->length = sizeof("/user/head") - 1;
+		memcpy((char *)second->c_str(), "/user/head", sizeof("/user/head"));
+
+		u_hashset_insert_item(hs, second);
+		CHECK(second->hash == first->hash);
+
+		struct u_hashset_item *found = nullptr;
+		CHECK(u_hashset_find_c_str(hs, "/user/head", &found) == 0);
+		CHECK(found == second);
+		free(first);
+	}
+
+	size_t freed = 0;
+	u_hashset_clear_and_call_for_each(hs, free_callback, &freed);
+	CHECK(u_hashset_find_c_str(hs, "/user/head", &item) != 0);
+	u_hashset_destroy(&hs);
+	CHECK(hs == nullptr);
+}
+
+TEST_CASE("u_hashset binding paths")
+{
+	std::vector<std::string> paths = binding_paths();
+	REQUIRE(paths.size() > 100);
+
+	struct u_hashset *hs = nullptr;
+	u_hashset_create(&hs);
+
+	for (const std::string &path : paths) {
+		struct u_hashset_item *item = nullptr;
+		REQUIRE(u_hashset_create_and_insert_str(hs, path.data(), path.size(), &item) == 0);
+	}
+
+	uint32_t missing = 0;
+	for (const std::string &path : paths) {
+		struct u_hashset_item *item = nullptr;
+		missing += u_hashset_find_str(hs, path.data(), path.size(), &item) != 0;
+	}
+	CHECK(missing == 0);
+
+	size_t freed = 0;
+	u_hashset_clear_and_call_for_each(hs, free_callback, &freed);
+	CHECK(freed == paths.size());
+	u_hashset_destroy(&hs);
+}
+
+/*!
+ * Hidden, run with: tests_hashset "[benchmark]"
+ *
+ * Interns every path of the built-in interaction profiles, the way session
+ * setup does with a big action manifest, then looks them all up again.
+ */
+TEST_CASE("u_hashset intern", "[.][benchmark]")
+{
+	std::vector<std::string> paths = binding_paths();
+
+	BENCHMARK("intern all binding paths")
+	{
+		struct u_hashset *hs = nullptr;
+		u_hashset_create(&hs);
+
+		for (const std::string &path : paths) {
+			struct u_hashset_item *item = nullptr;
+			if (u_hashset_find_c_str(hs, path.c_str(), &item) != 0) {
+				u_hashset_create_and_insert_str_c(hs, path.c_str(), &item);
+			}
+		}
+
+		size_t freed = 0;
+		u_hashset_clear_and_call_for_each(hs, free_callback, &freed);
+		u_hashset_destroy(&hs);
+		return freed;
+	};
+
+	struct u_hashset *hs = nullptr;
+	u_hashset_create(&hs);
+	for (const std::string &path : paths) {
+		struct u_hashset_item *item = nullptr;
+		u_hashset_create_and_insert_str_c(hs, path.c_str(), &item);
+	}
+
+	BENCHMARK("find all binding paths")
+	{
+		size_t found = 0;
+		for (const std::string &path : paths) {
+			struct u_hashset_item *item = nullptr;
+			found += u_hashset_find_c_str(hs, path.c_str(), &item) == 0;
+		}
+		return found;
+	};
+
+	size_t freed = 0;
+	u_hashset_clear_and_call_for_each(hs, free_callback, &freed);
+	u_hashset_destroy(&hs);
+}
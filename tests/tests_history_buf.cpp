@@ -10,6 +10,11 @@
 #include <util/u_time.h>
 #include <util/u_template_historybuf.hpp>
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
 
 
 using xrt::auxiliary::util::HistoryBuffer;
@@ -210,6 +215,146 @@ TEST_CASE("RelationHistory")
 	}
 }
 
+TEST_CASE("m_relation_history concurrent")
+{
+	using xrt::auxiliary::math::RelationHistory;
+	RelationHistory rh;
+
+	// Every pushed relation encodes its own timestamp in the position, so torn reads are easy to spot.
+	constexpr uint64_t Step = (uint64_t)U_TIME_1MS_IN_NS;
+	constexpr uint64_t Count = 20000; // Wraps the 4096 entry ring several times.
+
+	std::atomic<bool> done{false};
+	std::atomic<uint64_t> latest_pushed{0};
+	std::atomic<uint64_t> mismatches{0};
+
+	auto reader = [&] {
+		while (!done.load()) {
+			uint64_t latest = latest_pushed.load();
+			if (latest == 0) {
+				continue;
+			}
+
+			xrt_space_relation out_relation = XRT_SPACE_RELATION_ZERO;
+			uint64_t at = std::max<uint64_t>(Step, latest - 100 * Step);
+			if (rh.get(at, &out_relation) == M_RELATION_HISTORY_RESULT_EXACT &&
+			    out_relation.pose.position.x != (float)(at / Step)) {
+				mismatches++;
+			}
+
+			uint64_t out_time = 0;
+			if (rh.get_latest(&out_time, &out_relation) &&
+			    out_relation.pose.position.x != (float)(out_time / Step)) {
+				mismatches++;
+			}
+
+			if (rh.size() > 4096) {
+				mismatches++;
+			}
+		}
+	};
+
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 3; i++) {
+		readers.emplace_back(reader);
+	}
+
+	xrt_space_relation relation = XRT_SPACE_RELATION_ZERO;
+	relation.relation_flags = (xrt_space_relation_flags)(XRT_SPACE_RELATION_POSITION_VALID_BIT |
+	                                                     XRT_SPACE_RELATION_ORIENTATION_VALID_BIT);
+	for (uint64_t i = 1; i <= Count; i++) {
+		relation.pose.position.x = (float)i;
+		CHECK(rh.push(relation, i * Step));
+		latest_pushed = i * Step;
+	}
+
+	done = true;
+	for (auto &t : readers) {
+		t.join();
+	}
+
+	CHECK(mismatches.load() == 0);
+	CHECK(rh.size() == 4096);
+
+	rh.clear();
+	CHECK(rh.size() == 0);
+}
+
+/*!
+ * Tail latency of queries while a single producer pushes at IMU/SLAM rates.
+ *
+ * Hidden, run with: tests_history_buf "[benchmark]"
+ */
+TEST_CASE("m_relation_history contention", "[.][benchmark]")
+{
+	using xrt::auxiliary::math::RelationHistory;
+	using clock = std::chrono::steady_clock;
+
+	constexpr int ReaderCount = 4;
+	constexpr auto Duration = std::chrono::milliseconds(500);
+
+	for (uint64_t rate_hz : {1000, 2000, 4000}) {
+		RelationHistory rh;
+		std::atomic<bool> done{false};
+		std::atomic<uint64_t> latest_pushed{0};
+
+		std::vector<std::vector<int64_t>> latencies(ReaderCount);
+		std::vector<std::thread> readers;
+		for (int i = 0; i < ReaderCount; i++) {
+			readers.emplace_back([&, i] {
+				auto &out = latencies[i];
+				out.reserve(1 << 20);
+				while (!done.load(std::memory_order_relaxed)) {
+					uint64_t latest = latest_pushed.load(std::memory_order_relaxed);
+					if (latest == 0) {
+						continue;
+					}
+					xrt_space_relation out_relation;
+					auto start = clock::now();
+					// Typical compositor query, slightly in the future.
+					rh.get(latest + (uint64_t)U_TIME_1MS_IN_NS * 5, &out_relation);
+					auto end = clock::now();
+					out.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+					                  .count());
+				}
+			});
+		}
+
+		xrt_space_relation relation = XRT_SPACE_RELATION_ZERO;
+		relation.relation_flags = (xrt_space_relation_flags)(XRT_SPACE_RELATION_POSITION_VALID_BIT |
+		                                                     XRT_SPACE_RELATION_ORIENTATION_VALID_BIT);
+		auto period = std::chrono::nanoseconds(U_TIME_1S_IN_NS / rate_hz);
+		auto start = clock::now();
+		auto next = start;
+		uint64_t ts = 0;
+		while (clock::now() - start < Duration) {
+			ts += period.count();
+			relation.pose.position.x += 0.001f;
+			rh.push(relation, ts);
+			latest_pushed.store(ts, std::memory_order_relaxed);
+			next += period;
+			std::this_thread::sleep_until(next);
+		}
+
+		done = true;
+		for (auto &t : readers) {
+			t.join();
+		}
+
+		std::vector<int64_t> all;
+		for (auto &l : latencies) {
+			all.insert(all.end(), l.begin(), l.end());
+		}
+		REQUIRE_FALSE(all.empty());
+		std::sort(all.begin(), all.end());
+		auto pct = [&](double p) { return all[std::min(all.size() - 1, (size_t)(p * (double)all.size()))]; };
+
+		std::cout << "push " << rate_hz << "Hz, " << ReaderCount << " readers, " << all.size()
+		          << " gets: p50 " << pct(0.5) << "ns p99 " << pct(0.99) << "ns p99.9 " << pct(0.999)
+		          << "ns max " << all.back() << "ns" << std::endl;
+	}
+}
+
 TEST_CASE("u_template_historybuf")
 {
 	HistoryBuffer<int, 4> buffer;
@@ -0,0 +1,255 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief IMU preintegration tests.
+ */
+
+#include "math/m_api.h"
+#include "math/m_vec3.h"
+#include "math/m_imu_preintegration.h"
+
+#include "util/u_time.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <cmath>
+#include <vector>
+
+
+using Catch::Matchers::WithinAbs;
+
+namespace {
+
+constexpr int64_t ImuPeriodNs = U_TIME_1MS_IN_NS; // 1 kHz
+
+struct imu_sample
+{
+	int64_t ts;
+	struct xrt_vec3 accel;
+	struct xrt_vec3 gyro;
+};
+
+/*!
+ * Head like motion: a slow wobble in all three axes with gravity on top of
+ * the accelerometer, similar to what a EuRoC sequence looks like.
+ */
+std::vector<imu_sample>
+make_samples(int64_t start_ts, uint32_t count)
+{
+	std::vector<imu_sample> samples(count);
+	for (uint32_t i = 0; i < count; i++) {
+		float t = (float)i * 0.001f;
+		samples[i].ts = start_ts + (int64_t)(i + 1) * ImuPeriodNs;
+		samples[i].gyro = {0.3f * sinf(2.1f * t), 0.5f * cosf(1.3f * t), 0.2f * sinf(3.7f * t + 1.f)};
+		samples[i].accel = {0.4f * cosf(1.7f * t), 9.81f + 0.3f * sinf(2.9f * t), 0.2f * sinf(0.7f * t)};
+	}
+	return samples;
+}
+
+struct xrt_space_relation
+make_base()
+{
+	struct xrt_space_relation rel = XRT_SPACE_RELATION_ZERO;
+	rel.pose.orientation = {0.1f, 0.2f, 0.05f, 0.97f};
+	math_quat_normalize(&rel.pose.orientation);
+	rel.pose.position = {1.f, 1.6f, -0.5f};
+	rel.linear_velocity = {0.1f, -0.05f, 0.2f};
+	rel.angular_velocity = {0.f, 0.1f, 0.f};
+	return rel;
+}
+
+const struct xrt_vec3 GravityCorrection = {0, -MATH_GRAVITY_M_S2, 0};
+
+/*!
+ * Steps a world space relation one sample at a time, the way SLAM prediction
+ * used to do it on every query.
+ */
+void
+naive_integrate(struct xrt_space_relation rel,
+                int64_t rel_ts,
+                const imu_sample *samples,
+                size_t count,
+                struct xrt_space_relation *out_rel)
+{
+	struct xrt_quat &o = rel.pose.orientation;
+	struct xrt_vec3 &p = rel.pose.position;
+	struct xrt_vec3 &w = rel.angular_velocity;
+	struct xrt_vec3 &v = rel.linear_velocity;
+
+	for (size_t i = 0; i < count; i++) {
+		float dt = (float)time_ns_to_s(samples[i].ts - rel_ts);
+		rel_ts = samples[i].ts;
+
+		struct xrt_quat angvel_delta;
+		struct xrt_vec3 scaled_half_g = m_vec3_mul_scalar(samples[i].gyro, dt * 0.5f);
+		math_quat_exp(&scaled_half_g, &angvel_delta);
+		math_quat_rotate(&o, &angvel_delta, &o);
+		math_quat_rotate_derivative(&o, &samples[i].gyro, &w);
+
+		struct xrt_vec3 world_accel;
+		math_quat_rotate_vec3(&o, &samples[i].accel, &world_accel);
+		world_accel = m_vec3_add(world_accel, GravityCorrection);
+		v = m_vec3_add(v, m_vec3_mul_scalar(world_accel, dt));
+		p = m_vec3_add(p, m_vec3_add(m_vec3_mul_scalar(v, dt), m_vec3_mul_scalar(world_accel, dt * dt * 0.5f)));
+	}
+
+	*out_rel = rel;
+}
+
+void
+check_vec3(const struct xrt_vec3 &a, const struct xrt_vec3 &b, float margin)
+{
+	CHECK_THAT(a.x, WithinAbs(b.x, margin));
+	CHECK_THAT(a.y, WithinAbs(b.y, margin));
+	CHECK_THAT(a.z, WithinAbs(b.z, margin));
+}
+
+void
+check_relation(const struct xrt_space_relation &a, const struct xrt_space_relation &b)
+{
+	CHECK_THAT(a.pose.orientation.x, WithinAbs(b.pose.orientation.x, 1e-5));
+	CHECK_THAT(a.pose.orientation.y, WithinAbs(b.pose.orientation.y, 1e-5));
+	CHECK_THAT(a.pose.orientation.z, WithinAbs(b.pose.orientation.z, 1e-5));
+	CHECK_THAT(a.pose.orientation.w, WithinAbs(b.pose.orientation.w, 1e-5));
+	check_vec3(a.pose.position, b.pose.position, 1e-4f);
+	check_vec3(a.linear_velocity, b.linear_velocity, 1e-4f);
+	check_vec3(a.angular_velocity, b.angular_velocity, 1e-5f);
+}
+
+} // namespace
+
+
+TEST_CASE("m_imu_preintegration")
+{
+	const int64_t base_ts = 1000 * U_TIME_1MS_IN_NS;
+	const struct xrt_space_relation base = make_base();
+	const std::vector<imu_sample> samples = make_samples(base_ts, 200);
+
+	struct m_imu_preintegration pi;
+	m_imu_preintegration_reset(&pi, base_ts);
+
+	SECTION("no samples gives the base")
+	{
+		struct xrt_space_relation rel;
+		m_imu_preintegration_apply(&pi, &base, &GravityCorrection, &rel);
+		check_relation(rel, base);
+		CHECK(pi.last_ts == base_ts);
+	}
+
+	SECTION("matches stepping the relation sample by sample")
+	{
+		for (size_t i = 0; i < samples.size(); i++) {
+			m_imu_preintegration_integrate(&pi, samples[i].ts, &samples[i].accel, &samples[i].gyro);
+
+			if (i % 50 != 49) {
+				continue;
+			}
+			CAPTURE(i);
+
+			struct xrt_space_relation expected;
+			naive_integrate(base, base_ts, samples.data(), i + 1, &expected);
+
+			struct xrt_space_relation rel;
+			m_imu_preintegration_apply(&pi, &base, &GravityCorrection, &rel);
+			check_relation(rel, expected);
+		}
+		CHECK(pi.last_ts == samples.back().ts);
+		CHECK(pi.sample_count == samples.size());
+	}
+
+	SECTION("old samples are ignored")
+	{
+		m_imu_preintegration_integrate(&pi, samples[1].ts, &samples[1].accel, &samples[1].gyro);
+		m_imu_preintegration_integrate(&pi, samples[0].ts, &samples[0].accel, &samples[0].gyro);
+		CHECK(pi.sample_count == 1);
+		CHECK(pi.last_ts == samples[1].ts);
+	}
+
+	SECTION("interpolated samples")
+	{
+		const imu_sample &s0 = samples[0];
+		const imu_sample &s1 = samples[1];
+		m_imu_preintegration_integrate(&pi, s0.ts, &s0.accel, &s0.gyro);
+
+		// Halfway in between the two samples.
+		int64_t mid_ts = s0.ts + ImuPeriodNs / 2;
+		struct m_imu_preintegration interpolated = pi;
+		m_imu_preintegration_integrate_interpolated(&interpolated, mid_ts, s1.ts, &s1.accel, &s1.gyro);
+
+		imu_sample mid = {mid_ts, m_vec3_lerp(s0.accel, s1.accel, 0.5f), m_vec3_lerp(s0.gyro, s1.gyro, 0.5f)};
+		m_imu_preintegration_integrate(&pi, mid.ts, &mid.accel, &mid.gyro);
+
+		CHECK(interpolated.last_ts == mid_ts);
+		check_vec3(interpolated.last_gyro, mid.gyro, 1e-6f);
+		check_vec3(interpolated.delta_velocity, pi.delta_velocity, 1e-6f);
+		check_vec3(interpolated.delta_position, pi.delta_position, 1e-6f);
+	}
+}
+
+/*!
+ * Hidden, run with: tests_imu_preintegration "[benchmark]"
+ *
+ * Replays one second of 1 kHz IMU with a SLAM pose every 50 ms that shows up
+ * 30 ms late, and asks for the pose 8 times per IMU sample, roughly a few apps
+ * and the compositor all querying the head pose each frame.
+ */
+TEST_CASE("m_imu_preintegration replay", "[.][benchmark]")
+{
+	constexpr uint32_t SampleCount = 1000;
+	constexpr uint32_t PosePeriod = 50;
+	constexpr uint32_t PoseLatency = 30;
+	constexpr uint32_t QueriesPerSample = 8;
+
+	const struct xrt_space_relation base = make_base();
+	const std::vector<imu_sample> samples = make_samples(0, SampleCount);
+
+	BENCHMARK("re-integrate on every query")
+	{
+		struct xrt_space_relation rel = {};
+		float sum = 0;
+		for (uint32_t i = PoseLatency; i < SampleCount; i++) {
+			// Index of the latest SLAM pose that has arrived.
+			uint32_t pose_i = ((i - PoseLatency) / PosePeriod) * PosePeriod;
+
+			for (uint32_t q = 0; q < QueriesPerSample; q++) {
+				naive_integrate(base, samples[pose_i].ts, &samples[pose_i + 1], i - pose_i, &rel);
+				sum += rel.pose.position.x;
+			}
+		}
+		return sum;
+	};
+
+	BENCHMARK("preintegrated")
+	{
+		struct m_imu_preintegration pi;
+		m_imu_preintegration_reset(&pi, INT64_MAX);
+
+		struct xrt_space_relation rel = {};
+		float sum = 0;
+		uint32_t current_pose_i = UINT32_MAX;
+		for (uint32_t i = 0; i < SampleCount; i++) {
+			m_imu_preintegration_integrate(&pi, samples[i].ts, &samples[i].accel, &samples[i].gyro);
+			if (i < PoseLatency) {
+				continue;
+			}
+
+			// New pose, catch up on the samples since it once.
+			uint32_t pose_i = ((i - PoseLatency) / PosePeriod) * PosePeriod;
+			if (pose_i != current_pose_i) {
+				current_pose_i = pose_i;
+				m_imu_preintegration_reset(&pi, samples[pose_i].ts);
+				for (uint32_t j = pose_i + 1; j <= i; j++) {
+					m_imu_preintegration_integrate(&pi, samples[j].ts, &samples[j].accel,
+					                               &samples[j].gyro);
+				}
+			}
+
+			for (uint32_t q = 0; q < QueriesPerSample; q++) {
+				m_imu_preintegration_apply(&pi, &base, &GravityCorrection, &rel);
+				sum += rel.pose.position.x;
+			}
+		}
+		return sum;
+	};
+}
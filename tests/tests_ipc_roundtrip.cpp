@@ -0,0 +1,245 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief IPC message channel round-trip tests.
+ */
+
+#include "xrt/xrt_defines.h"
+
+#include "shared/ipc_protocol.h"
+#include "shared/ipc_message_channel.h"
+#include "ipc_client_generated.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+namespace {
+
+enum class receive_mode
+{
+	//! Peek the command, look up the size, then read it: two syscalls.
+	peek,
+	//! Read whatever is pending in one go: one syscall.
+	framed,
+};
+
+/*!
+ * Stand-in for the server side of the per client thread, it only answers
+ * @ref IPC_DEVICE_GET_TRACKED_POSE but reads commands exactly the way the
+ * real server does. Instantiating the full server requires a instance and
+ * a compositor, neither of which matters for the cost of the transport.
+ */
+struct fake_server
+{
+	struct ipc_message_channel imc = {};
+	receive_mode mode;
+	std::thread thread;
+
+	fake_server(int fd, receive_mode mode) : mode(mode)
+	{
+		imc.ipc_handle = fd;
+		imc.log_level = U_LOGGING_WARN;
+		thread = std::thread([this] { run(); });
+	}
+
+	~fake_server()
+	{
+		thread.join();
+		ipc_message_channel_close(&imc);
+	}
+
+	bool
+	receive(uint8_t *buf, size_t buf_size)
+	{
+		if (mode == receive_mode::peek) {
+			enum ipc_command cmd;
+			ssize_t len = recv(imc.ipc_handle, &cmd, sizeof(cmd), MSG_PEEK);
+			if (len != sizeof(cmd)) {
+				return false;
+			}
+			return ipc_receive(&imc, buf, sizeof(struct ipc_device_get_tracked_pose_msg)) == XRT_SUCCESS;
+		}
+
+		size_t len = 0;
+		xrt_result_t xret = ipc_receive_some(&imc, buf, buf_size, &len);
+		return xret == XRT_SUCCESS && len == sizeof(struct ipc_device_get_tracked_pose_msg);
+	}
+
+	void
+	run()
+	{
+		uint8_t buf[IPC_BUF_SIZE];
+
+		while (receive(buf, sizeof(buf))) {
+			auto *msg = (struct ipc_device_get_tracked_pose_msg *)buf;
+
+			struct ipc_device_get_tracked_pose_reply reply = {};
+			reply.result = XRT_SUCCESS;
+			reply.relation.pose.orientation.w = 1.f;
+			reply.relation.pose.position.x = (float)msg->id;
+			reply.relation.pose.position.y = (float)(msg->at_timestamp % 1000);
+
+			if (ipc_send(&imc, &reply, sizeof(reply)) != XRT_SUCCESS) {
+				break;
+			}
+		}
+	}
+};
+
+struct fixture
+{
+	struct ipc_connection ipc_c = {};
+	fake_server *server = nullptr;
+
+	fixture(receive_mode mode)
+	{
+		int fds[2] = {-1, -1};
+		REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+		ipc_c.imc.ipc_handle = fds[0];
+		ipc_c.imc.log_level = U_LOGGING_WARN;
+		os_mutex_init(&ipc_c.mutex);
+
+		server = new fake_server(fds[1], mode);
+	}
+
+	~fixture()
+	{
+		// Closing our end makes the server see a zero sized read and exit.
+		ipc_message_channel_close(&ipc_c.imc);
+		delete server;
+		os_mutex_destroy(&ipc_c.mutex);
+	}
+
+	xrt_result_t
+	call(uint32_t id, uint64_t ts, struct xrt_space_relation *out_rel)
+	{
+		return ipc_call_device_get_tracked_pose(&ipc_c, id, XRT_INPUT_GENERIC_HEAD_POSE, ts, out_rel);
+	}
+};
+
+} // namespace
+
+
+TEST_CASE("ipc_receive_some")
+{
+	int fds[2] = {-1, -1};
+	REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+	struct ipc_message_channel tx = {};
+	tx.ipc_handle = fds[0];
+	tx.log_level = U_LOGGING_WARN;
+	struct ipc_message_channel rx = {};
+	rx.ipc_handle = fds[1];
+	rx.log_level = U_LOGGING_WARN;
+
+	uint8_t buf[IPC_BUF_SIZE];
+	size_t len = 0;
+
+	SECTION("whole message in one read")
+	{
+		struct ipc_device_get_tracked_pose_msg msg = {};
+		msg.cmd = IPC_DEVICE_GET_TRACKED_POSE;
+		msg.id = 7;
+		REQUIRE(ipc_send(&tx, &msg, sizeof(msg)) == XRT_SUCCESS);
+
+		CHECK(ipc_receive_some(&rx, buf, sizeof(buf), &len) == XRT_SUCCESS);
+		CHECK(len == sizeof(msg));
+		CHECK(((struct ipc_device_get_tracked_pose_msg *)buf)->id == 7);
+	}
+
+	SECTION("closed connection reads zero bytes")
+	{
+		ipc_message_channel_close(&tx);
+
+		CHECK(ipc_receive_some(&rx, buf, sizeof(buf), &len) == XRT_SUCCESS);
+		CHECK(len == 0);
+	}
+
+	ipc_message_channel_close(&tx);
+	ipc_message_channel_close(&rx);
+}
+
+TEST_CASE("ipc_receive_discard")
+{
+	int fds[2] = {-1, -1};
+	REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+	struct ipc_message_channel tx = {};
+	tx.ipc_handle = fds[0];
+	tx.log_level = U_LOGGING_WARN;
+	struct ipc_message_channel rx = {};
+	rx.ipc_handle = fds[1];
+	rx.log_level = U_LOGGING_WARN;
+
+	// Bigger than the scratch buffer, so it takes more than one read.
+	std::vector<uint8_t> payload(10000, 0xab);
+
+	SECTION("channel is in sync afterwards")
+	{
+		uint32_t tail = 0x12345678;
+		REQUIRE(ipc_send(&tx, payload.data(), payload.size()) == XRT_SUCCESS);
+		REQUIRE(ipc_send(&tx, &tail, sizeof(tail)) == XRT_SUCCESS);
+
+		CHECK(ipc_receive_discard(&rx, payload.size()) == XRT_SUCCESS);
+
+		uint32_t got = 0;
+		CHECK(ipc_receive(&rx, &got, sizeof(got)) == XRT_SUCCESS);
+		CHECK(got == tail);
+	}
+
+	SECTION("closed connection before everything was read")
+	{
+		REQUIRE(ipc_send(&tx, payload.data(), 100) == XRT_SUCCESS);
+		ipc_message_channel_close(&tx);
+
+		CHECK(ipc_receive_discard(&rx, payload.size()) == XRT_ERROR_IPC_FAILURE);
+	}
+
+	ipc_message_channel_close(&tx);
+	ipc_message_channel_close(&rx);
+}
+
+TEST_CASE("ipc round-trip")
+{
+	auto mode = GENERATE(receive_mode::peek, receive_mode::framed);
+	fixture f(mode);
+
+	for (uint32_t i = 0; i < 16; i++) {
+		struct xrt_space_relation rel = XRT_SPACE_RELATION_ZERO;
+		CHECK(f.call(i, 1000 + i, &rel) == XRT_SUCCESS);
+		CHECK(rel.pose.position.x == (float)i);
+		CHECK(rel.pose.position.y == (float)i);
+	}
+}
+
+/*!
+ * Hidden, run with: tests_ipc_roundtrip "[benchmark]"
+ */
+TEST_CASE("ipc round-trip latency", "[.][benchmark]")
+{
+	struct xrt_space_relation rel = XRT_SPACE_RELATION_ZERO;
+
+	{
+		fixture f(receive_mode::peek);
+		BENCHMARK("device_get_tracked_pose, peek then read")
+		{
+			return f.call(0, 0, &rel);
+		};
+	}
+
+	{
+		fixture f(receive_mode::framed);
+		BENCHMARK("device_get_tracked_pose, single read")
+		{
+			return f.call(0, 0, &rel);
+		};
+	}
+}
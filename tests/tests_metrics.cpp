@@ -0,0 +1,137 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Metrics writer tests.
+ */
+
+#include "util/u_metrics.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+const char *
+metrics_path()
+{
+	static std::string path = [] {
+		const char *tmp = getenv("TMPDIR");
+		std::string p = std::string(tmp != nullptr ? tmp : "/tmp") + "/monado_tests_metrics.bin";
+		// Read once by u_metrics_init, must be set before the first call.
+#ifdef _WIN32
+		_putenv_s("XRT_METRICS_FILE", p.c_str());
+#else
+		setenv("XRT_METRICS_FILE", p.c_str(), 1);
+#endif
+		return p;
+	}();
+	return path.c_str();
+}
+
+/*!
+ * Every record is written as a length prefixed submessage, walk the varints
+ * to count them without having to decode anything.
+ */
+uint32_t
+count_records(const char *path)
+{
+	FILE *file = fopen(path, "rb");
+	REQUIRE(file != nullptr);
+
+	uint32_t count = 0;
+	while (true) {
+		uint64_t len = 0;
+		int shift = 0;
+		int c = 0;
+		while ((c = fgetc(file)) != EOF) {
+			len |= (uint64_t)(c & 0x7f) << shift;
+			shift += 7;
+			if ((c & 0x80) == 0) {
+				break;
+			}
+		}
+		if (c == EOF) {
+			break;
+		}
+
+		if (fseek(file, (long)len, SEEK_CUR) != 0) {
+			break;
+		}
+		count++;
+	}
+
+	fclose(file);
+	return count;
+}
+
+void
+write_frames(int64_t session_id, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		struct u_metrics_session_frame umsf = {};
+		umsf.session_id = session_id;
+		umsf.frame_id = i;
+		umsf.predicted_display_time_ns = 1000 * i;
+		u_metrics_write_session_frame(&umsf);
+	}
+}
+
+} // namespace
+
+
+TEST_CASE("u_metrics")
+{
+	const char *path = metrics_path();
+
+	u_metrics_init();
+	REQUIRE(u_metrics_is_active());
+
+	constexpr uint32_t ThreadCount = 4;
+	constexpr uint32_t PerThread = 5000;
+
+	std::vector<std::thread> threads;
+	for (uint32_t i = 0; i < ThreadCount; i++) {
+		threads.emplace_back(write_frames, (int64_t)i, PerThread);
+	}
+	for (auto &t : threads) {
+		t.join();
+	}
+
+	u_metrics_close();
+	CHECK_FALSE(u_metrics_is_active());
+
+	// The version record plus everything that was not dropped.
+	uint32_t written = count_records(path);
+	uint32_t dropped = u_metrics_get_dropped_count();
+	CHECK(written + dropped == 1 + ThreadCount * PerThread);
+
+	remove(path);
+}
+
+/*!
+ * Hidden, run with: tests_metrics "[benchmark]"
+ */
+TEST_CASE("u_metrics write", "[.][benchmark]")
+{
+	const char *path = metrics_path();
+
+	u_metrics_init();
+
+	struct u_metrics_session_frame umsf = {};
+
+	BENCHMARK("u_metrics_write_session_frame")
+	{
+		umsf.frame_id++;
+		u_metrics_write_session_frame(&umsf);
+	};
+
+	u_metrics_close();
+	remove(path);
+}
@@ -0,0 +1,104 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Precise sleeper wake up error tests.
+ */
+
+#include "os/os_time.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <algorithm>
+#include <vector>
+
+
+namespace {
+
+//! Waits for @p count deadlines a little over a millisecond apart, returns the sorted wake up errors.
+std::vector<int64_t>
+wait_for_deadlines(struct os_precise_sleeper &sleeper, int count)
+{
+	constexpr int64_t Period = 1000 * 1000;
+
+	std::vector<int64_t> errors;
+	errors.reserve(count);
+
+	uint64_t deadline_ns = os_monotonic_get_ns();
+	for (int i = 0; i < count; i++) {
+		// Not a whole period so the deadlines don't line up with the timer tick.
+		deadline_ns += Period + (i % 7) * 13 * 1000;
+
+		os_precise_sleeper_wait_until(&sleeper, deadline_ns);
+		int64_t error_ns = (int64_t)(os_monotonic_get_ns() - deadline_ns);
+
+		CHECK(sleeper.last_error_ns >= 0);
+		CHECK(sleeper.last_error_ns <= error_ns);
+		errors.push_back(error_ns);
+	}
+
+	std::sort(errors.begin(), errors.end());
+	return errors;
+}
+
+} // namespace
+
+
+TEST_CASE("os_precise_sleeper_wait_until")
+{
+	struct os_precise_sleeper sleeper = {};
+	os_precise_sleeper_init(&sleeper);
+
+	std::vector<int64_t> errors = wait_for_deadlines(sleeper, 100);
+	CHECK(sleeper.wait_count == 100);
+
+	// Never early, how late depends on the machine so see the benchmark below.
+	CHECK(errors.front() >= 0);
+
+	// Stays within what it is allowed to spin.
+	CHECK(sleeper.spin_ns >= 10 * 1000);
+	CHECK(sleeper.spin_ns <= 500 * 1000);
+
+	os_precise_sleeper_deinit(&sleeper);
+}
+
+/*!
+ * Hidden, run with: tests_precise_sleeper "[benchmark]"
+ *
+ * Only meaningful on an otherwise idle machine.
+ */
+TEST_CASE("os_precise_sleeper_wait_until wake up error", "[.][benchmark]")
+{
+	constexpr int DeadlineCount = 1000;
+
+	struct os_precise_sleeper sleeper = {};
+	os_precise_sleeper_init(&sleeper);
+
+	std::vector<int64_t> errors = wait_for_deadlines(sleeper, DeadlineCount);
+	int64_t median_ns = errors[DeadlineCount / 2];
+	int64_t p90_ns = errors[DeadlineCount * 90 / 100];
+	int64_t p99_ns = errors[DeadlineCount * 99 / 100];
+
+	CAPTURE(median_ns, p90_ns, p99_ns);
+	CHECK(median_ns < 100 * 1000);
+
+	os_precise_sleeper_deinit(&sleeper);
+}
+
+TEST_CASE("os_precise_sleeper_wait_until in the past")
+{
+	struct os_precise_sleeper sleeper = {};
+	os_precise_sleeper_init(&sleeper);
+
+	uint64_t now_ns = os_monotonic_get_ns();
+	os_precise_sleeper_wait_until(&sleeper, now_ns - 1000);
+	CHECK(sleeper.last_error_ns >= 1000);
+
+	// Too short to sleep, only spins.
+	now_ns = os_monotonic_get_ns();
+	os_precise_sleeper_wait_until(&sleeper, now_ns + 5000);
+	CHECK(os_monotonic_get_ns() >= now_ns + 5000);
+	CHECK(sleeper.spin_ns == OS_PRECISE_SLEEPER_INITIAL_SPIN_NS);
+
+	os_precise_sleeper_deinit(&sleeper);
+}
@@ -0,0 +1,301 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Prober hotplug tests, with events fed in by hand instead of udev.
+ */
+
+#include "xrt/xrt_prober.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <prober/p_prober.h>
+
+#include <linux/input.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+
+namespace {
+
+constexpr uint16_t OtherVid = 0x1234;
+constexpr uint16_t Vid = 0x2345;
+constexpr uint16_t Pid = 0x0001;
+
+std::string
+usb_path(uint16_t bus, uint16_t addr)
+{
+	return "/sys/devices/usb" + std::to_string(bus) + "/" + std::to_string(bus) + "-" + std::to_string(addr);
+}
+
+std::string
+hidraw_path(uint16_t bus, uint16_t addr)
+{
+	return usb_path(bus, addr) + "/hidraw";
+}
+
+/*!
+ * Stands in for the udev monitor, the events are what it would have parsed.
+ */
+struct FakeSource
+{
+	struct prober_hotplug_source base = {};
+	std::mutex mutex;
+	std::deque<struct prober_hotplug_event> events;
+	size_t taken = 0;
+
+	FakeSource()
+	{
+		base.get_fd = get_fd;
+		base.next_event = next_event;
+		base.destroy = destroy;
+	}
+
+	~FakeSource()
+	{
+		for (struct prober_hotplug_event &event : events) {
+			free_entry(event.entry);
+		}
+	}
+
+	void
+	add_usb(uint16_t bus, uint16_t addr, uint16_t vid, uint16_t pid)
+	{
+		struct prober_hotplug_event event = {};
+		event.action = PROBER_HOTPLUG_ADD;
+		fill(event.entry, PROBER_UDEV_ENTRY_USB, usb_path(bus, addr), bus, addr, vid, pid);
+		push(event);
+	}
+
+	void
+	add_hidraw(uint16_t bus, uint16_t addr, uint16_t vid, uint16_t pid)
+	{
+		struct prober_hotplug_event event = {};
+		event.action = PROBER_HOTPLUG_ADD;
+		fill(event.entry, PROBER_UDEV_ENTRY_HIDRAW, hidraw_path(bus, addr), bus, addr, vid, pid);
+		event.entry.bus_type = BUS_USB;
+		push(event);
+	}
+
+	void
+	remove(enum prober_udev_entry_type type, const std::string &path)
+	{
+		struct prober_hotplug_event event = {};
+		event.action = PROBER_HOTPLUG_REMOVE;
+		event.entry.type = type;
+		event.entry.sysfs_path = strdup(path.c_str());
+		push(event);
+	}
+
+	static void
+	fill(struct prober_udev_entry &e,
+	     enum prober_udev_entry_type type,
+	     const std::string &path,
+	     uint16_t bus,
+	     uint16_t addr,
+	     uint16_t vid,
+	     uint16_t pid)
+	{
+		e.type = type;
+		e.sysfs_path = strdup(path.c_str());
+		e.dev_path = strdup(("/dev" + path).c_str());
+		e.vendor_id = vid;
+		e.product_id = pid;
+		e.usb_bus = bus;
+		e.usb_addr = addr;
+	}
+
+	static void
+	free_entry(struct prober_udev_entry &e)
+	{
+		free(e.sysfs_path);
+		free(e.dev_path);
+	}
+
+	void
+	push(const struct prober_hotplug_event &event)
+	{
+		std::unique_lock lock(mutex);
+		events.push_back(event);
+	}
+
+	static int
+	get_fd(struct prober_hotplug_source *src)
+	{
+		return -1;
+	}
+
+	static bool
+	next_event(struct prober_hotplug_source *src, struct prober *p, struct prober_hotplug_event *out_event)
+	{
+		auto *fs = (FakeSource *)src;
+		std::unique_lock lock(fs->mutex);
+		if (fs->events.empty()) {
+			return false;
+		}
+
+		*out_event = fs->events.front();
+		fs->events.pop_front();
+		fs->taken++;
+		return true;
+	}
+
+	static void
+	destroy(struct prober_hotplug_source *src)
+	{
+		// Owned by the test.
+	}
+};
+
+/*!
+ * Just enough of a prober for hotplug, no udev, libusb or builders of its own.
+ */
+struct TestProber
+{
+	struct prober p = {};
+	FakeSource source;
+
+	TestProber()
+	{
+		p.log_level = U_LOGGING_WARN;
+
+		os_mutex_init(&p.list_mutex);
+		REQUIRE(p_udev_hotplug_init(&p, &source.base) == 0);
+	}
+
+	~TestProber()
+	{
+		p_udev_hotplug_teardown(&p);
+		p_udev_teardown(&p);
+
+		while (p.device_count > 0) {
+			p_dev_remove(&p, &p.devices[p.device_count - 1]);
+		}
+		free(p.devices);
+
+		os_mutex_destroy(&p.list_mutex);
+	}
+
+	struct prober_device *
+	find(uint16_t bus, uint16_t addr)
+	{
+		for (size_t i = 0; i < p.device_count; i++) {
+			if (p.devices[i].usb.bus == bus && p.devices[i].usb.addr == addr) {
+				return &p.devices[i];
+			}
+		}
+		return nullptr;
+	}
+};
+
+} // namespace
+
+
+TEST_CASE("prober_hotplug")
+{
+	TestProber tp;
+	struct prober &p = tp.p;
+
+	SECTION("devices come and go with their interfaces")
+	{
+		tp.source.add_usb(1, 2, Vid, Pid);
+		tp.source.add_hidraw(1, 2, Vid, Pid);
+		p_udev_hotplug_poll(&p);
+
+		REQUIRE(p.device_count == 1);
+		struct prober_device *pdev = tp.find(1, 2);
+		REQUIRE(pdev != nullptr);
+		CHECK(pdev->base.vendor_id == Vid);
+		CHECK(pdev->num_hidraws == 1);
+		CHECK(std::string(pdev->usb.path) == "/dev" + usb_path(1, 2));
+
+		// Both events were for the same device, so it's only rebuilt once.
+		CHECK(p.hotplug.event_count == 2);
+		CHECK(p.hotplug.device_count == 1);
+
+		tp.source.remove(PROBER_UDEV_ENTRY_HIDRAW, hidraw_path(1, 2));
+		p_udev_hotplug_poll(&p);
+
+		REQUIRE(p.device_count == 1);
+		CHECK(tp.find(1, 2)->num_hidraws == 0);
+
+		tp.source.remove(PROBER_UDEV_ENTRY_USB, usb_path(1, 2));
+		p_udev_hotplug_poll(&p);
+
+		CHECK(p.device_count == 0);
+		CHECK(p.hotplug.device_count == 3);
+	}
+
+	SECTION("cost follows the changes, not the bus size")
+	{
+		constexpr uint16_t BusSize = 500;
+		for (uint16_t addr = 1; addr <= BusSize; addr++) {
+			tp.source.add_usb(1, addr, OtherVid, Pid);
+		}
+		p_udev_hotplug_poll(&p);
+
+		REQUIRE(p.device_count == BusSize);
+		CHECK(p.hotplug.device_count == BusSize);
+
+		size_t taken = tp.source.taken;
+		uint64_t devices = p.hotplug.device_count;
+
+		tp.source.add_usb(2, 1, Vid, Pid);
+		p_udev_hotplug_poll(&p);
+
+		// One event read, one device rebuilt, nothing enumerated or parsed.
+		CHECK(tp.source.taken - taken == 1);
+		CHECK(p.hotplug.device_count - devices == 1);
+		CHECK(p.probe_timing.udev_parsed == 0);
+		CHECK(p.device_count == BusSize + 1);
+
+		tp.source.remove(PROBER_UDEV_ENTRY_USB, usb_path(1, BusSize / 2));
+		p_udev_hotplug_poll(&p);
+
+		CHECK(tp.source.taken - taken == 2);
+		CHECK(p.hotplug.device_count - devices == 2);
+		CHECK(p.device_count == BusSize);
+		CHECK(tp.find(1, BusSize / 2) == nullptr);
+		CHECK(tp.find(1, BusSize / 2 + 1) != nullptr);
+	}
+
+	SECTION("events wait while the list is locked")
+	{
+		p.list_lock_count = 1;
+
+		tp.source.add_usb(1, 2, OtherVid, Pid);
+		p_udev_hotplug_poll(&p);
+
+		CHECK(p.device_count == 0);
+		CHECK(p.hotplug.pending_count == 1);
+
+		p.list_lock_count = 0;
+		p_udev_hotplug_poll(&p);
+
+		CHECK(p.device_count == 1);
+		CHECK(p.hotplug.pending_count == 0);
+	}
+
+	SECTION("thread picks up events")
+	{
+		REQUIRE(p_udev_hotplug_start_thread(&p) == 0);
+
+		tp.source.add_usb(1, 2, Vid, Pid);
+
+		size_t count = 0;
+		for (int i = 0; i < 100 && count == 0; i++) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			os_mutex_lock(&p.list_mutex);
+			count = p.device_count;
+			os_mutex_unlock(&p.list_mutex);
+		}
+
+		CHECK(count == 1);
+	}
+}
@@ -0,0 +1,250 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief PS Move tracker blob finding tests.
+ */
+
+#include "tracking/t_tracker_psmv_blobs.hpp"
+
+#include "catch_amalgamated.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+
+using xrt::auxiliary::tracking::calibration_get_undistort_map;
+using xrt::auxiliary::tracking::CameraCalibrationWrapper;
+using xrt::auxiliary::tracking::ViewRectification;
+using xrt::auxiliary::tracking::psmv::create_blob_detector;
+using xrt::auxiliary::tracking::psmv::View;
+
+namespace {
+
+constexpr int Width = 640;
+constexpr int Height = 480;
+
+t_camera_calibration
+make_calib(enum t_camera_distortion_model model, int w, int h)
+{
+	t_camera_calibration calib = {};
+	calib.image_size_pixels = {w, h};
+	calib.intrinsics[0][0] = 0.85 * w;
+	calib.intrinsics[0][2] = w / 2.0;
+	calib.intrinsics[1][1] = 0.85 * w;
+	calib.intrinsics[1][2] = h / 2.0;
+	calib.intrinsics[2][2] = 1.0;
+	calib.distortion_model = model;
+
+	if (model == T_DISTORTION_FISHEYE_KB4) {
+		calib.kb4 = {0.05, -0.01, 0.002, 0.0};
+	} else {
+		calib.rt5 = {-0.2, 0.05, 0.001, -0.001, 0.0};
+	}
+
+	return calib;
+}
+
+/*!
+ * Rectification that only undistorts, like a view of a stereo pair that
+ * already is perfectly aligned.
+ */
+View
+make_view(t_camera_calibration &calib)
+{
+	CameraCalibrationWrapper wrap(calib);
+
+	ViewRectification rectification;
+	rectification.rotation_mat = cv::Mat::eye(3, 3, CV_64F);
+	rectification.projection_mat = cv::Mat::zeros(3, 4, CV_64F);
+	wrap.intrinsics_mat.copyTo(rectification.projection_mat(cv::Rect(0, 0, 3, 3)));
+	rectification.rectify = calibration_get_undistort_map( //
+	    calib, rectification.rotation_mat, rectification.projection_mat);
+
+	View view = {};
+	view.populate_from_calib(calib, rectification);
+	return view;
+}
+
+//! Where a point in the rectified image is in the raw one.
+cv::Point2f
+distort(const View &view, cv::Point2f rectified)
+{
+	const cv::Matx33d &k = view.intrinsics;
+	std::vector<cv::Point2f> normalized = {{
+	    (float)((rectified.x - k(0, 2)) / k(0, 0)),
+	    (float)((rectified.y - k(1, 2)) / k(1, 1)),
+	}};
+	std::vector<cv::Point2f> raw;
+
+	if (view.distortion_model == T_DISTORTION_FISHEYE_KB4) {
+		cv::fisheye::distortPoints(normalized, raw, k, view.distortion);
+	} else {
+		std::vector<cv::Point3f> points = {{normalized[0].x, normalized[0].y, 1.0f}};
+		cv::projectPoints(points, cv::Vec3d(), cv::Vec3d(), k, view.distortion, raw);
+	}
+
+	return raw[0];
+}
+
+//! A dark, slightly noisy frame with balls at the given rectified positions.
+cv::Mat
+render(const View &view, const std::vector<cv::Point2f> &balls, int w, int h, uint32_t seed)
+{
+	cv::Mat grey(h, w, CV_8UC1);
+	cv::theRNG().state = seed;
+	cv::randu(grey, 0, 24);
+
+	for (const cv::Point2f &ball : balls) {
+		cv::circle(grey, distort(view, ball), 6, cv::Scalar(200), cv::FILLED, cv::LINE_8);
+	}
+
+	return grey;
+}
+
+std::vector<cv::Point2f>
+sorted_points(const std::vector<cv::KeyPoint> &keypoints)
+{
+	std::vector<cv::Point2f> ret;
+	for (const cv::KeyPoint &kp : keypoints) {
+		ret.push_back(kp.pt);
+	}
+	std::sort(ret.begin(), ret.end(), [](const cv::Point2f &a, const cv::Point2f &b) { return a.x < b.x; });
+	return ret;
+}
+
+} // namespace
+
+
+TEST_CASE("psmv_blobs")
+{
+	enum t_camera_distortion_model model = GENERATE(T_DISTORTION_OPENCV_RADTAN_5, T_DISTORTION_FISHEYE_KB4);
+	CAPTURE(model);
+
+	t_camera_calibration calib = make_calib(model, Width, Height);
+	View view = make_view(calib);
+	cv::Ptr<cv::SimpleBlobDetector> sbd = create_blob_detector();
+
+	SECTION("sparse finds the same balls as dense")
+	{
+		std::vector<cv::Point2f> balls = {{100, 80}, {320, 240}, {560, 400}};
+		cv::Mat grey = render(view, balls, Width, Height, 1);
+
+		view.find_blobs_dense(*sbd, grey);
+		std::vector<cv::Point2f> dense = sorted_points(view.keypoints);
+
+		view.find_blobs_sparse(grey);
+		std::vector<cv::Point2f> sparse = sorted_points(view.keypoints);
+
+		REQUIRE(dense.size() == balls.size());
+		REQUIRE(sparse.size() == balls.size());
+		for (size_t i = 0; i < balls.size(); i++) {
+			CAPTURE(i, balls[i], dense[i], sparse[i]);
+			CHECK(cv::norm(sparse[i] - balls[i]) < 1.0);
+			CHECK(cv::norm(sparse[i] - dense[i]) < 1.5);
+		}
+	}
+
+	SECTION("close small blobs are not merged")
+	{
+		// Two 3x3 dots with one dark column between them, closer than minDistBetweenBlobs.
+		cv::Mat grey = render(view, {}, Width, Height, 5);
+		cv::rectangle(grey, cv::Rect(318, 238, 3, 3), cv::Scalar(200), cv::FILLED);
+		cv::rectangle(grey, cv::Rect(322, 238, 3, 3), cv::Scalar(200), cv::FILLED);
+
+		view.find_blobs_dense(*sbd, grey);
+		size_t dense = view.keypoints.size();
+
+		view.find_blobs_sparse(grey);
+		CHECK(view.keypoints.size() == 2);
+		CHECK(view.keypoints.size() == dense);
+	}
+
+	SECTION("nothing bright, no blobs")
+	{
+		cv::Mat grey = render(view, {}, Width, Height, 2);
+
+		view.find_blobs_sparse(grey);
+		CHECK(view.keypoints.empty());
+	}
+
+	SECTION("streaks are not balls")
+	{
+		cv::Mat grey = render(view, {}, Width, Height, 3);
+		cv::line(grey, {50, 50}, {300, 200}, cv::Scalar(255), 1, cv::LINE_8);
+
+		view.find_blobs_sparse(grey);
+		CHECK(view.keypoints.empty());
+	}
+
+	SECTION("debug drawing of both paths")
+	{
+		cv::Mat grey = render(view, {{320, 240}}, Width, Height, 4);
+		cv::Mat rgb(Height, Width, CV_8UC3);
+
+		view.find_blobs_sparse(grey);
+		view.draw_debug(rgb, true);
+		view.find_blobs_dense(*sbd, grey);
+		view.draw_debug(rgb, false);
+		CHECK(rgb.size() == grey.size());
+	}
+}
+
+/*!
+ * Hidden, run with: tests_psmv_blobs "[benchmark]"
+ *
+ * Set PSMV_BLOBS_FRAMES to a directory of greyscale images, for instance the
+ * cam0/data directory of a recording, to run on recorded frames instead of
+ * rendered ones. Each image is treated as one view.
+ */
+TEST_CASE("psmv_blobs paths", "[.][benchmark]")
+{
+	std::vector<cv::Mat> frames;
+
+	const char *dir = std::getenv("PSMV_BLOBS_FRAMES");
+	if (dir != nullptr) {
+		std::vector<std::string> paths;
+		for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+			paths.push_back(entry.path().string());
+		}
+		std::sort(paths.begin(), paths.end());
+
+		for (const std::string &path : paths) {
+			cv::Mat grey = cv::imread(path, cv::IMREAD_GRAYSCALE);
+			if (!grey.empty() && (frames.empty() || grey.size() == frames[0].size())) {
+				frames.push_back(grey);
+			}
+		}
+		REQUIRE(!frames.empty());
+	}
+
+	int w = frames.empty() ? Width : frames[0].cols;
+	int h = frames.empty() ? Height : frames[0].rows;
+
+	t_camera_calibration calib = make_calib(T_DISTORTION_OPENCV_RADTAN_5, w, h);
+	View view = make_view(calib);
+	cv::Ptr<cv::SimpleBlobDetector> sbd = create_blob_detector();
+
+	// A ball moving across the image.
+	for (uint32_t i = 0; dir == nullptr && i < 60; i++) {
+		cv::Point2f ball(w * (0.2f + 0.01f * i), h * (0.3f + 0.005f * i));
+		frames.push_back(render(view, {ball}, w, h, i));
+	}
+
+	size_t index = 0;
+	BENCHMARK("dense")
+	{
+		view.find_blobs_dense(*sbd, frames[index++ % frames.size()]);
+		return view.keypoints.size();
+	};
+
+	index = 0;
+	BENCHMARK("sparse")
+	{
+		view.find_blobs_sparse(frames[index++ % frames.size()]);
+		return view.keypoints.size();
+	};
+}
@@ -13,6 +13,8 @@
 
 #include "catch_amalgamated.hpp"
 
+#include <random>
+
 
 /*
  *
@@ -237,3 +239,137 @@ TEST_CASE("Relation Chain Flags")
 		TEST_FLAGS(XRT_SPACE_RELATION_POSITION_VALID_BIT, VNT, ONLY_POSITION, P);
 	}
 }
+
+
+/*
+ *
+ * Relation set, must match the chain.
+ *
+ */
+
+static xrt_space_relation
+random_relation(std::mt19937 &rng, bool all_flags)
+{
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+	xrt_space_relation r = {};
+	r.pose.orientation = {dist(rng), dist(rng), dist(rng), dist(rng)};
+	math_quat_normalize(&r.pose.orientation);
+	r.pose.position = {dist(rng), dist(rng), dist(rng)};
+	r.linear_velocity = {dist(rng), dist(rng), dist(rng)};
+	r.angular_velocity = {dist(rng), dist(rng), dist(rng)};
+	uint32_t flags = all_flags ? (uint32_t)XRT_SPACE_RELATION_BITMASK_ALL : (uint32_t)(rng() & 0x3f);
+	r.relation_flags = (xrt_space_relation_flags)flags;
+
+	return r;
+}
+
+static void
+check_relation_near(const xrt_space_relation &a, const xrt_space_relation &b)
+{
+	constexpr float eps = 1e-4f;
+
+	CHECK(a.relation_flags == b.relation_flags);
+	CHECK(a.pose.position.x == Catch::Approx(b.pose.position.x).margin(eps));
+	CHECK(a.pose.position.y == Catch::Approx(b.pose.position.y).margin(eps));
+	CHECK(a.pose.position.z == Catch::Approx(b.pose.position.z).margin(eps));
+	CHECK(a.pose.orientation.x == Catch::Approx(b.pose.orientation.x).margin(eps));
+	CHECK(a.pose.orientation.y == Catch::Approx(b.pose.orientation.y).margin(eps));
+	CHECK(a.pose.orientation.z == Catch::Approx(b.pose.orientation.z).margin(eps));
+	CHECK(a.pose.orientation.w == Catch::Approx(b.pose.orientation.w).margin(eps));
+	CHECK(a.linear_velocity.x == Catch::Approx(b.linear_velocity.x).margin(eps));
+	CHECK(a.linear_velocity.y == Catch::Approx(b.linear_velocity.y).margin(eps));
+	CHECK(a.linear_velocity.z == Catch::Approx(b.linear_velocity.z).margin(eps));
+	CHECK(a.angular_velocity.x == Catch::Approx(b.angular_velocity.x).margin(eps));
+	CHECK(a.angular_velocity.y == Catch::Approx(b.angular_velocity.y).margin(eps));
+	CHECK(a.angular_velocity.z == Catch::Approx(b.angular_velocity.z).margin(eps));
+}
+
+TEST_CASE("Relation Set")
+{
+	std::mt19937 rng(42);
+	bool all_flags = GENERATE(true, false);
+	CAPTURE(all_flags);
+
+	for (int round = 0; round < 20; round++) {
+		xrt_space_relation latest = random_relation(rng, all_flags);
+		xrt_space_relation predicted = random_relation(rng, all_flags);
+		xrt_space_relation joints[XRT_HAND_JOINT_COUNT];
+
+		m_relation_set set = {};
+		for (uint32_t i = 0; i < XRT_HAND_JOINT_COUNT; i++) {
+			joints[i] = random_relation(rng, all_flags);
+			m_relation_set_store(&set, i, &joints[i]);
+		}
+		REQUIRE(set.count == XRT_HAND_JOINT_COUNT);
+
+		// Like the hand tracking, relative to the latest wrist then predicted.
+		xrt_space_relation inv_latest = {};
+		m_space_relation_invert(&latest, &inv_latest);
+		m_relation_set_apply(&set, &inv_latest, &set);
+		m_relation_set_apply(&set, &predicted, &set);
+
+		for (uint32_t i = 0; i < XRT_HAND_JOINT_COUNT; i++) {
+			xrt_relation_chain xrc = {};
+			m_relation_chain_push_relation(&xrc, &joints[i]);
+			m_relation_chain_push_inverted_relation(&xrc, &latest);
+			m_relation_chain_push_relation(&xrc, &predicted);
+
+			xrt_space_relation expected = {};
+			m_relation_chain_resolve(&xrc, &expected);
+
+			xrt_space_relation actual = {};
+			m_relation_set_load(&set, i, &actual);
+
+			CAPTURE(round, i, joints[i].relation_flags);
+			check_relation_near(actual, expected);
+		}
+	}
+}
+
+/*!
+ * Hidden, run with: tests_relation_chain "[benchmark]"
+ *
+ * Moving all joints of a hand, as one chain per joint or one set.
+ */
+TEST_CASE("Relation Set vs Chain", "[.][benchmark]")
+{
+	std::mt19937 rng(7);
+	xrt_space_relation latest = random_relation(rng, true);
+	xrt_space_relation predicted = random_relation(rng, true);
+	xrt_space_relation joints[XRT_HAND_JOINT_COUNT];
+	xrt_space_relation out[XRT_HAND_JOINT_COUNT];
+
+	m_relation_set set = {};
+	for (uint32_t i = 0; i < XRT_HAND_JOINT_COUNT; i++) {
+		joints[i] = random_relation(rng, true);
+		m_relation_set_store(&set, i, &joints[i]);
+	}
+
+	xrt_space_relation inv_latest = {};
+	m_space_relation_invert(&latest, &inv_latest);
+	m_relation_set wrist_set = {};
+	m_relation_set_apply(&set, &inv_latest, &wrist_set);
+
+	BENCHMARK("Chain per joint")
+	{
+		for (uint32_t i = 0; i < XRT_HAND_JOINT_COUNT; i++) {
+			xrt_relation_chain xrc = {};
+			m_relation_chain_push_relation(&xrc, &joints[i]);
+			m_relation_chain_push_inverted_relation(&xrc, &latest);
+			m_relation_chain_push_relation(&xrc, &predicted);
+			m_relation_chain_resolve(&xrc, &out[i]);
+		}
+		return out[0].pose.position.x;
+	};
+
+	BENCHMARK("Set")
+	{
+		m_relation_set tmp;
+		m_relation_set_apply(&wrist_set, &predicted, &tmp);
+		for (uint32_t i = 0; i < XRT_HAND_JOINT_COUNT; i++) {
+			m_relation_set_load(&tmp, i, &out[i]);
+		}
+		return out[0].pose.position.x;
+	};
+}
@@ -0,0 +1,262 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Side-by-side view frame and combiner tests.
+ */
+
+#include "xrt/xrt_frame.h"
+
+#include "util/u_frame.h"
+#include "util/u_sink.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+constexpr uint32_t Width = 37; // Odd so the eyes aren't stride aligned
+constexpr uint32_t Height = 9;
+
+struct xrt_frame *
+make_eye(enum xrt_format format, uint32_t eye, uint64_t timestamp)
+{
+	struct xrt_frame *xf = nullptr;
+	u_frame_create_one_off(format, Width, Height, &xf);
+	for (size_t i = 0; i < xf->size; i++) {
+		xf->data[i] = (uint8_t)(eye * 101 + i);
+	}
+	xf->timestamp = timestamp;
+	return xf;
+}
+
+/*!
+ * End of the chain, keeps every frame. The combiner pushes from the genlock
+ * thread, so wait for the frames before looking at them.
+ */
+struct keep_sink
+{
+	struct xrt_frame_sink base = {};
+	std::vector<struct xrt_frame *> frames;
+	std::atomic<size_t> pushed = 0;
+
+	keep_sink()
+	{
+		base.push_frame = push_frame;
+	}
+
+	~keep_sink()
+	{
+		for (struct xrt_frame *&xf : frames) {
+			xrt_frame_reference(&xf, nullptr);
+		}
+	}
+
+	static void
+	push_frame(struct xrt_frame_sink *xfs, struct xrt_frame *xf)
+	{
+		auto *ks = (struct keep_sink *)xfs;
+		struct xrt_frame *ref = nullptr;
+		xrt_frame_reference(&ref, xf);
+		ks->frames.push_back(ref);
+		ks->pushed++;
+	}
+
+	bool
+	wait_for(size_t count)
+	{
+		for (int i = 0; i < 1000 && pushed < count; i++) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return pushed >= count;
+	}
+};
+
+void
+check_packed(struct xrt_frame *sbs, struct xrt_frame *l, struct xrt_frame *r)
+{
+	REQUIRE(sbs->data != nullptr);
+	REQUIRE(sbs->width == l->width + r->width);
+	REQUIRE(sbs->height == l->height);
+
+	size_t bpp = l->stride / l->width;
+	uint32_t mismatches = 0;
+	for (uint32_t y = 0; y < sbs->height; y++) {
+		for (size_t x = 0; x < l->width * bpp; x++) {
+			mismatches += sbs->data[y * sbs->stride + x] != l->data[y * l->stride + x];
+			mismatches += sbs->data[y * sbs->stride + l->width * bpp + x] != r->data[y * r->stride + x];
+		}
+	}
+	CHECK(mismatches == 0);
+}
+
+} // namespace
+
+
+TEST_CASE("u_frame_sbs_view")
+{
+	enum xrt_format format = GENERATE(XRT_FORMAT_L8, XRT_FORMAT_R8G8B8);
+	CAPTURE(format);
+
+	struct xrt_frame *l = make_eye(format, 0, 1000);
+	struct xrt_frame *r = make_eye(format, 1, 1200);
+
+	struct xrt_frame *sbs = nullptr;
+	u_frame_create_sbs_view(l, r, &sbs);
+	REQUIRE(sbs != nullptr);
+
+	CHECK(sbs->data == nullptr);
+	CHECK(sbs->width == Width * 2);
+	CHECK(sbs->height == Height);
+	CHECK(sbs->format == format);
+	CHECK(sbs->stereo_format == XRT_STEREO_FORMAT_SBS);
+	CHECK(sbs->timestamp == 1100);
+
+	SECTION("eyes share the original data with the combined timestamp")
+	{
+		struct xrt_frame *el = nullptr;
+		struct xrt_frame *er = nullptr;
+		REQUIRE(u_frame_sbs_view_get_eyes(sbs, &el, &er));
+		CHECK(el->data == l->data);
+		CHECK(er->data == r->data);
+		CHECK(el->width == Width);
+		CHECK(el->stride == l->stride);
+		CHECK(el->timestamp == 1100);
+		CHECK(er->timestamp == 1100);
+
+		// The originals are not touched, others may hold them.
+		CHECK(l->timestamp == 1000);
+		CHECK(r->timestamp == 1200);
+		xrt_frame_reference(&el, nullptr);
+		xrt_frame_reference(&er, nullptr);
+
+		CHECK_FALSE(u_frame_sbs_view_get_eyes(l, &el, &er));
+		CHECK(el == nullptr);
+	}
+
+	SECTION("packing makes a new frame")
+	{
+		struct xrt_frame *packed = nullptr;
+		u_frame_pack_sbs_view(sbs, &packed);
+		REQUIRE(packed != sbs);
+		check_packed(packed, l, r);
+		CHECK(packed->stereo_format == XRT_STEREO_FORMAT_SBS);
+		CHECK(packed->timestamp == 1100);
+
+		// The view itself never changes.
+		CHECK(sbs->data == nullptr);
+		xrt_frame_reference(&packed, nullptr);
+
+		// Not a view, nothing to do.
+		u_frame_pack_sbs_view(l, &packed);
+		CHECK(packed == l);
+		xrt_frame_reference(&packed, nullptr);
+	}
+
+	SECTION("view outlives the eyes references")
+	{
+		xrt_frame_reference(&l, nullptr);
+		xrt_frame_reference(&r, nullptr);
+
+		struct xrt_frame *el = nullptr;
+		struct xrt_frame *er = nullptr;
+		struct xrt_frame *packed = nullptr;
+		REQUIRE(u_frame_sbs_view_get_eyes(sbs, &el, &er));
+		u_frame_pack_sbs_view(sbs, &packed);
+		check_packed(packed, el, er);
+		xrt_frame_reference(&packed, nullptr);
+		xrt_frame_reference(&el, nullptr);
+		xrt_frame_reference(&er, nullptr);
+	}
+
+	xrt_frame_reference(&sbs, nullptr);
+	xrt_frame_reference(&l, nullptr);
+	xrt_frame_reference(&r, nullptr);
+}
+
+TEST_CASE("u_sink_combiner")
+{
+	struct xrt_frame_context xfctx = {};
+	keep_sink slam_left;
+	keep_sink slam_right;
+	keep_sink packed;
+
+	struct xrt_frame *l = make_eye(XRT_FORMAT_L8, 0, 5000);
+	struct xrt_frame *r = make_eye(XRT_FORMAT_L8, 1, 5400);
+
+	SECTION("views split back without copies")
+	{
+		// Like a SLAM tracker and a debug window on the same combined stream.
+		struct xrt_frame_sink *splitter = nullptr;
+		u_sink_stereo_sbs_to_slam_sbs_create(&xfctx, &slam_left.base, &slam_right.base, &splitter);
+
+		struct xrt_frame_sink *packer = nullptr;
+		u_sink_sbs_pack_create(&xfctx, &packed.base, &packer);
+
+		struct xrt_frame_sink *split = nullptr;
+		u_sink_split_create(&xfctx, splitter, packer, &split);
+
+		struct xrt_frame_sink *cams[2] = {};
+		REQUIRE(u_sink_combiner_create_views(&xfctx, split, &cams[0], &cams[1]));
+
+		xrt_sink_push_frame(cams[0], l);
+		xrt_sink_push_frame(cams[1], r);
+
+		REQUIRE(packed.wait_for(1));
+		REQUIRE(slam_left.wait_for(1));
+		REQUIRE(slam_right.wait_for(1));
+		CHECK(slam_left.frames[0]->data == l->data);
+		CHECK(slam_right.frames[0]->data == r->data);
+
+		// Stereo consumers expect both eyes at the middle of the pair.
+		CHECK(slam_left.frames[0]->timestamp == 5200);
+		CHECK(slam_right.frames[0]->timestamp == 5200);
+		CHECK(packed.frames[0]->timestamp == 5200);
+
+		check_packed(packed.frames[0], l, r);
+	}
+
+	SECTION("plain combiner hands out packed frames")
+	{
+		struct xrt_frame_sink *cams[2] = {};
+		REQUIRE(u_sink_combiner_create(&xfctx, &packed.base, &cams[0], &cams[1]));
+
+		xrt_sink_push_frame(cams[0], l);
+		xrt_sink_push_frame(cams[1], r);
+
+		REQUIRE(packed.wait_for(1));
+		check_packed(packed.frames[0], l, r);
+	}
+
+	SECTION("packed frames still split")
+	{
+		struct xrt_frame_sink *splitter = nullptr;
+		u_sink_stereo_sbs_to_slam_sbs_create(&xfctx, &slam_left.base, &slam_right.base, &splitter);
+
+		struct xrt_frame *sbs = nullptr;
+		u_frame_create_sbs_view(l, r, &sbs);
+
+		// Not a view anymore, like a frame from a SBS camera.
+		struct xrt_frame *plain = nullptr;
+		u_frame_pack_sbs_view(sbs, &plain);
+		xrt_sink_push_frame(splitter, plain);
+
+		REQUIRE(slam_left.frames.size() == 1);
+		CHECK(slam_left.frames[0]->data != l->data);
+		CHECK(slam_left.frames[0]->width == Width);
+		CHECK(slam_left.frames[0]->data[1] == l->data[1]);
+		CHECK(slam_right.frames[0]->data[1] == r->data[1]);
+
+		xrt_frame_reference(&plain, nullptr);
+		xrt_frame_reference(&sbs, nullptr);
+	}
+
+	xrt_frame_reference(&l, nullptr);
+	xrt_frame_reference(&r, nullptr);
+	xrt_frame_context_destroy_nodes(&xfctx);
+}
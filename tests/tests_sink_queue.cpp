@@ -0,0 +1,195 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Frame sink queue tests.
+ */
+
+#include "xrt/xrt_frame.h"
+
+#include "util/u_sink.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+std::atomic<uint32_t> g_destroyed{0};
+
+void
+frame_destroy(struct xrt_frame *xf)
+{
+	g_destroyed++;
+	delete xf;
+}
+
+struct xrt_frame *
+frame_create(uint64_t sequence)
+{
+	auto *xf = new xrt_frame{};
+	xf->reference.count = 1;
+	xf->destroy = frame_destroy;
+	xf->source_sequence = sequence;
+	return xf;
+}
+
+/*!
+ * Downstream of the queue, records the order frames arrive in.
+ */
+struct counting_sink
+{
+	struct xrt_frame_sink base = {};
+	struct xrt_frame_node node = {};
+
+	std::atomic<uint32_t> count{0};
+	std::vector<uint64_t> sequences;
+
+	counting_sink()
+	{
+		base.push_frame = push_frame;
+		node.break_apart = [](struct xrt_frame_node *) {};
+		node.destroy = [](struct xrt_frame_node *) {};
+	}
+
+	static void
+	push_frame(struct xrt_frame_sink *xfs, struct xrt_frame *xf)
+	{
+		auto *cs = (struct counting_sink *)xfs;
+		cs->sequences.push_back(xf->source_sequence);
+		cs->count++;
+	}
+};
+
+struct xrt_frame_sink *
+create_queue(struct xrt_frame_context *xfctx, uint64_t max_size, struct counting_sink *cs)
+{
+	struct xrt_frame_sink *xfs = nullptr;
+	REQUIRE(u_sink_queue_create(xfctx, max_size, &cs->base, &xfs));
+	return xfs;
+}
+
+void
+push_and_release(struct xrt_frame_sink *xfs, uint64_t sequence)
+{
+	struct xrt_frame *xf = frame_create(sequence);
+	xrt_sink_push_frame(xfs, xf);
+	xrt_frame_reference(&xf, nullptr);
+}
+
+void
+wait_for(std::atomic<uint32_t> &value, uint32_t expected)
+{
+	while (value.load() < expected) {
+		std::this_thread::yield();
+	}
+}
+
+} // namespace
+
+
+TEST_CASE("u_sink_queue")
+{
+	constexpr uint32_t FrameCount = 1000;
+
+	uint64_t max_size = GENERATE(1, 3, 4);
+	CAPTURE(max_size);
+
+	struct xrt_frame_context xfctx = {};
+	counting_sink cs;
+	g_destroyed = 0;
+
+	struct xrt_frame_sink *xfs = create_queue(&xfctx, max_size, &cs);
+
+	SECTION("every frame is delivered when the consumer keeps up")
+	{
+		for (uint32_t i = 0; i < FrameCount; i++) {
+			push_and_release(xfs, i);
+			wait_for(cs.count, i + 1);
+		}
+
+		xrt_frame_context_destroy_nodes(&xfctx);
+
+		REQUIRE(cs.sequences.size() == FrameCount);
+		for (uint32_t i = 0; i < FrameCount; i++) {
+			CHECK(cs.sequences[i] == i);
+		}
+	}
+
+	SECTION("frames are dropped, never reordered or leaked, when bursting")
+	{
+		for (uint32_t i = 0; i < FrameCount; i++) {
+			push_and_release(xfs, i);
+		}
+
+		xrt_frame_context_destroy_nodes(&xfctx);
+
+		// Frames still queued at break apart are released, not delivered.
+		CHECK(cs.sequences.size() <= FrameCount);
+		for (size_t i = 1; i < cs.sequences.size(); i++) {
+			CHECK(cs.sequences[i - 1] < cs.sequences[i]);
+		}
+	}
+
+	// Queued or not, every frame must have been released.
+	CHECK(g_destroyed == FrameCount);
+}
+
+TEST_CASE("u_sink_queue unbounded")
+{
+	constexpr uint32_t FrameCount = 100;
+
+	struct xrt_frame_context xfctx = {};
+	counting_sink cs;
+	g_destroyed = 0;
+
+	struct xrt_frame_sink *xfs = create_queue(&xfctx, 0, &cs);
+
+	// Pushes faster than the queue thread drains, so the ring has to grow.
+	for (uint32_t i = 0; i < FrameCount; i++) {
+		push_and_release(xfs, i);
+	}
+	wait_for(cs.count, FrameCount);
+
+	xrt_frame_context_destroy_nodes(&xfctx);
+
+	REQUIRE(cs.sequences.size() == FrameCount);
+	for (uint32_t i = 0; i < FrameCount; i++) {
+		CHECK(cs.sequences[i] == i);
+	}
+	CHECK(g_destroyed == FrameCount);
+}
+
+/*!
+ * Hidden, run with: tests_sink_queue "[benchmark]"
+ */
+TEST_CASE("u_sink_queue throughput", "[.][benchmark]")
+{
+	constexpr uint32_t FrameCount = 1000;
+
+	// Same frame for every push, so only the queue itself is measured.
+	struct xrt_frame *xf = frame_create(0);
+
+	struct xrt_frame_context xfctx = {};
+	counting_sink cs;
+
+	struct xrt_frame_sink *xfs = create_queue(&xfctx, 4, &cs);
+
+	BENCHMARK("1000 frames")
+	{
+		uint32_t start = cs.count;
+		for (uint32_t i = 0; i < FrameCount; i++) {
+			xrt_sink_push_frame(xfs, xf);
+			// Keep the queue from overflowing, measures hand-off latency.
+			wait_for(cs.count, start + i + 1);
+		}
+		return cs.count.load();
+	};
+
+	xrt_frame_context_destroy_nodes(&xfctx);
+
+	xrt_frame_reference(&xf, nullptr);
+}
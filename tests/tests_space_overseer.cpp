@@ -0,0 +1,225 @@
+// Copyright 2024, Collabora, Ltd.
+// SPDX-License-Identifier: BSL-1.0
+/*!
+ * @file
+ * @brief Space overseer tests.
+ */
+
+#include "xrt/xrt_device.h"
+#include "xrt/xrt_space.h"
+
+#include "os/os_time.h"
+
+#include "util/u_device.h"
+#include "util/u_space_overseer.h"
+
+#include "catch_amalgamated.hpp"
+
+#include <cstdint>
+#include <vector>
+
+
+namespace {
+
+constexpr uint32_t DeviceCount = 5;
+constexpr uint32_t SpaceCount = 64;
+
+struct counting_device
+{
+	struct xrt_device base;
+	uint32_t call_count;
+};
+
+void
+counting_device_get_tracked_pose(struct xrt_device *xdev,
+                                 enum xrt_input_name name,
+                                 uint64_t at_timestamp_ns,
+                                 struct xrt_space_relation *out_relation)
+{
+	struct counting_device *cd = (struct counting_device *)xdev;
+	cd->call_count++;
+
+	*out_relation = XRT_SPACE_RELATION_ZERO;
+	out_relation->pose.orientation.w = 1.f;
+	out_relation->pose.position.x = (float)(at_timestamp_ns % 1000);
+	out_relation->pose.position.y = (float)name;
+	out_relation->relation_flags = (enum xrt_space_relation_flags)(XRT_SPACE_RELATION_POSITION_VALID_BIT |
+	                                                               XRT_SPACE_RELATION_ORIENTATION_VALID_BIT);
+}
+
+void
+counting_device_destroy(struct xrt_device *xdev)
+{
+	u_device_free(xdev);
+}
+
+/*!
+ * Five devices, a head and four "controllers", each with 64 / 5 pose spaces.
+ */
+struct fixture
+{
+	struct u_space_overseer *uso = nullptr;
+	struct xrt_space_overseer *xso = nullptr;
+	struct xrt_device *xdevs[DeviceCount] = {};
+	std::vector<struct xrt_space *> spaces;
+	std::vector<struct xrt_pose> offsets;
+
+	fixture()
+	{
+		for (uint32_t i = 0; i < DeviceCount; i++) {
+			auto *cd = U_DEVICE_ALLOCATE(struct counting_device, U_DEVICE_ALLOC_TRACKING_NONE, 0, 0);
+			cd->base.get_tracked_pose = counting_device_get_tracked_pose;
+			cd->base.destroy = counting_device_destroy;
+			xdevs[i] = &cd->base;
+		}
+
+		uso = u_space_overseer_create(nullptr);
+		// Don't let snapshots age out on a slow machine, the tests set it when they need it.
+		u_space_overseer_set_snapshot_max_age(uso, UINT64_MAX);
+		struct xrt_pose local_offset = XRT_POSE_IDENTITY;
+		u_space_overseer_legacy_setup(uso, xdevs, DeviceCount, xdevs[0], &local_offset, false);
+		xso = (struct xrt_space_overseer *)uso;
+
+		for (uint32_t i = 0; i < SpaceCount; i++) {
+			struct xrt_space *xs = nullptr;
+			auto name = (enum xrt_input_name)(XRT_INPUT_GENERIC_HEAD_POSE + i % 2);
+			xrt_space_overseer_create_pose_space(xso, xdevs[i % DeviceCount], name, &xs);
+			spaces.push_back(xs);
+			offsets.push_back(XRT_POSE_IDENTITY);
+		}
+	}
+
+	~fixture()
+	{
+		for (auto *xs : spaces) {
+			xrt_space_reference(&xs, nullptr);
+		}
+		xrt_space_overseer_destroy(&xso);
+		for (auto *xdev : xdevs) {
+			xrt_device_destroy(&xdev);
+		}
+	}
+
+	uint32_t
+	total_calls() const
+	{
+		uint32_t total = 0;
+		for (auto *xdev : xdevs) {
+			total += ((struct counting_device *)xdev)->call_count;
+		}
+		return total;
+	}
+
+	void
+	locate_all(uint64_t at_timestamp_ns, struct xrt_space_relation *out_relations)
+	{
+		xrt_space_overseer_locate_spaces(xso, xso->semantic.local, &offsets[0], at_timestamp_ns,
+		                                 spaces.data(), SpaceCount, offsets.data(), out_relations);
+	}
+};
+
+} // namespace
+
+
+TEST_CASE("u_space_overseer pose snapshot")
+{
+	fixture f;
+	struct xrt_space_relation relations[SpaceCount];
+
+	uint64_t now_ns = os_monotonic_get_ns();
+
+	f.locate_all(now_ns, relations);
+
+	// Two input names per device at most, resolved once each.
+	CHECK(f.total_calls() <= DeviceCount * 2);
+
+	for (uint32_t i = 0; i < SpaceCount; i++) {
+		CHECK(relations[i].pose.position.x == (float)(now_ns % 1000));
+	}
+
+	SECTION("same timestamp is served from the snapshot")
+	{
+		uint32_t before = f.total_calls();
+		f.locate_all(now_ns, relations);
+
+		struct xrt_space_relation rel;
+		xrt_space_overseer_locate_device(f.xso, f.xso->semantic.local, &f.offsets[0], now_ns,
+		                                 f.xdevs[1], &rel);
+		CHECK(f.total_calls() == before);
+	}
+
+	SECTION("expired snapshot asks the devices again")
+	{
+		u_space_overseer_set_snapshot_max_age(f.uso, 0);
+
+		uint32_t before = f.total_calls();
+		f.locate_all(now_ns, relations);
+		CHECK(f.total_calls() > before);
+	}
+
+	SECTION("new timestamp asks the devices again")
+	{
+		uint32_t before = f.total_calls();
+		f.locate_all(now_ns + 1, relations);
+		CHECK(f.total_calls() > before);
+		CHECK(relations[0].pose.position.x == (float)((now_ns + 1) % 1000));
+	}
+}
+
+TEST_CASE("u_space_overseer locate_spaces duplicates")
+{
+	fixture f;
+
+	// More than fits the on stack table, every space twice with two offsets.
+	std::vector<struct xrt_space *> spaces;
+	std::vector<struct xrt_pose> offsets;
+	for (uint32_t round = 0; round < 4; round++) {
+		for (uint32_t i = 0; i < SpaceCount; i++) {
+			struct xrt_pose offset = XRT_POSE_IDENTITY;
+			offset.position.z = (float)(round % 2);
+			spaces.push_back(f.spaces[i]);
+			offsets.push_back(offset);
+		}
+	}
+	spaces.push_back(nullptr);
+	offsets.push_back(XRT_POSE_IDENTITY);
+
+	uint64_t now_ns = os_monotonic_get_ns();
+	std::vector<struct xrt_space_relation> relations(spaces.size());
+	xrt_space_overseer_locate_spaces(f.xso, f.xso->semantic.local, &f.offsets[0], now_ns, spaces.data(),
+	                                 (uint32_t)spaces.size(), offsets.data(), relations.data());
+
+	for (size_t i = 0; i < spaces.size() - 1; i++) {
+		struct xrt_space_relation rel;
+		xrt_space_overseer_locate_space(f.xso, f.xso->semantic.local, &f.offsets[0], now_ns, spaces[i],
+		                                &offsets[i], &rel);
+		CHECK(relations[i].relation_flags == rel.relation_flags);
+		CHECK(relations[i].pose.position.x == rel.pose.position.x);
+		CHECK(relations[i].pose.position.y == rel.pose.position.y);
+		CHECK(relations[i].pose.position.z == rel.pose.position.z);
+	}
+
+	CHECK(relations.back().relation_flags == XRT_SPACE_RELATION_BITMASK_NONE);
+}
+
+/*!
+ * Hidden, run with: tests_space_overseer "[benchmark]"
+ */
+TEST_CASE("u_space_overseer locate_spaces", "[.][benchmark]")
+{
+	fixture f;
+	struct xrt_space_relation relations[SpaceCount];
+	uint64_t ts = os_monotonic_get_ns();
+
+	BENCHMARK("64 spaces, 5 devices, same timestamp")
+	{
+		f.locate_all(ts, relations);
+		return relations[0].pose.position.x;
+	};
+
+	BENCHMARK("64 spaces, 5 devices, new timestamp")
+	{
+		f.locate_all(++ts, relations);
+		return relations[0].pose.position.x;
+	};
+}
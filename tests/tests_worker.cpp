@@ -6,12 +6,15 @@
  * @author Rylie Pavlik <rylie.pavlik@collabora.com>
  */
 
+#include <util/u_worker.h>
 #include <util/u_worker.hpp>
 
 #include "catch_amalgamated.hpp"
 
+#include <atomic>
 #include <thread>
 #include <chrono>
+#include <vector>
 
 using namespace std::chrono_literals;
 
@@ -130,3 +133,147 @@ TEST_CASE("TaskCollection")
 		CHECK(calledA[2]);
 	}
 }
+
+namespace {
+
+struct Counter
+{
+	std::atomic<uint32_t> count = 0;
+	struct u_worker_group *uwg = nullptr;
+	uint32_t nested = 0;
+};
+
+void
+count_task(void *ptr)
+{
+	auto *c = (Counter *)ptr;
+	c->count++;
+}
+
+void
+nested_task(void *ptr)
+{
+	auto *c = (Counter *)ptr;
+	for (uint32_t i = 0; i < c->nested; i++) {
+		u_worker_group_push(c->uwg, count_task, c);
+	}
+	c->count++;
+}
+
+void
+spin_task(void *ptr)
+{
+	auto *c = (Counter *)ptr;
+	volatile uint32_t x = 0;
+	for (uint32_t i = 0; i < 1000; i++) {
+		x = x + i;
+	}
+	c->count++;
+}
+
+} // namespace
+
+TEST_CASE("u_worker_group")
+{
+	struct u_worker_thread_pool *uwtp = u_worker_thread_pool_create(2, 4, "Test");
+	REQUIRE(uwtp != nullptr);
+
+	struct u_worker_group *uwg = u_worker_group_create(uwtp);
+	Counter c;
+	c.uwg = uwg;
+
+	SECTION("more tasks than the old fixed queue")
+	{
+		for (uint32_t i = 0; i < 10000; i++) {
+			u_worker_group_push(uwg, count_task, &c);
+		}
+		u_worker_group_wait_all(uwg);
+		CHECK(c.count == 10000);
+
+		// The group can be reused.
+		u_worker_group_push(uwg, count_task, &c);
+		u_worker_group_wait_all(uwg);
+		CHECK(c.count == 10001);
+	}
+
+	SECTION("tasks pushing tasks")
+	{
+		c.nested = 10;
+		for (uint32_t i = 0; i < 100; i++) {
+			u_worker_group_push(uwg, nested_task, &c);
+		}
+		u_worker_group_wait_all(uwg);
+		CHECK(c.count == 100 * 11);
+	}
+
+	SECTION("groups waiting from many threads")
+	{
+		constexpr uint32_t Threads = 6;
+		std::vector<Counter> counters(Threads);
+		std::vector<std::thread> threads;
+
+		for (uint32_t t = 0; t < Threads; t++) {
+			threads.emplace_back([&, t] {
+				struct u_worker_group *g = u_worker_group_create(uwtp);
+				for (uint32_t round = 0; round < 50; round++) {
+					for (uint32_t i = 0; i < 20; i++) {
+						u_worker_group_push(g, spin_task, &counters[t]);
+					}
+					u_worker_group_wait_all(g);
+					if (counters[t].count != (round + 1) * 20) {
+						break;
+					}
+				}
+				u_worker_group_reference(&g, nullptr);
+			});
+		}
+
+		for (std::thread &thread : threads) {
+			thread.join();
+		}
+
+		for (const Counter &counter : counters) {
+			CHECK(counter.count == 50 * 20);
+		}
+	}
+
+	u_worker_group_reference(&uwg, nullptr);
+	u_worker_thread_pool_reference(&uwtp, nullptr);
+}
+
+/*!
+ * Hidden, run with: tests_worker "[benchmark]"
+ *
+ * Throughput is many small tasks pushed and waited for at once, latency is a
+ * single task pushed and waited for, like the hand tracking does per frame.
+ */
+TEST_CASE("u_worker_group throughput and latency", "[.][benchmark]")
+{
+	for (uint32_t thread_count : {1, 2, 4, 8, 16, 32}) {
+		struct u_worker_thread_pool *uwtp =
+		    u_worker_thread_pool_create(thread_count - 1, thread_count, "Bench");
+		struct u_worker_group *uwg = u_worker_group_create(uwtp);
+		Counter c;
+
+		std::string name = std::to_string(thread_count) + " threads, 1000 tasks";
+		BENCHMARK(name.c_str())
+		{
+			for (uint32_t i = 0; i < 1000; i++) {
+				u_worker_group_push(uwg, spin_task, &c);
+			}
+			u_worker_group_wait_all(uwg);
+			return c.count.load();
+		};
+
+		name = std::to_string(thread_count) + " threads, 1 task";
+		BENCHMARK(name.c_str())
+		{
+			u_worker_group_push(uwg, count_task, &c);
+			u_worker_group_wait_all(uwg);
+			return c.count.load();
+		};
+
+		u_worker_group_reference(&uwg, nullptr);
+		u_worker_thread_pool_reference(&uwtp, nullptr);
+	}
+}